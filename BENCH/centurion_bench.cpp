@@ -0,0 +1,899 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "argparse.hpp"
+#include "read_xml_config_file.h"
+#include "simulation.h"
+#include "log_file.h"
+#include "thread_pool.h"
+#include "sensors.h"
+#include "crash_check.h"
+#include "agent_index.h"
+#include "agent_store.h"
+#include "collision_detection.h"
+
+/*
+ * centurion_bench - scaling benchmark on generated worlds.
+ *
+ * For every combination of the --agents, --objects and --sensors lists a
+ * world is written as a config, then run for --epochs epochs of the
+ * discrete loop in its own forked process (so the peak RSS is per world
+ * and one world can not warm the next).  Agents are placed at a constant
+ * density so the arena grows with the agent count - or with --clusters
+ * packed into that many swarms of the same size.  The results are one
+ * JSON array in -o.
+ *
+ * With --check-queries nothing is timed - the circle and k nearest queries
+ * of both agent indexes are checked against brute force over the agents
+ * instead, in the same worlds and in lattice worlds full of exact ties.
+ */
+
+/* globals - the same as centurion.cpp */
+global_args_t global_args;
+
+sim_system_t sim_system;
+environment_t environment;
+agent_groups_t agent_groups;
+atons_t atons;
+communication_stack_t comm_stack;
+
+/* agents and objects per square meter of generated world */
+#define BENCH_AGENT_DENSITY 10.0
+#define BENCH_OBJECT_DENSITY 2.0
+#define BENCH_AGENT_RADIUS 0.05
+/* agents per square meter inside a --clusters swarm */
+#define BENCH_CLUSTER_DENSITY 40.0
+#define BENCH_EPOCH_S 0.01
+/* lattice agents just touch - it starts in from the corner so it is not lined up with the index cells */
+#define BENCH_LATTICE_PITCH_IN_M (2 * BENCH_AGENT_RADIUS)
+#define BENCH_LATTICE_ORIGIN_IN_M 2.0
+/* of each kind, before and after the epochs are run */
+#define BENCH_CHECK_QUERIES 500
+
+typedef struct bench_args_t_t bench_args_t;
+struct bench_args_t_t
+{
+	argparse::ArgValue<char*> agents;
+	argparse::ArgValue<char*> objects;
+	argparse::ArgValue<char*> sensors;
+	argparse::ArgValue<char*> control;
+	argparse::ArgValue<char*> agent_index;
+	argparse::ArgValue<char*> output_file;
+	argparse::ArgValue<char*> work_dir;
+	argparse::ArgValue<int> epochs;
+	argparse::ArgValue<int> num_threads;
+	argparse::ArgValue<int> num_clusters;
+	argparse::ArgValue<bool> check_queries;
+	argparse::ArgValue<bool> show_help;
+};
+
+/* what one world sends back to the parent */
+typedef struct bench_result_t_t bench_result_t;
+struct bench_result_t_t
+{
+	short done;
+	int num_epochs;
+	double setup_s;
+	double control_s;
+	double commit_s;
+	double crash_check_s;
+	double log_s;
+	double total_s;
+	long long num_rays;
+};
+
+/* what checking one world's queries sends back */
+typedef struct bench_check_t_t bench_check_t;
+struct bench_check_t_t
+{
+	short done;
+	int num_queries;
+	int num_mismatches;
+};
+
+/* an agent as the brute force sees it */
+typedef struct bench_neighbor_t_t bench_neighbor_t;
+struct bench_neighbor_t_t
+{
+	int sim_object_idx;
+	double distance;
+};
+
+bench_args_t bench_args;
+
+/* prototypes */
+void get_bench_options(int argc, char** argv);
+int split_list(char *list, char ***items);
+double bench_wall_time();
+void write_bench_config(char *file_name, int num_agents, int num_objects, char *sensor, char *control, int num_epochs, char *agent_index, int num_clusters, short lattice);
+void run_bench_world(char *config_file_name, int num_epochs, int num_threads, int result_fd);
+short bench_world(char *config_file_name, int num_epochs, int num_threads, bench_result_t *result, long *peak_rss_kb);
+int check_all_queries(int num_agent_list, char **agent_list, int num_object_list, char **object_list);
+short check_world(char *config_file_name, int num_epochs, bench_check_t *check);
+void run_check_world(char *config_file_name, int num_epochs, int result_fd);
+void check_queries(bench_check_t *check);
+vector_2D_t check_query_point(int query);
+int brute_force_nearest(vector_2D_t *point, int exclude_sim_object_idx, bench_neighbor_t *neighbors);
+int compare_neighbors(const void *a, const void *b);
+void count_circle_hit(int sim_object_idx, void *context);
+
+int main(int argc, char **argv)
+{
+	char **agent_list;
+	char **object_list;
+	char **sensor_list;
+	int num_agent_list;
+	int num_object_list;
+	int num_sensor_list;
+	int i, j, k;
+	short first = TRUE;
+	char config_file_name[4096];
+	FILE *fout;
+
+	get_bench_options(argc, argv);
+
+	num_agent_list = split_list(bench_args.agents, &agent_list);
+	num_object_list = split_list(bench_args.objects, &object_list);
+	num_sensor_list = split_list(bench_args.sensors, &sensor_list);
+
+	if (bench_args.check_queries == true)
+	{
+		int num_failed = check_all_queries(num_agent_list, agent_list, num_object_list, object_list);
+
+		free(agent_list);
+		free(object_list);
+		free(sensor_list);
+
+		return (num_failed == 0) ? 0 : 1;
+	}
+
+	fout = fopen(bench_args.output_file, "w");
+	oassert(fout != NULL);
+	fprintf(fout, "[\n");
+
+	snprintf(config_file_name, sizeof(config_file_name), "%s/centurion_bench_%d.xml", bench_args.work_dir.value(), (int)getpid());
+
+	for (k = 0; k < num_sensor_list; k++)
+	{
+		for (j = 0; j < num_object_list; j++)
+		{
+			for (i = 0; i < num_agent_list; i++)
+			{
+				int num_agents = atoi(agent_list[i]);
+				int num_objects = atoi(object_list[j]);
+				double agent_steps;
+				bench_result_t result;
+				long peak_rss_kb = 0;
+
+				write_bench_config(config_file_name, num_agents, num_objects, sensor_list[k], bench_args.control, bench_args.epochs, bench_args.agent_index, bench_args.num_clusters, FALSE);
+
+				printf("agents %d objects %d sensor %s: ", num_agents, num_objects, sensor_list[k]);
+				fflush(stdout);
+
+				if (bench_world(config_file_name, bench_args.epochs, bench_args.num_threads, &result, &peak_rss_kb) == FALSE)
+				{
+					printf("FAILED\n");
+					fprintf(fout, "%s  {\"agents\": %d, \"objects\": %d, \"sensor\": \"%s\", \"done\": false}", (first == TRUE) ? "" : ",\n", num_agents, num_objects, sensor_list[k]);
+					first = FALSE;
+					continue;
+				}
+
+				/* the overlord is an agent too */
+				agent_steps = (double)(num_agents + 1) * result.num_epochs;
+
+				printf("%.0f agent-steps/s %.0f rays/s %ld KB\n", agent_steps / result.total_s, result.num_rays / result.total_s, peak_rss_kb);
+
+				fprintf(fout, "%s  {\"agents\": %d, \"objects\": %d, \"sensor\": \"%s\", \"control\": \"%s\", \"threads\": %d, \"epochs\": %d, \"done\": true,\n", 
+						(first == TRUE) ? "" : ",\n", num_agents, num_objects, sensor_list[k], bench_args.control.value(), bench_args.num_threads.value(), result.num_epochs);
+				fprintf(fout, "   \"agent_index\": \"%s\", \"clusters\": %d,\n", bench_args.agent_index.value(), bench_args.num_clusters.value());
+				fprintf(fout, "   \"setup_s\": %f, \"total_s\": %f, \"agent_steps_per_s\": %f, \"rays\": %lld, \"rays_per_s\": %f,\n", 
+						result.setup_s, result.total_s, agent_steps / result.total_s, result.num_rays, result.num_rays / result.total_s);
+				fprintf(fout, "   \"ns_per_epoch\": {\"control\": %.0f, \"commit\": %.0f, \"crash_check\": %.0f, \"log\": %.0f},\n", 
+						1e9 * result.control_s / result.num_epochs, 1e9 * result.commit_s / result.num_epochs, 1e9 * result.crash_check_s / result.num_epochs, 1e9 * result.log_s / result.num_epochs);
+				fprintf(fout, "   \"ns_per_agent_step\": {\"control\": %.1f, \"commit\": %.1f, \"crash_check\": %.1f, \"log\": %.1f},\n", 
+						1e9 * result.control_s / agent_steps, 1e9 * result.commit_s / agent_steps, 1e9 * result.crash_check_s / agent_steps, 1e9 * result.log_s / agent_steps);
+				fprintf(fout, "   \"peak_rss_kb\": %ld}", peak_rss_kb);
+				first = FALSE;
+				fflush(fout);
+			}
+		}
+	}
+
+	fprintf(fout, "\n]\n");
+	fclose(fout);
+	unlink(config_file_name);
+
+	printf("Results in %s\n", bench_args.output_file.value());
+
+	free(agent_list);
+	free(object_list);
+	free(sensor_list);
+
+	return 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bench_world)
+ * Runs one world in a child and collects what it measured.  Returns FALSE
+ * if the child died before sending a result.
+ *-----------------------------------------------------------------------*/
+short bench_world(char *config_file_name, int num_epochs, int num_threads, bench_result_t *result, long *peak_rss_kb)
+{
+	int result_pipe[2];
+	int status;
+	pid_t pid;
+	struct rusage usage;
+	ssize_t num_read;
+
+	status = pipe(result_pipe);
+	oassert(status == 0);
+
+	/* so buffered output is not written twice */
+	fflush(NULL);
+
+	pid = fork();
+	oassert(pid >= 0);
+	if (pid == 0)
+	{
+		close(result_pipe[0]);
+		run_bench_world(config_file_name, num_epochs, num_threads, result_pipe[1]);
+		_exit(0);
+	}
+	close(result_pipe[1]);
+
+	memset(result, 0, sizeof(bench_result_t));
+	num_read = read(result_pipe[0], result, sizeof(bench_result_t));
+	close(result_pipe[0]);
+
+	pid = wait4(pid, &status, 0, &usage);
+	oassert(pid > 0);
+	*peak_rss_kb = usage.ru_maxrss;
+
+	return (num_read == sizeof(bench_result_t) && result->done == TRUE) ? TRUE : FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: run_bench_world)
+ * The body of one forked world - the same steps as simulation_loop with
+ * a clock around each phase.
+ *-----------------------------------------------------------------------*/
+void run_bench_world(char *config_file_name, int num_epochs, int num_threads, int result_fd)
+{
+	bench_result_t result;
+	double current_time = 0;
+	double start_time;
+	double phase_time;
+	long long start_rays;
+	int epoch;
+	ssize_t written;
+
+	/* the controls and sensors print every epoch */
+	freopen("/dev/null", "w", stdout);
+
+	memset(&result, 0, sizeof(bench_result_t));
+
+	start_time = bench_wall_time();
+
+	read_config_file(config_file_name);
+
+	sim_system.Fdebug_out = fopen(sim_system.debug_file_out, "w");
+	oassert(sim_system.Fdebug_out != NULL);
+	output_log_open(sim_system.sim_log_file_out);
+
+	srand(sim_system.rand_seed);
+	rand_float_seed(sim_system.rand_seed);
+
+	output_log_header();
+	setup_simulation();
+	thread_pool_start(num_threads);
+
+	result.setup_s = bench_wall_time() - start_time;
+
+	start_rays = num_sensor_beams_cast;
+	start_time = bench_wall_time();
+
+	for (epoch = 0; epoch < num_epochs; epoch++)
+	{
+		current_time += environment.sim_time_computation_epoch_s;
+
+		phase_time = bench_wall_time();
+		output_log_time_step_start(current_time);
+		result.log_s += bench_wall_time() - phase_time;
+
+		phase_time = bench_wall_time();
+		run_agent_controls(current_time);
+		result.control_s += bench_wall_time() - phase_time;
+
+		/* the agent poses are logged as part of the commit */
+		phase_time = bench_wall_time();
+		commit_epoch();
+		result.commit_s += bench_wall_time() - phase_time;
+
+		phase_time = bench_wall_time();
+		check_for_crashes(current_time);
+		result.crash_check_s += bench_wall_time() - phase_time;
+
+		phase_time = bench_wall_time();
+		output_log_time_step_stop();
+		result.log_s += bench_wall_time() - phase_time;
+	}
+
+	result.total_s = bench_wall_time() - start_time;
+	result.num_rays = num_sensor_beams_cast - start_rays;
+	result.num_epochs = num_epochs;
+	result.done = TRUE;
+
+	thread_pool_stop();
+	output_log_footer();
+	fclose(sim_system.Fdebug_out);
+	output_log_close();
+
+	written = write(result_fd, &result, sizeof(bench_result_t));
+	oassert(written == sizeof(bench_result_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: check_all_queries)
+ * --check-queries - every world of the --agents and --objects lists with
+ * both agent indexes, spread (or --clusters) and on a lattice.  Returns
+ * how many worlds failed or had a mismatch.
+ *-----------------------------------------------------------------------*/
+int check_all_queries(int num_agent_list, char **agent_list, int num_object_list, char **object_list)
+{
+	const char *agent_indexes[2] = {"GRID", "LOOSE_QUADTREE"};
+	char config_file_name[4096];
+	int num_failed = 0;
+	int i, j, ix;
+	short lattice;
+
+	snprintf(config_file_name, sizeof(config_file_name), "%s/centurion_bench_%d.xml", bench_args.work_dir.value(), (int)getpid());
+
+	for (j = 0; j < num_object_list; j++)
+	{
+		for (i = 0; i < num_agent_list; i++)
+		{
+			for (ix = 0; ix < 2; ix++)
+			{
+				for (lattice = FALSE; lattice <= TRUE; lattice++)
+				{
+					int num_agents = atoi(agent_list[i]);
+					int num_objects = atoi(object_list[j]);
+					bench_check_t check;
+
+					write_bench_config(config_file_name, num_agents, num_objects, (char*)"IDEAL_BEAM", bench_args.control, bench_args.epochs, (char*)agent_indexes[ix], bench_args.num_clusters, lattice);
+
+					printf("agents %d objects %d %s%s: ", num_agents, num_objects, agent_indexes[ix], (lattice == TRUE) ? " lattice" : "");
+					fflush(stdout);
+
+					if (check_world(config_file_name, bench_args.epochs, &check) == FALSE)
+					{
+						printf("FAILED\n");
+						num_failed ++;
+						continue;
+					}
+
+					printf("%d queries %d mismatches\n", check.num_queries, check.num_mismatches);
+					if (check.num_mismatches > 0)
+						num_failed ++;
+				}
+			}
+		}
+	}
+
+	unlink(config_file_name);
+
+	return num_failed;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: check_world)
+ * Checks one world in a child like bench_world.  Returns FALSE if the
+ * child died before sending a result.
+ *-----------------------------------------------------------------------*/
+short check_world(char *config_file_name, int num_epochs, bench_check_t *check)
+{
+	int result_pipe[2];
+	int status;
+	pid_t pid;
+	ssize_t num_read;
+
+	status = pipe(result_pipe);
+	oassert(status == 0);
+
+	/* so buffered output is not written twice */
+	fflush(NULL);
+
+	pid = fork();
+	oassert(pid >= 0);
+	if (pid == 0)
+	{
+		close(result_pipe[0]);
+		run_check_world(config_file_name, num_epochs, result_pipe[1]);
+		_exit(0);
+	}
+	close(result_pipe[1]);
+
+	memset(check, 0, sizeof(bench_check_t));
+	num_read = read(result_pipe[0], check, sizeof(bench_check_t));
+	close(result_pipe[0]);
+
+	pid = waitpid(pid, &status, 0);
+	oassert(pid > 0);
+
+	return (num_read == sizeof(bench_check_t) && check->done == TRUE) ? TRUE : FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: run_check_world)
+ * The body of one forked check - the queries are checked as the world is
+ * set up and again after num_epochs epochs have moved the agents through
+ * the index.
+ *-----------------------------------------------------------------------*/
+void run_check_world(char *config_file_name, int num_epochs, int result_fd)
+{
+	bench_check_t check;
+	double current_time = 0;
+	int epoch;
+	ssize_t written;
+
+	/* the controls and sensors print every epoch */
+	freopen("/dev/null", "w", stdout);
+
+	memset(&check, 0, sizeof(bench_check_t));
+
+	read_config_file(config_file_name);
+
+	sim_system.Fdebug_out = fopen(sim_system.debug_file_out, "w");
+	oassert(sim_system.Fdebug_out != NULL);
+	output_log_open(sim_system.sim_log_file_out);
+
+	srand(sim_system.rand_seed);
+	rand_float_seed(sim_system.rand_seed);
+
+	output_log_header();
+	setup_simulation();
+
+	check_queries(&check);
+
+	for (epoch = 0; epoch < num_epochs; epoch++)
+	{
+		current_time += environment.sim_time_computation_epoch_s;
+
+		output_log_time_step_start(current_time);
+		run_agent_controls(current_time);
+		commit_epoch();
+		check_for_crashes(current_time);
+		output_log_time_step_stop();
+	}
+
+	check_queries(&check);
+	check.done = TRUE;
+
+	output_log_footer();
+	fclose(sim_system.Fdebug_out);
+	output_log_close();
+
+	written = write(result_fd, &check, sizeof(bench_check_t));
+	oassert(written == sizeof(bench_check_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: check_queries)
+ * BENCH_CHECK_QUERIES circle and k nearest queries against brute force.
+ * k goes from 1 to more than there are agents and every other k nearest
+ * query excludes an agent.
+ *-----------------------------------------------------------------------*/
+void check_queries(bench_check_t *check)
+{
+	bench_neighbor_t *neighbors = (bench_neighbor_t*)malloc(sizeof(bench_neighbor_t) * (agent_store.num_agents + 1));
+	int *found = (int*)malloc(sizeof(int) * (agent_store.num_agents + 2));
+	double *distances = (double*)malloc(sizeof(double) * (agent_store.num_agents + 2));
+	int *hits = (int*)malloc(sizeof(int) * num_sim_objects);
+	int num_physical = 0;
+	int query, i;
+
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		if (agent_store.not_physical[i] == FALSE)
+			num_physical ++;
+	}
+
+	for (query = 0; query < BENCH_CHECK_QUERIES; query++)
+	{
+		circle_t circle;
+		short mismatch = FALSE;
+
+		circle.center = check_query_point(query);
+		circle.radius = rand_float() * 0.5;
+
+		memset(hits, 0, sizeof(int) * num_sim_objects);
+		agent_index_query_circle(&circle, count_circle_hit, (void*)hits);
+
+		/* every physical agent touching it once and nothing else */
+		for (i = 0; i < num_sim_objects; i++)
+		{
+			int expected = 0;
+
+			if (sim_objects[i]->type == AGENT && agent_store.not_physical[sim_objects[i]->agent->agent_idx] == FALSE)
+			{
+				circle_t c = agent_store_circle(&agent_store, sim_objects[i]->agent->agent_idx);
+
+				expected = (circles_collide(&c, &circle) == TRUE) ? 1 : 0;
+			}
+			if (hits[i] != expected)
+				mismatch = TRUE;
+		}
+
+		check->num_queries ++;
+		if (mismatch == TRUE)
+			check->num_mismatches ++;
+	}
+
+	for (query = 0; query < BENCH_CHECK_QUERIES; query++)
+	{
+		const int ks[3] = {1, 2, 8};
+		vector_2D_t point = check_query_point(query);
+		int exclude_sim_object_idx = -1;
+		int k = (query % 4 < 3) ? ks[query % 4] : num_physical + 2;
+		int num_expected;
+		int num_found;
+
+		if (query % 2 == 1 && agent_store.num_agents > 0)
+		{
+			int agent_idx = (int)(rand_float() * agent_store.num_agents) % agent_store.num_agents;
+
+			exclude_sim_object_idx = agent_store.agents[agent_idx]->sim_object_idx;
+		}
+
+		num_expected = brute_force_nearest(&point, exclude_sim_object_idx, neighbors);
+		if (num_expected > k)
+			num_expected = k;
+
+		num_found = agent_index_k_nearest(&point, k, exclude_sim_object_idx, found, distances);
+
+		check->num_queries ++;
+		if (num_found != num_expected)
+		{
+			check->num_mismatches ++;
+			continue;
+		}
+		for (i = 0; i < num_found; i++)
+		{
+			if (found[i] != neighbors[i].sim_object_idx || distances[i] != neighbors[i].distance)
+			{
+				check->num_mismatches ++;
+				break;
+			}
+		}
+	}
+
+	free(neighbors);
+	free(found);
+	free(distances);
+	free(hits);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: check_query_point)
+ * In turn anywhere in the world, on an agent, or on that agent snapped to
+ * half the lattice pitch - between lattice agents the distances tie.
+ *-----------------------------------------------------------------------*/
+vector_2D_t check_query_point(int query)
+{
+	vector_2D_t point;
+	int agent_idx = (int)(rand_float() * agent_store.num_agents) % agent_store.num_agents;
+
+	if (query % 3 == 0 || agent_store.not_physical[agent_idx] == TRUE)
+	{
+		point.x = rand_float() * environment.real_size_x_in_m;
+		point.y = rand_float() * environment.real_size_y_in_m;
+	}
+	else
+	{
+		point = agent_store_circle(&agent_store, agent_idx).center;
+		if (query % 3 == 2)
+		{
+			point.x = round(point.x / (BENCH_LATTICE_PITCH_IN_M / 2)) * (BENCH_LATTICE_PITCH_IN_M / 2);
+			point.y = round(point.y / (BENCH_LATTICE_PITCH_IN_M / 2)) * (BENCH_LATTICE_PITCH_IN_M / 2);
+		}
+	}
+
+	return point;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: brute_force_nearest)
+ * Every physical agent but the excluded one by the edge distance of
+ * agent_index_k_nearest, nearest first and ties to the lower sim object.
+ * Returns how many there are.
+ *-----------------------------------------------------------------------*/
+int brute_force_nearest(vector_2D_t *point, int exclude_sim_object_idx, bench_neighbor_t *neighbors)
+{
+	int num_neighbors = 0;
+	int i;
+
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		circle_t c;
+
+		if (agent_store.not_physical[i] == TRUE || agent_store.agents[i]->sim_object_idx == exclude_sim_object_idx)
+			continue;
+
+		c = agent_store_circle(&agent_store, i);
+		neighbors[num_neighbors].sim_object_idx = agent_store.agents[i]->sim_object_idx;
+		neighbors[num_neighbors].distance = maximum(0, sqrt((point->x - c.center.x) * (point->x - c.center.x) + (point->y - c.center.y) * (point->y - c.center.y)) - c.radius);
+		num_neighbors ++;
+	}
+
+	qsort(neighbors, num_neighbors, sizeof(bench_neighbor_t), compare_neighbors);
+
+	return num_neighbors;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: compare_neighbors)
+ *-----------------------------------------------------------------------*/
+int compare_neighbors(const void *a, const void *b)
+{
+	const bench_neighbor_t *na = (const bench_neighbor_t*)a;
+	const bench_neighbor_t *nb = (const bench_neighbor_t*)b;
+
+	if (na->distance != nb->distance)
+		return (na->distance < nb->distance) ? -1 : 1;
+
+	return na->sim_object_idx - nb->sim_object_idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: count_circle_hit)
+ *-----------------------------------------------------------------------*/
+void count_circle_hit(int sim_object_idx, void *context)
+{
+	int *hits = (int*)context;
+
+	hits[sim_object_idx] ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: write_bench_config)
+ * A square world at a constant agent and object density with an overlord
+ * group and one group of single sensor agents.  Logs go to /dev/null so
+ * only the cost of formatting them is measured.  With num_clusters the
+ * agents are spread evenly over disks of BENCH_CLUSTER_DENSITY around
+ * random centers instead of over the whole world, and with lattice they
+ * sit on a square lattice of BENCH_LATTICE_PITCH_IN_M in from the corner.
+ *-----------------------------------------------------------------------*/
+void write_bench_config(char *file_name, int num_agents, int num_objects, char *sensor, char *control, int num_epochs, char *agent_index, int num_clusters, short lattice)
+{
+	FILE *fconfig;
+	double size_in_m;
+	double cluster_radius_in_m = 0;
+	double *cluster_x = NULL;
+	double *cluster_y = NULL;
+	/* too few lattice points so some agents are on top of each other */
+	int lattice_side = (int)ceil(sqrt(0.75 * num_agents));
+	int i;
+
+	size_in_m = sqrt(num_agents / BENCH_AGENT_DENSITY);
+	if (sqrt(num_objects / BENCH_OBJECT_DENSITY) > size_in_m)
+		size_in_m = sqrt(num_objects / BENCH_OBJECT_DENSITY);
+	if (size_in_m < 1)
+		size_in_m = 1;
+	if (lattice == TRUE && 2 * BENCH_LATTICE_ORIGIN_IN_M + lattice_side * BENCH_LATTICE_PITCH_IN_M > size_in_m)
+		size_in_m = 2 * BENCH_LATTICE_ORIGIN_IN_M + lattice_side * BENCH_LATTICE_PITCH_IN_M;
+
+	/* the same world every time for a given size */
+	rand_float_seed(num_agents * 7919 + num_objects);
+
+	fconfig = fopen(file_name, "w");
+	oassert(fconfig != NULL);
+
+	fprintf(fconfig, "<centurion_config>\n");
+	fprintf(fconfig, "<system><simulation_type>discrete</simulation_type><rand_seed>1</rand_seed><debug_file_out>/dev/null</debug_file_out><sim_log_file_out>/dev/null</sim_log_file_out></system>\n");
+	fprintf(fconfig, "<environment><real_size_x_in_m>%f</real_size_x_in_m><real_size_y_in_m>%f</real_size_y_in_m><sim_grid_size_in_m>0.1</sim_grid_size_in_m><agent_index>%s</agent_index>", size_in_m, size_in_m, agent_index);
+	fprintf(fconfig, "<sim_time_s>%f</sim_time_s><sim_time_computation_epoch_s>%f</sim_time_computation_epoch_s><boundary_walls>FALSE</boundary_walls>\n", num_epochs * BENCH_EPOCH_S, BENCH_EPOCH_S);
+	fprintf(fconfig, "<objects><num_objects>%d</num_objects>\n", num_objects);
+	for (i = 0; i < num_objects; i++)
+	{
+		if (rand_float() < 0.5)
+			fprintf(fconfig, "<object><circle><x>%f</x><y>%f</y><radius>%f</radius></circle></object>\n", 
+					rand_float() * size_in_m, rand_float() * size_in_m, 0.01 + rand_float() * 0.09);
+		else
+			fprintf(fconfig, "<object><rectangle><center_x>%f</center_x><center_y>%f</center_y><halfExtend_x>%f</halfExtend_x><halfExtend_y>%f</halfExtend_y><rotation>%f</rotation></rectangle></object>\n", 
+					rand_float() * size_in_m, rand_float() * size_in_m, 0.01 + rand_float() * 0.19, 0.01 + rand_float() * 0.19, rand_float() * 90);
+	}
+	fprintf(fconfig, "</objects></environment>\n");
+
+	fprintf(fconfig, "<agents><num_agent_groups>2</num_agent_groups>\n");
+	fprintf(fconfig, "<agent_group><num_agents>1</num_agents><control><control_algorithm>OVERLORD</control_algorithm></control></agent_group>\n");
+	fprintf(fconfig, "<agent_group><num_agents>%d</num_agents><initialization_of_agents><list>\n", num_agents);
+	if (num_clusters > 0)
+	{
+		cluster_radius_in_m = sqrt(num_agents / (double)num_clusters / BENCH_CLUSTER_DENSITY / M_PI);
+		cluster_x = (double*)malloc(sizeof(double) * num_clusters);
+		cluster_y = (double*)malloc(sizeof(double) * num_clusters);
+		/* the swarms start inside the world */
+		for (i = 0; i < num_clusters; i++)
+		{
+			cluster_x[i] = cluster_radius_in_m + rand_float() * fmax(0, size_in_m - 2 * cluster_radius_in_m);
+			cluster_y[i] = cluster_radius_in_m + rand_float() * fmax(0, size_in_m - 2 * cluster_radius_in_m);
+		}
+	}
+	for (i = 0; i < num_agents; i++)
+	{
+		if (lattice == TRUE)
+		{
+			fprintf(fconfig, "<x>%f</x><y>%f</y><angle>%f</angle>\n", BENCH_LATTICE_ORIGIN_IN_M + (i % lattice_side) * BENCH_LATTICE_PITCH_IN_M, BENCH_LATTICE_ORIGIN_IN_M + (i / lattice_side % lattice_side) * BENCH_LATTICE_PITCH_IN_M, rand_float() * 2 * M_PI);
+		}
+		else if (num_clusters > 0)
+		{
+			/* uniform over the disk */
+			double distance = cluster_radius_in_m * sqrt(rand_float());
+			double direction = rand_float() * 2 * M_PI;
+
+			fprintf(fconfig, "<x>%f</x><y>%f</y><angle>%f</angle>\n", cluster_x[i % num_clusters] + distance * cos(direction), cluster_y[i % num_clusters] + distance * sin(direction), rand_float() * 2 * M_PI);
+		}
+		else
+		{
+			fprintf(fconfig, "<x>%f</x><y>%f</y><angle>%f</angle>\n", rand_float() * size_in_m, rand_float() * size_in_m, rand_float() * 2 * M_PI);
+		}
+	}
+	free(cluster_x);
+	free(cluster_y);
+	fprintf(fconfig, "</list></initialization_of_agents>\n");
+	fprintf(fconfig, "<object><circle><x>0</x><y>0</y><radius>%f</radius></circle></object>\n", BENCH_AGENT_RADIUS);
+	fprintf(fconfig, "<sensors><num_sensors>1</num_sensors><sensor><type>%s</type><direction_on_agent>0</direction_on_agent><sim_time_computation_epoch_s>0.1</sim_time_computation_epoch_s></sensor></sensors>\n", sensor);
+	fprintf(fconfig, "<actuators><num_actuators>1</num_actuators><actuator><type>IDEAL_TWO_WHEEL</type></actuator></actuators>\n");
+	fprintf(fconfig, "<control><control_algorithm>%s</control_algorithm></control></agent_group></agents>\n", control);
+	fprintf(fconfig, "</centurion_config>\n");
+
+	fclose(fconfig);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: split_list)
+ * Splits a comma separated list in place.  Returns the number of items.
+ *-----------------------------------------------------------------------*/
+int split_list(char *list, char ***items)
+{
+	int num_items = 0;
+	char *item;
+
+	*items = (char**)malloc(sizeof(char*) * (strlen(list) + 1));
+	for (item = strtok(list, ","); item != NULL; item = strtok(NULL, ","))
+	{
+		(*items)[num_items] = item;
+		num_items ++;
+	}
+
+	return num_items;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bench_wall_time)
+ *-----------------------------------------------------------------------*/
+double bench_wall_time()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*---------------------------------------------------------------------------------------------
+ * (function: get_bench_options)
+ *-------------------------------------------------------------------------------------------*/
+void get_bench_options(int argc, char** argv) 
+{
+	auto parser = argparse::ArgumentParser(argv[0]);
+
+	global_args.program_name = parser.prog();
+
+	parser.add_argument(bench_args.agents, "--agents")
+		.help("Comma separated agent counts")
+		.default_value("1,10,100,1000,10000,100000")
+		.metavar("COUNTS")
+		;
+
+	parser.add_argument(bench_args.objects, "--objects")
+		.help("Comma separated static object counts")
+		.default_value("0,10,100,1000,10000")
+		.metavar("COUNTS")
+		;
+
+	parser.add_argument(bench_args.sensors, "--sensors")
+		.help("Comma separated sensor types")
+		.default_value("IDEAL_BEAM,ULTRASONIC,IR")
+		.metavar("TYPES")
+		;
+
+	parser.add_argument(bench_args.control, "--control")
+		.help("Control algorithm of the agents")
+		.default_value("BASIC_AVOID_ICRA")
+		.metavar("CONTROL")
+		;
+
+	parser.add_argument(bench_args.agent_index, "--agent-index")
+		.help("GRID or LOOSE_QUADTREE - what finds the agents")
+		.default_value("GRID")
+		.metavar("INDEX")
+		;
+
+	parser.add_argument(bench_args.num_clusters, "--clusters")
+		.help("Packs the agents into this many swarms - 0 spreads them over the world")
+		.default_value("0")
+		.metavar("NUM_CLUSTERS")
+		;
+
+	parser.add_argument(bench_args.check_queries, "--check-queries")
+		.help("Checks the circle and k nearest agent queries against brute force instead of timing")
+		.action(argparse::Action::STORE_TRUE)
+		.default_value("false")
+		;
+
+	parser.add_argument(bench_args.epochs, "--epochs")
+		.help("Epochs run in each world")
+		.default_value("50")
+		.metavar("NUM_EPOCHS")
+		;
+
+	parser.add_argument(bench_args.num_threads, "--threads")
+		.help("Number of threads sharing the agents each epoch")
+		.default_value("1")
+		.metavar("NUM_THREADS")
+		;
+
+	parser.add_argument(bench_args.work_dir, "--work-dir")
+		.help("Where the generated configs are written")
+		.default_value("/tmp")
+		.metavar("DIR")
+		;
+
+	parser.add_argument(bench_args.output_file, "-o")
+		.help("JSON results file")
+		.default_value("centurion_bench.json")
+		.metavar("OUTPUT_FILE_PATH")
+		;
+
+	parser.add_argument(bench_args.show_help, "-h")
+		.help("Display this help message")
+		.action(argparse::Action::HELP)
+		;
+
+	parser.parse_args(argc, argv);
+}
@@ -0,0 +1,280 @@
+#Reader, writer and converters for the binary centurion sim log
+#(<sim_log_format>binary</sim_log_format> or binary32 in the config).
+#The layout is described at the top of SRC/log_file_binary.cpp.
+#
+#Usage:
+#  python3 centurion_binary_log.py to_xml log_file.out log_file.xml
+#  python3 centurion_binary_log.py to_binary log_file.xml log_file.out [32]
+#  python3 centurion_binary_log.py reconstruct log_file.out log_file.xml [step_in_s]
+#
+#to_xml gives the same file the xml log would have been so the visualizer
+#and other xml tools keep working.
+#
+#reconstruct reads a binary or xml log written with the level of detail
+#options (<sim_log_every_epochs>, <sim_log_changes_only>, ...) and writes an
+#xml log with every agent in every step.  Agents left out of a step keep
+#their last pose.  With step_in_s the steps are resampled every step_in_s
+#seconds and the poses interpolated between the logged ones.
+
+import bisect
+import math
+import struct
+import sys
+import xml.etree.ElementTree as ET
+
+LOG_MAGIC = b"CENTLOG\0"
+BEAM_MAGIC = b"CENTBEAM"
+LOG_VERSION = 1
+CIRCLE = 0
+RECTANGLE = 1
+
+
+def float_code(float_bytes):
+    return "f" if float_bytes == 4 else "d"
+
+
+def read_binary_log(file_name):
+    """Returns a dict with the header, 'objects' and 'steps'.
+    Each step is (time_at, [(agent_id, x, y, angle_in_degrees), ...])."""
+    with open(file_name, "rb") as fin:
+        data = fin.read()
+
+    if data[0:8] != LOG_MAGIC:
+        raise ValueError(file_name + " is not a binary centurion log")
+    version, float_bytes = struct.unpack_from("<ii", data, 8)
+    if version != LOG_VERSION:
+        raise ValueError("unsupported binary log version " + str(version))
+    time_step_in_s, sim_x_in_m, sim_y_in_m, agent_radius, num_objects = struct.unpack_from("<ddddi", data, 16)
+    offset = 16 + 4 * 8 + 4
+
+    log = {"float_bytes": float_bytes, "time_step_in_s": time_step_in_s, "sim_x_in_m": sim_x_in_m,
+           "sim_y_in_m": sim_y_in_m, "agent_radius": agent_radius, "objects": [], "steps": []}
+
+    for i in range(num_objects):
+        obj_type, x, y, a, b, c = struct.unpack_from("<iddddd", data, offset)
+        offset += 4 + 5 * 8
+        if obj_type == CIRCLE:
+            log["objects"].append({"type": "circle", "x": x, "y": y, "radius": a})
+        else:
+            log["objects"].append({"type": "rectangle", "x": x, "y": y, "halfx": a, "halfy": b, "rotation": c})
+
+    record = struct.Struct("<i" + 3 * float_code(float_bytes))
+    while offset < len(data):
+        time_at, num_agents = struct.unpack_from("<di", data, offset)
+        offset += 12
+        agents = list(record.iter_unpack(data[offset:offset + num_agents * record.size]))
+        offset += num_agents * record.size
+        log["steps"].append((time_at, agents))
+
+    return log
+
+
+def read_binary_beams(file_name):
+    """Returns [(time_at, beam_x1, beam_y1, beam_x2, beam_y2, point_intersect_x, point_intersect_y, distance), ...]"""
+    with open(file_name, "rb") as fin:
+        data = fin.read()
+
+    if data[0:8] != BEAM_MAGIC:
+        raise ValueError(file_name + " is not a binary centurion beam log")
+    version, float_bytes = struct.unpack_from("<ii", data, 8)
+    if version != LOG_VERSION:
+        raise ValueError("unsupported binary log version " + str(version))
+
+    record = struct.Struct("<d" + 7 * float_code(float_bytes))
+    return list(record.iter_unpack(data[16:]))
+
+
+def write_binary_log(log, beams, file_name, float_bytes=8):
+    """Writes what read_binary_log/read_binary_beams return (or read_xml_log)"""
+    code = float_code(float_bytes)
+    with open(file_name, "wb") as fout:
+        fout.write(LOG_MAGIC)
+        fout.write(struct.pack("<ii", LOG_VERSION, float_bytes))
+        fout.write(struct.pack("<ddddi", log["time_step_in_s"], log["sim_x_in_m"], log["sim_y_in_m"], log["agent_radius"], len(log["objects"])))
+        for obj in log["objects"]:
+            if obj["type"] == "circle":
+                fout.write(struct.pack("<iddddd", CIRCLE, obj["x"], obj["y"], obj["radius"], 0, 0))
+            else:
+                fout.write(struct.pack("<iddddd", RECTANGLE, obj["x"], obj["y"], obj["halfx"], obj["halfy"], obj["rotation"]))
+        record = struct.Struct("<i" + 3 * code)
+        for time_at, agents in log["steps"]:
+            fout.write(struct.pack("<di", time_at, len(agents)))
+            for agent in agents:
+                fout.write(record.pack(*agent))
+
+    with open(file_name + ".beams", "wb") as fout:
+        fout.write(BEAM_MAGIC)
+        fout.write(struct.pack("<ii", LOG_VERSION, float_bytes))
+        record = struct.Struct("<d" + 7 * code)
+        for beam in beams:
+            fout.write(record.pack(*beam))
+
+
+def read_xml_log(file_name):
+    """Reads the xml sim log into the same shape as read_binary_log and read_binary_beams"""
+    log = {"float_bytes": 8, "objects": [], "steps": []}
+    beams = []
+    for event, elem in ET.iterparse(file_name, events=("end",)):
+        tag = elem.tag
+        if tag in ("time_step_in_s", "sim_x_in_m", "sim_y_in_m", "agent_radius"):
+            log[tag] = float(elem.text)
+        elif tag == "circle":
+            log["objects"].append({"type": "circle", "x": float(elem.findtext("x")), "y": float(elem.findtext("y")),
+                                   "radius": float(elem.findtext("radius"))})
+        elif tag == "rectangle":
+            log["objects"].append({"type": "rectangle", "x": float(elem.findtext("x")), "y": float(elem.findtext("y")),
+                                   "halfx": float(elem.findtext("halfx")), "halfy": float(elem.findtext("halfy")),
+                                   "rotation": float(elem.findtext("rotation"))})
+        elif tag == "time_step":
+            time_at = float(elem.findtext("time_at"))
+            agents = []
+            for agent in elem.iter("agent"):
+                agents.append((int(agent.findtext("agent_id")), float(agent.findtext("x")), float(agent.findtext("y")),
+                               float(agent.findtext("angle"))))
+            for beam in elem.iter("sensor_beam"):
+                beams.append((time_at,) + tuple(float(beam.findtext(name)) for name in
+                             ("beam_x1", "beam_y1", "beam_x2", "beam_y2", "point_intersect_x", "point_intersect_y", "distance")))
+            log["steps"].append((time_at, agents))
+            elem.clear()
+    return log, beams
+
+
+def write_xml_log(log, beams, file_name):
+    """Writes the xml sim log the way centurion does"""
+    tab = "    "
+    beam_idx = 0
+    with open(file_name, "w") as fout:
+        fout.write("<data_log>\n")
+        fout.write(tab + "<time_step_in_s>%f</time_step_in_s>\n" % log["time_step_in_s"])
+        fout.write(tab + "<sim_x_in_m>%f</sim_x_in_m>\n" % log["sim_x_in_m"])
+        fout.write(tab + "<sim_y_in_m>%f</sim_y_in_m>\n" % log["sim_y_in_m"])
+        fout.write(tab + "<agent_radius>%f</agent_radius>\n" % log["agent_radius"])
+        fout.write(tab + "<object>\n")
+        for obj in log["objects"]:
+            if obj["type"] == "circle":
+                fout.write(2 * tab + "<circle>\n")
+                for name in ("x", "y", "radius"):
+                    fout.write(3 * tab + "<%s>%f</%s>\n" % (name, obj[name], name))
+                fout.write(2 * tab + "</circle>\n")
+            else:
+                fout.write(2 * tab + "<rectangle>\n")
+                for name in ("x", "y", "halfx", "halfy", "rotation"):
+                    fout.write(3 * tab + "<%s>%f</%s>\n" % (name, obj[name], name))
+                fout.write(2 * tab + "</rectangle>\n")
+        fout.write(tab + "</object>\n")
+
+        for time_at, agents in log["steps"]:
+            fout.write(tab + "<time_step>\n")
+            fout.write(2 * tab + "<time_at>%f</time_at>\n" % time_at)
+            # the beams of a step come before its agents
+            while beam_idx < len(beams) and beams[beam_idx][0] == time_at:
+                beam = beams[beam_idx]
+                fout.write(2 * tab + "<sensor_beam>\n")
+                fout.write(3 * tab + "<beam_x1>%f</beam_x1><beam_y1>%f</beam_y1>\n" % (beam[1], beam[2]))
+                fout.write(3 * tab + "<beam_x2>%f</beam_x2><beam_y2>%f</beam_y2>\n" % (beam[3], beam[4]))
+                fout.write(3 * tab + "<point_intersect_x>%f</point_intersect_x><point_intersect_y>%f</point_intersect_y>\n" % (beam[5], beam[6]))
+                fout.write(3 * tab + "<distance>%f</distance>\n" % beam[7])
+                fout.write(2 * tab + "</sensor_beam>\n")
+                beam_idx += 1
+            for agent_id, x, y, angle in agents:
+                fout.write(2 * tab + "<agent>\n")
+                fout.write(3 * tab + "<agent_id>%d</agent_id>\n" % agent_id)
+                fout.write(3 * tab + "<x>%f</x>\n" % x)
+                fout.write(3 * tab + "<y>%f</y>\n" % y)
+                fout.write(3 * tab + "<angle>%f</angle>\n" % angle)
+                fout.write(2 * tab + "</agent>\n")
+            fout.write(tab + "</time_step>\n")
+        fout.write("</data_log>\n")
+
+
+def read_any_log(file_name):
+    """read_binary_log and read_binary_beams or read_xml_log by what the file starts with"""
+    with open(file_name, "rb") as fin:
+        magic = fin.read(8)
+    if magic == LOG_MAGIC:
+        return read_binary_log(file_name), read_binary_beams(file_name + ".beams")
+    return read_xml_log(file_name)
+
+
+def reconstruct_steps(log, step_in_s=None):
+    """Returns a copy of log where every step has every agent seen so far.
+    Without step_in_s the logged steps are kept and a missing agent keeps its
+    last pose.  With step_in_s there is a step every step_in_s seconds from
+    the first logged step to the last and each pose is linearly interpolated
+    between the logged ones (angles the shorter way round).  An agent left
+    out of a step had not moved so it is held still until one logging
+    interval before it shows up again."""
+    out = dict(log)
+    steps = log["steps"]
+    out["steps"] = []
+    if not steps:
+        return out
+
+    if step_in_s is None:
+        last_pose = {}
+        for time_at, agents in steps:
+            for agent in agents:
+                last_pose[agent[0]] = agent
+            out["steps"].append((time_at, [last_pose[agent_id] for agent_id in sorted(last_pose)]))
+        return out
+
+    # the logging interval is the smallest gap between steps with agents in them
+    agent_times = [time_at for time_at, agents in steps if agents]
+    gaps = [t1 - t0 for t0, t1 in zip(agent_times, agent_times[1:])]
+    interval = min(gaps) if gaps else 0.0
+
+    # per agent the times and poses it was logged at
+    tracks = {}
+    for time_at, agents in steps:
+        for agent_id, x, y, angle in agents:
+            track = tracks.setdefault(agent_id, ([], []))
+            if track[0] and time_at - interval > track[0][-1] + 1e-9:
+                track[0].append(time_at - interval)
+                track[1].append(track[1][-1])
+            track[0].append(time_at)
+            track[1].append((x, y, angle))
+
+    out["time_step_in_s"] = step_in_s
+    first_time = steps[0][0]
+    num_steps = int(math.floor((steps[-1][0] - first_time) / step_in_s + 1e-9)) + 1
+    for i in range(num_steps):
+        time_at = first_time + i * step_in_s
+        agents = []
+        for agent_id in sorted(tracks):
+            times, poses = tracks[agent_id]
+            after = bisect.bisect_right(times, time_at)
+            if after == 0:
+                continue  # not logged yet
+            x0, y0, a0 = poses[after - 1]
+            if after == len(times):
+                agents.append((agent_id, x0, y0, a0))
+                continue
+            x1, y1, a1 = poses[after]
+            f = (time_at - times[after - 1]) / (times[after] - times[after - 1])
+            turn = (a1 - a0 + 180.0) % 360.0 - 180.0
+            agents.append((agent_id, x0 + f * (x1 - x0), y0 + f * (y1 - y0), a0 + f * turn))
+        out["steps"].append((time_at, agents))
+    return out
+
+
+def main():
+    if len(sys.argv) < 4 or sys.argv[1] not in ("to_xml", "to_binary", "reconstruct"):
+        print("Usage: centurion_binary_log.py to_xml <binary log> <xml log>")
+        print("       centurion_binary_log.py to_binary <xml log> <binary log> [32]")
+        print("       centurion_binary_log.py reconstruct <binary or xml log> <xml log> [step_in_s]")
+        sys.exit()
+
+    if sys.argv[1] == "reconstruct":
+        log, beams = read_any_log(sys.argv[2])
+        step_in_s = float(sys.argv[4]) if len(sys.argv) > 4 else None
+        write_xml_log(reconstruct_steps(log, step_in_s), beams, sys.argv[3])
+    elif sys.argv[1] == "to_xml":
+        write_xml_log(read_binary_log(sys.argv[2]), read_binary_beams(sys.argv[2] + ".beams"), sys.argv[3])
+    else:
+        float_bytes = 4 if len(sys.argv) > 4 and sys.argv[4] == "32" else 8
+        log, beams = read_xml_log(sys.argv[2])
+        write_binary_log(log, beams, sys.argv[3], float_bytes)
+
+
+if __name__ == "__main__":
+    main()
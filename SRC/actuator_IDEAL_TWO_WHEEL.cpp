@@ -32,6 +32,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "utils.h"
 
 #include "robot_movement.h"
+#include "control_sensors_actuators.h"
+#include "checkpoint.h"
 
 /* globals */
 
@@ -87,6 +89,7 @@ void actuator_function_IDEAL_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act
 		/* record time of instruction and when should end */
 		actuator_state->last_instruction_time_start = current_time;
 		actuator_state->last_instruction_time_end = current_time + inputs->time_in_s;
+		agent->moving_until_time = actuator_state->last_instruction_time_end;
 
 		/* get direction */
 		if (inputs->left == 1 && inputs->right == 1)
@@ -116,6 +119,10 @@ void actuator_function_IDEAL_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act
 		}
 	}
 
+	/* control may want to know when the instruction is done */
+	if (current_time < actuator_state->last_instruction_time_end)
+		schedule_agent_wake(agent, actuator_state->last_instruction_time_end - environment.sim_time_computation_epoch_s/2);
+
 	/* check to see if instruction is completed */
 	if (current_time < actuator_state->last_instruction_time_end)
 	{
@@ -138,3 +145,24 @@ void actuator_function_IDEAL_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act
 		}
 	}
 }
+
+/*-------------------------------------------------------------------------
+ * (function: actuator_memory_save_IDEAL_TWO_WHEEL)
+ *-----------------------------------------------------------------------*/
+void actuator_memory_save_IDEAL_TWO_WHEEL(void *memory, checkpoint_t *checkpoint)
+{
+	checkpoint_put(checkpoint, memory, sizeof(actuator_state_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: actuator_memory_load_IDEAL_TWO_WHEEL)
+ *-----------------------------------------------------------------------*/
+void* actuator_memory_load_IDEAL_TWO_WHEEL(checkpoint_t *checkpoint)
+{
+	actuator_state_t* actuator_state;
+
+	actuator_state = (actuator_state_t*)malloc(sizeof(actuator_state_t));
+	checkpoint_get(checkpoint, actuator_state, sizeof(actuator_state_t));
+
+	return (void*)actuator_state;
+}
@@ -34,17 +34,20 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #include "robot_movement.h"
 #include "collision_detection.h"
+#include "control_sensors_actuators.h"
+#include "rng.h"
+#include "checkpoint.h"
 
 /* globals */
 
-double turn_angle_in_seconds(double s);
-double go_forward_distance_in_seconds(double s);
-double go_forward_result_angle_in_s(double s); 
+double turn_angle_in_seconds(double s, rng_stream_t *noise);
+double go_forward_distance_in_seconds(double s, rng_stream_t *noise);
+double go_forward_result_angle_in_s(double s, rng_stream_t *noise); 
 
 enum movement {FORWARD, BACKWARDS, RIGHT, LEFT, STOPPED};
 
-typedef struct actuator_state_t_t actuator_state_t;
-struct actuator_state_t_t
+typedef struct two_wheel_state_t_t two_wheel_state_t;
+struct two_wheel_state_t_t
 {
 	movement move_type;
 	double last_instruction_time_start;
@@ -59,18 +62,22 @@ struct actuator_state_t_t
  *-----------------------------------------------------------------------*/
 void actuator_function_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act_inputs_t *inputs, double current_time) 
 {
-	actuator_state_t* actuator_state;
+	two_wheel_state_t* actuator_state;
+	rng_stream_t noise;
 
 	//printf("IDEAL_TWO WHEEL ACTUATOR called\n");
 
+	/* what the wheels do this epoch */
+	agent_noise_stream(&noise, agent, RNG_ACTUATOR_DEVICE(actuator->actuator_idx), current_time);
+
 	if (agent->actuator_memories[actuator->actuator_idx] == NULL)
 	{	
-		actuator_state = (actuator_state_t*)malloc(sizeof(actuator_state_t));
+		actuator_state = (two_wheel_state_t*)malloc(sizeof(two_wheel_state_t));
 		/* velocity is m/s and simulator epoch is a time smaller than seconds so use characterization for epoch */
-		actuator_state->m_per_epoch = go_forward_distance_in_seconds(environment.sim_time_computation_epoch_s);
-		actuator_state->drift_angle_per_epoch = go_forward_result_angle_in_s(environment.sim_time_computation_epoch_s);
+		actuator_state->m_per_epoch = go_forward_distance_in_seconds(environment.sim_time_computation_epoch_s, &noise);
+		actuator_state->drift_angle_per_epoch = go_forward_result_angle_in_s(environment.sim_time_computation_epoch_s, &noise);
 		/* angle is rad/s and simulator epoch is a time smaller than seconds so use characterization for epoc */
-		actuator_state->angle_per_epoch = turn_angle_in_seconds(environment.sim_time_computation_epoch_s);
+		actuator_state->angle_per_epoch = turn_angle_in_seconds(environment.sim_time_computation_epoch_s, &noise);
 
 		actuator_state->last_instruction_time_start = 0;
 		actuator_state->last_instruction_time_end = 0;
@@ -81,7 +88,7 @@ void actuator_function_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act_input
 	else
 	{
 		/* extract memory */
-		actuator_state = (actuator_state_t*)(agent->actuator_memories[actuator->actuator_idx]);
+		actuator_state = (two_wheel_state_t*)(agent->actuator_memories[actuator->actuator_idx]);
 	}
 
 	if (inputs->new_instruction == TRUE)
@@ -90,6 +97,7 @@ void actuator_function_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act_input
 		/* record time of instruction and when should end */
 		actuator_state->last_instruction_time_start = current_time;
 		actuator_state->last_instruction_time_end = current_time + inputs->time_in_s;
+		agent->moving_until_time = actuator_state->last_instruction_time_end;
 
 		/* get direction */
 		if (inputs->left == 1 && inputs->right == 1)
@@ -119,16 +127,20 @@ void actuator_function_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act_input
 		}
 	}
 
+	/* control may want to know when the instruction is done */
+	if (current_time < actuator_state->last_instruction_time_end)
+		schedule_agent_wake(agent, actuator_state->last_instruction_time_end - environment.sim_time_computation_epoch_s/2);
+
 	/* check to see if instruction is completed */
 	if (current_time < actuator_state->last_instruction_time_end)
 	{
 		/* UPDATE characterization of robot */
 		/* velocity is m/s and simulator epoch is a time smaller than seconds so use characterization for epoch */
-		actuator_state->m_per_epoch = go_forward_distance_in_seconds(environment.sim_time_computation_epoch_s);
-		actuator_state->drift_angle_per_epoch = go_forward_result_angle_in_s(environment.sim_time_computation_epoch_s);
+		actuator_state->m_per_epoch = go_forward_distance_in_seconds(environment.sim_time_computation_epoch_s, &noise);
+		actuator_state->drift_angle_per_epoch = go_forward_result_angle_in_s(environment.sim_time_computation_epoch_s, &noise);
 		/* angle is rad/s and simulator epoch is a time smaller than seconds so use characterization for epoc */
-		actuator_state->angle_per_epoch = turn_angle_in_seconds(environment.sim_time_computation_epoch_s);
-		printf("epochs: %f, m/s:%f, drift:%f, angle:%f\n", environment.sim_time_computation_epoch_s, actuator_state->m_per_epoch, actuator_state->drift_angle_per_epoch, actuator_state->angle_per_epoch);
+		actuator_state->angle_per_epoch = turn_angle_in_seconds(environment.sim_time_computation_epoch_s, &noise);
+		//printf("epochs: %f, m/s:%f, drift:%f, angle:%f\n", environment.sim_time_computation_epoch_s, actuator_state->m_per_epoch, actuator_state->drift_angle_per_epoch, actuator_state->angle_per_epoch);
 
 		switch (actuator_state->move_type)
 		{
@@ -150,102 +162,50 @@ void actuator_function_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act_input
 	}
 }
 
-/* GAUSSIAN code from
- * https://kcru.lawsonresearch.ca/research/srk/normalDBN_random.html
- */
-double turn_angle_in_seconds(double s) 
+/* characterization of the wheels - each draw is one gaussian from the
+ * actuator's noise stream */
+double turn_angle_in_seconds(double s, rng_stream_t *noise) 
 {
 	double mu = 237.5288752 * s + 19.28566864;
 	double sigma = 3;
-	double U1, U2, W, mult;
-	static double X1, X2;
-	static int call = 0;
-	
-	if (call == 1)
-	{
-		call = !call;
-	//	return (mu + sigma * (double)X2);
-        	return (degrees_to_radian(mu + sigma * (double)X1));
-	}
-
-	do
-	{
-		U1 = -1 + ((double)rand() / RAND_MAX) * 2;
-		U2 = -1 + ((double)rand() / RAND_MAX) * 2;
-		W = pow(U1, 2) + pow(U2, 2);
-	} while (W >= 1 || W == 0);
-
-	mult = sqrt((-2 * log(W)) / W);
-	X1 = U1 * mult;
-	X2 = U2 * mult;
-
-//	call = !call;
 
-	//return (mu + sigma * (double)X1);
-        return (degrees_to_radian(mu + sigma * (double)X1));
+	return (degrees_to_radian(mu + sigma * rng_gaussian(noise)));
 }
 
-double go_forward_distance_in_seconds(double s) 
+double go_forward_distance_in_seconds(double s, rng_stream_t *noise) 
 {
 	double mu = 22.660707 * s + 1.3405;
 	double sigma = 0.15;
-	double U1, U2, W, mult;
-	static double X1, X2;
-	static int call = 0;
-	
-	if (call == 1)
-	{
-		call = !call;
-	//	return (mu + sigma * (double)X2);
-		return ((mu + sigma * (double)X2)/100);
-	}
 
-	do
-	{
-		U1 = -1 + ((double)rand() / RAND_MAX) * 2;
-		U2 = -1 + ((double)rand() / RAND_MAX) * 2;
-		W = pow(U1, 2) + pow(U2, 2);
-	} while (W >= 1 || W == 0);
+	// In meters
+	return ((mu + sigma * rng_gaussian(noise))/100);
+}
 
-	mult = sqrt((-2 * log(W)) / W);
-	X1 = U1 * mult;
-	X2 = U2 * mult;
+double go_forward_result_angle_in_s(double s, rng_stream_t *noise) 
+{
+	double mu = 4.38 * s + 1.3874;
+	double sigma = 2;	
 
-//	call = !call;
+	return (degrees_to_radian(mu + sigma * rng_gaussian(noise)));
+}
 
-	//return (mu + sigma * (double)X1);
-	// In meters
-	return ((mu + sigma * (double)X1)/100);
+/*-------------------------------------------------------------------------
+ * (function: actuator_memory_save_TWO_WHEEL)
+ *-----------------------------------------------------------------------*/
+void actuator_memory_save_TWO_WHEEL(void *memory, checkpoint_t *checkpoint)
+{
+	checkpoint_put(checkpoint, memory, sizeof(two_wheel_state_t));
 }
 
-double go_forward_result_angle_in_s(double s) 
+/*-------------------------------------------------------------------------
+ * (function: actuator_memory_load_TWO_WHEEL)
+ *-----------------------------------------------------------------------*/
+void* actuator_memory_load_TWO_WHEEL(checkpoint_t *checkpoint)
 {
-        double mu = 4.38 * s + 1.3874;
-        double sigma = 2;	
-        double U1, U2, W, mult;
-        static double X1, X2;
-        static int call = 0;
-
-        if (call == 1)
-        {
-                call = !call;
-//                return (mu + sigma * (double)X2);
-        	return (degrees_to_radian(mu + sigma * (double)X2));
-        }
-
-        do
-        {
-                U1 = -1 + ((double)rand() / RAND_MAX) * 2;
-                U2 = -1 + ((double)rand() / RAND_MAX) * 2;
-                W = pow(U1, 2) + pow(U2, 2);
-        } while (W >= 1 || W == 0);
-
-        mult = sqrt((-2 * log(W)) / W);
-        X1 = U1 * mult;
-        X2 = U2 * mult;
-
-//        call = !call;
-
-//	return (mu + sigma * (double)X1);
-        return (degrees_to_radian(mu + sigma * (double)X1));
+	two_wheel_state_t* actuator_state;
+
+	actuator_state = (two_wheel_state_t*)malloc(sizeof(two_wheel_state_t));
+	checkpoint_get(checkpoint, actuator_state, sizeof(two_wheel_state_t));
+
+	return (void*)actuator_state;
 }
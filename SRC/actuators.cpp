@@ -32,6 +32,7 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "utils.h"
 
 #include "control_sensors_actuators.h"
+#include "profile.h"
 
 /* globals */
 int num_actuator_names = 2; // number of strings below and in enum
@@ -51,6 +52,8 @@ void run_actuator(
 		double current_time
 	)
 {
+	PROFILE_SCOPE(PROFILE_ACTUATOR);
+
 	/* call the control function of the current simulated robot */
 	(*(actuator->fptr_actuator))(actuator, agent, inputs, current_time);	
 }
@@ -71,9 +74,13 @@ void setup_function_for_actuator(actuator_t *actuator, char *function_name)
                 /* PERMUTATION ENCODINGS */
                 case IDEAL_TWO_WHEEL:
                         actuator->fptr_actuator = actuator_function_IDEAL_TWO_WHEEL;
+			actuator->fptr_actuator_memory_save = actuator_memory_save_IDEAL_TWO_WHEEL;
+			actuator->fptr_actuator_memory_load = actuator_memory_load_IDEAL_TWO_WHEEL;
 			break;
                 case TWO_WHEEL:
                         actuator->fptr_actuator = actuator_function_TWO_WHEEL;
+			actuator->fptr_actuator_memory_save = actuator_memory_save_TWO_WHEEL;
+			actuator->fptr_actuator_memory_load = actuator_memory_load_TWO_WHEEL;
 			break;
 		default:
 			printf("EXIT - Agent with no actuator algorithm\n");
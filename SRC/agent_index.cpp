@@ -0,0 +1,308 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "agent_index.h"
+#include "spatial_grid.h"
+#include "loose_quadtree.h"
+#include "agent_store.h"
+#include "collision_detection.h"
+
+/* globals */
+
+/* the k-th nearest must be this much inside the box - an agent outside of it could round to the same distance */
+#define GRID_DISTANCE_SLACK_IN_M 1e-9
+
+/* the grid only has box queries - these carry the circle and k nearest queries through them */
+typedef struct grid_circle_query_t_t grid_circle_query_t;
+struct grid_circle_query_t_t
+{
+	circle_t *circle;
+	void (*fptr_found)(int sim_object_idx, void *context);
+	void *context;
+};
+
+typedef struct grid_nearest_query_t_t grid_nearest_query_t;
+struct grid_nearest_query_t_t
+{
+	vector_2D_t *point;
+	int k;
+	int exclude_sim_object_idx;
+	int *found;
+	double *distances;
+	int num_found;
+};
+
+void grid_circle_found(int sim_object_idx, void *context);
+int grid_k_nearest(vector_2D_t *point, int k, int exclude_sim_object_idx, int *found, double *distances);
+void grid_nearest_found(int sim_object_idx, void *context);
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_build)
+ * The agents are found either with the uniform grid (sim_grid) or the
+ * loose quadtree (sim_quadtree) as environment.agent_index says.  The grid
+ * is cheapest when the agents are spread out, the quadtree keeps its cells
+ * small only where a swarm is clustered.  Only the one picked is built.
+ *-----------------------------------------------------------------------*/
+void agent_index_build()
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		loose_quadtree_build(&sim_quadtree, environment.real_size_x_in_m, environment.real_size_y_in_m);
+	else
+		spatial_grid_build(&sim_grid, environment.sim_grid_size_in_m, environment.real_size_x_in_m, environment.real_size_y_in_m);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_next_version)
+ *-----------------------------------------------------------------------*/
+void agent_index_next_version()
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		loose_quadtree_next_version(&sim_quadtree);
+	else
+		spatial_grid_next_version(&sim_grid);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_update_object)
+ *-----------------------------------------------------------------------*/
+void agent_index_update_object(int sim_object_idx)
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		loose_quadtree_update_object(&sim_quadtree, sim_object_idx);
+	else
+		spatial_grid_update_object(&sim_grid, sim_object_idx);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_version)
+ *-----------------------------------------------------------------------*/
+unsigned int agent_index_version()
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		return sim_quadtree.version;
+	else
+		return sim_grid.version;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_unchanged_since)
+ *-----------------------------------------------------------------------*/
+short agent_index_unchanged_since(rectangle_t *box, unsigned int version)
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		return loose_quadtree_unchanged_since(&sim_quadtree, box, version);
+	else
+		return spatial_grid_unchanged_since(&sim_grid, box, version);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_raycast)
+ *-----------------------------------------------------------------------*/
+double agent_index_raycast(line_segment_t *beam, double (*fptr_hit)(int sim_object_idx, void *context), void *context)
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		return loose_quadtree_raycast(&sim_quadtree, beam, fptr_hit, context);
+	else
+		return spatial_grid_raycast(&sim_grid, beam, fptr_hit, context);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_query_overlap)
+ *-----------------------------------------------------------------------*/
+void agent_index_query_overlap(rectangle_t *box, void (*fptr_found)(int sim_object_idx, void *context), void *context)
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		loose_quadtree_query_overlap(&sim_quadtree, box, fptr_found, context);
+	else
+		spatial_grid_query_overlap(&sim_grid, box, fptr_found, context);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_query_circle)
+ * Calls fptr_found once for each physical agent touching the circle.
+ *-----------------------------------------------------------------------*/
+void agent_index_query_circle(circle_t *circle, void (*fptr_found)(int sim_object_idx, void *context), void *context)
+{
+	grid_circle_query_t query;
+	rectangle_t box;
+
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+	{
+		loose_quadtree_query_circle(&sim_quadtree, circle, fptr_found, context);
+	}
+	else
+	{
+		query.circle = circle;
+		query.fptr_found = fptr_found;
+		query.context = context;
+		box = circle_rectangle_hull(circle);
+		spatial_grid_query_overlap(&sim_grid, &box, grid_circle_found, (void*)&query);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_k_nearest)
+ * The k physical agents whose edges are nearest the point, as
+ * loose_quadtree_k_nearest - nearest first, ties to the lower sim object,
+ * skipping exclude_sim_object_idx (-1 skips none).
+ *
+ * returns how many were found (less than k if there are not that many)
+ *-----------------------------------------------------------------------*/
+int agent_index_k_nearest(vector_2D_t *point, int k, int exclude_sim_object_idx, int *found, double *distances)
+{
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+		return loose_quadtree_k_nearest(&sim_quadtree, point, k, exclude_sim_object_idx, found, distances);
+	else
+		return grid_k_nearest(point, k, exclude_sim_object_idx, found, distances);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: grid_circle_found)
+ * exact test of a grid candidate
+ *-----------------------------------------------------------------------*/
+void grid_circle_found(int sim_object_idx, void *context)
+{
+	grid_circle_query_t *query = (grid_circle_query_t*)context;
+	circle_t c;
+
+	if (sim_objects[sim_object_idx]->type != AGENT || agent_store.not_physical[sim_objects[sim_object_idx]->agent->agent_idx] == TRUE)
+		return;
+
+	c = agent_store_circle(&agent_store, sim_objects[sim_object_idx]->agent->agent_idx);
+	if (circles_collide(&c, query->circle) == TRUE)
+		(*query->fptr_found)(sim_object_idx, query->context);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: grid_k_nearest)
+ * Box queries of the grid around the point, doubling the box until the
+ * k-th nearest found is no further than its half size - an agent that
+ * was not found does not touch the box so it is further than that.  Once
+ * the box covers the whole grid everyone has been seen.
+ *-----------------------------------------------------------------------*/
+int grid_k_nearest(vector_2D_t *point, int k, int exclude_sim_object_idx, int *found, double *distances)
+{
+	grid_nearest_query_t query;
+	rectangle_t box;
+	double half_size = sim_grid.cell_size_in_m;
+
+	if (sim_grid.cells == NULL || k <= 0)
+		return 0;
+
+	query.point = point;
+	query.k = k;
+	query.exclude_sim_object_idx = exclude_sim_object_idx;
+	query.found = found;
+	query.distances = distances;
+
+	while (TRUE)
+	{
+		box.origin.x = point->x - half_size;
+		box.origin.y = point->y - half_size;
+		box.size.x = 2 * half_size;
+		box.size.y = 2 * half_size;
+
+		query.num_found = 0;
+		spatial_grid_query_overlap(&sim_grid, &box, grid_nearest_found, (void*)&query);
+
+		if (query.num_found == k && distances[k - 1] + GRID_DISTANCE_SLACK_IN_M <= half_size)
+			break;
+		if (box.origin.x <= 0 && box.origin.y <= 0 && box.origin.x + box.size.x >= environment.real_size_x_in_m && box.origin.y + box.size.y >= environment.real_size_y_in_m)
+			break;
+
+		half_size *= 2;
+	}
+
+	return query.num_found;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: grid_nearest_found)
+ * keeps the k nearest in order like loose_quadtree_k_nearest
+ *-----------------------------------------------------------------------*/
+void grid_nearest_found(int sim_object_idx, void *context)
+{
+	grid_nearest_query_t *query = (grid_nearest_query_t*)context;
+	int k = query->k;
+	int *found = query->found;
+	double *distances = query->distances;
+	int j;
+	double distance;
+	circle_t c;
+
+	if (sim_object_idx == query->exclude_sim_object_idx)
+		return;
+	if (sim_objects[sim_object_idx]->type != AGENT || agent_store.not_physical[sim_objects[sim_object_idx]->agent->agent_idx] == TRUE)
+		return;
+
+	c = agent_store_circle(&agent_store, sim_objects[sim_object_idx]->agent->agent_idx);
+	distance = maximum(0, sqrt((query->point->x - c.center.x) * (query->point->x - c.center.x) + (query->point->y - c.center.y) * (query->point->y - c.center.y)) - c.radius);
+
+	if (query->num_found == k && (distance > distances[k - 1] || (distance == distances[k - 1] && sim_object_idx > found[k - 1])))
+		return;
+
+	/* insertion into the sorted results */
+	j = (query->num_found < k) ? query->num_found++ : k - 1;
+	for (; j > 0 && (distances[j - 1] > distance || (distances[j - 1] == distance && found[j - 1] > sim_object_idx)); j--)
+	{
+		found[j] = found[j - 1];
+		distances[j] = distances[j - 1];
+	}
+	found[j] = sim_object_idx;
+	distances[j] = distance;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_checkpoint_save)
+ * Nothing of the quadtree is saved - its shape only depends on where the
+ * agents are so it is rebuilt on load.
+ *-----------------------------------------------------------------------*/
+void agent_index_checkpoint_save(checkpoint_t *checkpoint)
+{
+	spatial_grid_checkpoint_save(&sim_grid, checkpoint);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_index_checkpoint_load)
+ * Called once the agents' poses are loaded.
+ *-----------------------------------------------------------------------*/
+void agent_index_checkpoint_load(checkpoint_t *checkpoint)
+{
+	spatial_grid_checkpoint_load(&sim_grid, checkpoint);
+
+	if (environment.agent_index == AGENT_INDEX_LOOSE_QUADTREE)
+	{
+		loose_quadtree_free(&sim_quadtree);
+		loose_quadtree_build(&sim_quadtree, environment.real_size_x_in_m, environment.real_size_y_in_m);
+	}
+}
@@ -0,0 +1,45 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef AGENT_INDEX_H
+#define AGENT_INDEX_H
+
+#include "types.h"
+
+void agent_index_build();
+void agent_index_next_version();
+void agent_index_update_object(int sim_object_idx);
+unsigned int agent_index_version();
+short agent_index_unchanged_since(rectangle_t *box, unsigned int version);
+double agent_index_raycast(line_segment_t *beam, double (*fptr_hit)(int sim_object_idx, void *context), void *context);
+void agent_index_query_overlap(rectangle_t *box, void (*fptr_found)(int sim_object_idx, void *context), void *context);
+void agent_index_query_circle(circle_t *circle, void (*fptr_found)(int sim_object_idx, void *context), void *context);
+int agent_index_k_nearest(vector_2D_t *point, int k, int exclude_sim_object_idx, int *found, double *distances);
+
+void agent_index_checkpoint_save(checkpoint_t *checkpoint);
+void agent_index_checkpoint_load(checkpoint_t *checkpoint);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "agent_store.h"
+
+/* globals */
+agent_store_t agent_store;
+
+/*-------------------------------------------------------------------------
+ * (function: agent_store_reserve)
+ * Makes room for num_agents so a group read from the config lands in one
+ * allocation instead of growing as it goes.
+ *-----------------------------------------------------------------------*/
+void agent_store_reserve(agent_store_t *store, int num_agents)
+{
+	if (num_agents <= store->alloc_agents)
+		return;
+
+	store->alloc_agents = num_agents;
+	store->x = (double*)realloc(store->x, sizeof(double) * store->alloc_agents);
+	store->y = (double*)realloc(store->y, sizeof(double) * store->alloc_agents);
+	store->angle = (double*)realloc(store->angle, sizeof(double) * store->alloc_agents);
+	store->radius = (double*)realloc(store->radius, sizeof(double) * store->alloc_agents);
+	store->next_x = (double*)realloc(store->next_x, sizeof(double) * store->alloc_agents);
+	store->next_y = (double*)realloc(store->next_y, sizeof(double) * store->alloc_agents);
+	store->next_angle = (double*)realloc(store->next_angle, sizeof(double) * store->alloc_agents);
+	store->state = (int*)realloc(store->state, sizeof(int) * store->alloc_agents);
+	store->group = (int*)realloc(store->group, sizeof(int) * store->alloc_agents);
+	store->not_physical = (short*)realloc(store->not_physical, sizeof(short) * store->alloc_agents);
+	store->crashed = (short*)realloc(store->crashed, sizeof(short) * store->alloc_agents);
+	store->pose_version = (unsigned int*)realloc(store->pose_version, sizeof(unsigned int) * store->alloc_agents);
+	store->agents = (agent_t**)realloc(store->agents, sizeof(agent_t*) * store->alloc_agents);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_store_add)
+ * Gives the agent a slot in the store.  Agents start at the origin in
+ * state 0 and not physical until the group shape is read.
+ *
+ * returns the handle (agent_idx) of the agent
+ *-----------------------------------------------------------------------*/
+int agent_store_add(agent_store_t *store, agent_t *agent, int group_idx)
+{
+	int idx = store->num_agents;
+
+	if (store->num_agents == store->alloc_agents)
+	{
+		agent_store_reserve(store, (store->alloc_agents == 0) ? 64 : store->alloc_agents * 2);
+	}
+
+	store->x[idx] = 0;
+	store->y[idx] = 0;
+	store->angle[idx] = 0;
+	store->radius[idx] = 0;
+	store->next_x[idx] = 0;
+	store->next_y[idx] = 0;
+	store->next_angle[idx] = 0;
+	store->state[idx] = 0;
+	store->group[idx] = group_idx;
+	store->not_physical[idx] = TRUE;
+	store->crashed[idx] = FALSE;
+	store->pose_version[idx] = 0;
+	store->agents[idx] = agent;
+
+	agent->agent_idx = idx;
+	store->num_agents ++;
+
+	return idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_store_free)
+ *-----------------------------------------------------------------------*/
+void agent_store_free(agent_store_t *store)
+{
+	free(store->x);
+	free(store->y);
+	free(store->angle);
+	free(store->radius);
+	free(store->next_x);
+	free(store->next_y);
+	free(store->next_angle);
+	free(store->state);
+	free(store->group);
+	free(store->not_physical);
+	free(store->crashed);
+	free(store->pose_version);
+	free(store->agents);
+
+	memset(store, 0, sizeof(agent_store_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_store_start)
+ * Called once the config is read.  The next pose starts where the agent
+ * is and the seed keys every agent's noise streams.
+ *-----------------------------------------------------------------------*/
+void agent_store_start(agent_store_t *store, int rand_seed)
+{
+	int i;
+
+	store->rand_seed = (unsigned int)rand_seed;
+
+	for (i = 0; i < store->num_agents; i++)
+	{
+		store->next_x[i] = store->x[i];
+		store->next_y[i] = store->y[i];
+		store->next_angle[i] = store->angle[i];
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_store_commit)
+ * Makes the next pose the current one.  Crashed agents do not move.
+ *
+ * returns TRUE if the agent moved
+ *-----------------------------------------------------------------------*/
+short agent_store_commit(agent_store_t *store, int agent_idx)
+{
+	if (store->crashed[agent_idx] == TRUE)
+	{
+		/* whatever the actuators did it stays where it crashed */
+		store->next_x[agent_idx] = store->x[agent_idx];
+		store->next_y[agent_idx] = store->y[agent_idx];
+		store->next_angle[agent_idx] = store->angle[agent_idx];
+		return FALSE;
+	}
+
+	if (store->x[agent_idx] == store->next_x[agent_idx] && store->y[agent_idx] == store->next_y[agent_idx] && store->angle[agent_idx] == store->next_angle[agent_idx])
+		return FALSE;
+
+	store->x[agent_idx] = store->next_x[agent_idx];
+	store->y[agent_idx] = store->next_y[agent_idx];
+	store->angle[agent_idx] = store->next_angle[agent_idx];
+	store->pose_version[agent_idx] ++;
+
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_store_circle)
+ * returns the body of the agent for the collision routines
+ *-----------------------------------------------------------------------*/
+circle_t agent_store_circle(agent_store_t *store, int agent_idx)
+{
+	circle_t c;
+
+	c.center.x = store->x[agent_idx];
+	c.center.y = store->y[agent_idx];
+	c.radius = store->radius[agent_idx];
+
+	return c;
+}
@@ -0,0 +1,39 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef AGENT_STORE_H
+#define AGENT_STORE_H
+
+#include "types.h"
+
+void agent_store_reserve(agent_store_t *store, int num_agents);
+int agent_store_add(agent_store_t *store, agent_t *agent, int group_idx);
+void agent_store_free(agent_store_t *store);
+void agent_store_start(agent_store_t *store, int rand_seed);
+short agent_store_commit(agent_store_t *store, int agent_idx);
+circle_t agent_store_circle(agent_store_t *store, int agent_idx);
+
+#endif
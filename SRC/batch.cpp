@@ -0,0 +1,594 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "batch.h"
+#include "simulation.h"
+#include "log_file.h"
+#include "agent_store.h"
+#include "read_xml_config_file.h"
+#include "thread_pool.h"
+
+/* globals */
+
+/* what one run sends back to the parent - small enough for an atomic pipe write */
+typedef struct batch_summary_t_t batch_summary_t;
+struct batch_summary_t_t
+{
+	int run;
+	int seed;
+	short done;
+	double wall_time_s;
+	double mean_displacement_in_m;
+	double max_displacement_in_m;
+	int num_agents_not_moved;
+};
+
+/* one line of the branches file - a seed and config overrides */
+typedef struct batch_branch_t_t batch_branch_t;
+struct batch_branch_t_t
+{
+	int seed;
+	int num_overrides;
+	char **override_names;
+	char **override_values;
+};
+
+/* the branched run - set by run_branches for batch_branch_point */
+double branch_at_s = -1; // -1 is no branching
+int branch_num_branches = 0;
+batch_branch_t *branches = NULL;
+int branch_num_workers = 1;
+batch_summary_t *branch_summaries = NULL;
+int branch_summary_fd = -1;
+int branch_run = -1; // the branch a forked run is
+short branch_forked = FALSE;
+long long branch_log_position;
+long long branch_beam_log_position;
+
+void run_batch_replicate(int run, int seed, int summary_fd);
+int fork_batch_runs(int num_runs, int num_workers, batch_summary_t *summaries, int *summary_fd);
+void read_batch_summaries(int summary_fd, batch_summary_t *summaries);
+void summarize_batch_run(int run, int seed, double *start_x, double *start_y, double start_time, int summary_fd);
+void write_batch_summaries(char *summary_file_name, batch_summary_t *summaries, int num_runs, double start_time);
+int read_branches_file(char *file_name, batch_branch_t **branches_read);
+void start_branch(int run, long long debug_position);
+double batch_wall_time();
+
+/*-------------------------------------------------------------------------
+ * (function: run_batch)
+ * Runs num_runs replicates of the already read config with seeds
+ * seed_start, seed_start+1, ...  The world is set up once and each run is
+ * a forked copy of it, with at most num_workers running at a time.  Each
+ * run writes its own log files (names get .<seed> added) and a one line
+ * summary goes to summary_file_name.
+ *-----------------------------------------------------------------------*/
+void run_batch(int num_runs, int seed_start, int num_workers, char *summary_file_name)
+{
+	int i;
+	int run;
+	int summary_fd;
+	batch_summary_t *summaries;
+	double start_time = batch_wall_time();
+
+	if (strcmp(sim_system.simulation_type, "discrete") != 0 && strcmp(sim_system.simulation_type, "event") != 0)
+	{
+		printf("Unsupported simulation type\n");
+		return;
+	}
+	if (num_workers < 1)
+		num_workers = 1;
+
+	printf("Doing %d runs from seed %d with %d at a time\n", num_runs, seed_start, num_workers);
+
+	/* everything up to here is shared by the runs */
+	setup_simulation();
+
+	summaries = (batch_summary_t*)calloc(num_runs, sizeof(batch_summary_t));
+	for (i = 0; i < num_runs; i++)
+	{
+		summaries[i].run = i;
+		summaries[i].seed = seed_start + i;
+		summaries[i].done = FALSE;
+	}
+
+	run = fork_batch_runs(num_runs, num_workers, summaries, &summary_fd);
+	if (run >= 0)
+	{
+		run_batch_replicate(run, seed_start + run, summary_fd);
+		_exit(0);
+	}
+
+	write_batch_summaries(summary_file_name, summaries, num_runs, start_time);
+
+	free(summaries);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: run_batch_replicate)
+ * The body of one forked run.
+ *-----------------------------------------------------------------------*/
+void run_batch_replicate(int run, int seed, int summary_fd)
+{
+	char file_name[4096];
+	double *start_x;
+	double *start_y;
+	double start_time = batch_wall_time();
+
+	/* the controls print every epoch - too much for many runs at once */
+	freopen("/dev/null", "w", stdout);
+
+	/* runs at once would all write the same checkpoint file */
+	sim_system.checkpoint_every_s = 0;
+
+	/* set randomization */
+	sim_system.rand_seed = seed;
+	srand(seed);
+	rand_float_seed(seed);
+	agent_store_start(&agent_store, seed);
+
+	snprintf(file_name, sizeof(file_name), "%s.%d", sim_system.debug_file_out, seed);
+	sim_system.Fdebug_out = fopen(file_name, "w");
+	oassert(sim_system.Fdebug_out != NULL);
+	snprintf(file_name, sizeof(file_name), "%s.%d", sim_system.sim_log_file_out, seed);
+	output_log_open(file_name);
+
+	start_x = (double*)malloc(sizeof(double) * agent_store.num_agents);
+	start_y = (double*)malloc(sizeof(double) * agent_store.num_agents);
+	memcpy(start_x, agent_store.x, sizeof(double) * agent_store.num_agents);
+	memcpy(start_y, agent_store.y, sizeof(double) * agent_store.num_agents);
+
+	output_log_header();
+
+	if (strcmp(sim_system.simulation_type, "discrete") == 0)
+		simulation_loop(NULL);
+	else
+		event_simulation_loop(NULL);
+
+	output_log_footer();
+
+	fclose(sim_system.Fdebug_out);
+	output_log_close();
+
+	summarize_batch_run(run, seed, start_x, start_y, start_time, summary_fd);
+
+	free(start_x);
+	free(start_y);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: run_branches)
+ * Runs the config once up to the first epoch at or past at_s and forks
+ * one branch per line of branches_file_name there, with at most
+ * num_workers running at a time.  Each branch carries on from the shared
+ * prefix with its own seed and config overrides, so the prefix is only
+ * simulated once.  The prefix run's logs are the config's file names and
+ * hold the prefix.  Each branch's logs are .branch<n> added to them and
+ * start with a copy of the prefix, so they read as one whole run.  A one
+ * line summary per branch goes to summary_file_name.
+ *-----------------------------------------------------------------------*/
+void run_branches(double at_s, char *branches_file_name, int num_workers, char *summary_file_name)
+{
+	int i;
+	double *start_x;
+	double *start_y;
+	double start_time = batch_wall_time();
+
+	if (strcmp(sim_system.simulation_type, "discrete") != 0 && strcmp(sim_system.simulation_type, "event") != 0)
+	{
+		printf("Unsupported simulation type\n");
+		return;
+	}
+	if (num_workers < 1)
+		num_workers = 1;
+
+	branch_num_branches = read_branches_file(branches_file_name, &branches);
+	if (branch_num_branches == 0)
+	{
+		printf("No branches in %s\n", branches_file_name);
+		return;
+	}
+	branch_at_s = at_s;
+	branch_num_workers = num_workers;
+
+	printf("Doing %d branches at time %f with %d at a time\n", branch_num_branches, at_s, num_workers);
+
+	branch_summaries = (batch_summary_t*)calloc(branch_num_branches, sizeof(batch_summary_t));
+	for (i = 0; i < branch_num_branches; i++)
+	{
+		branch_summaries[i].run = i;
+		branch_summaries[i].seed = branches[i].seed;
+		branch_summaries[i].done = FALSE;
+	}
+
+	/* the prefix - as a single run with the config's seed */
+	sim_system.Fdebug_out = fopen(sim_system.debug_file_out, "w");
+	oassert(sim_system.Fdebug_out != NULL);
+	output_log_open(sim_system.sim_log_file_out);
+
+	srand(sim_system.rand_seed);
+	rand_float_seed(sim_system.rand_seed);
+	setup_simulation();
+
+	start_x = (double*)malloc(sizeof(double) * agent_store.num_agents);
+	start_y = (double*)malloc(sizeof(double) * agent_store.num_agents);
+	memcpy(start_x, agent_store.x, sizeof(double) * agent_store.num_agents);
+	memcpy(start_y, agent_store.y, sizeof(double) * agent_store.num_agents);
+
+	output_log_header();
+
+	/* the prefix uses the workers as threads - batch_branch_point stops them before it forks */
+	thread_pool_start(num_workers);
+
+	/* the branches come back here once they are done too */
+	if (strcmp(sim_system.simulation_type, "discrete") == 0)
+		simulation_loop(NULL);
+	else
+		event_simulation_loop(NULL);
+
+	thread_pool_stop();
+
+	if (branch_run >= 0)
+	{
+		output_log_footer();
+		fclose(sim_system.Fdebug_out);
+		output_log_close();
+
+		summarize_batch_run(branch_run, branches[branch_run].seed, start_x, start_y, start_time, branch_summary_fd);
+		_exit(0);
+	}
+
+	/* the prefix logs end where the branches took over */
+	if (branch_forked == TRUE)
+	{
+		output_log_resume(sim_system.sim_log_file_out, branch_log_position, branch_beam_log_position);
+		write_batch_summaries(summary_file_name, branch_summaries, branch_num_branches, start_time);
+	}
+	else
+	{
+		printf("The run ended before the branch time %f - nothing was branched\n", at_s);
+	}
+
+	output_log_footer();
+	fclose(sim_system.Fdebug_out);
+	output_log_close();
+
+	free(start_x);
+	free(start_y);
+	free(branch_summaries);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: batch_branch_due)
+ * TRUE at the end of the first epoch at or past the branch time of a
+ * run_branches prefix.
+ *-----------------------------------------------------------------------*/
+short batch_branch_due(double current_time)
+{
+	if (branch_at_s < 0 || branch_forked == TRUE)
+		return FALSE;
+
+	return (current_time + environment.sim_time_computation_epoch_s/2 >= branch_at_s) ? TRUE : FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: batch_branch_point)
+ * Called by the loops between epochs when batch_branch_due.  The world as
+ * it is now - poses, memories, the event queue on the loop's stack - is
+ * shared copy-on-write with the forked branches.
+ *
+ * returns TRUE in the prefix run, which stops once the branches are done,
+ * and FALSE in a branch, which carries on with the loop
+ *-----------------------------------------------------------------------*/
+short batch_branch_point(double current_time)
+{
+	int run;
+	long long debug_position;
+
+	printf("Branching at time %f\n", current_time);
+
+	/* nothing but this thread may be running at the fork */
+	thread_pool_stop();
+	fflush(sim_system.Fdebug_out);
+	debug_position = ftello(sim_system.Fdebug_out);
+	output_log_suspend(&branch_log_position, &branch_beam_log_position);
+	branch_forked = TRUE;
+
+	run = fork_batch_runs(branch_num_branches, branch_num_workers, branch_summaries, &branch_summary_fd);
+	if (run < 0)
+		return TRUE;
+
+	start_branch(run, debug_position);
+
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: start_branch)
+ * In the forked run - takes its own copies of the outputs and applies the
+ * branch's seed and overrides.
+ *-----------------------------------------------------------------------*/
+void start_branch(int run, long long debug_position)
+{
+	int i;
+	char file_name[4096];
+	batch_branch_t *branch = &branches[run];
+
+	branch_run = run;
+
+	/* the controls print every epoch - too much for many runs at once */
+	freopen("/dev/null", "w", stdout);
+
+	/* runs at once would all write the same checkpoint file */
+	sim_system.checkpoint_every_s = 0;
+
+	fclose(sim_system.Fdebug_out);
+	snprintf(file_name, sizeof(file_name), "%s.branch%d", sim_system.debug_file_out, run);
+	copy_file_prefix(sim_system.debug_file_out, file_name, debug_position);
+	sim_system.Fdebug_out = fopen(file_name, "a");
+	oassert(sim_system.Fdebug_out != NULL);
+	snprintf(file_name, sizeof(file_name), "%s.branch%d", sim_system.sim_log_file_out, run);
+	output_log_branch(sim_system.sim_log_file_out, file_name, branch_log_position, branch_beam_log_position);
+
+	/* from here on the noise differs between the branches */
+	sim_system.rand_seed = branch->seed;
+	srand(branch->seed);
+	rand_float_seed(branch->seed);
+	agent_store_start(&agent_store, branch->seed);
+
+	for (i = 0; i < branch->num_overrides; i++)
+	{
+		if (read_config_override(branch->override_names[i], branch->override_values[i]) == FALSE)
+		{
+			fprintf(stderr, "Branch %d: unsupported override %s\n", run, branch->override_names[i]);
+			_exit(1);
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: fork_batch_runs)
+ * Forks runs 0 to num_runs-1 with at most num_workers running at a time.
+ *
+ * returns the run in a forked child, with *summary_fd where it writes
+ * its summary, and -1 in the parent once every run has finished
+ *-----------------------------------------------------------------------*/
+int fork_batch_runs(int num_runs, int num_workers, batch_summary_t *summaries, int *summary_fd)
+{
+	int i;
+	int next_run = 0;
+	int num_running = 0;
+	int summary_pipe[2];
+
+	/* the summaries are read as runs finish so the pipe never fills */
+	i = pipe(summary_pipe);
+	oassert(i == 0);
+	fcntl(summary_pipe[0], F_SETFL, O_NONBLOCK);
+
+	while (next_run < num_runs || num_running > 0)
+	{
+		/* keep the workers busy */
+		while (next_run < num_runs && num_running < num_workers)
+		{
+			pid_t pid;
+
+			/* so buffered output is not written twice */
+			fflush(NULL);
+
+			pid = fork();
+			oassert(pid >= 0);
+			if (pid == 0)
+			{
+				close(summary_pipe[0]);
+				*summary_fd = summary_pipe[1];
+				return next_run;
+			}
+
+			next_run ++;
+			num_running ++;
+		}
+
+		/* a run that crashed just has no summary */
+		if (wait(NULL) > 0)
+			num_running --;
+
+		read_batch_summaries(summary_pipe[0], summaries);
+	}
+
+	close(summary_pipe[0]);
+	close(summary_pipe[1]);
+
+	return -1;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: read_batch_summaries)
+ * Takes whatever summaries are waiting in the pipe without blocking.
+ *-----------------------------------------------------------------------*/
+void read_batch_summaries(int summary_fd, batch_summary_t *summaries)
+{
+	batch_summary_t summary;
+
+	while (read(summary_fd, &summary, sizeof(batch_summary_t)) == sizeof(batch_summary_t))
+	{
+		summaries[summary.run] = summary;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: summarize_batch_run)
+ * Sends where the agents of a finished run ended up to the parent.
+ *-----------------------------------------------------------------------*/
+void summarize_batch_run(int run, int seed, double *start_x, double *start_y, double start_time, int summary_fd)
+{
+	int i;
+	batch_summary_t summary;
+	ssize_t written;
+
+	memset(&summary, 0, sizeof(batch_summary_t));
+	summary.run = run;
+	summary.seed = seed;
+	summary.done = TRUE;
+
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		double displacement = sqrt((agent_store.x[i] - start_x[i]) * (agent_store.x[i] - start_x[i]) + (agent_store.y[i] - start_y[i]) * (agent_store.y[i] - start_y[i]));
+
+		summary.mean_displacement_in_m += displacement;
+		if (displacement > summary.max_displacement_in_m)
+			summary.max_displacement_in_m = displacement;
+		if (displacement == 0)
+			summary.num_agents_not_moved ++;
+	}
+	if (agent_store.num_agents > 0)
+		summary.mean_displacement_in_m /= agent_store.num_agents;
+
+	summary.wall_time_s = batch_wall_time() - start_time;
+
+	written = write(summary_fd, &summary, sizeof(batch_summary_t));
+	oassert(written == sizeof(batch_summary_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: write_batch_summaries)
+ *-----------------------------------------------------------------------*/
+void write_batch_summaries(char *summary_file_name, batch_summary_t *summaries, int num_runs, double start_time)
+{
+	int i;
+	int num_failed = 0;
+	double mean_displacement_in_m = 0;
+	FILE *fsummary;
+
+	fsummary = fopen(summary_file_name, "w");
+	oassert(fsummary != NULL);
+	fprintf(fsummary, "run,seed,done,wall_time_s,mean_displacement_in_m,max_displacement_in_m,num_agents_not_moved\n");
+	for (i = 0; i < num_runs; i++)
+	{
+		fprintf(fsummary, "%d,%d,%d,%f,%f,%f,%d\n", summaries[i].run, summaries[i].seed, summaries[i].done, summaries[i].wall_time_s, summaries[i].mean_displacement_in_m, summaries[i].max_displacement_in_m, summaries[i].num_agents_not_moved);
+
+		if (summaries[i].done == TRUE)
+			mean_displacement_in_m += summaries[i].mean_displacement_in_m;
+		else
+			num_failed ++;
+	}
+	fclose(fsummary);
+
+	if (num_failed < num_runs)
+		mean_displacement_in_m /= (num_runs - num_failed);
+
+	printf("Batch done: %d runs, %d failed, mean displacement %f m, %f s - summary in %s\n", num_runs, num_failed, mean_displacement_in_m, batch_wall_time() - start_time, summary_file_name);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: read_branches_file)
+ * One branch per line - its seed then any number of name=value config
+ * overrides (see read_config_override), split by spaces.  Empty lines and
+ * lines starting with # are skipped.
+ *
+ * returns the number of branches
+ *-----------------------------------------------------------------------*/
+int read_branches_file(char *file_name, batch_branch_t **branches_read)
+{
+	FILE *fbranches;
+	char line[4096];
+	char *token;
+	char *equals;
+	int num_branches = 0;
+	int alloc_branches = 0;
+	batch_branch_t *branch;
+
+	*branches_read = NULL;
+
+	fbranches = fopen(file_name, "r");
+	if (fbranches == NULL)
+	{
+		printf("Could not read branches file %s\n", file_name);
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), fbranches) != NULL)
+	{
+		token = strtok(line, " \t\r\n");
+		if (token == NULL || token[0] == '#')
+			continue;
+
+		if (num_branches == alloc_branches)
+		{
+			alloc_branches = (alloc_branches == 0) ? 16 : alloc_branches * 2;
+			*branches_read = (batch_branch_t*)realloc(*branches_read, sizeof(batch_branch_t) * alloc_branches);
+		}
+		branch = &(*branches_read)[num_branches];
+		branch->seed = atoi(token);
+		branch->num_overrides = 0;
+		branch->override_names = NULL;
+		branch->override_values = NULL;
+
+		while ((token = strtok(NULL, " \t\r\n")) != NULL)
+		{
+			equals = strchr(token, '=');
+			if (equals == NULL)
+			{
+				printf("Branch %d: %s is not name=value\n", num_branches, token);
+				oassert(FALSE);
+			}
+			*equals = '\0';
+
+			branch->override_names = (char**)realloc(branch->override_names, sizeof(char*) * (branch->num_overrides + 1));
+			branch->override_values = (char**)realloc(branch->override_values, sizeof(char*) * (branch->num_overrides + 1));
+			branch->override_names[branch->num_overrides] = strdup(token);
+			branch->override_values[branch->num_overrides] = strdup(equals + 1);
+			branch->num_overrides ++;
+		}
+
+		num_branches ++;
+	}
+	fclose(fbranches);
+
+	return num_branches;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: batch_wall_time)
+ *-----------------------------------------------------------------------*/
+double batch_wall_time()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
@@ -0,0 +1,288 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "bayesian_filter.h"
+
+/* 
+ * The grid filter behind the *_W_BAYESIAN sensors.  The mean and std of
+ * the reading at each distance state never change, so they are in a table
+ * and an update is one pass of likelihood * prior with the sum and the
+ * most likely state kept on the way, then one pass to normalize.
+ */
+
+/* globals */
+
+/* exp(x) is 0 in a double below this */
+#define EXP_UNDERFLOW -708.0
+#define EXP_OVERFLOW 709.0
+
+#ifdef __SSE2__
+__m128d exp_2(__m128d x);
+#endif
+double exp_1(double x);
+double bayesian_restart(bayesian_table_t *table, double *prob_array, double reading);
+
+/*-------------------------------------------------------------------------
+ * (function: bayesian_table_build)
+ * States are first_state, first_state+state_step, ... added up the same
+ * way the sensors always have.
+ *-----------------------------------------------------------------------*/
+void bayesian_table_build(bayesian_table_t *table, int num_states, double first_state, double state_step, double (*fptr_mean)(double state), double (*fptr_std)(double state))
+{
+	int i;
+	double state = first_state;
+
+	table->num_states = num_states;
+	table->state = (double*)malloc(sizeof(double) * num_states);
+	table->mean = (double*)malloc(sizeof(double) * num_states);
+	table->neg_half_inv_variance = (double*)malloc(sizeof(double) * num_states);
+	table->scale = (double*)malloc(sizeof(double) * num_states);
+
+	for (i = 0; i < num_states; i++)
+	{
+		double std = (*fptr_std)(state);
+
+		table->state[i] = state;
+		table->mean[i] = (*fptr_mean)(state);
+		table->neg_half_inv_variance[i] = -1.0 / (std * std * 2.0);
+		table->scale[i] = 1.0 / (std * sqrt(2.0 * M_PI));
+
+		state += state_step;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bayesian_table_free)
+ *-----------------------------------------------------------------------*/
+void bayesian_table_free(bayesian_table_t *table)
+{
+	free(table->state);
+	free(table->mean);
+	free(table->neg_half_inv_variance);
+	free(table->scale);
+	table->num_states = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bayesian_reset)
+ * Uniform prior.
+ *-----------------------------------------------------------------------*/
+void bayesian_reset(bayesian_table_t *table, double *prob_array)
+{
+	int i;
+	double uniform = 1.0 / (double)table->num_states;
+
+	for (i = 0; i < table->num_states; i++)
+	{
+		prob_array[i] = uniform;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bayesian_update)
+ * prob_array becomes the normalized posterior after reading.  Returns the
+ * state with the highest probability (the first one on ties).
+ *-----------------------------------------------------------------------*/
+double bayesian_update(bayesian_table_t *table, double *prob_array, double reading)
+{
+	int i = 0;
+	int at_idx = 0;
+	int num_states = table->num_states;
+	double find_max = -1;
+	double sum = 0;
+
+#ifdef __SSE2__
+	__m128d sum_2 = _mm_setzero_pd();
+	__m128d reading_2 = _mm_set1_pd(reading);
+
+	for (; i + 1 < num_states; i += 2)
+	{
+		__m128d diff = _mm_sub_pd(reading_2, _mm_loadu_pd(&table->mean[i]));
+		__m128d likelihood = _mm_mul_pd(_mm_loadu_pd(&table->scale[i]), exp_2(_mm_mul_pd(_mm_loadu_pd(&table->neg_half_inv_variance[i]), _mm_mul_pd(diff, diff))));
+		__m128d posterior = _mm_mul_pd(likelihood, _mm_loadu_pd(&prob_array[i]));
+
+		_mm_storeu_pd(&prob_array[i], posterior);
+		sum_2 = _mm_add_pd(sum_2, posterior);
+
+		/* normalizing does not move the max */
+		if (prob_array[i] > find_max)
+		{
+			find_max = prob_array[i];
+			at_idx = i;
+		}
+		if (prob_array[i+1] > find_max)
+		{
+			find_max = prob_array[i+1];
+			at_idx = i+1;
+		}
+	}
+	sum = _mm_cvtsd_f64(_mm_add_sd(sum_2, _mm_unpackhi_pd(sum_2, sum_2)));
+#endif
+	for (; i < num_states; i++)
+	{
+		double diff = reading - table->mean[i];
+
+		prob_array[i] = table->scale[i] * exp_1(table->neg_half_inv_variance[i] * diff * diff) * prob_array[i];
+		sum += prob_array[i];
+
+		if (prob_array[i] > find_max)
+		{
+			find_max = prob_array[i];
+			at_idx = i;
+		}
+	}
+
+	/* every state's posterior went to 0 so there is nothing to normalize */
+	if (sum <= 0)
+		return bayesian_restart(table, prob_array, reading);
+
+	for (i = 0; i < num_states; i++)
+	{
+		prob_array[i] = prob_array[i] / sum;
+	}
+
+	return table->state[at_idx];
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bayesian_restart)
+ * For a reading the prior gives no chance to, or that is so far from every
+ * state that all the likelihoods are below what a double holds.  The prior
+ * is dropped and prob_array becomes the likelihood of the reading
+ * normalized, worked out from the log likelihoods so it can not be all 0.
+ *-----------------------------------------------------------------------*/
+double bayesian_restart(bayesian_table_t *table, double *prob_array, double reading)
+{
+	int i;
+	int at_idx = 0;
+	double find_max = -HUGE_VAL;
+	double sum = 0;
+
+	for (i = 0; i < table->num_states; i++)
+	{
+		double diff = reading - table->mean[i];
+
+		prob_array[i] = log(table->scale[i]) + table->neg_half_inv_variance[i] * diff * diff;
+		if (prob_array[i] > find_max)
+		{
+			find_max = prob_array[i];
+			at_idx = i;
+		}
+	}
+
+	for (i = 0; i < table->num_states; i++)
+	{
+		prob_array[i] = exp(prob_array[i] - find_max);
+		sum += prob_array[i];
+	}
+
+	for (i = 0; i < table->num_states; i++)
+	{
+		prob_array[i] = prob_array[i] / sum;
+	}
+
+	return table->state[at_idx];
+}
+
+#ifdef __SSE2__
+/*-------------------------------------------------------------------------
+ * (function: exp_2)
+ * exp of two doubles.  x = n ln2 + r with |r| <= ln2/2, e^r by its Taylor
+ * series to r^13 and 2^n put straight into the exponent.  Over [-708, 0]
+ * it is at most 1.2 ulp from the exact value (libm's exp is 0.5).
+ * Below EXP_UNDERFLOW gives 0 - the likelihood of a far off state.
+ *-----------------------------------------------------------------------*/
+__m128d exp_2(__m128d x)
+{
+	const __m128d ln2_hi = _mm_set1_pd(6.93147180369123816490e-01);
+	const __m128d ln2_lo = _mm_set1_pd(1.90821492927058770002e-10);
+	__m128d underflow = _mm_cmplt_pd(x, _mm_set1_pd(EXP_UNDERFLOW));
+	__m128d fn;
+	__m128d r;
+	__m128d poly;
+	__m128i n;
+	__m128i two_to_n;
+
+	x = _mm_max_pd(x, _mm_set1_pd(EXP_UNDERFLOW));
+	x = _mm_min_pd(x, _mm_set1_pd(EXP_OVERFLOW));
+
+	/* nearest n so |r| <= ln2/2 */
+	n = _mm_cvtpd_epi32(_mm_mul_pd(x, _mm_set1_pd(1.44269504088896338700e+00)));
+	fn = _mm_cvtepi32_pd(n);
+	r = _mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(fn, ln2_hi)), _mm_mul_pd(fn, ln2_lo));
+
+	/* 1 + r + r^2/2! + ... + r^13/13! */
+	poly = _mm_set1_pd(1.0 / 6227020800.0);
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 479001600.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 39916800.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 3628800.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 362880.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 40320.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 5040.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 720.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 120.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 24.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0 / 6.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(0.5));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0));
+	poly = _mm_add_pd(_mm_mul_pd(poly, r), _mm_set1_pd(1.0));
+
+	/* the two n are in the low 32 bit lanes - widen to 64 bits then build the double 2^n */
+	two_to_n = _mm_unpacklo_epi32(_mm_add_epi32(n, _mm_set1_epi32(1023)), _mm_setzero_si128());
+	two_to_n = _mm_slli_epi64(two_to_n, 52);
+
+	return _mm_andnot_pd(underflow, _mm_mul_pd(poly, _mm_castsi128_pd(two_to_n)));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: exp_1)
+ * The odd state at the end goes through the same kernel so every state
+ * gets the same rounding.
+ *-----------------------------------------------------------------------*/
+double exp_1(double x)
+{
+	return _mm_cvtsd_f64(exp_2(_mm_set_sd(x)));
+}
+#else
+/*-------------------------------------------------------------------------
+ * (function: exp_1)
+ *-----------------------------------------------------------------------*/
+double exp_1(double x)
+{
+	return exp(x);
+}
+#endif
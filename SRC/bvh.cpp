@@ -0,0 +1,365 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "bvh.h"
+#include "collision_detection.h"
+
+/* globals */
+
+/* leaves hold at most this many objects */
+#define BVH_MAX_LEAF_ITEMS 4
+/* deep enough for any tree built with median splits */
+#define BVH_STACK_SIZE 64
+
+int bvh_build_node(bvh_t *bvh, rectangle_t *item_boxes, int first_item, int num_items);
+rectangle_t bvh_merge_boxes(rectangle_t *a, rectangle_t *b);
+int bvh_compare_item_centers(const void *a, const void *b);
+
+/* used by qsort while building since it has no context pointer */
+rectangle_t *bvh_sort_boxes;
+short bvh_sort_axis_is_x;
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_build)
+ * Builds the hierarchy over the static objects once.  Each node splits its
+ * objects at the median center along the longer side of its box.  The item
+ * numbers are the index into objects which is also the sim_objects index
+ * since the objects go in sim_objects first.
+ *-----------------------------------------------------------------------*/
+void bvh_build(bvh_t *bvh, objects_t **objects, int num_objects)
+{
+	int i;
+	rectangle_t *item_boxes;
+
+	bvh->num_nodes = 0;
+	bvh->nodes = NULL;
+	bvh->num_items = num_objects;
+	bvh->items = NULL;
+
+	if (num_objects == 0)
+		return;
+
+	item_boxes = (rectangle_t*)malloc(sizeof(rectangle_t) * num_objects);
+	bvh->items = (int*)malloc(sizeof(int) * num_objects);
+	/* a binary tree with at least one item per leaf has less than 2n nodes */
+	bvh->nodes = (bvh_node_t*)malloc(sizeof(bvh_node_t) * 2 * num_objects);
+
+	for (i = 0; i < num_objects; i++)
+	{
+		bvh->items[i] = i;
+
+		if (objects[i]->type == CIRCLE)
+			item_boxes[i] = circle_rectangle_hull(objects[i]->circle);
+		else if (objects[i]->type == RECTANGLE)
+			item_boxes[i] = oriented_rectangle_rectangle_hull(objects[i]->rectangle);
+		else
+			oassert(FALSE);
+	}
+
+	bvh_build_node(bvh, item_boxes, 0, num_objects);
+
+	free(item_boxes);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_build_node)
+ * returns the index of the node made for items[first_item .. first_item+num_items-1]
+ *-----------------------------------------------------------------------*/
+int bvh_build_node(bvh_t *bvh, rectangle_t *item_boxes, int first_item, int num_items)
+{
+	int i;
+	int node_idx = bvh->num_nodes;
+	bvh_node_t *node = &bvh->nodes[node_idx];
+	int left;
+	int right;
+
+	bvh->num_nodes ++;
+
+	node->box = item_boxes[bvh->items[first_item]];
+	for (i = first_item + 1; i < first_item + num_items; i++)
+	{
+		node->box = bvh_merge_boxes(&node->box, &item_boxes[bvh->items[i]]);
+	}
+	node->first_item = first_item;
+	node->num_items = num_items;
+	node->left = -1;
+	node->right = -1;
+
+	if (num_items <= BVH_MAX_LEAF_ITEMS)
+		return node_idx;
+
+	/* median split along the longest side */
+	bvh_sort_boxes = item_boxes;
+	bvh_sort_axis_is_x = (node->box.size.x >= node->box.size.y);
+	qsort(&bvh->items[first_item], num_items, sizeof(int), bvh_compare_item_centers);
+
+	/* node pointer is not used past here but index into nodes is stable */
+	left = bvh_build_node(bvh, item_boxes, first_item, num_items / 2);
+	right = bvh_build_node(bvh, item_boxes, first_item + num_items / 2, num_items - num_items / 2);
+	bvh->nodes[node_idx].left = left;
+	bvh->nodes[node_idx].right = right;
+
+	return node_idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_free)
+ *-----------------------------------------------------------------------*/
+void bvh_free(bvh_t *bvh)
+{
+	free(bvh->nodes);
+	free(bvh->items);
+
+	bvh->nodes = NULL;
+	bvh->items = NULL;
+	bvh->num_nodes = 0;
+	bvh->num_items = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_raycast)
+ * Visits the nodes the beam passes through nearest first calling fptr_hit
+ * once per object in each leaf reached.  fptr_hit returns the distance from
+ * point1 to the hit or -1 for a miss.  Any node the beam enters after the
+ * closest hit so far is skipped, so once a hit is confirmed the rest of the
+ * tree is only entered where something could still be closer.
+ *
+ * returns the closest distance or -1 if nothing hit
+ *-----------------------------------------------------------------------*/
+double bvh_raycast(bvh_t *bvh, line_segment_t *beam, double (*fptr_hit)(int object_idx, void *context), void *context)
+{
+	int i;
+	double x1 = beam->point1.x;
+	double y1 = beam->point1.y;
+	double dx = beam->point2.x - beam->point1.x;
+	double dy = beam->point2.y - beam->point1.y;
+	double length = sqrt(dx*dx + dy*dy);
+	double closest = -1;
+	double t_enter;
+
+	int stack[BVH_STACK_SIZE];
+	double stack_t[BVH_STACK_SIZE];
+	int stack_top = 0;
+
+	if (bvh->num_nodes == 0)
+		return -1;
+	if (!bvh_ray_enters_box(&bvh->nodes[0].box, x1, y1, dx, dy, &t_enter))
+		return -1;
+
+	stack[0] = 0;
+	stack_t[0] = t_enter;
+	stack_top = 1;
+
+	while (stack_top > 0)
+	{
+		bvh_node_t *node;
+		stack_top --;
+		node = &bvh->nodes[stack[stack_top]];
+
+		/* something already hit before this box */
+		if (closest >= 0 && stack_t[stack_top] * length > closest)
+			continue;
+
+		if (node->left == -1)
+		{
+			for (i = node->first_item; i < node->first_item + node->num_items; i++)
+			{
+				double distance = (*fptr_hit)(bvh->items[i], context);
+				if (distance >= 0 && (closest < 0 || distance < closest))
+					closest = distance;
+			}
+		}
+		else
+		{
+			double t_left;
+			double t_right;
+			short hit_left = bvh_ray_enters_box(&bvh->nodes[node->left].box, x1, y1, dx, dy, &t_left);
+			short hit_right = bvh_ray_enters_box(&bvh->nodes[node->right].box, x1, y1, dx, dy, &t_right);
+
+			oassert(stack_top + 2 <= BVH_STACK_SIZE);
+
+			/* push the far child first so the near one comes off next */
+			if (hit_left && hit_right && t_left < t_right)
+			{
+				stack[stack_top] = node->right;
+				stack_t[stack_top++] = t_right;
+				stack[stack_top] = node->left;
+				stack_t[stack_top++] = t_left;
+			}
+			else
+			{
+				if (hit_left)
+				{
+					stack[stack_top] = node->left;
+					stack_t[stack_top++] = t_left;
+				}
+				if (hit_right)
+				{
+					stack[stack_top] = node->right;
+					stack_t[stack_top++] = t_right;
+				}
+			}
+		}
+	}
+
+	return closest;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_query_overlap)
+ * Calls fptr_found for every object whose bounding box overlaps box.  The
+ * caller does the exact test.
+ *-----------------------------------------------------------------------*/
+void bvh_query_overlap(bvh_t *bvh, rectangle_t *box, void (*fptr_found)(int object_idx, void *context), void *context)
+{
+	int i;
+	int stack[BVH_STACK_SIZE];
+	int stack_top = 0;
+
+	if (bvh->num_nodes == 0)
+		return;
+
+	stack[stack_top++] = 0;
+
+	while (stack_top > 0)
+	{
+		bvh_node_t *node = &bvh->nodes[stack[--stack_top]];
+
+		if (!rectangles_collide(&node->box, box))
+			continue;
+
+		if (node->left == -1)
+		{
+			for (i = node->first_item; i < node->first_item + node->num_items; i++)
+			{
+				(*fptr_found)(bvh->items[i], context);
+			}
+		}
+		else
+		{
+			oassert(stack_top + 2 <= BVH_STACK_SIZE);
+			stack[stack_top++] = node->left;
+			stack[stack_top++] = node->right;
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_merge_boxes)
+ *-----------------------------------------------------------------------*/
+rectangle_t bvh_merge_boxes(rectangle_t *a, rectangle_t *b)
+{
+	rectangle_t m;
+	double max_x = maximum(a->origin.x + a->size.x, b->origin.x + b->size.x);
+	double max_y = maximum(a->origin.y + a->size.y, b->origin.y + b->size.y);
+
+	m.origin.x = minimum(a->origin.x, b->origin.x);
+	m.origin.y = minimum(a->origin.y, b->origin.y);
+	m.size.x = max_x - m.origin.x;
+	m.size.y = max_y - m.origin.y;
+
+	return m;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_compare_item_centers)
+ *-----------------------------------------------------------------------*/
+int bvh_compare_item_centers(const void *a, const void *b)
+{
+	rectangle_t *box_a = &bvh_sort_boxes[*(const int*)a];
+	rectangle_t *box_b = &bvh_sort_boxes[*(const int*)b];
+	double center_a;
+	double center_b;
+
+	if (bvh_sort_axis_is_x)
+	{
+		center_a = box_a->origin.x + box_a->size.x / 2;
+		center_b = box_b->origin.x + box_b->size.x / 2;
+	}
+	else
+	{
+		center_a = box_a->origin.y + box_a->size.y / 2;
+		center_b = box_b->origin.y + box_b->size.y / 2;
+	}
+
+	if (center_a < center_b)
+		return -1;
+	else if (center_a > center_b)
+		return 1;
+	/* keep the order the same on every platform */
+	return *(const int*)a - *(const int*)b;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: bvh_ray_enters_box)
+ * Slab test of the beam point1 + t*(dx, dy) for t in [0, 1] against box.
+ *
+ * returns TRUE if the beam touches the box and sets t_enter to where
+ *-----------------------------------------------------------------------*/
+short bvh_ray_enters_box(rectangle_t *box, double x1, double y1, double dx, double dy, double *t_enter)
+{
+	double t_min = 0.0;
+	double t_max = 1.0;
+	double t_a, t_b;
+
+	if (dx == 0)
+	{
+		if (x1 < box->origin.x || x1 > box->origin.x + box->size.x)
+			return FALSE;
+	}
+	else
+	{
+		t_a = (box->origin.x - x1) / dx;
+		t_b = (box->origin.x + box->size.x - x1) / dx;
+		t_min = maximum(t_min, minimum(t_a, t_b));
+		t_max = minimum(t_max, maximum(t_a, t_b));
+	}
+
+	if (dy == 0)
+	{
+		if (y1 < box->origin.y || y1 > box->origin.y + box->size.y)
+			return FALSE;
+	}
+	else
+	{
+		t_a = (box->origin.y - y1) / dy;
+		t_b = (box->origin.y + box->size.y - y1) / dy;
+		t_min = maximum(t_min, minimum(t_a, t_b));
+		t_max = minimum(t_max, maximum(t_a, t_b));
+	}
+
+	*t_enter = t_min;
+
+	return t_min <= t_max;
+}
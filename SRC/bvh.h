@@ -0,0 +1,38 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "types.h"
+
+void bvh_build(bvh_t *bvh, objects_t **objects, int num_objects);
+void bvh_free(bvh_t *bvh);
+double bvh_raycast(bvh_t *bvh, line_segment_t *beam, double (*fptr_hit)(int object_idx, void *context), void *context);
+void bvh_query_overlap(bvh_t *bvh, rectangle_t *box, void (*fptr_found)(int object_idx, void *context), void *context);
+short bvh_ray_enters_box(rectangle_t *box, double x1, double y1, double dx, double dy, double *t_enter);
+
+#endif
@@ -35,7 +35,11 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "argparse.hpp"
 #include "read_xml_config_file.h"
 #include "simulation.h"
-#include "log_file_xml.h"
+#include "log_file.h"
+#include "thread_pool.h"
+#include "batch.h"
+#include "profile.h"
+#include "checkpoint.h"
 
 /* globals */
 global_args_t global_args;
@@ -53,6 +57,8 @@ void get_options(int argc, char** argv);
 
 int main(int argc, char **argv)
 {
+	checkpoint_t *resume = NULL;
+
 	printf("--------------------------------------------------------------------\n");
 	printf("Welcome the centurion simulator\n");
 	printf("Email: jamieson.peter@gmail.com\n\n");
@@ -60,24 +66,48 @@ int main(int argc, char **argv)
 	/* get the command line options */
 	get_options(argc, argv);
 
-	/* read config file */
-	read_config_file(global_args.config_file);
+	/* read config file - from the scenario cache when one is given and has this config */
+	read_config_file_with_cache(global_args.config_file, (strlen(global_args.scenario_cache) > 0) ? (char*)global_args.scenario_cache : NULL);
 
 	/* check parameters */
 
-	/* open final ouput files */
-	sim_system.Fdebug_out = fopen(sim_system.debug_file_out, "w");
-	oassert(sim_system.Fdebug_out != NULL);
-	sim_system.Fsim_log_out = fopen(sim_system.sim_log_file_out, "w");
-	oassert(sim_system.Fsim_log_out != NULL);
+	/* many seeds of the same config - each run is its own process */
+	if (global_args.num_runs > 0)
+	{
+		run_batch(global_args.num_runs, (global_args.seed_start < 0) ? sim_system.rand_seed : global_args.seed_start, global_args.num_threads, global_args.output_file);
+		return 1;
+	}
+
+	/* runs that share everything up to --branch-at - the prefix is run once and each branch forked from it */
+	if (strlen(global_args.branches_file) > 0)
+	{
+		run_branches(global_args.branch_at_s, global_args.branches_file, global_args.num_threads, global_args.output_file);
+		return 1;
+	}
+
+	/* open final ouput files - a resumed run reopens them where the checkpoint was taken */
+	if (strlen(global_args.resume_file) > 0)
+	{
+		resume = checkpoint_open_read(global_args.resume_file);
+	}
+	else
+	{
+		sim_system.Fdebug_out = fopen(sim_system.debug_file_out, "w");
+		oassert(sim_system.Fdebug_out != NULL);
+		output_log_open(sim_system.sim_log_file_out);
+	}
 
 	/* set randomization */
 	srand(sim_system.rand_seed);
 	rand_float_seed(sim_system.rand_seed);
 	printf("rand seed: %d\n", sim_system.rand_seed);
 
+	/* timers of the hot paths - only with -DCENTURION_PROFILE */
+	PROFILE_START();
+
 	/* start log file */
-	sim_system.output_log_tab_step = output_log_file_xml_header();
+	if (resume == NULL)
+		output_log_header();
 
 	/* ---- BASIC Sequential GA Executions ---- */
 	if (strcmp(sim_system.simulation_type, "discrete") == 0)
@@ -86,8 +116,29 @@ int main(int argc, char **argv)
 		/* initialize everything for simulation */
 		setup_simulation();
 
+		/* threads that share the agents each epoch */
+		printf("Using %d threads\n", global_args.num_threads.value());
+		thread_pool_start(global_args.num_threads);
+
 		/* run the simulation loop */
-		simulation_loop();
+		simulation_loop(resume);
+
+		thread_pool_stop();
+	}
+	else if (strcmp(sim_system.simulation_type, "event") == 0)
+	{
+		printf("Doing Event Simulation\n");
+		/* initialize everything for simulation */
+		setup_simulation();
+
+		/* threads that share the agents woken at an epoch */
+		printf("Using %d threads\n", global_args.num_threads.value());
+		thread_pool_start(global_args.num_threads);
+
+		/* only run agents when something can change */
+		event_simulation_loop(resume);
+
+		thread_pool_stop();
 	}
 	else
 	{
@@ -95,12 +146,14 @@ int main(int argc, char **argv)
 	}
 
 	/* end log file */
-	output_log_file_xml_footer(sim_system.output_log_tab_step);
+	output_log_footer();
+
+	PROFILE_REPORT(global_args.profile_file);
 
 	/*-------------------FREE_PROBLEM------------------*/
 	/* free the problem */
 	fclose(sim_system.Fdebug_out);
-	fclose(sim_system.Fsim_log_out);
+	output_log_close();
 
 	return 1;
 }
@@ -132,6 +185,54 @@ void get_options(int argc, char** argv)
 		.metavar("TEST_FILE_PATH")
 		;
 
+	parser.add_argument(global_args.num_threads, "--threads")
+		.help("Number of threads sharing the agents each epoch (the log is the same for any number) or of runs at a time with -n")
+		.default_value("1")
+		.metavar("NUM_THREADS")
+		;
+
+	parser.add_argument(global_args.num_runs, "-n")
+		.help("Batch of runs with seeds from --seed-start - --threads runs at a time and a summary line per run in -o")
+		.default_value("0")
+		.metavar("NUM_RUNS")
+		;
+
+	parser.add_argument(global_args.seed_start, "--seed-start")
+		.help("Seed of the first batch run (default is the config rand_seed)")
+		.default_value("-1")
+		.metavar("SEED")
+		;
+
+	parser.add_argument(global_args.branches_file, "--branches")
+		.help("Fork a run per line of BRANCHES_FILE (a seed then name=value config overrides) from one shared run up to --branch-at - --threads at a time and a summary line per branch in -o")
+		.default_value("")
+		.metavar("BRANCHES_FILE")
+		;
+
+	parser.add_argument(global_args.branch_at_s, "--branch-at")
+		.help("Simulated time in seconds the --branches runs split at")
+		.default_value("0")
+		.metavar("SECONDS")
+		;
+
+	parser.add_argument(global_args.profile_file, "--profile")
+		.help("Where the hot path timings go at exit (only when built with -DCENTURION_PROFILE=ON)")
+		.default_value("centurion_profile.txt")
+		.metavar("PROFILE_FILE")
+		;
+
+	parser.add_argument(global_args.scenario_cache, "--scenario-cache")
+		.help("Directory of binary scenario caches - a config read once is replayed from here on the next launch")
+		.default_value("")
+		.metavar("CACHE_DIR")
+		;
+
+	parser.add_argument(global_args.resume_file, "--resume")
+		.help("Carry on a run from a checkpoint written with the config's checkpoint_every_s - the same config has to be given with -c")
+		.default_value("")
+		.metavar("CHECKPOINT_FILE")
+		;
+
 	parser.add_argument(global_args.show_help, "-h")
 		.help("Display this help message")
 		.action(argparse::Action::HELP)
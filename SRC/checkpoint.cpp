@@ -0,0 +1,438 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "checkpoint.h"
+#include "log_file.h"
+#include "agent_index.h"
+
+/* 
+ * A checkpoint is what a run needs to carry on from the end of an epoch
+ * as if it had never stopped - the agent store, each agent's state and
+ * memories, the spatial grid, where the log and debug files were and the
+ * state of rand_float.  The memories are opaque here - each sensor,
+ * actuator and control type writes and reads back its own through the
+ * hooks set up with its function.  The noise of the devices is counter
+ * based (see rng.cpp) so it has no state to keep.  The loops add their own
+ * state after checkpoint_save_simulation.
+ *
+ * The logs are on disk before the checkpoint is and the checkpoint is
+ * renamed into place, so the last checkpoint is always whole and never
+ * ahead of the logs.  Resuming cuts the logs back to where it was taken.
+ */
+
+/* globals */
+
+#define CHECKPOINT_MAGIC "CENTCKPT"
+#define CHECKPOINT_VERSION 2
+
+struct checkpoint_t_t
+{
+	FILE *file;
+	char *file_name;
+	char *temp_file_name; // NULL when reading
+};
+
+double checkpoint_next_time;
+
+void checkpoint_put_memory(checkpoint_t *checkpoint, void *memory, void (*fptr_save)(void *memory, checkpoint_t *checkpoint));
+void *checkpoint_get_memory(checkpoint_t *checkpoint, void* (*fptr_load)(checkpoint_t *checkpoint));
+void checkpoint_check_int(checkpoint_t *checkpoint, int value, const char *what);
+FILE *checkpoint_reopen_file(char *file_name, long long position);
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_open_write)
+ *-----------------------------------------------------------------------*/
+checkpoint_t *checkpoint_open_write(char *file_name)
+{
+	checkpoint_t *checkpoint = (checkpoint_t*)malloc(sizeof(checkpoint_t));
+	int length = strlen(file_name) + 5;
+
+	checkpoint->file_name = strdup(file_name);
+	checkpoint->temp_file_name = (char*)malloc(length);
+	snprintf(checkpoint->temp_file_name, length, "%s.tmp", file_name);
+
+	checkpoint->file = fopen(checkpoint->temp_file_name, "wb");
+	if (checkpoint->file == NULL)
+	{
+		printf("Could not write checkpoint %s\n", checkpoint->temp_file_name);
+		oassert(FALSE);
+	}
+
+	return checkpoint;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_open_read)
+ *-----------------------------------------------------------------------*/
+checkpoint_t *checkpoint_open_read(char *file_name)
+{
+	checkpoint_t *checkpoint = (checkpoint_t*)malloc(sizeof(checkpoint_t));
+
+	checkpoint->file_name = strdup(file_name);
+	checkpoint->temp_file_name = NULL;
+
+	checkpoint->file = fopen(file_name, "rb");
+	if (checkpoint->file == NULL)
+	{
+		printf("Could not read checkpoint %s\n", file_name);
+		oassert(FALSE);
+	}
+
+	return checkpoint;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_close)
+ * A written checkpoint only replaces the last one once it is on disk.
+ *-----------------------------------------------------------------------*/
+void checkpoint_close(checkpoint_t *checkpoint)
+{
+	if (checkpoint->temp_file_name != NULL)
+	{
+		oassert(fflush(checkpoint->file) == 0);
+		oassert(fsync(fileno(checkpoint->file)) == 0);
+		oassert(fclose(checkpoint->file) == 0);
+		oassert(rename(checkpoint->temp_file_name, checkpoint->file_name) == 0);
+		free(checkpoint->temp_file_name);
+	}
+	else
+	{
+		fclose(checkpoint->file);
+	}
+
+	free(checkpoint->file_name);
+	free(checkpoint);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_put)
+ *-----------------------------------------------------------------------*/
+void checkpoint_put(checkpoint_t *checkpoint, const void *data, size_t size)
+{
+	if (size == 0)
+		return;
+
+	oassert(fwrite(data, size, 1, checkpoint->file) == 1);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_get)
+ *-----------------------------------------------------------------------*/
+void checkpoint_get(checkpoint_t *checkpoint, void *data, size_t size)
+{
+	if (size == 0)
+		return;
+
+	if (fread(data, size, 1, checkpoint->file) != 1)
+	{
+		printf("Checkpoint %s is cut short\n", checkpoint->file_name);
+		oassert(FALSE);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_start)
+ * The next checkpoint is at the next multiple of checkpoint_every_s.
+ *-----------------------------------------------------------------------*/
+void checkpoint_start(double current_time)
+{
+	double half_epoch = environment.sim_time_computation_epoch_s / 2;
+
+	if (sim_system.checkpoint_every_s <= 0)
+		return;
+
+	checkpoint_next_time = (floor((current_time + half_epoch) / sim_system.checkpoint_every_s) + 1) * sim_system.checkpoint_every_s;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_due)
+ * TRUE at the end of the first epoch at or past the next checkpoint time.
+ * Times are sums of the epoch so half an epoch of slack is allowed.
+ *-----------------------------------------------------------------------*/
+short checkpoint_due(double current_time)
+{
+	double half_epoch = environment.sim_time_computation_epoch_s / 2;
+
+	if (sim_system.checkpoint_every_s <= 0 || current_time + half_epoch < checkpoint_next_time)
+		return FALSE;
+
+	checkpoint_start(current_time);
+
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_save_simulation)
+ * Called at the end of an epoch once the logs of it are written.
+ *-----------------------------------------------------------------------*/
+void checkpoint_save_simulation(checkpoint_t *checkpoint, double current_time, short event_simulation)
+{
+	int i, j;
+	int version = CHECKPOINT_VERSION;
+	long long debug_position;
+
+	/* what the config has to match to resume */
+	checkpoint_put(checkpoint, CHECKPOINT_MAGIC, 8);
+	checkpoint_put(checkpoint, &version, sizeof(int));
+	checkpoint_put(checkpoint, &event_simulation, sizeof(short));
+	checkpoint_put(checkpoint, &sim_system.rand_seed, sizeof(int));
+	checkpoint_put(checkpoint, &environment.sim_time_computation_epoch_s, sizeof(double));
+	checkpoint_put(checkpoint, &environment.num_objects, sizeof(int));
+	checkpoint_put(checkpoint, &agent_groups.num_agent_groups, sizeof(int));
+	for (i = 0; i < agent_groups.num_agent_groups; i++)
+	{
+		checkpoint_put(checkpoint, &agent_groups.agent_group[i]->num_agents, sizeof(int));
+		checkpoint_put(checkpoint, &agent_groups.agent_group[i]->num_sensors, sizeof(int));
+		checkpoint_put(checkpoint, &agent_groups.agent_group[i]->num_actuators, sizeof(int));
+	}
+
+	checkpoint_put(checkpoint, &current_time, sizeof(double));
+	rand_float_checkpoint_save(checkpoint);
+
+	/* the outputs are on disk up to here */
+	fflush(sim_system.Fdebug_out);
+	fsync(fileno(sim_system.Fdebug_out));
+	debug_position = ftello(sim_system.Fdebug_out);
+	checkpoint_put(checkpoint, &debug_position, sizeof(long long));
+	output_log_checkpoint_save(checkpoint);
+
+	/* the agent store */
+	checkpoint_put(checkpoint, agent_store.x, sizeof(double) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.y, sizeof(double) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.angle, sizeof(double) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.radius, sizeof(double) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.next_x, sizeof(double) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.next_y, sizeof(double) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.next_angle, sizeof(double) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.state, sizeof(int) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.not_physical, sizeof(short) * agent_store.num_agents);
+	checkpoint_put(checkpoint, agent_store.crashed, sizeof(short) * agent_store.num_agents);
+
+	/* each agent's state and memories */
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		agent_t *agent = agent_store.agents[i];
+		agent_group_t *agent_group = agent->agent_group;
+
+		/* the beam hits of an epoch are logged at its commit */
+		oassert(agent->num_beam_hit_logs == 0);
+
+		checkpoint_put(checkpoint, &agent->time_in_state, sizeof(double));
+		checkpoint_put(checkpoint, &agent->last_time, sizeof(double));
+		checkpoint_put(checkpoint, &agent->wake_time, sizeof(double));
+		checkpoint_put(checkpoint, &agent->moving_until_time, sizeof(double));
+		checkpoint_put(checkpoint, &agent->num_last_contacts, sizeof(int));
+		checkpoint_put(checkpoint, agent->last_contacts, sizeof(int) * agent->num_last_contacts);
+
+		checkpoint_put_memory(checkpoint, agent->general_memory, agent_group->fptr_control_memory_save);
+		for (j = 0; j < agent_group->num_sensors; j++)
+		{
+			checkpoint_put_memory(checkpoint, agent->sensor_memories[j], agent_group->sensors[j]->fptr_sensor_memory_save);
+		}
+		for (j = 0; j < agent_group->num_actuators; j++)
+		{
+			checkpoint_put_memory(checkpoint, agent->actuator_memories[j], agent_group->actuators[j]->fptr_actuator_memory_save);
+		}
+	}
+
+	/* the order agents sit in the cells decides ties between equally close hits */
+	agent_index_checkpoint_save(checkpoint);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_load_simulation)
+ * Called after setup_simulation in place of opening the debug file and
+ * logs - they are opened and cut back to where the checkpoint was taken.
+ *-----------------------------------------------------------------------*/
+void checkpoint_load_simulation(checkpoint_t *checkpoint, double *current_time, short event_simulation)
+{
+	int i, j;
+	char magic[8];
+	int version;
+	short checkpoint_event_simulation;
+	int rand_seed;
+	double epoch_s;
+	long long debug_position;
+
+	checkpoint_get(checkpoint, magic, 8);
+	checkpoint_get(checkpoint, &version, sizeof(int));
+	if (memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 || version != CHECKPOINT_VERSION)
+	{
+		printf("%s is not a checkpoint of this version\n", checkpoint->file_name);
+		oassert(FALSE);
+	}
+	checkpoint_get(checkpoint, &checkpoint_event_simulation, sizeof(short));
+	checkpoint_get(checkpoint, &rand_seed, sizeof(int));
+	checkpoint_get(checkpoint, &epoch_s, sizeof(double));
+	if (checkpoint_event_simulation != event_simulation || rand_seed != sim_system.rand_seed || epoch_s != environment.sim_time_computation_epoch_s)
+	{
+		printf("Checkpoint %s is of a different simulation type, rand_seed or epoch\n", checkpoint->file_name);
+		oassert(FALSE);
+	}
+	checkpoint_check_int(checkpoint, environment.num_objects, "objects");
+	checkpoint_check_int(checkpoint, agent_groups.num_agent_groups, "agent groups");
+	for (i = 0; i < agent_groups.num_agent_groups; i++)
+	{
+		checkpoint_check_int(checkpoint, agent_groups.agent_group[i]->num_agents, "agents in a group");
+		checkpoint_check_int(checkpoint, agent_groups.agent_group[i]->num_sensors, "sensors in a group");
+		checkpoint_check_int(checkpoint, agent_groups.agent_group[i]->num_actuators, "actuators in a group");
+	}
+
+	checkpoint_get(checkpoint, current_time, sizeof(double));
+	rand_float_checkpoint_load(checkpoint);
+
+	checkpoint_get(checkpoint, &debug_position, sizeof(long long));
+	sim_system.Fdebug_out = checkpoint_reopen_file(sim_system.debug_file_out, debug_position);
+	output_log_checkpoint_load(checkpoint);
+
+	checkpoint_get(checkpoint, agent_store.x, sizeof(double) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.y, sizeof(double) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.angle, sizeof(double) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.radius, sizeof(double) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.next_x, sizeof(double) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.next_y, sizeof(double) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.next_angle, sizeof(double) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.state, sizeof(int) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.not_physical, sizeof(short) * agent_store.num_agents);
+	checkpoint_get(checkpoint, agent_store.crashed, sizeof(short) * agent_store.num_agents);
+
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		agent_t *agent = agent_store.agents[i];
+		agent_group_t *agent_group = agent->agent_group;
+
+		checkpoint_get(checkpoint, &agent->time_in_state, sizeof(double));
+		checkpoint_get(checkpoint, &agent->last_time, sizeof(double));
+		checkpoint_get(checkpoint, &agent->wake_time, sizeof(double));
+		checkpoint_get(checkpoint, &agent->moving_until_time, sizeof(double));
+		checkpoint_get(checkpoint, &agent->num_last_contacts, sizeof(int));
+		if (agent->num_last_contacts > agent->alloc_last_contacts)
+		{
+			agent->alloc_last_contacts = agent->num_last_contacts;
+			agent->last_contacts = (int*)realloc(agent->last_contacts, sizeof(int) * agent->alloc_last_contacts);
+		}
+		checkpoint_get(checkpoint, agent->last_contacts, sizeof(int) * agent->num_last_contacts);
+
+		agent->general_memory = checkpoint_get_memory(checkpoint, agent_group->fptr_control_memory_load);
+		for (j = 0; j < agent_group->num_sensors; j++)
+		{
+			agent->sensor_memories[j] = checkpoint_get_memory(checkpoint, agent_group->sensors[j]->fptr_sensor_memory_load);
+		}
+		for (j = 0; j < agent_group->num_actuators; j++)
+		{
+			agent->actuator_memories[j] = checkpoint_get_memory(checkpoint, agent_group->actuators[j]->fptr_actuator_memory_load);
+		}
+	}
+
+	agent_index_checkpoint_load(checkpoint);
+
+	printf("Resumed from checkpoint %s at time: %f\n", checkpoint->file_name, *current_time);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_put_memory)
+ *-----------------------------------------------------------------------*/
+void checkpoint_put_memory(checkpoint_t *checkpoint, void *memory, void (*fptr_save)(void *memory, checkpoint_t *checkpoint))
+{
+	short has_memory = (memory != NULL);
+
+	checkpoint_put(checkpoint, &has_memory, sizeof(short));
+	if (has_memory == FALSE)
+		return;
+
+	if (fptr_save == NULL)
+	{
+		printf("A sensor, actuator or control with memory has no checkpoint hook\n");
+		oassert(FALSE);
+	}
+	(*fptr_save)(memory, checkpoint);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_get_memory)
+ *-----------------------------------------------------------------------*/
+void *checkpoint_get_memory(checkpoint_t *checkpoint, void* (*fptr_load)(checkpoint_t *checkpoint))
+{
+	short has_memory;
+
+	checkpoint_get(checkpoint, &has_memory, sizeof(short));
+	if (has_memory == FALSE)
+		return NULL;
+
+	oassert(fptr_load != NULL);
+	return (*fptr_load)(checkpoint);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_check_int)
+ *-----------------------------------------------------------------------*/
+void checkpoint_check_int(checkpoint_t *checkpoint, int value, const char *what)
+{
+	int checkpoint_value;
+
+	checkpoint_get(checkpoint, &checkpoint_value, sizeof(int));
+	if (checkpoint_value != value)
+	{
+		printf("Checkpoint %s has %d %s and the config %d\n", checkpoint->file_name, checkpoint_value, what, value);
+		oassert(FALSE);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: checkpoint_reopen_file)
+ * Opens an output to carry on writing at position - what a run wrote
+ * after its checkpoint is cut off.
+ *-----------------------------------------------------------------------*/
+FILE *checkpoint_reopen_file(char *file_name, long long position)
+{
+	FILE *file;
+	int fd = open(file_name, O_WRONLY | O_CREAT, 0644);
+
+	oassert(fd >= 0);
+	if (lseek(fd, 0, SEEK_END) < position)
+	{
+		printf("%s is shorter than its checkpoint\n", file_name);
+		oassert(FALSE);
+	}
+	oassert(ftruncate(fd, position) == 0);
+	oassert(lseek(fd, position, SEEK_SET) == position);
+
+	file = fdopen(fd, "wb");
+	oassert(file != NULL);
+
+	return file;
+}
@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "types.h"
+
+/* a checkpoint file - written aside and renamed into place on close */
+checkpoint_t *checkpoint_open_write(char *file_name);
+checkpoint_t *checkpoint_open_read(char *file_name);
+void checkpoint_close(checkpoint_t *checkpoint);
+void checkpoint_put(checkpoint_t *checkpoint, const void *data, size_t size);
+void checkpoint_get(checkpoint_t *checkpoint, void *data, size_t size);
+
+/* when the loops write one - every sim_system.checkpoint_every_s of simulated time */
+void checkpoint_start(double current_time);
+short checkpoint_due(double current_time);
+
+/* everything but the loop's own state */
+void checkpoint_save_simulation(checkpoint_t *checkpoint, double current_time, short event_simulation);
+void checkpoint_load_simulation(checkpoint_t *checkpoint, double *current_time, short event_simulation);
+
+#endif
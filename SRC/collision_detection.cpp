@@ -111,7 +111,7 @@ short circle_oriented_rectangle_collide( circle_t* c,  oriented_rectangle_t_t* r
 
 	circle_t lc = {{0, 0}, c->radius};
 	lc.center = subtract_vector(&c->center, &r->center);
-	lc.center = rotate_vector(&lc.center, -r->rotation);
+	lc.center = rotate_vector_into_rectangle(&lc.center, r);
 	lc.center = add_vector(&lc.center, &r->halfExtend);
 
 	return circle_rectangle_collide(&lc, &lr);
@@ -241,9 +241,9 @@ short line_oriented_rectangle_collide( line_t* l,  oriented_rectangle_t_t* r)
 
 	line_t ll;
 	ll.base = subtract_vector(&l->base, &r->center);
-	ll.base = rotate_vector(&ll.base, -r->rotation);
+	ll.base = rotate_vector_into_rectangle(&ll.base, r);
 	ll.base = add_vector(&ll.base, &r->halfExtend);
-	ll.direction = rotate_vector(&l->direction, -r->rotation);
+	ll.direction = rotate_vector_into_rectangle(&l->direction, r);
 
 	return line_rectangle_collide(&ll, &lr);
 }
@@ -289,7 +289,7 @@ short oriented_rectangle_point_collide( oriented_rectangle_t_t* r,  vector_2D_t*
 {
 	rectangle_t lr = {{0, 0}, {r->halfExtend.x * 2, r->halfExtend.y * 2}};
 	vector_2D_t lp = subtract_vector(p, &r->center);
-	lp = rotate_vector(&lp, -r->rotation);
+	lp = rotate_vector_into_rectangle(&lp, r);
 	lp = add_vector(&lp, &r->halfExtend);
 
 	return point_rectangle_collide(&lp, &lr);
@@ -301,8 +301,7 @@ short oriented_rectangle_point_collide( oriented_rectangle_t_t* r,  vector_2D_t*
 short oriented_rectangle_rectangle_collide( oriented_rectangle_t_t* orect,  rectangle_t* aar)
 {
 	line_segment_t edge;
-	rectangle_t orHull = oriented_rectangle_rectangle_hull(orect);
-	if(!rectangles_collide(&orHull, aar))
+	if(!rectangles_collide(&orect->hull, aar))
 		return FALSE;
 
 	edge = oriented_rectangle_edge(orect, 0);
@@ -351,10 +350,10 @@ short oriented_rectangle_segment_collide( oriented_rectangle_t_t* r,  line_segme
 
 	line_segment_t ls;
 	ls.point1 = subtract_vector(&s->point1, &r->center);
-	ls.point1 = rotate_vector(&ls.point1, -r->rotation);
+	ls.point1 = rotate_vector_into_rectangle(&ls.point1, r);
 	ls.point1 = add_vector(&ls.point1, &r->halfExtend);
 	ls.point2 = subtract_vector(&s->point2, &r->center);
-	ls.point2 = rotate_vector(&ls.point2, -r->rotation);
+	ls.point2 = rotate_vector_into_rectangle(&ls.point2, r);
 	ls.point2 = add_vector(&ls.point2, &r->halfExtend);
 
 	return rectangle_segment_collide(&lr, &ls);
@@ -460,65 +459,81 @@ vector_2D_t rectangle_corner( rectangle_t* r, int nr)
 
 /*---------------------------------------------------------------------------------------------
  * (function: oriented_rectangle_corner)
+ * nr is 0 to 3 - cached by oriented_rectangle_update
  *-------------------------------------------------------------------------------------------*/
 vector_2D_t oriented_rectangle_corner( oriented_rectangle_t_t* r, int nr)
 {
-	vector_2D_t c = r->halfExtend;
-
-	switch(nr % 4) {
-		case 0:
-			c.x = -c.x;
-			break;
-		case 1:
-			/* c = r->halfExtend */
-			break;
-		case 2:
-			c.y = -c.y;
-			break;
-		default:
-			c = negate_vector(&c);
-			break;
+	return r->corners[nr & 3];
+}
+
+/*---------------------------------------------------------------------------------------------
+ * (function: oriented_rectangle_update)
+ * Works out the sine and cosine of the rotation, the corners, the points
+ * and the hull.  Each is computed the way the functions that use them did
+ * before they were cached so the results do not change.
+ *-------------------------------------------------------------------------------------------*/
+void oriented_rectangle_update( oriented_rectangle_t_t* r)
+{
+	int nr;
+	double radian = degrees_to_radian(r->rotation);
+	double cx = r->center.x;
+	double cy = r->center.y;
+	double x0, y0;
+	vector_2D_t c;
+
+	r->sine = sinf(radian);
+	r->cosine = cosf(radian);
+
+	for(nr = 0; nr < 4; ++nr)
+	{
+		c = r->halfExtend;
+		switch(nr) {
+			case 0:
+				c.x = -c.x;
+				break;
+			case 1:
+				/* c = r->halfExtend */
+				break;
+			case 2:
+				c.y = -c.y;
+				break;
+			default:
+				c = negate_vector(&c);
+				break;
+		}
+		c = rotate_vector(&c, r->rotation);
+		r->corners[nr] = add_vector(&c, &r->center);
 	}
 
-	c = rotate_vector(&c, r->rotation);
+	/* rectangles points    a b
+	 * 			d c */
+	for(nr = 0; nr < 4; ++nr)
+	{
+		x0 = (nr == 0 || nr == 3) ? cx - r->halfExtend.x : cx + r->halfExtend.x;
+		y0 = (nr == 0 || nr == 1) ? cy + r->halfExtend.y : cy - r->halfExtend.y;
+		r->points[nr].x = cx + r->cosine*(x0 - cx) - r->sine*(y0 - cy);
+		r->points[nr].y = cy + r->sine*(x0 - cx) + r->cosine*(y0 - cy);
+	}
 
-	return add_vector(&c, &r->center);
+	r->hull.origin = r->center;
+	r->hull.size.x = 0;
+	r->hull.size.y = 0;
+	for(nr = 0; nr < 4; ++nr)
+	{
+		r->hull = enlarge_rectangle_point(&r->hull, &r->corners[nr]);
+	}
 }
 
 /*---------------------------------------------------------------------------------------------
  * (function: oriented_rectangle_edge)
+ * edge nr goes from corner nr to corner nr+1
  *-------------------------------------------------------------------------------------------*/
 line_segment_t oriented_rectangle_edge( oriented_rectangle_t_t* r, int nr)
 {
 	line_segment_t edge;
-	vector_2D_t a = r->halfExtend;
-	vector_2D_t b = r->halfExtend;
-
-	switch(nr % 4) {
-		case 0:/* top edge */
-			a.x = -a.x;
-			break;
-		case 1:/* right edge */
-			b.y = -b.y;
-			break;
-		case 2:/* bottom edge */
-			a.y = -a.y;
-			b = negate_vector(&b);
-			break;
-		default:/* left edge */
-			a = negate_vector(&a);
-			b.x = -b.x;
-			break;
-	}
-
-	a = rotate_vector(&a, r->rotation);
-	a = add_vector(&a, &r->center);
-
-	b = rotate_vector(&b, r->rotation);
-	b = add_vector(&b, &r->center);
 
-	edge.point1 = a;
-	edge.point2 = b;
+	edge.point1 = r->corners[nr & 3];
+	edge.point2 = r->corners[(nr + 1) & 3];
 
 	return edge;
 }
@@ -735,6 +750,17 @@ vector_2D_t rotate_vector( vector_2D_t* v, double degrees)
 	return r;
 }
 
+/*---------------------------------------------------------------------------------------------
+ * (function: rotate_vector_into_rectangle)
+ * rotate_vector(v, -r->rotation) with the cached sine and cosine
+ *-------------------------------------------------------------------------------------------*/
+vector_2D_t rotate_vector_into_rectangle( vector_2D_t* v, oriented_rectangle_t_t* r)
+{
+	vector_2D_t rotated = {v->x * r->cosine + v->y * r->sine, v->y * r->cosine - v->x * r->sine};
+
+	return rotated;
+}
+
 /*---------------------------------------------------------------------------------------------
  * (function: rotate_vector_90)
  *-------------------------------------------------------------------------------------------*/
@@ -839,20 +865,19 @@ rectangle_t enlarge_rectangle_point( rectangle_t* r,  vector_2D_t* p)
  *-------------------------------------------------------------------------------------------*/
 rectangle_t oriented_rectangle_rectangle_hull( oriented_rectangle_t* r)
 {
-	int nr;
-	rectangle_t h = {{r->center.x, r->center.y}, {0, 0}};
-
-	vector_2D_t corner;
-
-	for(nr = 0; nr < 4; ++nr)
-	{
-		corner = oriented_rectangle_corner(r, nr);
-		h = enlarge_rectangle_point(&h, &corner);
-	}
+	return r->hull;
+}
+ 
+/*---------------------------------------------------------------------------------------------
+ * (function: circle_rectangle_hull)
+ *-------------------------------------------------------------------------------------------*/
+rectangle_t circle_rectangle_hull( circle_t* c)
+{
+	rectangle_t h = {{c->center.x - c->radius, c->center.y - c->radius}, {2 * c->radius, 2 * c->radius}};
 
 	return h;
 }
- 
+
 /*---------------------------------------------------------------------------------------------
  * (function: square)
  *-------------------------------------------------------------------------------------------*/
@@ -886,14 +911,12 @@ double helper_function_fy(double A, double B, double C, double y)
 }
  
 /*---------------------------------------------------------------------------------------------
- * (function: segment_intersects_circle_at) 
- * returns NULL if no intersection
- *
- * Prints the intersection points (if any) of a circle, center 'cp' with radius , 
- * and either a segment drawn between those points.  
+ * (function: segment_intersects_circle_hits) 
+ * returns the intersection points (if any) of a circle, center 'cp' with radius , 
+ * and a segment drawn between those points.  
  * CODE from : https://rosettacode.org/wiki/Line_circle_intersection#C
  *-------------------------------------------------------------------------------------------*/
-points_t *segment_intersects_circle_at(line_segment_t *line_segment, circle_t *circle)
+segment_hits_t segment_intersects_circle_hits(line_segment_t *line_segment, circle_t *circle)
 {
 	double epsilon = 1.0f / 8192.0f;/* should be small eFALSEugh for 1.0f == pixel width */
 	double x0 = circle->center.x;
@@ -909,9 +932,12 @@ points_t *segment_intersects_circle_at(line_segment_t *line_segment, circle_t *c
 	double a = square(A) + square(B); // length vector
 	double b, c, d;
 	short bnz = TRUE;
-	int cnt = 0;
+	int i;
+	int num_roots;
+	double roots[2];
 
-	points_t *return_points = NULL;
+	segment_hits_t hits;
+	hits.num_points = 0;
  
 	if (fabs(B) >= epsilon) 
 	{
@@ -929,145 +955,49 @@ points_t *segment_intersects_circle_at(line_segment_t *line_segment, circle_t *c
 	if (d < 0) 
 	{
 		// line & circle don't intersect
-		return return_points;
+		return hits;
 	}
  
 	if (d == 0) 
 	{
 		// line is tangent to circle, so just one intersect at most
-		
-		return_points = (points_t*)malloc(sizeof(points_t));
-		return_points->num_points = 1;
-		return_points->points = (vector_2D_t**)malloc(sizeof(vector_2D_t*));
-		return_points->points[0] = (vector_2D_t*)malloc(sizeof(vector_2D_t));
-
-		if (bnz) 
-		{
-			double x = -b / (2 * a);
-			double y = helper_function_fx(A, B, C, x);
-
-			if (helper_point_within_rectangle(x1, y1, x2, y2, x, y))
-			{
-				return_points->points[0]->x = x;	
-				return_points->points[0]->y = y;	
-			}
-			else
-			{
-				return_points->num_points = 0;
-				free(return_points->points[0]);
-				free(return_points->points);
-				free(return_points);
-				return_points = NULL;
-			}
-		} 
-		else 
-		{
-			double y = -b / (2 * a);
-			double x = helper_function_fy(A, B, C, y);
-
-			if (helper_point_within_rectangle(x1, y1, x2, y2, x, y))
-			{
-				return_points->points[0]->x = x;	
-				return_points->points[0]->y = y;	
-			}
-			else
-			{
-				return_points->num_points = 0;
-				free(return_points->points[0]);
-				free(return_points->points);
-				free(return_points);
-				return_points = NULL;
-			}
-		}
+		num_roots = 1;
+		roots[0] = -b / (2 * a);
 	} 
 	else 
 	{
 		// two intersects at most
-		return_points = (points_t*)malloc(sizeof(points_t));
-		return_points->num_points = 2;
-		return_points->points = (vector_2D_t**)malloc(sizeof(vector_2D_t*)*2);
-		return_points->points[0] = (vector_2D_t*)malloc(sizeof(vector_2D_t));
-		return_points->points[1] = (vector_2D_t*)malloc(sizeof(vector_2D_t));
-		cnt = 1;
-
+		num_roots = 2;
 		d = sqrt(d);
+		roots[0] = (-b + d) / (2 * a);
+		roots[1] = (-b - d) / (2 * a);
+	}
+
+	/* roots are x if B is not zero otherwise y - keep the ones on the segment */
+	for (i = 0; i < num_roots; i++)
+	{
+		double x, y;
+
 		if (bnz) 
 		{
-			double x = (-b + d) / (2 * a);
-			double y = helper_function_fx(A, B, C, x);
-
-			if (helper_point_within_rectangle(x1, y1, x2, y2, x, y))
-			{
-				return_points->points[0]->x = x;	
-				return_points->points[0]->y = y;	
-			}
-			else
-			{
-				return_points->num_points --;
-				free(return_points->points[1]);
-				cnt--;
-			}
- 
-			x = (-b - d) / (2 * a);
+			x = roots[i];
 			y = helper_function_fx(A, B, C, x);
-
-			if (helper_point_within_rectangle(x1, y1, x2, y2, x, y))
-			{
-				return_points->points[cnt]->x = x;	
-				return_points->points[cnt]->y = y;	
-			}
-			else if (cnt == 1)
-			{
-				return_points->num_points --;
-				free(return_points->points[cnt]);
-				cnt--;
-			}
-			else if (cnt == 0)
-			{
-				return_points->num_points = 0;
-				free(return_points->points[0]);
-				free(return_points->points);
-				free(return_points);
-				return_points = NULL;
-			}
 		} 
 		else 
 		{
-			double y = (-b + d) / (2 * a);
-			double x = helper_function_fy(A, B, C, y);
-
-			if (helper_point_within_rectangle(x1, y1, x2, y2, x, y))
-			{
-				return_points->points[0]->x = x;	
-				return_points->points[0]->y = y;	
-			}
- 
-			y = (-b - d) / (2 * a);
+			y = roots[i];
 			x = helper_function_fy(A, B, C, y);
+		}
 
-			if (helper_point_within_rectangle(x1, y1, x2, y2, x, y))
-			{
-				return_points->points[cnt]->x = x;	
-				return_points->points[cnt]->y = y;	
-			}
-			else if (cnt == 1)
-			{
-				return_points->num_points --;
-				free(return_points->points[cnt]);
-				cnt--;
-			}
-			else if (cnt == 0)
-			{
-				return_points->num_points = 0;
-				free(return_points->points[0]);
-				free(return_points->points);
-				free(return_points);
-				return_points = NULL;
-			}
+		if (helper_point_within_rectangle(x1, y1, x2, y2, x, y))
+		{
+			hits.points[hits.num_points].x = x;	
+			hits.points[hits.num_points].y = y;	
+			hits.num_points ++;
 		}
 	}
  
-	return return_points;
+	return hits;
 }
 
 
@@ -1163,109 +1093,46 @@ void oriented_rectangle_to_points(vector_2D_t *a, vector_2D_t *b, vector_2D_t *c
 {
 	/* rectangles points    a b
 	 * 			d c */
-	double radian = degrees_to_radian(rectangle->rotation);
-	double sine = sinf(radian);
-	double cosine = cosf(radian);
-	double cx = rectangle->center.x;
-	double cy = rectangle->center.y;
-	double x0 = cx - rectangle->halfExtend.x;
-	double y0 = cy + rectangle->halfExtend.y;
-	a->x = cx + cosine*(x0 - cx) - sine*(y0 - cy);
-	a->y = cy + sine*(x0 - cx) + cosine*(y0 - cy);
-	double x1 = cx + rectangle->halfExtend.x;
-	double y1 = cy + rectangle->halfExtend.y;
-	b->x = cx + cosine*(x1 - cx) - sine*(y1 - cy);
-	b->y = cy + sine*(x1 - cx) + cosine*(y1 - cy);
-	double x2 = cx + rectangle->halfExtend.x;
-	double y2 = cy - rectangle->halfExtend.y;
-	c->x = cx + cosine*(x2 - cx) - sine*(y2 - cy);
-	c->y = cy + sine*(x2 - cx) + cosine*(y2 - cy);
-	double x3 = cx - rectangle->halfExtend.x;
-	double y3 = cy - rectangle->halfExtend.y;
-	d->x = cx + cosine*(x3 - cx) - sine*(y3 - cy);
-	d->y = cy + sine*(x3 - cx) + cosine*(y3 - cy);
-}
-
-/*---------------------------------------------------------------------------------------------
- * (function: segment_intersects_oriented_rectangle_at) 
- *-------------------------------------------------------------------------------------------*/
-points_t *segment_intersects_oriented_rectangle_at(line_segment_t *line_segment, oriented_rectangle_t *rectangle) 
+	*a = rectangle->points[0];
+	*b = rectangle->points[1];
+	*c = rectangle->points[2];
+	*d = rectangle->points[3];
+}
+
+/*---------------------------------------------------------------------------------------------
+ * (function: segment_intersects_oriented_rectangle_hits) 
+ * returns where the segment crosses each edge - two points unless it goes through a corner
+ *-------------------------------------------------------------------------------------------*/
+segment_hits_t segment_intersects_oriented_rectangle_hits(line_segment_t *line_segment, oriented_rectangle_t *rectangle) 
 {
 	/* rectangles points    a b
 	 * 			d c */
-	vector_2D_t a;
-	vector_2D_t b;
-	vector_2D_t c;
-	vector_2D_t d;
-	oriented_rectangle_to_points(&a, &b, &c, &d, rectangle);
+	vector_2D_t a = rectangle->points[0];
+	vector_2D_t b = rectangle->points[1];
+	vector_2D_t c = rectangle->points[2];
+	vector_2D_t d = rectangle->points[3];
 	
 	/* create line segments of rectangle */
-	line_segment_t a_b;
-	a_b.point1.x = a.x;
-	a_b.point1.y = a.y;
-	a_b.point2.x = b.x;
-	a_b.point2.y = b.y;
-	line_segment_t a_d;
-	a_d.point1.x = a.x;
-	a_d.point1.y = a.y;
-	a_d.point2.x = d.x;
-	a_d.point2.y = d.y;
-	line_segment_t b_c;
-	b_c.point1.x = b.x;
-	b_c.point1.y = b.y;
-	b_c.point2.x = c.x;
-	b_c.point2.y = c.y;
-	line_segment_t c_d;
-	c_d.point1.x = c.x;
-	c_d.point1.y = c.y;
-	c_d.point2.x = d.x;
-	c_d.point2.y = d.y;
-
-	points_t *return_points;	
-	return_points = (points_t *)malloc(sizeof(points_t));
-	return_points->points = (vector_2D_t **)malloc(sizeof(vector_2D_t*)*2);
-	return_points->num_points = 0;
-
-	vector_2D_t intersection_point;
-
-	if (line_segments_intersect_at(&a_b, line_segment, &intersection_point))
+	line_segment_t edges[4];
+	edges[0].point1 = a; // a_b
+	edges[0].point2 = b;
+	edges[1].point1 = a; // a_d
+	edges[1].point2 = d;
+	edges[2].point1 = b; // b_c
+	edges[2].point2 = c;
+	edges[3].point1 = c; // c_d
+	edges[3].point2 = d;
+
+	segment_hits_t hits;
+	hits.num_points = 0;
+
+	for (int i = 0; i < 4; i++)
 	{
-		return_points->points[return_points->num_points] = (vector_2D_t *)malloc(sizeof(vector_2D_t));
-		return_points->points[return_points->num_points]->x = intersection_point.x;
-		return_points->points[return_points->num_points]->y = intersection_point.y;
-		return_points->num_points ++;
-	}
-	if (line_segments_intersect_at(&a_d, line_segment, &intersection_point))
-	{
-		return_points->points[return_points->num_points] = (vector_2D_t *)malloc(sizeof(vector_2D_t));
-		return_points->points[return_points->num_points]->x = intersection_point.x;
-		return_points->points[return_points->num_points]->y = intersection_point.y;
-		return_points->num_points ++;
-	}
-	if (line_segments_intersect_at(&b_c, line_segment, &intersection_point))
-	{
-		return_points->points[return_points->num_points] = (vector_2D_t *)malloc(sizeof(vector_2D_t));
-		return_points->points[return_points->num_points]->x = intersection_point.x;
-		return_points->points[return_points->num_points]->y = intersection_point.y;
-		return_points->num_points ++;
-	}
-	if (line_segments_intersect_at(&c_d, line_segment, &intersection_point))
-	{
-		return_points->points[return_points->num_points] = (vector_2D_t *)malloc(sizeof(vector_2D_t));
-		return_points->points[return_points->num_points]->x = intersection_point.x;
-		return_points->points[return_points->num_points]->y = intersection_point.y;
-		return_points->num_points ++;
-	}
-
-	oassert(return_points->num_points <= 2);
-
-	if(return_points->num_points == 0)
-	{
-		/* clean up if no intersections */
-		free(return_points->points);
-		free(return_points);
-		return_points = NULL;
+		if (line_segments_intersect_at(&edges[i], line_segment, &hits.points[hits.num_points]))
+		{
+			hits.num_points ++;
+		}
 	}
 
-	return return_points;
+	return hits;
 }
@@ -29,8 +29,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #ifndef COLLISSION_H
 #define COLLISSION_H
 
-points_t *segment_intersects_circle_at(line_segment_t *line_segment, circle_t *circle);
-points_t *segment_intersects_oriented_rectangle_at(line_segment_t *line_segment, oriented_rectangle_t *rectangle) ;
+segment_hits_t segment_intersects_circle_hits(line_segment_t *line_segment, circle_t *circle);
+segment_hits_t segment_intersects_oriented_rectangle_hits(line_segment_t *line_segment, oriented_rectangle_t *rectangle);
 
 short line_segments_intersect_at(line_segment_t *A, line_segment_t *B, vector_2D_t *intersection) ;
 
@@ -66,6 +66,7 @@ short parallel_vectors( vector_2D_t* a,  vector_2D_t* b);
 short equal_vectors( vector_2D_t* a,  vector_2D_t* b);
 vector_2D_t rectangle_corner( rectangle_t* r, int nr);
 vector_2D_t oriented_rectangle_corner( oriented_rectangle_t_t* r, int nr);
+void oriented_rectangle_update( oriented_rectangle_t_t* r);
 line_segment_t oriented_rectangle_edge( oriented_rectangle_t_t* r, int nr);
 short separating_axis_for_oriented_rectangle( line_segment_t* axis,  oriented_rectangle_t_t* r);
 short separating_axis_for_rectangle( line_segment_t* axis,  rectangle_t* r);
@@ -86,6 +87,7 @@ vector_2D_t divide_vector( vector_2D_t* v, double d);
 double dot_product( vector_2D_t* a,  vector_2D_t* b);
 double vector_length( vector_2D_t* v);
 vector_2D_t rotate_vector( vector_2D_t* v, double degrees);
+vector_2D_t rotate_vector_into_rectangle( vector_2D_t* v, oriented_rectangle_t_t* r);
 vector_2D_t rotate_vector_90( vector_2D_t* v);
 vector_2D_t rotate_vector_180( vector_2D_t* v);
 vector_2D_t rotate_vector_270( vector_2D_t* v);
@@ -97,5 +99,6 @@ double segment_length(line_segment_t* a);
 
 rectangle_t enlarge_rectangle_point( rectangle_t* r,  vector_2D_t* p);
 rectangle_t oriented_rectangle_rectangle_hull( oriented_rectangle_t* r);
+rectangle_t circle_rectangle_hull( circle_t* c);
 
 #endif
@@ -34,6 +34,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "control_sensors_actuators.h"
 #include "sensors.h"
 #include "actuators.h"
+#include "group_kernel.h"
+#include "checkpoint.h"
 
 /* globals */
 
@@ -45,37 +47,50 @@ OTHER DEALINGS IN THE SOFTWARE.
 #define FORWARD_TIME 10
 // 10degrees * 9s = 90 degrees
 #define TURN_TIME 9
+// 1s to warm up before moving
+#define WARMUP_TIME 1
 
 /*-------------------------------------------------------------------------
- * (function: BASIC_AVOID_ICRA_W_BAYESIAN)
+ * (function: control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN_kernel)
+ * SENSE and ACT are the sensor and actuator functions (see group_kernel.h)
  *-----------------------------------------------------------------------*/
-void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double current_time) 
+template <sensor_function_t SENSE, actuator_function_t ACT>
+void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN_kernel(agent_t *agent, double current_time) 
 {
 	void *sensor_val;
 	beam_sensor_t *sensor_data;
 	int *mem_old_STATE;
 	act_inputs_t actuator_input;
+	int old_state;
 	int sensor_reads;
 
 	/* with STATE being very big - S_START is STATE 0 */
 	enum states {S_START, S_START_WARMUP, S_WARMUP, S_START_FORWARD, S_FORWARD, S_START_TURN_RIGHT, S_TURN_RIGHT, S_WAIT_SENSOR_READS};
 
+	old_state = agent_store.state[agent->agent_idx];
+
+	/* states that do not set an input leave it as no instruction - not what another thread left on the stack */
+	actuator_input.left = 0;
+	actuator_input.right = 0;
+	actuator_input.time_in_s = 0;
+	actuator_input.new_instruction = FALSE;
+
 	/* read sensor two check if something is 5cm away */
-	sensor_val = run_sensor(agent->agent_group->sensors[SENSOR], agent, current_time);
+	sensor_val = SENSE(agent->agent_group->sensors[SENSOR], agent, current_time);
 	sensor_data = (beam_sensor_t*)sensor_val;
 
 	// PROCESS W BAYESIAN HERE
 
-	printf("sensor reads %f meters\n", sensor_data->in_m);
+	//printf("sensor reads %f meters\n", sensor_data->in_m);
 
 	/* sensor reads -1 if no objects */
 	if (
 			(sensor_data->in_m > 0.0 && sensor_data->in_m < 0.10) &&
-			(agent->CURRENT_STATE == S_FORWARD) 
+			(agent_store.state[agent->agent_idx] == S_FORWARD) 
 	   )
 	{
 		/* if in 10cm of an object need to turn right 90 degrees */
-	       	agent->CURRENT_STATE = S_START_TURN_RIGHT;	
+	       	agent_store.state[agent->agent_idx] = S_START_TURN_RIGHT;	
 		/* tell robot to stop */
 		actuator_input.left = 0;
 		actuator_input.right = 0;
@@ -84,7 +99,7 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 	}
 	else
 	{
-		switch (agent->CURRENT_STATE)
+		switch (agent_store.state[agent->agent_idx])
 		{
 			case S_START: 
 				/* create memory in the robot */
@@ -97,7 +112,7 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 				actuator_input.right = 0;
 				actuator_input.new_instruction = FALSE;
 
-				agent->CURRENT_STATE = S_WARMUP;
+				agent_store.state[agent->agent_idx] = S_WARMUP;
 				break;
 			case S_START_WARMUP: 
 				agent->time_in_state = 0;	
@@ -107,7 +122,7 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 				actuator_input.right = 0;
 				actuator_input.new_instruction = FALSE;
 
-				agent->CURRENT_STATE = S_WARMUP;
+				agent_store.state[agent->agent_idx] = S_WARMUP;
 				break;
 			case S_WARMUP: 
 				agent->time_in_state += current_time - agent->last_time;	
@@ -115,10 +130,10 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 				/* actuator inputs */
 				actuator_input.new_instruction = FALSE;
 
-				if (agent->time_in_state < 1)
-					agent->CURRENT_STATE = S_WARMUP;
+				if (agent->time_in_state < WARMUP_TIME)
+					agent_store.state[agent->agent_idx] = S_WARMUP;
 				else
-					agent->CURRENT_STATE = S_START_FORWARD;
+					agent_store.state[agent->agent_idx] = S_START_FORWARD;
 				break;
 			case S_START_FORWARD: 
 				agent->time_in_state = 0;	
@@ -128,7 +143,7 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 				actuator_input.right = 1;
 				actuator_input.new_instruction = TRUE;
 
-				agent->CURRENT_STATE = S_FORWARD;
+				agent_store.state[agent->agent_idx] = S_FORWARD;
 				break;
 			case S_FORWARD: 
 				/* actuator inputs */
@@ -146,7 +161,7 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 					actuator_input.new_instruction = TRUE;
 				}
 
-				agent->CURRENT_STATE = S_FORWARD;
+				agent_store.state[agent->agent_idx] = S_FORWARD;
 				break;
 			case S_START_TURN_RIGHT: 
 				agent->time_in_state = 0;	
@@ -157,7 +172,7 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 				actuator_input.time_in_s = TURN_TIME; // 9s at 10degrees per second = 90 degrees
 				actuator_input.new_instruction = TRUE;
 
-				agent->CURRENT_STATE = S_TURN_RIGHT;
+				agent_store.state[agent->agent_idx] = S_TURN_RIGHT;
 				break;
 			case S_TURN_RIGHT: 
 				agent->time_in_state += current_time - agent->last_time;	
@@ -168,9 +183,9 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 				actuator_input.new_instruction = FALSE;
 
 				if (agent->time_in_state < TURN_TIME)
-					agent->CURRENT_STATE = S_TURN_RIGHT;
+					agent_store.state[agent->agent_idx] = S_TURN_RIGHT;
 				else
-					agent->CURRENT_STATE = S_START_FORWARD;
+					agent_store.state[agent->agent_idx] = S_START_FORWARD;
 				break;
 			default:
 				printf("Robot in unknown state\n");
@@ -180,12 +195,73 @@ void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double curren
 	}
 
 	/* move actuator */
-	run_actuator( agent->agent_group->actuators[ACTUATOR], agent, &(actuator_input), current_time);
+	ACT(agent->agent_group->actuators[ACTUATOR], agent, &(actuator_input), current_time);
+
+	//printf("Robot at location x=%f, y=%f, angle=%f (degrees=%f)\n", agent_store.x[agent->agent_idx], agent_store.y[agent->agent_idx], agent_store.angle[agent->agent_idx], agent_store.angle[agent->agent_idx] * (180.0 / PI));
 
-	//printf("Robot at location x=%f, y=%f, angle=%f (degrees=%f)\n", agent->circle->center.x, agent->circle->center.y, agent->angle, agent->angle * (180.0 / PI));
+	/* when the control has to run again in the event simulation - the sensor and actuator add their own times */
+	switch (agent_store.state[agent->agent_idx])
+	{
+		case S_WARMUP:
+			schedule_agent_wake(agent, current_time + (WARMUP_TIME - agent->time_in_state) - environment.sim_time_computation_epoch_s/2);
+			break;
+		case S_TURN_RIGHT:
+			schedule_agent_wake(agent, current_time + (TURN_TIME - agent->time_in_state) - environment.sim_time_computation_epoch_s/2);
+			break;
+		case S_FORWARD:
+			/* the first forward instruction is given the epoch after S_START_FORWARD - after that only a new sensor read changes anything */
+			if (old_state != S_FORWARD)
+				schedule_agent_wake(agent, current_time);
+			break;
+		default:
+			/* the start states move on at the next epoch */
+			schedule_agent_wake(agent, current_time);
+			break;
+	}
 
 	/* record last time for tracking details */
 	agent->last_time = current_time;
 
 	return;
 }
+
+/*-------------------------------------------------------------------------
+ * (function: control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN)
+ * Any sensor and actuator through their function pointers.
+ *-----------------------------------------------------------------------*/
+void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double current_time) 
+{
+	control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN_kernel<run_sensor, run_actuator>(agent, current_time);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: specialize_control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN)
+ * Gives the group the kernel built for its sensor and actuator.
+ * Returns FALSE if there is none and the group stays generic.
+ *-----------------------------------------------------------------------*/
+short specialize_control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_group_t *agent_group) 
+{
+	GROUP_KERNEL_MATCH_ALL(agent_group, control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN_kernel, SENSOR, ACTUATOR)
+}
+
+/*-------------------------------------------------------------------------
+ * (function: control_memory_save_BASIC_AVOID_ICRA_W_BAYESIAN)
+ * general_memory is the old state the agent goes back to.
+ *-----------------------------------------------------------------------*/
+void control_memory_save_BASIC_AVOID_ICRA_W_BAYESIAN(void *memory, checkpoint_t *checkpoint)
+{
+	checkpoint_put(checkpoint, memory, sizeof(int));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: control_memory_load_BASIC_AVOID_ICRA_W_BAYESIAN)
+ *-----------------------------------------------------------------------*/
+void* control_memory_load_BASIC_AVOID_ICRA_W_BAYESIAN(checkpoint_t *checkpoint)
+{
+	int *mem_old_STATE;
+
+	mem_old_STATE = (int*)malloc(sizeof(int));
+	checkpoint_get(checkpoint, mem_old_STATE, sizeof(int));
+
+	return (void*)mem_old_STATE;
+}
@@ -31,6 +31,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "globals.h"
 #include "utils.h"
 
+#include "control_sensors_actuators.h"
+
 /* globals */
 
 /*-------------------------------------------------------------------------
@@ -39,6 +41,10 @@ OTHER DEALINGS IN THE SOFTWARE.
 void control_algorithm_OVERLORD(agent_t *agent, double current_time) 
 {
 	printf("OVERLORD_control_algorithm_called\n");
+
+	/* nothing to do for the rest of the simulation */
+	schedule_agent_wake(agent, environment.sim_time_s);
+
 	return;
 }
 
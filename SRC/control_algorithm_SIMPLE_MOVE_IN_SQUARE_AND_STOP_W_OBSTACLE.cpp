@@ -34,6 +34,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "control_sensors_actuators.h"
 #include "sensors.h"
 #include "actuators.h"
+#include "group_kernel.h"
+#include "checkpoint.h"
 
 /* globals */
 
@@ -47,12 +49,14 @@ OTHER DEALINGS IN THE SOFTWARE.
 #define TURN_TIME 9
 
 /*-------------------------------------------------------------------------
- * (function:control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE )
+ * (function:control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE_kernel )
  * 	Assume this robot has ideal_two_wheel acuator and an ideal beam sensor
  * 	The control goes in a square where 3s for 3cm and 9s for 90 degree turn
  * 	Simulation shows it's off by a bit
+ * 	SENSE and ACT are the sensor and actuator functions (see group_kernel.h)
  *-----------------------------------------------------------------------*/
-void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent, double current_time) 
+template <sensor_function_t SENSE, actuator_function_t ACT>
+void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE_kernel(agent_t *agent, double current_time) 
 {
 	void *sensor_val;
 	beam_sensor_t *sensor_data;
@@ -62,10 +66,16 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 	/* with STATE being very big - S_START is STATE 0 */
 	enum states {S_START, S_START_FORWARD, S_FORWARD, S_START_TURN_LEFT, S_TURN_LEFT, S_STOP_OBJECT, S_TURN_RIGHT, S_START_RIGHT_FROM_STOP};
 
+	/* states that do not set an input leave it as no instruction - not what another thread left on the stack */
+	actuator_input.left = 0;
+	actuator_input.right = 0;
+	actuator_input.time_in_s = 0;
+	actuator_input.new_instruction = FALSE;
+
 	//printf("SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE called\n");
 
 	/* read sensor two check if something is 5cm away */
-	sensor_val = run_sensor(agent->agent_group->sensors[IDEAL_BEAM_SENSOR], agent, current_time);
+	sensor_val = SENSE(agent->agent_group->sensors[IDEAL_BEAM_SENSOR], agent, current_time);
 	sensor_data = (beam_sensor_t*)sensor_val;
 
 	//printf("sensor reads %f meters\n", sensor_data->in_m);
@@ -73,11 +83,11 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 	/* sensor reads -1 if no objects */
 	if (sensor_data->in_m > 0.0 && sensor_data->in_m < 0.05)
 	{
-		if (agent->CURRENT_STATE != S_START)
+		if (agent_store.state[agent->agent_idx] != S_START)
 		{	
 			/* if in 5cm of an object need to stop and store current state */
-			((int*)(agent->general_memory))[0] = agent->CURRENT_STATE;
-		       	agent->CURRENT_STATE = S_STOP_OBJECT;	
+			((int*)(agent->general_memory))[0] = agent_store.state[agent->agent_idx];
+		       	agent_store.state[agent->agent_idx] = S_STOP_OBJECT;	
 			/* tell robot to stop */
 			actuator_input.left = 0;
 			actuator_input.right = 0;
@@ -87,7 +97,7 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 	}
 	else
 	{
-		switch (agent->CURRENT_STATE)
+		switch (agent_store.state[agent->agent_idx])
 		{
 			case S_START: 
 				/* create memory in the robot */
@@ -100,7 +110,7 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				actuator_input.right = 0;
 				actuator_input.new_instruction = FALSE;
 
-				agent->CURRENT_STATE = S_START_FORWARD;
+				agent_store.state[agent->agent_idx] = S_START_FORWARD;
 				break;
 			case S_START_FORWARD: 
 				agent->time_in_state = 0;	
@@ -111,7 +121,7 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				actuator_input.time_in_s = FORWARD_TIME; // s at 1cm/s = 10cm
 				actuator_input.new_instruction = TRUE;
 
-				agent->CURRENT_STATE = S_FORWARD;
+				agent_store.state[agent->agent_idx] = S_FORWARD;
 				break;
 			case S_FORWARD: 
 				agent->time_in_state += current_time - agent->last_time;	
@@ -120,9 +130,9 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				actuator_input.new_instruction = FALSE;
 
 				if (agent->time_in_state < FORWARD_TIME)
-					agent->CURRENT_STATE = S_FORWARD;
+					agent_store.state[agent->agent_idx] = S_FORWARD;
 				else
-					agent->CURRENT_STATE = S_START_TURN_LEFT;
+					agent_store.state[agent->agent_idx] = S_START_TURN_LEFT;
 				break;
 			case S_START_TURN_LEFT: 
 				agent->time_in_state = 0;	
@@ -133,7 +143,7 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				actuator_input.time_in_s = TURN_TIME; // 9s at 10degrees per second = 90 degrees
 				actuator_input.new_instruction = TRUE;
 
-				agent->CURRENT_STATE = S_TURN_LEFT;
+				agent_store.state[agent->agent_idx] = S_TURN_LEFT;
 				break;
 			case S_TURN_LEFT: 
 				agent->time_in_state += current_time - agent->last_time;	
@@ -142,9 +152,9 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				actuator_input.new_instruction = FALSE;
 
 				if (agent->time_in_state < TURN_TIME)
-					agent->CURRENT_STATE = S_TURN_LEFT;
+					agent_store.state[agent->agent_idx] = S_TURN_LEFT;
 				else
-					agent->CURRENT_STATE = S_START_FORWARD;
+					agent_store.state[agent->agent_idx] = S_START_FORWARD;
 				break;
 			case S_START_RIGHT_FROM_STOP:
 				agent->time_in_state = 0;	
@@ -155,7 +165,7 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				actuator_input.time_in_s = TURN_TIME; // 9s at 10degrees per second = 90 degrees
 				actuator_input.new_instruction = TRUE;
 
-				agent->CURRENT_STATE = S_TURN_RIGHT;
+				agent_store.state[agent->agent_idx] = S_TURN_RIGHT;
 				break;
 			case S_TURN_RIGHT: 
 				agent->time_in_state += current_time - agent->last_time;	
@@ -164,9 +174,9 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				actuator_input.new_instruction = FALSE;
 
 				if (agent->time_in_state < TURN_TIME)
-					agent->CURRENT_STATE = S_TURN_RIGHT;
+					agent_store.state[agent->agent_idx] = S_TURN_RIGHT;
 				else
-					agent->CURRENT_STATE = S_START_FORWARD;
+					agent_store.state[agent->agent_idx] = S_START_FORWARD;
 				break;
 			case S_STOP_OBJECT:
 				/* if back here then object is 5cm away */
@@ -174,7 +184,7 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 				/* actuator inputs */
 				actuator_input.new_instruction = FALSE;
 
-				agent->CURRENT_STATE = S_START_RIGHT_FROM_STOP;
+				agent_store.state[agent->agent_idx] = S_START_RIGHT_FROM_STOP;
 
 				break;
 			default:
@@ -185,9 +195,27 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 	}
 
 	/* move actuator */
-	run_actuator( agent->agent_group->actuators[IDEAL_TWO_WHEEL], agent, &(actuator_input), current_time);
+	ACT(agent->agent_group->actuators[IDEAL_TWO_WHEEL], agent, &(actuator_input), current_time);
 
-	printf("Robot at location x=%f, y=%f, angle=%f (degrees=%f)\n", agent->circle->center.x, agent->circle->center.y, agent->angle, agent->angle * (180.0 / PI));
+	//printf("Robot at location x=%f, y=%f, angle=%f (degrees=%f)\n", agent_store.next_x[agent->agent_idx], agent_store.next_y[agent->agent_idx], agent_store.next_angle[agent->agent_idx], agent_store.next_angle[agent->agent_idx] * (180.0 / PI));
+
+	/* when the control has to run again in the event simulation - the sensor and actuator add their own times */
+	switch (agent_store.state[agent->agent_idx])
+	{
+		case S_FORWARD:
+			schedule_agent_wake(agent, current_time + (FORWARD_TIME - agent->time_in_state) - environment.sim_time_computation_epoch_s/2);
+			break;
+		case S_TURN_LEFT:
+			schedule_agent_wake(agent, current_time + (TURN_TIME - agent->time_in_state) - environment.sim_time_computation_epoch_s/2);
+			break;
+		case S_TURN_RIGHT:
+			schedule_agent_wake(agent, current_time + (TURN_TIME - agent->time_in_state) - environment.sim_time_computation_epoch_s/2);
+			break;
+		default:
+			/* the start states move on at the next epoch */
+			schedule_agent_wake(agent, current_time);
+			break;
+	}
 
 	/* record last time for tracking details */
 	agent->last_time = current_time;
@@ -195,3 +223,43 @@ void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent,
 	return;
 }
 
+/*-------------------------------------------------------------------------
+ * (function: control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE)
+ * Any sensor and actuator through their function pointers.
+ *-----------------------------------------------------------------------*/
+void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent, double current_time) 
+{
+	control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE_kernel<run_sensor, run_actuator>(agent, current_time);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: specialize_control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE)
+ * Gives the group the kernel built for its sensor and actuator.
+ * Returns FALSE if there is none and the group stays generic.
+ *-----------------------------------------------------------------------*/
+short specialize_control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_group_t *agent_group) 
+{
+	GROUP_KERNEL_MATCH_ALL(agent_group, control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE_kernel, IDEAL_BEAM_SENSOR, IDEAL_TWO_WHEEL)
+}
+
+/*-------------------------------------------------------------------------
+ * (function: control_memory_save_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE)
+ * general_memory is the old state the agent goes back to.
+ *-----------------------------------------------------------------------*/
+void control_memory_save_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(void *memory, checkpoint_t *checkpoint)
+{
+	checkpoint_put(checkpoint, memory, sizeof(int));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: control_memory_load_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE)
+ *-----------------------------------------------------------------------*/
+void* control_memory_load_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(checkpoint_t *checkpoint)
+{
+	int *mem_old_STATE;
+
+	mem_old_STATE = (int*)malloc(sizeof(int));
+	checkpoint_get(checkpoint, mem_old_STATE, sizeof(int));
+
+	return (void*)mem_old_STATE;
+}
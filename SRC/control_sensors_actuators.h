@@ -34,6 +34,15 @@ extern void control_algorithm_OVERLORD(agent_t *agent, double current_time);
 extern void control_algorithm_BASIC_AVOID_ICRA(agent_t *agent, double current_time);
 extern void control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_t *agent, double current_time);
 extern void control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_t *agent, double current_time);
+extern short specialize_control_algorithm_BASIC_AVOID_ICRA(agent_group_t *agent_group);
+extern short specialize_control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_group_t *agent_group);
+extern short specialize_control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_group_t *agent_group);
+extern void control_memory_save_BASIC_AVOID_ICRA(void *memory, checkpoint_t *checkpoint);
+extern void* control_memory_load_BASIC_AVOID_ICRA(checkpoint_t *checkpoint);
+extern void control_memory_save_BASIC_AVOID_ICRA_W_BAYESIAN(void *memory, checkpoint_t *checkpoint);
+extern void* control_memory_load_BASIC_AVOID_ICRA_W_BAYESIAN(checkpoint_t *checkpoint);
+extern void control_memory_save_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(void *memory, checkpoint_t *checkpoint);
+extern void* control_memory_load_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(checkpoint_t *checkpoint);
 
 /* SENSORS */
 extern void* sensor_function_IDEAL_BEAM(sensor_t *sensor, agent_t *agent, double current_time);
@@ -41,10 +50,32 @@ extern void* sensor_function_ULTRASONIC(sensor_t *sensor, agent_t *agent, double
 extern void* sensor_function_ULTRASONIC_W_BAYESIAN(sensor_t *sensor, agent_t *agent, double current_time);
 extern void* sensor_function_IR(sensor_t *sensor, agent_t *agent, double current_time);
 extern void* sensor_function_IR_W_BAYESIAN(sensor_t *sensor, agent_t *agent, double current_time);
+extern void* sensor_function_LIDAR(sensor_t *sensor, agent_t *agent, double current_time);
+extern void setup_bayesian_table_ULTRASONIC();
+extern void setup_bayesian_table_IR();
+extern void sensor_memory_save_IDEAL_BEAM(void *memory, checkpoint_t *checkpoint);
+extern void* sensor_memory_load_IDEAL_BEAM(checkpoint_t *checkpoint);
+extern void sensor_memory_save_ULTRASONIC(void *memory, checkpoint_t *checkpoint);
+extern void* sensor_memory_load_ULTRASONIC(checkpoint_t *checkpoint);
+extern void sensor_memory_save_ULTRASONIC_W_BAYESIAN(void *memory, checkpoint_t *checkpoint);
+extern void* sensor_memory_load_ULTRASONIC_W_BAYESIAN(checkpoint_t *checkpoint);
+extern void sensor_memory_save_IR(void *memory, checkpoint_t *checkpoint);
+extern void* sensor_memory_load_IR(checkpoint_t *checkpoint);
+extern void sensor_memory_save_IR_W_BAYESIAN(void *memory, checkpoint_t *checkpoint);
+extern void* sensor_memory_load_IR_W_BAYESIAN(checkpoint_t *checkpoint);
+extern void sensor_memory_save_LIDAR(void *memory, checkpoint_t *checkpoint);
+extern void* sensor_memory_load_LIDAR(checkpoint_t *checkpoint);
 
 /* ACTUATORS */
 extern void actuator_function_IDEAL_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act_inputs_t *inputs, double current_time);
 extern void actuator_function_TWO_WHEEL(actuator_t *actuator, agent_t *agent, act_inputs_t *inputs, double current_time);
+extern void actuator_memory_save_IDEAL_TWO_WHEEL(void *memory, checkpoint_t *checkpoint);
+extern void* actuator_memory_load_IDEAL_TWO_WHEEL(checkpoint_t *checkpoint);
+extern void actuator_memory_save_TWO_WHEEL(void *memory, checkpoint_t *checkpoint);
+extern void* actuator_memory_load_TWO_WHEEL(checkpoint_t *checkpoint);
+
+/* SCHEDULING for the event simulation */
+extern void schedule_agent_wake(agent_t *agent, double wake_after_time);
 
 typedef struct beam_sensor_t_t beam_sensor_t;
 struct beam_sensor_t_t
@@ -56,5 +87,18 @@ struct beam_sensor_t_t
 	short reads;
 };
 
+/* what a LIDAR returns - center_beam is first so a control written for one beam reads the middle of the scan */
+typedef struct scan_sensor_t_t scan_sensor_t;
+struct scan_sensor_t_t
+{
+	beam_sensor_t center_beam;
+
+	int num_beams;
+	double first_angle; // of beam 0 from the heading of the agent in radians
+	double angle_step; // between beams
+	int center_beam_idx; // the beam copied to center_beam - the one nearest the sensor's direction
+	double *in_m; // num_beams distances from the edge of the agent, -1 if nothing in range
+};
+
 #endif
 
@@ -0,0 +1,200 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "crash_check.h"
+#include "collision_detection.h"
+#include "agent_index.h"
+#include "bvh.h"
+#include "agent_store.h"
+#include "thread_pool.h"
+#include "profile.h"
+
+/* globals */
+
+/* what the overlap queries of one agent work with */
+typedef struct contact_context_t_t contact_context_t;
+struct contact_context_t_t
+{
+	agent_t *agent;
+	circle_t circle;
+};
+
+void find_agent_contacts_range(int first_agent, int last_agent, void *context);
+void contact_with_object(int object_idx, void *context);
+void contact_with_agent(int sim_object_idx, void *context);
+void add_contact(agent_t *agent, int sim_object_idx);
+short was_in_contact(agent_t *agent, int sim_object_idx);
+int compare_contacts(const void *a, const void *b);
+
+/*-------------------------------------------------------------------------
+ * (function: check_for_crashes)
+ * Finds every agent touching another agent or an object with the agent
+ * index and BVH as the broad phase.  New contacts go to the debug file as
+ * "contact time id id" with the ids of the log, and with
+ * stop_on_collision the agents involved stop for good.
+ *-----------------------------------------------------------------------*/
+void check_for_crashes(double current_time)
+{
+	int i, j;
+	int *swap;
+	int swap_alloc;
+	PROFILE_SCOPE(PROFILE_CRASH_CHECK);
+
+	if (environment.check_collisions == FALSE)
+		return;
+
+	/* each agent only fills its own contacts */
+	thread_pool_run(agent_store.num_agents, find_agent_contacts_range, NULL);
+
+	/* report in agent order so the file does not depend on the threads */
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		agent_t *agent = agent_store.agents[i];
+
+		/* the order the grid found them in is not meaningful */
+		qsort(agent->contacts, agent->num_contacts, sizeof(int), compare_contacts);
+
+		for (j = 0; j < agent->num_contacts; j++)
+		{
+			int other = agent->contacts[j];
+
+			/* agent pairs are found from both sides - report once */
+			if (was_in_contact(agent, other) == FALSE && (other < environment.num_objects || other > agent->sim_object_idx))
+				fprintf(sim_system.Fdebug_out, "contact %f %d %d\n", current_time, agent->sim_object_idx, other);
+		}
+
+		if (agent->num_contacts > 0 && environment.stop_on_collision == TRUE)
+			agent_store.crashed[i] = TRUE;
+
+		/* this epoch is the last one for the next check */
+		swap = agent->last_contacts;
+		agent->last_contacts = agent->contacts;
+		agent->contacts = swap;
+		swap_alloc = agent->alloc_last_contacts;
+		agent->alloc_last_contacts = agent->alloc_contacts;
+		agent->alloc_contacts = swap_alloc;
+		agent->num_last_contacts = agent->num_contacts;
+		agent->num_contacts = 0;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: find_agent_contacts_range)
+ *-----------------------------------------------------------------------*/
+void find_agent_contacts_range(int first_agent, int last_agent, void *)
+{
+	int i;
+	contact_context_t contact;
+	rectangle_t box;
+
+	for (i = first_agent; i < last_agent; i++)
+	{
+		contact.agent = agent_store.agents[i];
+		contact.agent->num_contacts = 0;
+
+		if (agent_store.not_physical[i] == TRUE)
+			continue;
+
+		contact.circle = agent_store_circle(&agent_store, i);
+		box = circle_rectangle_hull(&contact.circle);
+
+		bvh_query_overlap(&sim_bvh, &box, contact_with_object, (void*)&contact);
+		agent_index_query_circle(&contact.circle, contact_with_agent, (void*)&contact);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: contact_with_object)
+ * narrow phase against a static object
+ *-----------------------------------------------------------------------*/
+void contact_with_object(int object_idx, void *context)
+{
+	contact_context_t *contact = (contact_context_t*)context;
+	objects_t *object = environment.objects[object_idx];
+
+	if (object->type == CIRCLE && circles_collide(&contact->circle, object->circle) == TRUE)
+		add_contact(contact->agent, object_idx);
+	else if (object->type == RECTANGLE && circle_oriented_rectangle_collide(&contact->circle, object->rectangle) == TRUE)
+		add_contact(contact->agent, object_idx);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: contact_with_agent)
+ * an agent touching this one - the agent index did the exact test
+ *-----------------------------------------------------------------------*/
+void contact_with_agent(int sim_object_idx, void *context)
+{
+	contact_context_t *contact = (contact_context_t*)context;
+
+	if (sim_object_idx != contact->agent->sim_object_idx)
+		add_contact(contact->agent, sim_object_idx);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: add_contact)
+ *-----------------------------------------------------------------------*/
+void add_contact(agent_t *agent, int sim_object_idx)
+{
+	if (agent->num_contacts == agent->alloc_contacts)
+	{
+		agent->alloc_contacts = (agent->alloc_contacts == 0) ? 4 : agent->alloc_contacts * 2;
+		agent->contacts = (int*)realloc(agent->contacts, sizeof(int) * agent->alloc_contacts);
+	}
+	agent->contacts[agent->num_contacts] = sim_object_idx;
+	agent->num_contacts ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: was_in_contact)
+ * the lists are a handful long so a scan is fine
+ *-----------------------------------------------------------------------*/
+short was_in_contact(agent_t *agent, int sim_object_idx)
+{
+	int i;
+
+	for (i = 0; i < agent->num_last_contacts; i++)
+	{
+		if (agent->last_contacts[i] == sim_object_idx)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: compare_contacts)
+ *-----------------------------------------------------------------------*/
+int compare_contacts(const void *a, const void *b)
+{
+	return *(const int*)a - *(const int*)b;
+}
@@ -0,0 +1,180 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "event_queue.h"
+#include "checkpoint.h"
+
+/* globals */
+
+short event_before(event_queue_t *queue, int a, int b);
+void event_swap(event_queue_t *queue, int a, int b);
+
+/*-------------------------------------------------------------------------
+ * (function: event_queue_push)
+ *-----------------------------------------------------------------------*/
+void event_queue_push(event_queue_t *queue, double time, int agent_idx)
+{
+	int i;
+
+	if (queue->num_events == queue->alloc_events)
+	{
+		queue->alloc_events = (queue->alloc_events == 0) ? 64 : queue->alloc_events * 2;
+		queue->times = (double*)realloc(queue->times, sizeof(double) * queue->alloc_events);
+		queue->agent_idxs = (int*)realloc(queue->agent_idxs, sizeof(int) * queue->alloc_events);
+	}
+
+	i = queue->num_events;
+	queue->times[i] = time;
+	queue->agent_idxs[i] = agent_idx;
+	queue->num_events ++;
+
+	/* sift up */
+	while (i > 0 && event_before(queue, i, (i - 1) / 2))
+	{
+		event_swap(queue, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_queue_pop)
+ * returns the agent of the earliest event and removes it
+ *-----------------------------------------------------------------------*/
+int event_queue_pop(event_queue_t *queue)
+{
+	int i = 0;
+	int agent_idx;
+
+	oassert(queue->num_events > 0);
+
+	agent_idx = queue->agent_idxs[0];
+	queue->num_events --;
+	queue->times[0] = queue->times[queue->num_events];
+	queue->agent_idxs[0] = queue->agent_idxs[queue->num_events];
+
+	/* sift down */
+	while (TRUE)
+	{
+		int smallest = i;
+		int left = 2 * i + 1;
+		int right = 2 * i + 2;
+
+		if (left < queue->num_events && event_before(queue, left, smallest))
+			smallest = left;
+		if (right < queue->num_events && event_before(queue, right, smallest))
+			smallest = right;
+		if (smallest == i)
+			break;
+
+		event_swap(queue, i, smallest);
+		i = smallest;
+	}
+
+	return agent_idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_queue_next_time)
+ * returns the time of the earliest event or HUGE_VAL if there is none
+ *-----------------------------------------------------------------------*/
+double event_queue_next_time(event_queue_t *queue)
+{
+	if (queue->num_events == 0)
+		return HUGE_VAL;
+
+	return queue->times[0];
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_queue_free)
+ *-----------------------------------------------------------------------*/
+void event_queue_free(event_queue_t *queue)
+{
+	free(queue->times);
+	free(queue->agent_idxs);
+
+	memset(queue, 0, sizeof(event_queue_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_queue_checkpoint_save)
+ * The heap is kept as it is so the pops after a resume come out the same.
+ *-----------------------------------------------------------------------*/
+void event_queue_checkpoint_save(event_queue_t *queue, checkpoint_t *checkpoint)
+{
+	checkpoint_put(checkpoint, &queue->num_events, sizeof(int));
+	checkpoint_put(checkpoint, queue->times, sizeof(double) * queue->num_events);
+	checkpoint_put(checkpoint, queue->agent_idxs, sizeof(int) * queue->num_events);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_queue_checkpoint_load)
+ *-----------------------------------------------------------------------*/
+void event_queue_checkpoint_load(event_queue_t *queue, checkpoint_t *checkpoint)
+{
+	event_queue_free(queue);
+
+	checkpoint_get(checkpoint, &queue->num_events, sizeof(int));
+	queue->alloc_events = (queue->num_events > 64) ? queue->num_events : 64;
+	queue->times = (double*)malloc(sizeof(double) * queue->alloc_events);
+	queue->agent_idxs = (int*)malloc(sizeof(int) * queue->alloc_events);
+	checkpoint_get(checkpoint, queue->times, sizeof(double) * queue->num_events);
+	checkpoint_get(checkpoint, queue->agent_idxs, sizeof(int) * queue->num_events);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_before)
+ * ties go to the lower agent so the order never depends on the heap
+ *-----------------------------------------------------------------------*/
+short event_before(event_queue_t *queue, int a, int b)
+{
+	if (queue->times[a] != queue->times[b])
+		return queue->times[a] < queue->times[b];
+
+	return queue->agent_idxs[a] < queue->agent_idxs[b];
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_swap)
+ *-----------------------------------------------------------------------*/
+void event_swap(event_queue_t *queue, int a, int b)
+{
+	double time = queue->times[a];
+	int agent_idx = queue->agent_idxs[a];
+
+	queue->times[a] = queue->times[b];
+	queue->agent_idxs[a] = queue->agent_idxs[b];
+	queue->times[b] = time;
+	queue->agent_idxs[b] = agent_idx;
+}
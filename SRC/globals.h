@@ -31,8 +31,12 @@ extern global_args_t global_args;
 extern sim_system_t sim_system;
 extern environment_t environment;
 extern agent_groups_t agent_groups;
+extern agent_store_t agent_store;
 extern atons_t atons;
 extern communication_stack_t comm_stack;
 
 extern sim_obj_t **sim_objects;
 extern int num_sim_objects;
+extern spatial_grid_t sim_grid;
+extern loose_quadtree_t sim_quadtree;
+extern bvh_t sim_bvh;
@@ -0,0 +1,96 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef GROUP_KERNEL_H
+#define GROUP_KERNEL_H
+
+/* 
+ * A group kernel is one loop over the agents of an agent group with its
+ * control, sensor and actuator fixed at compile time.  The controls are
+ * templates on their sensor and actuator function so each (control,
+ * sensor, actuator) combination becomes its own function with direct
+ * calls the compiler can inline (with -flto across files) instead of
+ * going through three function pointers per agent per epoch.
+ * setup_group_kernels() picks the instance for each group once.
+ */
+
+#include "types.h"
+#include "globals.h"
+#include "control_sensors_actuators.h"
+
+typedef void* (*sensor_function_t)(sensor_t *sensor, agent_t *agent, double current_time);
+typedef void (*actuator_function_t)(actuator_t *actuator, agent_t *agent, act_inputs_t *inputs, double current_time);
+typedef void (*control_function_t)(agent_t *agent, double current_time);
+
+/*-------------------------------------------------------------------------
+ * (function: group_kernel_batch)
+ * Batch control that runs CONTROL for agents first_agent to last_agent-1
+ * of agent_group.
+ *-----------------------------------------------------------------------*/
+template <control_function_t CONTROL>
+void group_kernel_batch(agent_group_t *agent_group, int first_agent, int last_agent, double current_time)
+{
+	int i;
+
+	/* a batch never spans two groups */
+	oassert(first_agent >= agent_group->first_agent_idx && last_agent <= agent_group->first_agent_idx + agent_group->num_agents);
+
+	for (i = first_agent; i < last_agent; i++)
+	{
+		CONTROL(agent_store.agents[i], current_time);
+	}
+}
+
+/* 
+ * Used in a control's specialize function.  If the group's sensor and
+ * actuator at the indexes the control reads are SENSOR_FUNCTION and
+ * ACTUATOR_FUNCTION the group gets KERNEL<SENSOR_FUNCTION, ACTUATOR_FUNCTION>.
+ */
+#define GROUP_KERNEL_MATCH(group, KERNEL, SENSOR_IDX, SENSOR_FUNCTION, ACTUATOR_IDX, ACTUATOR_FUNCTION) \
+	if ((group)->sensors[SENSOR_IDX]->fptr_sensor == SENSOR_FUNCTION && (group)->actuators[ACTUATOR_IDX]->fptr_actuator == ACTUATOR_FUNCTION) \
+	{ \
+		(group)->fptr_control_algorithm = KERNEL<SENSOR_FUNCTION, ACTUATOR_FUNCTION>; \
+		(group)->fptr_control_algorithm_batch = group_kernel_batch< KERNEL<SENSOR_FUNCTION, ACTUATOR_FUNCTION> >; \
+		return TRUE; \
+	}
+
+/* every sensor with the actuators - add new sensors and actuators here */
+#define GROUP_KERNEL_MATCH_SENSOR(group, KERNEL, SENSOR_IDX, SENSOR_FUNCTION, ACTUATOR_IDX) \
+	GROUP_KERNEL_MATCH(group, KERNEL, SENSOR_IDX, SENSOR_FUNCTION, ACTUATOR_IDX, actuator_function_IDEAL_TWO_WHEEL) \
+	GROUP_KERNEL_MATCH(group, KERNEL, SENSOR_IDX, SENSOR_FUNCTION, ACTUATOR_IDX, actuator_function_TWO_WHEEL)
+
+#define GROUP_KERNEL_MATCH_ALL(group, KERNEL, SENSOR_IDX, ACTUATOR_IDX) \
+	if ((group)->num_sensors <= (SENSOR_IDX) || (group)->num_actuators <= (ACTUATOR_IDX)) \
+		return FALSE; \
+	GROUP_KERNEL_MATCH_SENSOR(group, KERNEL, SENSOR_IDX, sensor_function_IDEAL_BEAM, ACTUATOR_IDX) \
+	GROUP_KERNEL_MATCH_SENSOR(group, KERNEL, SENSOR_IDX, sensor_function_ULTRASONIC, ACTUATOR_IDX) \
+	GROUP_KERNEL_MATCH_SENSOR(group, KERNEL, SENSOR_IDX, sensor_function_ULTRASONIC_W_BAYESIAN, ACTUATOR_IDX) \
+	GROUP_KERNEL_MATCH_SENSOR(group, KERNEL, SENSOR_IDX, sensor_function_IR, ACTUATOR_IDX) \
+	GROUP_KERNEL_MATCH_SENSOR(group, KERNEL, SENSOR_IDX, sensor_function_IR_W_BAYESIAN, ACTUATOR_IDX) \
+	GROUP_KERNEL_MATCH_SENSOR(group, KERNEL, SENSOR_IDX, sensor_function_LIDAR, ACTUATOR_IDX) \
+	return FALSE;
+
+#endif
@@ -0,0 +1,368 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "log_file.h"
+#include "log_file_xml.h"
+#include "log_file_binary.h"
+#include "log_writer.h"
+#include "checkpoint.h"
+#include "profile.h"
+
+/* 
+ * Level of detail - sim_system.sim_log_every_epochs and
+ * sim_log_beam_every_epochs skip epochs, and a time step is only written
+ * when its agents or its beams are due.  With sim_log_changes_only an
+ * agent is written when it moved or turned more than the thresholds since
+ * the pose last written for it (so slow drift still shows up), and every
+ * agent is written the first time, and a time step with nothing in it
+ * is left out.  Readers carry an agent's last pose
+ * forward (centurion_binary_log.py reconstruct fills and interpolates).
+ */
+
+/* globals */
+short log_agents_this_step;
+short log_beams_this_step;
+short log_step_started;
+double log_step_time;
+/* pose of each agent_id when it was last written - for sim_log_changes_only */
+double *log_last_x = NULL;
+double *log_last_y = NULL;
+double *log_last_angle = NULL;
+int log_last_alloc = 0;
+
+short output_log_agent_changed(int agent_id, double x, double y, double angle);
+void output_log_start_step_now();
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_open)
+ * binary logs put the sensor beams in file_name.beams
+ *-----------------------------------------------------------------------*/
+void output_log_open(char *file_name) 
+{
+	output_log_open_at(file_name, 0, 0);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_open_at)
+ * The logs carry on from position and beam_position (see log_writer_open_at)
+ *-----------------------------------------------------------------------*/
+void output_log_open_at(char *file_name, long long position, long long beam_position) 
+{
+	char beam_file_name[4096];
+
+	sim_system.sim_log_out = log_writer_open_at(file_name, sim_system.sim_log_writer, position);
+	sim_system.sim_beam_log_out = NULL;
+
+	if (sim_system.sim_log_format != LOG_XML)
+	{
+		snprintf(beam_file_name, sizeof(beam_file_name), "%s.beams", file_name);
+		sim_system.sim_beam_log_out = log_writer_open_at(beam_file_name, sim_system.sim_log_writer, beam_position);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_close)
+ * with the async writer this waits until the log is on disk
+ *-----------------------------------------------------------------------*/
+void output_log_close() 
+{
+	log_writer_close(sim_system.sim_log_out);
+	if (sim_system.sim_beam_log_out != NULL)
+		log_writer_close(sim_system.sim_beam_log_out);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_header)
+ *-----------------------------------------------------------------------*/
+void output_log_header() 
+{
+	PROFILE_SCOPE(PROFILE_LOG_STEP);
+
+	log_agents_this_step = FALSE;
+	log_beams_this_step = FALSE;
+	log_step_started = FALSE;
+
+	if (sim_system.sim_log_format == LOG_XML)
+		sim_system.output_log_tab_step = output_log_file_xml_header();
+	else
+		output_log_file_binary_header((sim_system.sim_log_format == LOG_BINARY32) ? sizeof(float) : sizeof(double));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_footer)
+ *-----------------------------------------------------------------------*/
+void output_log_footer() 
+{
+	PROFILE_SCOPE(PROFILE_LOG_STEP);
+
+	if (sim_system.sim_log_format == LOG_XML)
+		output_log_file_xml_footer(sim_system.output_log_tab_step);
+	else
+		output_log_file_binary_footer();
+
+	free(log_last_x);
+	free(log_last_y);
+	free(log_last_angle);
+	log_last_x = NULL;
+	log_last_y = NULL;
+	log_last_angle = NULL;
+	log_last_alloc = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_time_step_start)
+ *-----------------------------------------------------------------------*/
+void output_log_time_step_start(double current_time) 
+{
+	int every_epochs = (sim_system.sim_log_every_epochs > 1) ? sim_system.sim_log_every_epochs : 1;
+	int beam_every_epochs = (sim_system.sim_log_beam_every_epochs > 0) ? sim_system.sim_log_beam_every_epochs : every_epochs;
+	/* from the time and not a count of calls - the event simulation only logs the epochs where someone wakes */
+	long long log_epoch = llround(current_time / environment.sim_time_computation_epoch_s);
+	PROFILE_SCOPE(PROFILE_LOG_STEP);
+
+	log_agents_this_step = (log_epoch % every_epochs == 0);
+	log_beams_this_step = (log_epoch % beam_every_epochs == 0);
+	log_step_time = current_time;
+	log_step_started = FALSE;
+
+	/* changes only waits for something to write */
+	if ((log_agents_this_step || log_beams_this_step) && sim_system.sim_log_changes_only == FALSE)
+		output_log_start_step_now();
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_time_step_stop)
+ *-----------------------------------------------------------------------*/
+void output_log_time_step_stop() 
+{
+	PROFILE_SCOPE(PROFILE_LOG_STEP);
+
+	if (log_step_started == FALSE)
+		return;
+	log_step_started = FALSE;
+
+	if (sim_system.sim_log_format == LOG_XML)
+		sim_system.output_log_tab_step = output_log_file_xml_time_step_stop(sim_system.output_log_tab_step);
+	else
+		output_log_file_binary_time_step_stop();
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_time_step_agent)
+ *-----------------------------------------------------------------------*/
+void output_log_time_step_agent(int agent_id, double x, double y, double angle) 
+{
+	PROFILE_SCOPE(PROFILE_LOG_AGENT);
+
+	if (log_agents_this_step == FALSE)
+		return;
+	if (sim_system.sim_log_changes_only && output_log_agent_changed(agent_id, x, y, angle) == FALSE)
+		return;
+	if (log_step_started == FALSE)
+		output_log_start_step_now();
+
+	if (sim_system.sim_log_format == LOG_XML)
+		sim_system.output_log_tab_step = output_log_file_xml_time_step_agent(sim_system.output_log_tab_step, agent_id, x, y, angle);
+	else
+		output_log_file_binary_time_step_agent(agent_id, x, y, angle);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_time_step_sensor_beam_hit)
+ *-----------------------------------------------------------------------*/
+void output_log_time_step_sensor_beam_hit(line_segment_t *sensor_beam, vector_2D_t *point_intersect, double distance) 
+{
+	PROFILE_SCOPE(PROFILE_LOG_BEAM);
+
+	if (log_beams_this_step == FALSE)
+		return;
+	if (log_step_started == FALSE)
+		output_log_start_step_now();
+
+	if (sim_system.sim_log_format == LOG_XML)
+		sim_system.output_log_tab_step = output_log_file_xml_time_step_sensor_beam_hit(sim_system.output_log_tab_step, sensor_beam, point_intersect, distance);
+	else
+		output_log_file_binary_time_step_sensor_beam_hit(sensor_beam, point_intersect, distance);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_checkpoint_save)
+ * Between epochs - the logs are synced to disk and their ends kept with
+ * the level of detail state.
+ *-----------------------------------------------------------------------*/
+void output_log_checkpoint_save(checkpoint_t *checkpoint)
+{
+	long long position = log_writer_sync(sim_system.sim_log_out);
+	long long beam_position = (sim_system.sim_beam_log_out != NULL) ? log_writer_sync(sim_system.sim_beam_log_out) : 0;
+
+	checkpoint_put(checkpoint, &position, sizeof(long long));
+	checkpoint_put(checkpoint, &beam_position, sizeof(long long));
+	checkpoint_put(checkpoint, &sim_system.output_log_tab_step, sizeof(int));
+	checkpoint_put(checkpoint, &log_last_alloc, sizeof(int));
+	checkpoint_put(checkpoint, log_last_x, sizeof(double) * log_last_alloc);
+	checkpoint_put(checkpoint, log_last_y, sizeof(double) * log_last_alloc);
+	checkpoint_put(checkpoint, log_last_angle, sizeof(double) * log_last_alloc);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_checkpoint_load)
+ * Opens the logs where the checkpoint left them in place of
+ * output_log_open and output_log_header.
+ *-----------------------------------------------------------------------*/
+void output_log_checkpoint_load(checkpoint_t *checkpoint)
+{
+	long long position;
+	long long beam_position;
+
+	checkpoint_get(checkpoint, &position, sizeof(long long));
+	checkpoint_get(checkpoint, &beam_position, sizeof(long long));
+	output_log_resume(sim_system.sim_log_file_out, position, beam_position);
+
+	checkpoint_get(checkpoint, &sim_system.output_log_tab_step, sizeof(int));
+
+	checkpoint_get(checkpoint, &log_last_alloc, sizeof(int));
+	log_last_x = (double*)realloc(log_last_x, sizeof(double) * log_last_alloc);
+	log_last_y = (double*)realloc(log_last_y, sizeof(double) * log_last_alloc);
+	log_last_angle = (double*)realloc(log_last_angle, sizeof(double) * log_last_alloc);
+	checkpoint_get(checkpoint, log_last_x, sizeof(double) * log_last_alloc);
+	checkpoint_get(checkpoint, log_last_y, sizeof(double) * log_last_alloc);
+	checkpoint_get(checkpoint, log_last_angle, sizeof(double) * log_last_alloc);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_suspend)
+ * Closes the logs between epochs - before a fork so no writer thread is
+ * running - and gives where they end for output_log_resume.
+ *-----------------------------------------------------------------------*/
+void output_log_suspend(long long *position, long long *beam_position)
+{
+	*position = log_writer_sync(sim_system.sim_log_out);
+	*beam_position = (sim_system.sim_beam_log_out != NULL) ? log_writer_sync(sim_system.sim_beam_log_out) : 0;
+
+	output_log_close();
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_resume)
+ * Opens logs that already have their header to carry on at position.
+ * The level of detail state is whatever is in memory.
+ *-----------------------------------------------------------------------*/
+void output_log_resume(char *file_name, long long position, long long beam_position)
+{
+	output_log_open_at(file_name, position, beam_position);
+	if (sim_system.sim_log_format != LOG_XML)
+		output_log_file_binary_resume((sim_system.sim_log_format == LOG_BINARY32) ? sizeof(float) : sizeof(double));
+
+	log_agents_this_step = FALSE;
+	log_beams_this_step = FALSE;
+	log_step_started = FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_branch)
+ * The logs of a branch start as a copy of the prefix run's up to where it
+ * was suspended.
+ *-----------------------------------------------------------------------*/
+void output_log_branch(char *prefix_file_name, char *file_name, long long position, long long beam_position)
+{
+	char prefix_beam_file_name[4096];
+	char beam_file_name[4096];
+
+	copy_file_prefix(prefix_file_name, file_name, position);
+	if (sim_system.sim_log_format != LOG_XML)
+	{
+		snprintf(prefix_beam_file_name, sizeof(prefix_beam_file_name), "%s.beams", prefix_file_name);
+		snprintf(beam_file_name, sizeof(beam_file_name), "%s.beams", file_name);
+		copy_file_prefix(prefix_beam_file_name, beam_file_name, beam_position);
+	}
+
+	output_log_resume(file_name, position, beam_position);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_start_step_now)
+ *-----------------------------------------------------------------------*/
+void output_log_start_step_now()
+{
+	if (sim_system.sim_log_format == LOG_XML)
+		sim_system.output_log_tab_step = output_log_file_xml_time_step_start(sim_system.output_log_tab_step, log_step_time);
+	else
+		output_log_file_binary_time_step_start(log_step_time);
+
+	log_step_started = TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_agent_changed)
+ * TRUE if the agent has to be written - it then becomes the last pose
+ *-----------------------------------------------------------------------*/
+short output_log_agent_changed(int agent_id, double x, double y, double angle)
+{
+	int i;
+	int new_alloc;
+	double dx, dy;
+	double turn;
+
+	if (agent_id >= log_last_alloc)
+	{
+		new_alloc = (log_last_alloc == 0) ? 1024 : log_last_alloc;
+		while (new_alloc <= agent_id)
+			new_alloc *= 2;
+
+		log_last_x = (double*)realloc(log_last_x, sizeof(double) * new_alloc);
+		log_last_y = (double*)realloc(log_last_y, sizeof(double) * new_alloc);
+		log_last_angle = (double*)realloc(log_last_angle, sizeof(double) * new_alloc);
+		/* NAN has never been written */
+		for (i = log_last_alloc; i < new_alloc; i++)
+			log_last_x[i] = NAN;
+		log_last_alloc = new_alloc;
+	}
+
+	if (!isnan(log_last_x[agent_id]))
+	{
+		dx = x - log_last_x[agent_id];
+		dy = y - log_last_y[agent_id];
+		/* the smaller way round */
+		turn = fabs(remainder(angle - log_last_angle[agent_id], 2*PI)) * (180/PI);
+
+		if (dx*dx + dy*dy <= sim_system.sim_log_move_threshold_in_m * sim_system.sim_log_move_threshold_in_m && turn <= sim_system.sim_log_turn_threshold_in_degrees)
+			return FALSE;
+	}
+
+	log_last_x[agent_id] = x;
+	log_last_y[agent_id] = y;
+	log_last_angle[agent_id] = angle;
+
+	return TRUE;
+}
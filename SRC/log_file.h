@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LOG_FILE_H
+#define LOG_FILE_H
+
+#include "types.h"
+
+/* the sim log in the format of sim_system.sim_log_format */
+void output_log_open(char *file_name) ;
+void output_log_open_at(char *file_name, long long position, long long beam_position) ;
+void output_log_close() ;
+void output_log_header() ;
+void output_log_footer() ;
+void output_log_time_step_start(double time) ;
+void output_log_time_step_stop() ;
+void output_log_time_step_agent(int agent_id, double x, double y, double angle) ;
+void output_log_time_step_sensor_beam_hit(line_segment_t *sensor_beam, vector_2D_t *point_intersect, double distance);
+/* where the logs are - see checkpoint.cpp */
+void output_log_checkpoint_save(checkpoint_t *checkpoint);
+void output_log_checkpoint_load(checkpoint_t *checkpoint);
+/* closing and reopening between epochs - see batch.cpp */
+void output_log_suspend(long long *position, long long *beam_position);
+void output_log_resume(char *file_name, long long position, long long beam_position);
+void output_log_branch(char *prefix_file_name, char *file_name, long long position, long long beam_position);
+
+#endif
@@ -0,0 +1,236 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "log_file_binary.h"
+#include "log_writer.h"
+
+/* 
+ * Binary sim log - the same content as the xml log without the text.
+ * Everything is little endian (as written on x86) and packed.
+ *
+ * sim_log_file_out:
+ *	header	char[8] "CENTLOG", int32 version, int32 float_bytes (4 or 8),
+ *		double time_step_in_s, sim_x_in_m, sim_y_in_m, agent_radius,
+ *		int32 num_objects
+ *	object	int32 type (0 circle, 1 rectangle), double x, y, a, b, c
+ *		(circle a = radius, rectangle a,b,c = halfx, halfy, rotation)
+ *	step	double time_at, int32 num_agents, then num_agents of
+ *		int32 agent_id, float x, y, angle (degrees)
+ *
+ * sim_log_file_out.beams:
+ *	header	char[8] "CENTBEAM", int32 version, int32 float_bytes
+ *	hit	double time_at, float beam_x1, beam_y1, beam_x2, beam_y2,
+ *		point_intersect_x, point_intersect_y, distance
+ *
+ * "float" is float32 or float64 as float_bytes says.
+ */
+#define LOG_BINARY_VERSION 1
+
+/* globals */
+short binary_float_bytes;
+double binary_time_at;
+/* agents of the current step - written in one go when the step stops */
+unsigned char *binary_step_records = NULL;
+int binary_step_records_size = 0;
+int binary_step_records_alloc = 0;
+int binary_step_num_agents;
+
+void binary_put_int(log_writer_t *writer, int value);
+void binary_put_double(log_writer_t *writer, double value);
+void binary_put_float_to_records(double value);
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_file_binary_header)
+ *-----------------------------------------------------------------------*/
+void output_log_file_binary_header(short float_bytes) 
+{
+	int i;
+	const char *magic = "CENTLOG"; // the terminating 0 is the eighth byte
+	const char *beam_magic = "CENTBEAM";
+
+	oassert(float_bytes == sizeof(float) || float_bytes == sizeof(double));
+	binary_float_bytes = float_bytes;
+
+	log_writer_write(sim_system.sim_log_out, magic, 8);
+	binary_put_int(sim_system.sim_log_out, LOG_BINARY_VERSION);
+	binary_put_int(sim_system.sim_log_out, float_bytes);
+	binary_put_double(sim_system.sim_log_out, environment.sim_time_computation_epoch_s);
+	binary_put_double(sim_system.sim_log_out, environment.real_size_x_in_m);
+	binary_put_double(sim_system.sim_log_out, environment.real_size_y_in_m);
+	binary_put_double(sim_system.sim_log_out, agent_groups.agent_group[1]->shape->circle->radius);
+	binary_put_int(sim_system.sim_log_out, environment.num_objects);
+
+	for (i = 0; i < environment.num_objects; i++)
+	{
+		if (environment.objects[i]->type == CIRCLE)
+		{
+			binary_put_int(sim_system.sim_log_out, 0);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->circle->center.x);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->circle->center.y);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->circle->radius);
+			binary_put_double(sim_system.sim_log_out, 0);
+			binary_put_double(sim_system.sim_log_out, 0);
+		}
+		else
+		{
+			binary_put_int(sim_system.sim_log_out, 1);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->rectangle->center.x);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->rectangle->center.y);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->rectangle->halfExtend.x);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->rectangle->halfExtend.y);
+			binary_put_double(sim_system.sim_log_out, environment.objects[i]->rectangle->rotation);
+		}
+	}
+
+	log_writer_write(sim_system.sim_beam_log_out, beam_magic, 8);
+	binary_put_int(sim_system.sim_beam_log_out, LOG_BINARY_VERSION);
+	binary_put_int(sim_system.sim_beam_log_out, float_bytes);
+}
+	
+/*-------------------------------------------------------------------------
+ * (function: output_log_file_binary_resume)
+ * A log carried on from a checkpoint already has its headers.
+ *-----------------------------------------------------------------------*/
+void output_log_file_binary_resume(short float_bytes) 
+{
+	oassert(float_bytes == sizeof(float) || float_bytes == sizeof(double));
+	binary_float_bytes = float_bytes;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_file_binary_footer)
+ *-----------------------------------------------------------------------*/
+void output_log_file_binary_footer() 
+{
+	free(binary_step_records);
+	binary_step_records = NULL;
+	binary_step_records_alloc = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_file_binary_time_step_start)
+ *-----------------------------------------------------------------------*/
+void output_log_file_binary_time_step_start(double current_time) 
+{
+	binary_time_at = current_time;
+	binary_step_records_size = 0;
+	binary_step_num_agents = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_file_binary_time_step_stop)
+ *-----------------------------------------------------------------------*/
+void output_log_file_binary_time_step_stop() 
+{
+	binary_put_double(sim_system.sim_log_out, binary_time_at);
+	binary_put_int(sim_system.sim_log_out, binary_step_num_agents);
+	log_writer_write(sim_system.sim_log_out, binary_step_records, binary_step_records_size);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_file_binary_time_step_agent)
+ *-----------------------------------------------------------------------*/
+void output_log_file_binary_time_step_agent(int agent_id, double x, double y, double angle) 
+{
+	int record_size = sizeof(int) + 3 * binary_float_bytes;
+
+	if (binary_step_records_size + record_size > binary_step_records_alloc)
+	{
+		binary_step_records_alloc = (binary_step_records_alloc == 0) ? 4096 : binary_step_records_alloc * 2;
+		binary_step_records = (unsigned char*)realloc(binary_step_records, binary_step_records_alloc);
+	}
+
+	memcpy(binary_step_records + binary_step_records_size, &agent_id, sizeof(int));
+	binary_step_records_size += sizeof(int);
+	binary_put_float_to_records(x);
+	binary_put_float_to_records(y);
+	/* output in degrees */
+	binary_put_float_to_records(angle*(180/PI));
+
+	binary_step_num_agents ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: output_log_file_binary_time_step_sensor_beam_hit)
+ *-----------------------------------------------------------------------*/
+void output_log_file_binary_time_step_sensor_beam_hit(line_segment_t *sensor_beam, vector_2D_t *point_intersect, double distance) 
+{
+	double values[7] = {sensor_beam->point1.x, sensor_beam->point1.y, sensor_beam->point2.x, sensor_beam->point2.y, point_intersect->x, point_intersect->y, distance};
+	float values32[7];
+	int i;
+
+	binary_put_double(sim_system.sim_beam_log_out, binary_time_at);
+
+	if (binary_float_bytes == sizeof(double))
+	{
+		log_writer_write(sim_system.sim_beam_log_out, values, sizeof(double) * 7);
+	}
+	else
+	{
+		for (i = 0; i < 7; i++)
+			values32[i] = (float)values[i];
+		log_writer_write(sim_system.sim_beam_log_out, values32, sizeof(float) * 7);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: binary_put_int)
+ *-----------------------------------------------------------------------*/
+void binary_put_int(log_writer_t *writer, int value)
+{
+	log_writer_write(writer, &value, sizeof(int));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: binary_put_double)
+ *-----------------------------------------------------------------------*/
+void binary_put_double(log_writer_t *writer, double value)
+{
+	log_writer_write(writer, &value, sizeof(double));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: binary_put_float_to_records)
+ * appends a pose value at the precision of the log - room is already made
+ *-----------------------------------------------------------------------*/
+void binary_put_float_to_records(double value)
+{
+	float value32 = (float)value;
+
+	if (binary_float_bytes == sizeof(double))
+		memcpy(binary_step_records + binary_step_records_size, &value, sizeof(double));
+	else
+		memcpy(binary_step_records + binary_step_records_size, &value32, sizeof(float));
+
+	binary_step_records_size += binary_float_bytes;
+}
@@ -0,0 +1,40 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LOG_FILE_BINARY_H
+#define LOG_FILE_BINARY_H
+
+#include "types.h"
+
+void output_log_file_binary_header(short float_bytes) ;
+void output_log_file_binary_resume(short float_bytes) ;
+void output_log_file_binary_footer() ;
+void output_log_file_binary_time_step_start(double time) ;
+void output_log_file_binary_time_step_stop() ;
+void output_log_file_binary_time_step_agent(int agent_id, double x, double y, double angle) ;
+void output_log_file_binary_time_step_sensor_beam_hit(line_segment_t *sensor_beam, vector_2D_t *point_intersect, double distance);
+
+#endif
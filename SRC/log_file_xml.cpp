@@ -31,6 +31,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "globals.h"
 #include "utils.h"
 
+#include "log_writer.h"
+
 /* globals */
 
 /*-------------------------------------------------------------------------
@@ -42,7 +44,7 @@ void tabs_to_line(int tabs)
 
 	for (i = 0; i < tabs; i++)
 	{
-		fprintf(sim_system.Fsim_log_out, "    ");
+		log_writer_write(sim_system.sim_log_out, "    ", 4);
 	}
 }
 
@@ -54,19 +56,19 @@ int output_log_file_xml_header()
 	int num_tabs = 0;
 	int i;
 
-	fprintf(sim_system.Fsim_log_out, "<data_log>\n");
+	log_writer_printf(sim_system.sim_log_out, "<data_log>\n");
 	num_tabs ++;	
 	
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<time_step_in_s>%f</time_step_in_s>\n", environment.sim_time_computation_epoch_s);
+	log_writer_printf(sim_system.sim_log_out, "<time_step_in_s>%f</time_step_in_s>\n", environment.sim_time_computation_epoch_s);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<sim_x_in_m>%f</sim_x_in_m>\n", environment.real_size_x_in_m);
+	log_writer_printf(sim_system.sim_log_out, "<sim_x_in_m>%f</sim_x_in_m>\n", environment.real_size_x_in_m);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<sim_y_in_m>%f</sim_y_in_m>\n", environment.real_size_y_in_m);
+	log_writer_printf(sim_system.sim_log_out, "<sim_y_in_m>%f</sim_y_in_m>\n", environment.real_size_y_in_m);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<agent_radius>%f</agent_radius>\n", agent_groups.agent_group[1]->shape->circle->radius);
+	log_writer_printf(sim_system.sim_log_out, "<agent_radius>%f</agent_radius>\n", agent_groups.agent_group[1]->shape->circle->radius);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<object>\n");
+	log_writer_printf(sim_system.sim_log_out, "<object>\n");
 	num_tabs ++;
 
 	for (i = 0; i < environment.num_objects; i++)
@@ -74,46 +76,46 @@ int output_log_file_xml_header()
 		if (environment.objects[i]->type == CIRCLE)
 		{
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<circle>\n");
+			log_writer_printf(sim_system.sim_log_out, "<circle>\n");
 			num_tabs++;
 			
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<x>%f</x>\n", environment.objects[i]->circle->center.x);
+			log_writer_printf(sim_system.sim_log_out, "<x>%f</x>\n", environment.objects[i]->circle->center.x);
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<y>%f</y>\n", environment.objects[i]->circle->center.y);
+			log_writer_printf(sim_system.sim_log_out, "<y>%f</y>\n", environment.objects[i]->circle->center.y);
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<radius>%f</radius>\n", environment.objects[i]->circle->radius);
+			log_writer_printf(sim_system.sim_log_out, "<radius>%f</radius>\n", environment.objects[i]->circle->radius);
 
 			num_tabs--;
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "</circle>\n");
+			log_writer_printf(sim_system.sim_log_out, "</circle>\n");
 		}
 		else if (environment.objects[i]->type == RECTANGLE)
 		{
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<rectangle>\n");
+			log_writer_printf(sim_system.sim_log_out, "<rectangle>\n");
 			num_tabs++;
 			
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<x>%f</x>\n", environment.objects[i]->rectangle->center.x);
+			log_writer_printf(sim_system.sim_log_out, "<x>%f</x>\n", environment.objects[i]->rectangle->center.x);
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<y>%f</y>\n", environment.objects[i]->rectangle->center.y);
+			log_writer_printf(sim_system.sim_log_out, "<y>%f</y>\n", environment.objects[i]->rectangle->center.y);
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<halfx>%f</halfx>\n", environment.objects[i]->rectangle->halfExtend.x);
+			log_writer_printf(sim_system.sim_log_out, "<halfx>%f</halfx>\n", environment.objects[i]->rectangle->halfExtend.x);
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<halfy>%f</halfy>\n", environment.objects[i]->rectangle->halfExtend.y);
+			log_writer_printf(sim_system.sim_log_out, "<halfy>%f</halfy>\n", environment.objects[i]->rectangle->halfExtend.y);
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "<rotation>%f</rotation>\n", environment.objects[i]->rectangle->rotation);
+			log_writer_printf(sim_system.sim_log_out, "<rotation>%f</rotation>\n", environment.objects[i]->rectangle->rotation);
 
 			num_tabs--;
 			tabs_to_line(num_tabs);
-			fprintf(sim_system.Fsim_log_out, "</rectangle>\n");
+			log_writer_printf(sim_system.sim_log_out, "</rectangle>\n");
 		}
 	}
 
 	num_tabs --;
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "</object>\n");
+	log_writer_printf(sim_system.sim_log_out, "</object>\n");
 
 	return num_tabs;
 }
@@ -127,7 +129,7 @@ void output_log_file_xml_footer(int tabs)
 
 	num_tabs--;
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "</data_log>\n");
+	log_writer_printf(sim_system.sim_log_out, "</data_log>\n");
 
 	oassert(num_tabs == 0);
 }
@@ -139,11 +141,11 @@ int output_log_file_xml_time_step_start(int tabs, double current_time)
 	int num_tabs = tabs;
 
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<time_step>\n");
+	log_writer_printf(sim_system.sim_log_out, "<time_step>\n");
 	num_tabs++;
 
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<time_at>%f</time_at>\n", current_time);
+	log_writer_printf(sim_system.sim_log_out, "<time_at>%f</time_at>\n", current_time);
 
 	return num_tabs;
 }
@@ -157,7 +159,7 @@ int output_log_file_xml_time_step_stop(int tabs)
 
 	num_tabs--;
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "</time_step>\n");
+	log_writer_printf(sim_system.sim_log_out, "</time_step>\n");
 
 	return num_tabs;
 }
@@ -170,22 +172,22 @@ int output_log_file_xml_time_step_agent(int tabs, int agent_id, double x, double
 	int num_tabs = tabs;
 
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<agent>\n");
+	log_writer_printf(sim_system.sim_log_out, "<agent>\n");
 	num_tabs++;
 
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<agent_id>%d</agent_id>\n", agent_id);
+	log_writer_printf(sim_system.sim_log_out, "<agent_id>%d</agent_id>\n", agent_id);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<x>%f</x>\n", x);
+	log_writer_printf(sim_system.sim_log_out, "<x>%f</x>\n", x);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<y>%f</y>\n", y);
+	log_writer_printf(sim_system.sim_log_out, "<y>%f</y>\n", y);
 	tabs_to_line(num_tabs);
 	/* output in degrees */
-	fprintf(sim_system.Fsim_log_out, "<angle>%f</angle>\n", angle*(180/PI));
+	log_writer_printf(sim_system.sim_log_out, "<angle>%f</angle>\n", angle*(180/PI));
 
 	num_tabs--;
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "</agent>\n");
+	log_writer_printf(sim_system.sim_log_out, "</agent>\n");
 
 	return num_tabs;
 }
@@ -198,21 +200,21 @@ int output_log_file_xml_time_step_sensor_beam_hit(int tabs, line_segment_t *sens
 	int num_tabs = tabs;
 
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<sensor_beam>\n");
+	log_writer_printf(sim_system.sim_log_out, "<sensor_beam>\n");
 	num_tabs++;
 
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<beam_x1>%f</beam_x1><beam_y1>%f</beam_y1>\n", sensor_beam->point1.x, sensor_beam->point1.y);
+	log_writer_printf(sim_system.sim_log_out, "<beam_x1>%f</beam_x1><beam_y1>%f</beam_y1>\n", sensor_beam->point1.x, sensor_beam->point1.y);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<beam_x2>%f</beam_x2><beam_y2>%f</beam_y2>\n", sensor_beam->point2.x, sensor_beam->point2.y);
+	log_writer_printf(sim_system.sim_log_out, "<beam_x2>%f</beam_x2><beam_y2>%f</beam_y2>\n", sensor_beam->point2.x, sensor_beam->point2.y);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<point_intersect_x>%f</point_intersect_x><point_intersect_y>%f</point_intersect_y>\n", point_intersect->x,  point_intersect->y);
+	log_writer_printf(sim_system.sim_log_out, "<point_intersect_x>%f</point_intersect_x><point_intersect_y>%f</point_intersect_y>\n", point_intersect->x,  point_intersect->y);
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "<distance>%f</distance>\n", distance);
+	log_writer_printf(sim_system.sim_log_out, "<distance>%f</distance>\n", distance);
 
 	num_tabs--;
 	tabs_to_line(num_tabs);
-	fprintf(sim_system.Fsim_log_out, "</sensor_beam>\n");
+	log_writer_printf(sim_system.sim_log_out, "</sensor_beam>\n");
 
 	return num_tabs;
 }
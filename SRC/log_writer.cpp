@@ -0,0 +1,369 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "log_writer.h"
+
+/* 
+ * The log backends write through a log_writer_t.  LOG_WRITER_STDIO is a
+ * FILE as before.  LOG_WRITER_ASYNC has the simulation thread copy the
+ * already formatted bytes into a ring buffer and returns - a writer
+ * thread drains the ring into the file in large write() calls.  There is
+ * one producer (the thread that commits the epochs) and one consumer so
+ * the ring only needs the two counters below.  The simulation only waits
+ * on the disk when the ring is full.
+ */
+
+/* globals */
+
+/* must be a power of two */
+#define LOG_WRITER_RING_SIZE (16*1024*1024)
+/* the sleeping writer is woken once this much is waiting - it is always woken to close */
+#define LOG_WRITER_WAKE_SIZE (256*1024)
+/* the largest single write() */
+#define LOG_WRITER_MAX_WRITE (4*1024*1024)
+/* room for one formatted line before log_writer_printf needs to allocate */
+#define LOG_WRITER_FORMAT_SIZE 1024
+
+struct log_writer_t_t
+{
+	log_writer_mode mode;
+	FILE *fout; // LOG_WRITER_STDIO
+
+	/* LOG_WRITER_ASYNC */
+	int fd;
+	char *ring;
+	long long head; // bytes ever put in the ring - only the producer writes it
+	long long tail; // bytes ever written to the file - only the writer thread writes it
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t data_ready; // the writer waits here for data
+	pthread_cond_t space_ready; // the producer waits here when the ring is full
+	int writer_sleeping;
+	int producer_waiting;
+	int closing;
+
+	char format_buffer[LOG_WRITER_FORMAT_SIZE];
+};
+
+void *log_writer_thread(void *arg);
+void log_writer_wake(log_writer_t *writer);
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_open)
+ *-----------------------------------------------------------------------*/
+log_writer_t *log_writer_open(char *file_name, log_writer_mode mode)
+{
+	return log_writer_open_at(file_name, mode, 0);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_open_at)
+ * Writing starts at position and anything after it is cut off - 0 for a
+ * new log and where a checkpoint left the log to resume it.
+ *-----------------------------------------------------------------------*/
+log_writer_t *log_writer_open_at(char *file_name, log_writer_mode mode, long long position)
+{
+	int fd;
+	log_writer_t *writer = (log_writer_t*)malloc(sizeof(log_writer_t));
+	oassert(writer != NULL);
+
+	writer->mode = mode;
+	writer->fout = NULL;
+	writer->fd = -1;
+	writer->ring = NULL;
+
+	/* a new log is opened like fopen "wb" so devices such as /dev/null still work */
+	fd = open(file_name, (position == 0) ? (O_WRONLY | O_CREAT | O_TRUNC) : (O_WRONLY | O_CREAT), 0644);
+	oassert(fd >= 0);
+	if (position > 0)
+	{
+		if (lseek(fd, 0, SEEK_END) < position)
+		{
+			printf("%s is shorter than its checkpoint\n", file_name);
+			oassert(FALSE);
+		}
+		oassert(ftruncate(fd, position) == 0);
+		oassert(lseek(fd, position, SEEK_SET) == position);
+	}
+
+	if (mode == LOG_WRITER_STDIO)
+	{
+		writer->fout = fdopen(fd, "wb");
+		oassert(writer->fout != NULL);
+		return writer;
+	}
+
+	writer->fd = fd;
+	writer->ring = (char*)malloc(LOG_WRITER_RING_SIZE);
+	oassert(writer->ring != NULL);
+	writer->head = 0;
+	writer->tail = 0;
+	writer->writer_sleeping = FALSE;
+	writer->producer_waiting = FALSE;
+	writer->closing = FALSE;
+	pthread_mutex_init(&writer->mutex, NULL);
+	pthread_cond_init(&writer->data_ready, NULL);
+	pthread_cond_init(&writer->space_ready, NULL);
+
+	oassert(pthread_create(&writer->thread, NULL, log_writer_thread, (void*)writer) == 0);
+
+	return writer;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_close)
+ * Waits for the writer thread to write everything that is in the ring.
+ *-----------------------------------------------------------------------*/
+void log_writer_close(log_writer_t *writer)
+{
+	if (writer->mode == LOG_WRITER_STDIO)
+	{
+		fclose(writer->fout);
+		free(writer);
+		return;
+	}
+
+	pthread_mutex_lock(&writer->mutex);
+	__atomic_store_n(&writer->closing, TRUE, __ATOMIC_SEQ_CST);
+	pthread_cond_signal(&writer->data_ready);
+	pthread_mutex_unlock(&writer->mutex);
+
+	pthread_join(writer->thread, NULL);
+
+	pthread_mutex_destroy(&writer->mutex);
+	pthread_cond_destroy(&writer->data_ready);
+	pthread_cond_destroy(&writer->space_ready);
+	close(writer->fd);
+	free(writer->ring);
+	free(writer);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_sync)
+ * Waits until everything written so far is on disk.
+ *
+ * returns the position in the file the next write goes to
+ *-----------------------------------------------------------------------*/
+long long log_writer_sync(log_writer_t *writer)
+{
+	if (writer->mode == LOG_WRITER_STDIO)
+	{
+		oassert(fflush(writer->fout) == 0);
+		fsync(fileno(writer->fout));
+		return ftello(writer->fout);
+	}
+
+	/* the same wait as a full ring - the writer says each time it wrote */
+	pthread_mutex_lock(&writer->mutex);
+	__atomic_store_n(&writer->producer_waiting, TRUE, __ATOMIC_SEQ_CST);
+	pthread_cond_signal(&writer->data_ready);
+	while (__atomic_load_n(&writer->tail, __ATOMIC_SEQ_CST) != writer->head)
+		pthread_cond_wait(&writer->space_ready, &writer->mutex);
+	__atomic_store_n(&writer->producer_waiting, FALSE, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&writer->mutex);
+
+	fsync(writer->fd);
+	return lseek(writer->fd, 0, SEEK_CUR);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_write)
+ *-----------------------------------------------------------------------*/
+void log_writer_write(log_writer_t *writer, const void *data, int size)
+{
+	const char *bytes = (const char*)data;
+	long long head;
+	long long space;
+	int at;
+	int to_copy;
+	int to_end;
+
+	if (writer->mode == LOG_WRITER_STDIO)
+	{
+		fwrite(data, 1, size, writer->fout);
+		return;
+	}
+
+	head = writer->head;
+	while (size > 0)
+	{
+		space = LOG_WRITER_RING_SIZE - (head - __atomic_load_n(&writer->tail, __ATOMIC_ACQUIRE));
+		if (space == 0)
+		{
+			/* full - the writer is busy (or woken here) and says when there is room */
+			pthread_mutex_lock(&writer->mutex);
+			__atomic_store_n(&writer->producer_waiting, TRUE, __ATOMIC_SEQ_CST);
+			pthread_cond_signal(&writer->data_ready);
+			while (head - __atomic_load_n(&writer->tail, __ATOMIC_SEQ_CST) == LOG_WRITER_RING_SIZE)
+				pthread_cond_wait(&writer->space_ready, &writer->mutex);
+			__atomic_store_n(&writer->producer_waiting, FALSE, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&writer->mutex);
+			continue;
+		}
+
+		to_copy = (space < size) ? (int)space : size;
+		at = (int)(head & (LOG_WRITER_RING_SIZE - 1));
+		to_end = LOG_WRITER_RING_SIZE - at;
+		if (to_copy <= to_end)
+		{
+			memcpy(writer->ring + at, bytes, to_copy);
+		}
+		else
+		{
+			memcpy(writer->ring + at, bytes, to_end);
+			memcpy(writer->ring, bytes + to_end, to_copy - to_end);
+		}
+
+		head += to_copy;
+		bytes += to_copy;
+		size -= to_copy;
+		__atomic_store_n(&writer->head, head, __ATOMIC_SEQ_CST);
+	}
+
+	if (__atomic_load_n(&writer->writer_sleeping, __ATOMIC_SEQ_CST) && head - __atomic_load_n(&writer->tail, __ATOMIC_ACQUIRE) >= LOG_WRITER_WAKE_SIZE)
+		log_writer_wake(writer);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_printf)
+ *-----------------------------------------------------------------------*/
+void log_writer_printf(log_writer_t *writer, const char *format, ...)
+{
+	va_list args;
+	va_list args_copy;
+	int size;
+	char *long_buffer;
+
+	va_start(args, format);
+
+	if (writer->mode == LOG_WRITER_STDIO)
+	{
+		vfprintf(writer->fout, format, args);
+		va_end(args);
+		return;
+	}
+
+	va_copy(args_copy, args);
+	size = vsnprintf(writer->format_buffer, LOG_WRITER_FORMAT_SIZE, format, args);
+	if (size < LOG_WRITER_FORMAT_SIZE)
+	{
+		log_writer_write(writer, writer->format_buffer, size);
+	}
+	else
+	{
+		long_buffer = (char*)malloc(size + 1);
+		vsnprintf(long_buffer, size + 1, format, args_copy);
+		log_writer_write(writer, long_buffer, size);
+		free(long_buffer);
+	}
+
+	va_end(args_copy);
+	va_end(args);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_wake)
+ *-----------------------------------------------------------------------*/
+void log_writer_wake(log_writer_t *writer)
+{
+	pthread_mutex_lock(&writer->mutex);
+	pthread_cond_signal(&writer->data_ready);
+	pthread_mutex_unlock(&writer->mutex);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: log_writer_thread)
+ * Writes the ring to the file until the log is closed and the ring empty.
+ *-----------------------------------------------------------------------*/
+void *log_writer_thread(void *arg)
+{
+	log_writer_t *writer = (log_writer_t*)arg;
+	long long head;
+	long long tail = 0;
+	int at;
+	int to_write;
+	ssize_t written;
+
+	while (TRUE)
+	{
+		head = __atomic_load_n(&writer->head, __ATOMIC_ACQUIRE);
+
+		if (head == tail)
+		{
+			if (__atomic_load_n(&writer->closing, __ATOMIC_SEQ_CST))
+			{
+				/* the producer stored its last head before closing */
+				if (__atomic_load_n(&writer->head, __ATOMIC_SEQ_CST) == tail)
+					break;
+				continue;
+			}
+
+			/* the producer looks at writer_sleeping after storing head so one of us sees the other */
+			pthread_mutex_lock(&writer->mutex);
+			__atomic_store_n(&writer->writer_sleeping, TRUE, __ATOMIC_SEQ_CST);
+			while (__atomic_load_n(&writer->head, __ATOMIC_SEQ_CST) == tail && !__atomic_load_n(&writer->closing, __ATOMIC_SEQ_CST))
+				pthread_cond_wait(&writer->data_ready, &writer->mutex);
+			__atomic_store_n(&writer->writer_sleeping, FALSE, __ATOMIC_SEQ_CST);
+			pthread_mutex_unlock(&writer->mutex);
+			continue;
+		}
+
+		/* up to the end of the ring - the wrapped part is the next write */
+		at = (int)(tail & (LOG_WRITER_RING_SIZE - 1));
+		to_write = LOG_WRITER_RING_SIZE - at;
+		if (head - tail < to_write)
+			to_write = (int)(head - tail);
+		if (to_write > LOG_WRITER_MAX_WRITE)
+			to_write = LOG_WRITER_MAX_WRITE;
+
+		written = write(writer->fd, writer->ring + at, to_write);
+		oassert(written > 0);
+
+		tail += written;
+		__atomic_store_n(&writer->tail, tail, __ATOMIC_SEQ_CST);
+
+		if (__atomic_load_n(&writer->producer_waiting, __ATOMIC_SEQ_CST))
+		{
+			pthread_mutex_lock(&writer->mutex);
+			pthread_cond_signal(&writer->space_ready);
+			pthread_mutex_unlock(&writer->mutex);
+		}
+	}
+
+	return NULL;
+}
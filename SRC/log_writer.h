@@ -0,0 +1,40 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include "types.h"
+
+/* where the log backends put their bytes - stdio or the async writer thread (see log_writer.cpp) */
+log_writer_t *log_writer_open(char *file_name, log_writer_mode mode);
+log_writer_t *log_writer_open_at(char *file_name, log_writer_mode mode, long long position);
+long long log_writer_sync(log_writer_t *writer);
+void log_writer_close(log_writer_t *writer);
+void log_writer_write(log_writer_t *writer, const void *data, int size);
+void log_writer_printf(log_writer_t *writer, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+#endif
@@ -0,0 +1,1024 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "loose_quadtree.h"
+#include "bvh.h"
+#include "collision_detection.h"
+#include "agent_store.h"
+
+/* globals */
+
+/* a node splits once more agents than this are in it and below, and goes back to a leaf at this many */
+#define QUADTREE_NODE_CAPACITY 8
+#define QUADTREE_MAX_DEPTH 20
+/* a depth first walk leaves at most 3 siblings per level on the stack */
+#define QUADTREE_STACK_SIZE (4 * QUADTREE_MAX_DEPTH + 4)
+/* a cell only this much further than the k-th agent is still searched - its distance and the agent's are rounded differently so a tie could be lost */
+#define QUADTREE_DISTANCE_SLACK_IN_M 1e-9
+
+/* best first heap of the k nearest search - one per thread */
+thread_local int *quadtree_heap_nodes = NULL;
+thread_local double *quadtree_heap_distances = NULL;
+thread_local int quadtree_alloc_heap = 0;
+
+short quadtree_agent_circle(int sim_object_idx, circle_t *circle);
+circle_t quadtree_indexed_circle(int sim_object_idx);
+int quadtree_new_node(loose_quadtree_t *qt, int parent, double center_x, double center_y, double half_size, int depth);
+void quadtree_free_subtree(loose_quadtree_t *qt, int node_idx, int into_idx);
+rectangle_t quadtree_loose_box(quadtree_node_t *node);
+short quadtree_loose_touches(quadtree_node_t *node, rectangle_t *box);
+short quadtree_agent_touches(int sim_object_idx, rectangle_t *box);
+int quadtree_child_of(quadtree_node_t *node, vector_2D_t *point);
+int quadtree_place(loose_quadtree_t *qt, vector_2D_t *point);
+int quadtree_start_node(loose_quadtree_t *qt, rectangle_t *box);
+short quadtree_can_split(loose_quadtree_t *qt, quadtree_node_t *node);
+void quadtree_insert(loose_quadtree_t *qt, int sim_object_idx, vector_2D_t *point);
+void quadtree_remove(loose_quadtree_t *qt, int sim_object_idx);
+void quadtree_split(loose_quadtree_t *qt, int node_idx);
+void quadtree_collapse(loose_quadtree_t *qt, int node_idx);
+void quadtree_mark_moved(loose_quadtree_t *qt, int node_idx, unsigned int version);
+void quadtree_node_add_id(quadtree_node_t *node, int id);
+void quadtree_node_remove_id(quadtree_node_t *node, int id);
+int quadtree_compare_ids(const void *a, const void *b);
+double quadtree_distance_to_box(rectangle_t *box, vector_2D_t *point);
+void quadtree_heap_push(int *num_heap, int node_idx, double distance);
+int quadtree_heap_pop(int *num_heap, double *distance);
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_build)
+ * The root's tight cell is the square around the environment.  Agents
+ * outside of it are kept in the root.  The shape of the tree only depends
+ * on where the agents are, not on the order they got there, so rebuilding
+ * it (as a checkpoint resume does) gives back the same tree.
+ *-----------------------------------------------------------------------*/
+void loose_quadtree_build(loose_quadtree_t *qt, double size_x_in_m, double size_y_in_m)
+{
+	int i;
+	double half_size = maximum(size_x_in_m, size_y_in_m) / 2;
+	circle_t c;
+
+	if (half_size <= 0)
+		half_size = 1;
+
+	qt->num_nodes = 0;
+	qt->alloc_nodes = 0;
+	qt->nodes = NULL;
+	qt->num_free_nodes = 0;
+	qt->free_nodes = NULL;
+	qt->version = 0;
+
+	qt->num_objects = num_sim_objects;
+	qt->node_of = (int*)malloc(sizeof(int) * num_sim_objects);
+
+	qt->max_radius_in_m = 0;
+	for (i = 0; i < num_sim_objects; i++)
+	{
+		qt->node_of[i] = -1;
+		if (quadtree_agent_circle(i, &c) == TRUE)
+			qt->max_radius_in_m = maximum(qt->max_radius_in_m, c.radius);
+	}
+
+	quadtree_new_node(qt, -1, size_x_in_m / 2, size_y_in_m / 2, half_size, 0);
+
+	for (i = 0; i < num_sim_objects; i++)
+	{
+		if (quadtree_agent_circle(i, &c) == TRUE)
+			quadtree_insert(qt, i, &c.center);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_free)
+ *-----------------------------------------------------------------------*/
+void loose_quadtree_free(loose_quadtree_t *qt)
+{
+	int i;
+
+	if (qt->nodes == NULL)
+		return;
+
+	for (i = 0; i < qt->num_nodes; i++)
+	{
+		free(qt->nodes[i].ids);
+	}
+	free(qt->nodes);
+	free(qt->free_nodes);
+	free(qt->node_of);
+
+	qt->nodes = NULL;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_thread_done)
+ * Frees the calling thread's k nearest heap - a pool worker calls this as
+ * it leaves.
+ *-----------------------------------------------------------------------*/
+void loose_quadtree_thread_done()
+{
+	free(quadtree_heap_nodes);
+	free(quadtree_heap_distances);
+
+	quadtree_heap_nodes = NULL;
+	quadtree_heap_distances = NULL;
+	quadtree_alloc_heap = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_update_object)
+ * An agent that moved only changes node when its center left the tight
+ * cell of the node it is in - the loose cell still holds the rest of it.
+ * The node it was in and the node it is in now are marked as moved in the
+ * current version.
+ *-----------------------------------------------------------------------*/
+void loose_quadtree_update_object(loose_quadtree_t *qt, int sim_object_idx)
+{
+	int old_node;
+	circle_t c;
+
+	if (qt->nodes == NULL)
+		return;
+	if (quadtree_agent_circle(sim_object_idx, &c) == FALSE)
+		return;
+
+	old_node = qt->node_of[sim_object_idx];
+	if (old_node == -1)
+	{
+		quadtree_insert(qt, sim_object_idx, &c.center);
+	}
+	else
+	{
+		/* marked before it is removed as that can free the node */
+		quadtree_mark_moved(qt, old_node, qt->version);
+		if (quadtree_place(qt, &c.center) == old_node)
+			return;
+
+		quadtree_remove(qt, sim_object_idx);
+		quadtree_insert(qt, sim_object_idx, &c.center);
+	}
+
+	quadtree_mark_moved(qt, qt->node_of[sim_object_idx], qt->version);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_next_version)
+ * Called before the agent moves of an epoch are committed so reads made
+ * before them can tell (see loose_quadtree_unchanged_since).
+ *-----------------------------------------------------------------------*/
+void loose_quadtree_next_version(loose_quadtree_t *qt)
+{
+	qt->version ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_unchanged_since)
+ * returns TRUE if nothing in the nodes whose loose cells touch the box has
+ * moved since the tree was at version.  Subtrees with no move since then
+ * are skipped without looking at where they are.
+ *-----------------------------------------------------------------------*/
+short loose_quadtree_unchanged_since(loose_quadtree_t *qt, rectangle_t *box, unsigned int version)
+{
+	int i;
+	int idx;
+	int stack[QUADTREE_STACK_SIZE];
+	int stack_top = 0;
+
+	if (qt->nodes == NULL)
+		return TRUE;
+
+	/* the nodes above the start have no objects of their own, but a move
+	 * marked on one before it split is still there */
+	stack[stack_top++] = quadtree_start_node(qt, box);
+	for (idx = qt->nodes[stack[0]].parent; idx != -1; idx = qt->nodes[idx].parent)
+	{
+		if (qt->nodes[idx].moved_version > version)
+			return FALSE;
+	}
+
+	while (stack_top > 0)
+	{
+		quadtree_node_t *node = &qt->nodes[stack[--stack_top]];
+
+		if (node->subtree_moved_version <= version)
+			continue;
+		if (node->moved_version > version)
+			return FALSE;
+		if (node->children[0] == QUADTREE_NO_CHILDREN)
+			continue;
+
+		for (i = 0; i < 4; i++)
+		{
+			quadtree_node_t *child = &qt->nodes[node->children[i]];
+
+			if (child->subtree_moved_version > version && quadtree_loose_touches(child, box))
+			{
+				oassert(stack_top < QUADTREE_STACK_SIZE);
+				stack[stack_top++] = node->children[i];
+			}
+		}
+	}
+
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_raycast)
+ * Visits the nodes whose loose cells the beam passes through nearest first
+ * calling fptr_hit once per object in each.  fptr_hit returns the distance
+ * from point1 to the hit or -1 for a miss.  A node the beam enters after
+ * the closest hit so far is skipped.  The root is always visited since it
+ * also keeps the agents outside of the environment.
+ *
+ * returns the closest distance or -1 if nothing hit
+ *-----------------------------------------------------------------------*/
+double loose_quadtree_raycast(loose_quadtree_t *qt, line_segment_t *beam, double (*fptr_hit)(int sim_object_idx, void *context), void *context)
+{
+	int i, j;
+	double x1 = beam->point1.x;
+	double y1 = beam->point1.y;
+	double dx = beam->point2.x - beam->point1.x;
+	double dy = beam->point2.y - beam->point1.y;
+	double length = sqrt(dx*dx + dy*dy);
+	double closest = -1;
+	rectangle_t beam_box;
+
+	int stack[QUADTREE_STACK_SIZE];
+	double stack_t[QUADTREE_STACK_SIZE];
+	int stack_top = 0;
+
+	if (qt->nodes == NULL)
+		return -1;
+
+	beam_box.origin.x = minimum(x1, x1 + dx);
+	beam_box.origin.y = minimum(y1, y1 + dy);
+	beam_box.size.x = fabs(dx);
+	beam_box.size.y = fabs(dy);
+
+	stack[0] = quadtree_start_node(qt, &beam_box);
+	stack_t[0] = 0;
+	stack_top = 1;
+
+	/* agents outside the environment */
+	if (stack[0] != 0)
+	{
+		for (i = 0; i < qt->nodes[0].num_ids; i++)
+		{
+			double distance = (*fptr_hit)(qt->nodes[0].ids[i], context);
+			if (distance >= 0 && (closest < 0 || distance < closest))
+				closest = distance;
+		}
+	}
+
+	while (stack_top > 0)
+	{
+		quadtree_node_t *node;
+		int num_entered = 0;
+		int entered[4];
+		double entered_t[4];
+
+		stack_top --;
+		node = &qt->nodes[stack[stack_top]];
+
+		/* something already hit before this cell */
+		if (closest >= 0 && stack_t[stack_top] * length > closest)
+			continue;
+
+		for (i = 0; i < node->num_ids; i++)
+		{
+			double distance = (*fptr_hit)(node->ids[i], context);
+			if (distance >= 0 && (closest < 0 || distance < closest))
+				closest = distance;
+		}
+
+		if (node->children[0] == QUADTREE_NO_CHILDREN)
+			continue;
+
+		/* children the beam enters sorted far to near so the near one comes off next */
+		for (i = 0; i < 4; i++)
+		{
+			quadtree_node_t *child = &qt->nodes[node->children[i]];
+			rectangle_t loose;
+			double t_enter;
+
+			if (child->num_in_subtree == 0)
+				continue;
+			loose = quadtree_loose_box(child);
+			if (!bvh_ray_enters_box(&loose, x1, y1, dx, dy, &t_enter))
+				continue;
+
+			for (j = num_entered; j > 0 && entered_t[j - 1] < t_enter; j--)
+			{
+				entered[j] = entered[j - 1];
+				entered_t[j] = entered_t[j - 1];
+			}
+			entered[j] = node->children[i];
+			entered_t[j] = t_enter;
+			num_entered ++;
+		}
+
+		oassert(stack_top + num_entered <= QUADTREE_STACK_SIZE);
+		for (i = 0; i < num_entered; i++)
+		{
+			stack[stack_top] = entered[i];
+			stack_t[stack_top++] = entered_t[i];
+		}
+	}
+
+	return closest;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_query_overlap)
+ * Calls fptr_found once for each agent whose bounding box touches the box.
+ * These are candidates - the caller does the exact test.
+ *-----------------------------------------------------------------------*/
+void loose_quadtree_query_overlap(loose_quadtree_t *qt, rectangle_t *box, void (*fptr_found)(int sim_object_idx, void *context), void *context)
+{
+	int i;
+	int stack[QUADTREE_STACK_SIZE];
+	int stack_top = 0;
+
+	if (qt->nodes == NULL)
+		return;
+
+	stack[stack_top++] = quadtree_start_node(qt, box);
+
+	/* agents outside the environment */
+	if (stack[0] != 0)
+	{
+		for (i = 0; i < qt->nodes[0].num_ids; i++)
+		{
+			if (quadtree_agent_touches(qt->nodes[0].ids[i], box))
+				(*fptr_found)(qt->nodes[0].ids[i], context);
+		}
+	}
+
+	while (stack_top > 0)
+	{
+		quadtree_node_t *node = &qt->nodes[stack[--stack_top]];
+
+		for (i = 0; i < node->num_ids; i++)
+		{
+			if (quadtree_agent_touches(node->ids[i], box))
+				(*fptr_found)(node->ids[i], context);
+		}
+
+		if (node->children[0] == QUADTREE_NO_CHILDREN)
+			continue;
+
+		for (i = 0; i < 4; i++)
+		{
+			quadtree_node_t *child = &qt->nodes[node->children[i]];
+
+			if (child->num_in_subtree > 0 && quadtree_loose_touches(child, box))
+			{
+				oassert(stack_top < QUADTREE_STACK_SIZE);
+				stack[stack_top++] = node->children[i];
+			}
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_query_circle)
+ * Calls fptr_found once for each agent touching the circle (exact test).
+ *-----------------------------------------------------------------------*/
+void loose_quadtree_query_circle(loose_quadtree_t *qt, circle_t *circle, void (*fptr_found)(int sim_object_idx, void *context), void *context)
+{
+	int i;
+	int stack[QUADTREE_STACK_SIZE];
+	int stack_top = 0;
+	rectangle_t box = circle_rectangle_hull(circle);
+	circle_t c;
+
+	if (qt->nodes == NULL)
+		return;
+
+	stack[stack_top++] = quadtree_start_node(qt, &box);
+
+	/* agents outside the environment */
+	if (stack[0] != 0)
+	{
+		for (i = 0; i < qt->nodes[0].num_ids; i++)
+		{
+			c = quadtree_indexed_circle(qt->nodes[0].ids[i]);
+			if (circles_collide(&c, circle))
+				(*fptr_found)(qt->nodes[0].ids[i], context);
+		}
+	}
+
+	while (stack_top > 0)
+	{
+		quadtree_node_t *node = &qt->nodes[stack[--stack_top]];
+
+		for (i = 0; i < node->num_ids; i++)
+		{
+			c = quadtree_indexed_circle(node->ids[i]);
+			if (circles_collide(&c, circle))
+				(*fptr_found)(node->ids[i], context);
+		}
+
+		if (node->children[0] == QUADTREE_NO_CHILDREN)
+			continue;
+
+		for (i = 0; i < 4; i++)
+		{
+			quadtree_node_t *child = &qt->nodes[node->children[i]];
+
+			if (child->num_in_subtree > 0 && quadtree_loose_touches(child, &box))
+			{
+				oassert(stack_top < QUADTREE_STACK_SIZE);
+				stack[stack_top++] = node->children[i];
+			}
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: loose_quadtree_k_nearest)
+ * Finds the k agents whose edges are nearest the point (0 if the point is
+ * inside one), skipping exclude_sim_object_idx (-1 skips none).  Nodes are
+ * visited best first by how far their loose cell is, and the search stops
+ * once the nearest unvisited cell is further than the k-th agent found.
+ * found and distances must have room for k and come back nearest first -
+ * ties go to the lower sim object.
+ *
+ * returns how many were found (less than k if there are not that many)
+ *-----------------------------------------------------------------------*/
+int loose_quadtree_k_nearest(loose_quadtree_t *qt, vector_2D_t *point, int k, int exclude_sim_object_idx, int *found, double *distances)
+{
+	int i, j;
+	int num_found = 0;
+	int num_heap = 0;
+	double cell_distance;
+	circle_t c;
+
+	if (qt->nodes == NULL || k <= 0)
+		return 0;
+
+	quadtree_heap_push(&num_heap, 0, 0);
+	while (num_heap > 0)
+	{
+		quadtree_node_t *node = &qt->nodes[quadtree_heap_pop(&num_heap, &cell_distance)];
+
+		if (num_found == k && cell_distance > distances[k - 1] + QUADTREE_DISTANCE_SLACK_IN_M)
+			break;
+
+		for (i = 0; i < node->num_ids; i++)
+		{
+			int id = node->ids[i];
+			double distance;
+
+			if (id == exclude_sim_object_idx)
+				continue;
+
+			c = quadtree_indexed_circle(id);
+			distance = maximum(0, sqrt((point->x - c.center.x) * (point->x - c.center.x) + (point->y - c.center.y) * (point->y - c.center.y)) - c.radius);
+
+			if (num_found == k && (distance > distances[k - 1] || (distance == distances[k - 1] && id > found[k - 1])))
+				continue;
+
+			/* insertion into the sorted results */
+			j = (num_found < k) ? num_found++ : k - 1;
+			for (; j > 0 && (distances[j - 1] > distance || (distances[j - 1] == distance && found[j - 1] > id)); j--)
+			{
+				found[j] = found[j - 1];
+				distances[j] = distances[j - 1];
+			}
+			found[j] = id;
+			distances[j] = distance;
+		}
+
+		if (node->children[0] == QUADTREE_NO_CHILDREN)
+			continue;
+
+		for (i = 0; i < 4; i++)
+		{
+			int child_idx = node->children[i];
+			rectangle_t loose;
+
+			if (qt->nodes[child_idx].num_in_subtree == 0)
+				continue;
+			loose = quadtree_loose_box(&qt->nodes[child_idx]);
+			quadtree_heap_push(&num_heap, child_idx, quadtree_distance_to_box(&loose, point));
+		}
+	}
+
+	return num_found;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_agent_circle)
+ * returns FALSE for anything that is not a physical agent
+ *-----------------------------------------------------------------------*/
+short quadtree_agent_circle(int sim_object_idx, circle_t *circle)
+{
+	int agent_idx;
+
+	if (sim_objects[sim_object_idx]->type != AGENT)
+		return FALSE;
+
+	agent_idx = sim_objects[sim_object_idx]->agent->agent_idx;
+	if (agent_store.not_physical[agent_idx] == TRUE)
+		return FALSE;
+
+	*circle = agent_store_circle(&agent_store, agent_idx);
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_indexed_circle)
+ * The circle of something already in the tree - only physical agents are
+ * put in it (see quadtree_agent_circle).
+ *-----------------------------------------------------------------------*/
+circle_t quadtree_indexed_circle(int sim_object_idx)
+{
+	oassert(sim_objects[sim_object_idx]->type == AGENT);
+	oassert(agent_store.not_physical[sim_objects[sim_object_idx]->agent->agent_idx] == FALSE);
+
+	return agent_store_circle(&agent_store, sim_objects[sim_object_idx]->agent->agent_idx);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_new_node)
+ * Reuses a freed node if there is one.  Can move qt->nodes so pointers
+ * into it are stale afterwards.
+ *-----------------------------------------------------------------------*/
+int quadtree_new_node(loose_quadtree_t *qt, int parent, double center_x, double center_y, double half_size, int depth)
+{
+	int idx;
+	quadtree_node_t *node;
+
+	if (qt->num_free_nodes > 0)
+	{
+		qt->num_free_nodes --;
+		idx = qt->free_nodes[qt->num_free_nodes];
+	}
+	else
+	{
+		if (qt->num_nodes == qt->alloc_nodes)
+		{
+			qt->alloc_nodes = (qt->alloc_nodes == 0) ? 16 : qt->alloc_nodes * 2;
+			qt->nodes = (quadtree_node_t*)realloc(qt->nodes, sizeof(quadtree_node_t) * qt->alloc_nodes);
+			qt->free_nodes = (int*)realloc(qt->free_nodes, sizeof(int) * qt->alloc_nodes);
+		}
+		idx = qt->num_nodes;
+		qt->num_nodes ++;
+		qt->nodes[idx].ids = NULL;
+		qt->nodes[idx].alloc_ids = 0;
+	}
+
+	node = &qt->nodes[idx];
+	node->center_x = center_x;
+	node->center_y = center_y;
+	node->half_size = half_size;
+	node->loose_half_size = half_size + qt->max_radius_in_m;
+	node->depth = depth;
+	node->parent = parent;
+	node->children[0] = node->children[1] = node->children[2] = node->children[3] = QUADTREE_NO_CHILDREN;
+	node->num_ids = 0;
+	node->num_in_subtree = 0;
+	node->moved_version = 0;
+	node->subtree_moved_version = 0;
+
+	return idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_free_subtree)
+ * Hands the nodes below node_idx back moving their objects into into_idx.
+ * The move marks come along so nothing that moved is forgotten.
+ *-----------------------------------------------------------------------*/
+void quadtree_free_subtree(loose_quadtree_t *qt, int node_idx, int into_idx)
+{
+	int i;
+	quadtree_node_t *node = &qt->nodes[node_idx];
+	quadtree_node_t *into = &qt->nodes[into_idx];
+
+	if (node->children[0] == QUADTREE_NO_CHILDREN)
+		return;
+
+	for (i = 0; i < 4; i++)
+	{
+		int child_idx = node->children[i];
+		quadtree_node_t *child = &qt->nodes[child_idx];
+		int j;
+
+		for (j = 0; j < child->num_ids; j++)
+		{
+			if (into->num_ids == into->alloc_ids)
+			{
+				into->alloc_ids = (into->alloc_ids == 0) ? 4 : into->alloc_ids * 2;
+				into->ids = (int*)realloc(into->ids, sizeof(int) * into->alloc_ids);
+			}
+			into->ids[into->num_ids++] = child->ids[j];
+			qt->node_of[child->ids[j]] = into_idx;
+		}
+		if (child->subtree_moved_version > into->moved_version)
+			into->moved_version = child->subtree_moved_version;
+
+		quadtree_free_subtree(qt, child_idx, into_idx);
+
+		child->num_ids = 0;
+		qt->free_nodes[qt->num_free_nodes++] = child_idx;
+		node->children[i] = QUADTREE_NO_CHILDREN;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_loose_box)
+ *-----------------------------------------------------------------------*/
+rectangle_t quadtree_loose_box(quadtree_node_t *node)
+{
+	rectangle_t box;
+
+	double reach = node->loose_half_size;
+
+	box.origin.x = node->center_x - reach;
+	box.origin.y = node->center_y - reach;
+	box.size.x = 2 * reach;
+	box.size.y = 2 * reach;
+
+	return box;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_loose_touches)
+ * same as rectangles_collide with the loose cell but without building it
+ *-----------------------------------------------------------------------*/
+short quadtree_loose_touches(quadtree_node_t *node, rectangle_t *box)
+{
+	double reach = node->loose_half_size;
+
+	return node->center_x - reach <= box->origin.x + box->size.x && box->origin.x <= node->center_x + reach
+		&& node->center_y - reach <= box->origin.y + box->size.y && box->origin.y <= node->center_y + reach;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_agent_touches)
+ * same as rectangles_collide with the agent's bounding box - straight from
+ * the store
+ *-----------------------------------------------------------------------*/
+short quadtree_agent_touches(int sim_object_idx, rectangle_t *box)
+{
+	int agent_idx = sim_objects[sim_object_idx]->agent->agent_idx;
+	double x = agent_store.x[agent_idx];
+	double y = agent_store.y[agent_idx];
+	double radius = agent_store.radius[agent_idx];
+
+	return x - radius <= box->origin.x + box->size.x && box->origin.x <= x + radius
+		&& y - radius <= box->origin.y + box->size.y && box->origin.y <= y + radius;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_child_of)
+ *-----------------------------------------------------------------------*/
+int quadtree_child_of(quadtree_node_t *node, vector_2D_t *point)
+{
+	return (point->x >= node->center_x) + 2 * (point->y >= node->center_y);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_place)
+ * returns the node an agent centered at point belongs in - the leaf whose
+ * tight cell has the point, or the root if it is outside the environment
+ *-----------------------------------------------------------------------*/
+int quadtree_place(loose_quadtree_t *qt, vector_2D_t *point)
+{
+	int idx = 0;
+	quadtree_node_t *root = &qt->nodes[0];
+
+	if (point->x < root->center_x - root->half_size || point->x > root->center_x + root->half_size
+		|| point->y < root->center_y - root->half_size || point->y > root->center_y + root->half_size)
+	{
+		return 0;
+	}
+
+	while (qt->nodes[idx].children[0] != QUADTREE_NO_CHILDREN)
+	{
+		idx = qt->nodes[idx].children[quadtree_child_of(&qt->nodes[idx], point)];
+	}
+
+	return idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_start_node)
+ * Where a query of the box can start instead of the root - the deepest
+ * node with the box far enough inside one child that no loose cell of the
+ * other children reaches it.  Only the root has objects of its own above
+ * that (the agents outside the environment).
+ *-----------------------------------------------------------------------*/
+int quadtree_start_node(loose_quadtree_t *qt, rectangle_t *box)
+{
+	int idx = 0;
+	double margin = qt->max_radius_in_m;
+
+	while (qt->nodes[idx].children[0] != QUADTREE_NO_CHILDREN)
+	{
+		quadtree_node_t *node = &qt->nodes[idx];
+		int child = 0;
+
+		if (box->origin.x > node->center_x + margin)
+			child += 1;
+		else if (box->origin.x + box->size.x >= node->center_x - margin)
+			break;
+
+		if (box->origin.y > node->center_y + margin)
+			child += 2;
+		else if (box->origin.y + box->size.y >= node->center_y - margin)
+			break;
+
+		idx = node->children[child];
+	}
+
+	return idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_can_split)
+ * Cells much smaller than an agent do not separate agents any better.
+ *-----------------------------------------------------------------------*/
+short quadtree_can_split(loose_quadtree_t *qt, quadtree_node_t *node)
+{
+	return node->depth < QUADTREE_MAX_DEPTH && node->half_size >= qt->max_radius_in_m;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_insert)
+ *-----------------------------------------------------------------------*/
+void quadtree_insert(loose_quadtree_t *qt, int sim_object_idx, vector_2D_t *point)
+{
+	int node_idx = quadtree_place(qt, point);
+	int idx;
+
+	quadtree_node_add_id(&qt->nodes[node_idx], sim_object_idx);
+	qt->node_of[sim_object_idx] = node_idx;
+
+	for (idx = node_idx; idx != -1; idx = qt->nodes[idx].parent)
+	{
+		qt->nodes[idx].num_in_subtree ++;
+	}
+
+	if (qt->nodes[node_idx].children[0] == QUADTREE_NO_CHILDREN
+		&& qt->nodes[node_idx].num_in_subtree > QUADTREE_NODE_CAPACITY
+		&& quadtree_can_split(qt, &qt->nodes[node_idx]))
+	{
+		quadtree_split(qt, node_idx);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_remove)
+ * The highest node left with few enough objects below it goes back to
+ * being a leaf.
+ *-----------------------------------------------------------------------*/
+void quadtree_remove(loose_quadtree_t *qt, int sim_object_idx)
+{
+	int node_idx = qt->node_of[sim_object_idx];
+	int idx;
+	int collapse_idx = -1;
+
+	quadtree_node_remove_id(&qt->nodes[node_idx], sim_object_idx);
+	qt->node_of[sim_object_idx] = -1;
+
+	for (idx = node_idx; idx != -1; idx = qt->nodes[idx].parent)
+	{
+		qt->nodes[idx].num_in_subtree --;
+		if (qt->nodes[idx].children[0] != QUADTREE_NO_CHILDREN && qt->nodes[idx].num_in_subtree <= QUADTREE_NODE_CAPACITY)
+			collapse_idx = idx;
+	}
+
+	if (collapse_idx != -1)
+		quadtree_collapse(qt, collapse_idx);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_split)
+ * Moves the objects of a leaf down into four new children, splitting them
+ * again if they are still too full.
+ *-----------------------------------------------------------------------*/
+void quadtree_split(loose_quadtree_t *qt, int node_idx)
+{
+	int i;
+	int num_kept = 0;
+	double quarter = qt->nodes[node_idx].half_size / 2;
+	int depth = qt->nodes[node_idx].depth + 1;
+	quadtree_node_t *node;
+	circle_t c;
+
+	for (i = 0; i < 4; i++)
+	{
+		double center_x = qt->nodes[node_idx].center_x + ((i & 1) ? quarter : -quarter);
+		double center_y = qt->nodes[node_idx].center_y + ((i & 2) ? quarter : -quarter);
+		int child_idx = quadtree_new_node(qt, node_idx, center_x, center_y, quarter, depth);
+
+		qt->nodes[node_idx].children[i] = child_idx;
+	}
+
+	/* ids are in order so the children's come out in order too */
+	node = &qt->nodes[node_idx];
+	for (i = 0; i < node->num_ids; i++)
+	{
+		int id = node->ids[i];
+
+		c = quadtree_indexed_circle(id);
+		if (node_idx == 0 && quadtree_place(qt, &c.center) == 0)
+		{
+			/* outside the environment - stays in the root */
+			node->ids[num_kept++] = id;
+		}
+		else
+		{
+			int child_idx = node->children[quadtree_child_of(node, &c.center)];
+
+			quadtree_node_add_id(&qt->nodes[child_idx], id);
+			qt->nodes[child_idx].num_in_subtree ++;
+			qt->node_of[id] = child_idx;
+		}
+	}
+	node->num_ids = num_kept;
+
+	for (i = 0; i < 4; i++)
+	{
+		quadtree_node_t *child = &qt->nodes[qt->nodes[node_idx].children[i]];
+
+		if (child->num_in_subtree > QUADTREE_NODE_CAPACITY && quadtree_can_split(qt, child))
+			quadtree_split(qt, qt->nodes[node_idx].children[i]);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_collapse)
+ *-----------------------------------------------------------------------*/
+void quadtree_collapse(loose_quadtree_t *qt, int node_idx)
+{
+	quadtree_node_t *node = &qt->nodes[node_idx];
+
+	quadtree_free_subtree(qt, node_idx, node_idx);
+	qsort(node->ids, node->num_ids, sizeof(int), quadtree_compare_ids);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_mark_moved)
+ *-----------------------------------------------------------------------*/
+void quadtree_mark_moved(loose_quadtree_t *qt, int node_idx, unsigned int version)
+{
+	int idx;
+
+	qt->nodes[node_idx].moved_version = version;
+	for (idx = node_idx; idx != -1 && qt->nodes[idx].subtree_moved_version != version; idx = qt->nodes[idx].parent)
+	{
+		qt->nodes[idx].subtree_moved_version = version;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_node_add_id)
+ * Kept sorted so the order objects are found in does not depend on the
+ * order they moved in.
+ *-----------------------------------------------------------------------*/
+void quadtree_node_add_id(quadtree_node_t *node, int id)
+{
+	int i;
+
+	if (node->num_ids == node->alloc_ids)
+	{
+		node->alloc_ids = (node->alloc_ids == 0) ? 4 : node->alloc_ids * 2;
+		node->ids = (int*)realloc(node->ids, sizeof(int) * node->alloc_ids);
+	}
+	for (i = node->num_ids; i > 0 && node->ids[i - 1] > id; i--)
+	{
+		node->ids[i] = node->ids[i - 1];
+	}
+	node->ids[i] = id;
+	node->num_ids ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_node_remove_id)
+ *-----------------------------------------------------------------------*/
+void quadtree_node_remove_id(quadtree_node_t *node, int id)
+{
+	int i;
+
+	for (i = 0; i < node->num_ids; i++)
+	{
+		if (node->ids[i] == id)
+		{
+			memmove(&node->ids[i], &node->ids[i + 1], sizeof(int) * (node->num_ids - i - 1));
+			node->num_ids --;
+			return;
+		}
+	}
+	oassert(FALSE);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_compare_ids)
+ *-----------------------------------------------------------------------*/
+int quadtree_compare_ids(const void *a, const void *b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_distance_to_box)
+ *-----------------------------------------------------------------------*/
+double quadtree_distance_to_box(rectangle_t *box, vector_2D_t *point)
+{
+	double dx = maximum(0, maximum(box->origin.x - point->x, point->x - (box->origin.x + box->size.x)));
+	double dy = maximum(0, maximum(box->origin.y - point->y, point->y - (box->origin.y + box->size.y)));
+
+	return sqrt(dx*dx + dy*dy);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_heap_push)
+ *-----------------------------------------------------------------------*/
+void quadtree_heap_push(int *num_heap, int node_idx, double distance)
+{
+	int i = *num_heap;
+
+	if (*num_heap == quadtree_alloc_heap)
+	{
+		quadtree_alloc_heap = (quadtree_alloc_heap == 0) ? 64 : quadtree_alloc_heap * 2;
+		quadtree_heap_nodes = (int*)realloc(quadtree_heap_nodes, sizeof(int) * quadtree_alloc_heap);
+		quadtree_heap_distances = (double*)realloc(quadtree_heap_distances, sizeof(double) * quadtree_alloc_heap);
+	}
+	(*num_heap) ++;
+
+	while (i > 0 && quadtree_heap_distances[(i - 1) / 2] > distance)
+	{
+		quadtree_heap_nodes[i] = quadtree_heap_nodes[(i - 1) / 2];
+		quadtree_heap_distances[i] = quadtree_heap_distances[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	quadtree_heap_nodes[i] = node_idx;
+	quadtree_heap_distances[i] = distance;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: quadtree_heap_pop)
+ * returns the nearest node on the heap
+ *-----------------------------------------------------------------------*/
+int quadtree_heap_pop(int *num_heap, double *distance)
+{
+	int top = quadtree_heap_nodes[0];
+	int last_node;
+	double last_distance;
+	int i = 0;
+
+	*distance = quadtree_heap_distances[0];
+	(*num_heap) --;
+	last_node = quadtree_heap_nodes[*num_heap];
+	last_distance = quadtree_heap_distances[*num_heap];
+
+	while (2 * i + 1 < *num_heap)
+	{
+		int child = 2 * i + 1;
+
+		if (child + 1 < *num_heap && quadtree_heap_distances[child + 1] < quadtree_heap_distances[child])
+			child ++;
+		if (quadtree_heap_distances[child] >= last_distance)
+			break;
+
+		quadtree_heap_nodes[i] = quadtree_heap_nodes[child];
+		quadtree_heap_distances[i] = quadtree_heap_distances[child];
+		i = child;
+	}
+	quadtree_heap_nodes[i] = last_node;
+	quadtree_heap_distances[i] = last_distance;
+
+	return top;
+}
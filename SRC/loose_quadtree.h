@@ -0,0 +1,44 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef LOOSE_QUADTREE_H
+#define LOOSE_QUADTREE_H
+
+#include "types.h"
+
+void loose_quadtree_build(loose_quadtree_t *qt, double size_x_in_m, double size_y_in_m);
+void loose_quadtree_free(loose_quadtree_t *qt);
+void loose_quadtree_thread_done();
+void loose_quadtree_update_object(loose_quadtree_t *qt, int sim_object_idx);
+double loose_quadtree_raycast(loose_quadtree_t *qt, line_segment_t *beam, double (*fptr_hit)(int sim_object_idx, void *context), void *context);
+
+void loose_quadtree_next_version(loose_quadtree_t *qt);
+short loose_quadtree_unchanged_since(loose_quadtree_t *qt, rectangle_t *box, unsigned int version);
+void loose_quadtree_query_overlap(loose_quadtree_t *qt, rectangle_t *box, void (*fptr_found)(int sim_object_idx, void *context), void *context);
+void loose_quadtree_query_circle(loose_quadtree_t *qt, circle_t *circle, void (*fptr_found)(int sim_object_idx, void *context), void *context);
+int loose_quadtree_k_nearest(loose_quadtree_t *qt, vector_2D_t *point, int k, int exclude_sim_object_idx, int *found, double *distances);
+
+#endif
@@ -0,0 +1,248 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "profile.h"
+
+#ifdef CENTURION_PROFILE
+
+/* 
+ * Every thread adds to its own counters so the timers need no locks.  The
+ * per epoch sums are collected by profile_epoch_done between epochs when
+ * the pool threads are idle.  Control times include the sensors and
+ * actuators the controls call.
+ */
+
+/* globals */
+
+typedef struct profile_counts_t_t profile_counts_t;
+struct profile_counts_t_t
+{
+	long long calls[NUM_PROFILE_PHASES];
+	long long total_ns[NUM_PROFILE_PHASES];
+	long long epoch_ns[NUM_PROFILE_PHASES];
+};
+
+const char *profile_phase_names[] = {"control", "sensor", "actuator", "commit", "crash_check", "log_step", "log_agent", "log_beam"};
+
+thread_local profile_counts_t *my_profile_counts = NULL;
+
+pthread_mutex_t profile_threads_lock = PTHREAD_MUTEX_INITIALIZER;
+profile_counts_t **profile_threads = NULL;
+int num_profile_threads = 0;
+
+/* per epoch samples - the last one is the wall time of the whole epoch */
+long long *profile_epoch_samples[NUM_PROFILE_PHASES+1];
+int num_profile_epochs = 0;
+int alloc_profile_epochs = 0;
+long long profile_epoch_start_ns;
+double profile_start_wall_time;
+double profile_start_cpu_time;
+
+profile_counts_t *profile_thread_counts();
+int compare_long_long(const void *a, const void *b);
+long long percentile_of_sorted(long long *sorted, int num, double fraction);
+
+/*-------------------------------------------------------------------------
+ * (function: profile_start)
+ *-----------------------------------------------------------------------*/
+void profile_start()
+{
+	profile_start_wall_time = get_wall_time();
+	profile_start_cpu_time = get_cpu_time();
+	profile_epoch_start_ns = profile_now_ns();
+}
+
+/*-------------------------------------------------------------------------
+ * (function: profile_thread_counts)
+ * The counters of the calling thread - made on its first timer.
+ *-----------------------------------------------------------------------*/
+profile_counts_t *profile_thread_counts()
+{
+	if (my_profile_counts == NULL)
+	{
+		my_profile_counts = (profile_counts_t*)calloc(1, sizeof(profile_counts_t));
+
+		pthread_mutex_lock(&profile_threads_lock);
+		profile_threads = (profile_counts_t**)realloc(profile_threads, sizeof(profile_counts_t*) * (num_profile_threads + 1));
+		profile_threads[num_profile_threads] = my_profile_counts;
+		num_profile_threads ++;
+		pthread_mutex_unlock(&profile_threads_lock);
+	}
+
+	return my_profile_counts;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: profile_add)
+ *-----------------------------------------------------------------------*/
+void profile_add(int phase, long long ns)
+{
+	profile_counts_t *counts = profile_thread_counts();
+
+	counts->calls[phase] ++;
+	counts->total_ns[phase] += ns;
+	counts->epoch_ns[phase] += ns;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: profile_epoch_done)
+ * Called once at the end of each epoch by the main thread.
+ *-----------------------------------------------------------------------*/
+void profile_epoch_done()
+{
+	int i, j;
+	long long now_ns = profile_now_ns();
+
+	if (num_profile_epochs == alloc_profile_epochs)
+	{
+		alloc_profile_epochs = (alloc_profile_epochs == 0) ? 1024 : alloc_profile_epochs * 2;
+		for (i = 0; i <= NUM_PROFILE_PHASES; i++)
+		{
+			profile_epoch_samples[i] = (long long*)realloc(profile_epoch_samples[i], sizeof(long long) * alloc_profile_epochs);
+		}
+	}
+
+	pthread_mutex_lock(&profile_threads_lock);
+	for (i = 0; i < NUM_PROFILE_PHASES; i++)
+	{
+		long long epoch_ns = 0;
+
+		for (j = 0; j < num_profile_threads; j++)
+		{
+			epoch_ns += profile_threads[j]->epoch_ns[i];
+			profile_threads[j]->epoch_ns[i] = 0;
+		}
+		profile_epoch_samples[i][num_profile_epochs] = epoch_ns;
+	}
+	pthread_mutex_unlock(&profile_threads_lock);
+
+	profile_epoch_samples[NUM_PROFILE_PHASES][num_profile_epochs] = now_ns - profile_epoch_start_ns;
+	profile_epoch_start_ns = now_ns;
+	num_profile_epochs ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: profile_report)
+ * Totals, calls/s and the p50/p99/max of the time each phase took per
+ * epoch.  Phases run on the thread pool are summed over the threads.
+ *-----------------------------------------------------------------------*/
+void profile_report(char *file_name)
+{
+	FILE *fprofile;
+	int i, j;
+	double wall_time = get_wall_time() - profile_start_wall_time;
+	double cpu_time = get_cpu_time() - profile_start_cpu_time;
+	long long *sorted;
+
+	fprofile = fopen(file_name, "w");
+	oassert(fprofile != NULL);
+
+	fprintf(fprofile, "run wall time: %f s cpu time: %f s epochs: %d threads timed: %d\n", wall_time, cpu_time, num_profile_epochs, num_profile_threads);
+	fprintf(fprofile, "%-12s %12s %12s %8s %12s %14s %14s %14s %14s\n", "phase", "calls", "total_s", "%wall", "ns/call", "calls/s", "epoch_p50_us", "epoch_p99_us", "epoch_max_us");
+
+	sorted = (long long*)malloc(sizeof(long long) * (num_profile_epochs + 1));
+
+	for (i = 0; i <= NUM_PROFILE_PHASES; i++)
+	{
+		long long calls = 0;
+		long long total_ns = 0;
+
+		if (i < NUM_PROFILE_PHASES)
+		{
+			for (j = 0; j < num_profile_threads; j++)
+			{
+				calls += profile_threads[j]->calls[i];
+				total_ns += profile_threads[j]->total_ns[i];
+			}
+		}
+		else
+		{
+			/* the whole epoch */
+			calls = num_profile_epochs;
+			for (j = 0; j < num_profile_epochs; j++)
+				total_ns += profile_epoch_samples[i][j];
+		}
+
+		memcpy(sorted, profile_epoch_samples[i], sizeof(long long) * num_profile_epochs);
+		qsort(sorted, num_profile_epochs, sizeof(long long), compare_long_long);
+
+		fprintf(fprofile, "%-12s %12lld %12.6f %8.2f %12.1f %14.1f %14.3f %14.3f %14.3f\n", 
+				(i < NUM_PROFILE_PHASES) ? profile_phase_names[i] : "epoch",
+				calls,
+				total_ns * 1e-9,
+				(wall_time > 0) ? 100 * total_ns * 1e-9 / wall_time : 0,
+				(calls > 0) ? (double)total_ns / calls : 0,
+				(wall_time > 0) ? calls / wall_time : 0,
+				percentile_of_sorted(sorted, num_profile_epochs, 0.5) * 1e-3,
+				percentile_of_sorted(sorted, num_profile_epochs, 0.99) * 1e-3,
+				percentile_of_sorted(sorted, num_profile_epochs, 1.0) * 1e-3);
+	}
+
+	fclose(fprofile);
+	free(sorted);
+
+	printf("Profile in %s\n", file_name);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: percentile_of_sorted)
+ * Nearest rank.
+ *-----------------------------------------------------------------------*/
+long long percentile_of_sorted(long long *sorted, int num, double fraction)
+{
+	int rank;
+
+	if (num == 0)
+		return 0;
+
+	rank = (int)ceil(fraction * num) - 1;
+	if (rank < 0)
+		rank = 0;
+
+	return sorted[rank];
+}
+
+/*-------------------------------------------------------------------------
+ * (function: compare_long_long)
+ *-----------------------------------------------------------------------*/
+int compare_long_long(const void *a, const void *b)
+{
+	long long la = *(const long long*)a;
+	long long lb = *(const long long*)b;
+
+	return (la > lb) - (la < lb);
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* 
+ * Hot path timers - only built with -DCENTURION_PROFILE (cmake
+ * -DCENTURION_PROFILE=ON).  Without it the macros are empty and nothing
+ * here costs anything.
+ */
+
+enum profile_phase {PROFILE_CONTROL = 0, PROFILE_SENSOR, PROFILE_ACTUATOR, PROFILE_COMMIT, PROFILE_CRASH_CHECK, PROFILE_LOG_STEP, PROFILE_LOG_AGENT, PROFILE_LOG_BEAM, NUM_PROFILE_PHASES};
+
+#ifdef CENTURION_PROFILE
+
+#include <time.h>
+
+void profile_start();
+void profile_add(int phase, long long ns);
+void profile_epoch_done();
+void profile_report(char *file_name);
+
+inline long long profile_now_ns()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/* adds the time from here to the end of the enclosing scope to phase */
+struct profile_scope_t
+{
+	int phase;
+	long long start_ns;
+
+	profile_scope_t(int scope_phase) : phase(scope_phase), start_ns(profile_now_ns()) {}
+	~profile_scope_t() { profile_add(phase, profile_now_ns() - start_ns); }
+};
+
+#define PROFILE_START() profile_start()
+#define PROFILE_SCOPE(phase) profile_scope_t profile_scope(phase)
+#define PROFILE_EPOCH_DONE() profile_epoch_done()
+#define PROFILE_REPORT(file_name) profile_report(file_name)
+
+#else
+
+#define PROFILE_START()
+#define PROFILE_SCOPE(phase)
+#define PROFILE_EPOCH_DONE()
+#define PROFILE_REPORT(file_name)
+
+#endif
+
+#endif
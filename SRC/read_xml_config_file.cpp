@@ -26,7 +26,13 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "types.h"
 #include "globals.h"
 
@@ -35,12 +41,79 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "robot_control.h"
 #include "sensors.h"
 #include "actuators.h"
+#include "agent_store.h"
+#include "collision_detection.h"
 
 // libxml includes
-#include <libxml/xmlmemory.h> //#include <libxml/xmlmemory.h>
-#include <libxml/parser.h> //#include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 
-void read_xml_object(objects_t *object, xmlNodePtr shape_xmlptr, xmlDocPtr doc);
+/* deepest nesting of elements the config uses (agents/agent_group/object/circle/x) with room to spare */
+#define CONFIG_MAX_DEPTH 32
+
+/* the scenario cache file - a header then the events the reader saw */
+#define SCENARIO_CACHE_MAGIC "CENTSCN1"
+#define SCENARIO_CACHE_VERSION 1
+#define SCENARIO_CACHE_NAME 'N'
+#define SCENARIO_CACHE_START 'S'
+#define SCENARIO_CACHE_END 'E'
+#define SCENARIO_CACHE_NO_TEXT 0xFFFFFFFFu
+
+typedef struct scenario_cache_header_t_t scenario_cache_header_t;
+typedef struct config_reader_t_t config_reader_t;
+
+struct scenario_cache_header_t_t
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t num_names;
+	uint64_t config_hash;
+	uint64_t config_size;
+	uint64_t events_size;
+};
+
+/* where the read is as the elements stream past - the same for the xml and a cache replay */
+struct config_reader_t_t
+{
+	const char *element[CONFIG_MAX_DEPTH];
+	short has_children[CONFIG_MAX_DEPTH];
+	int depth;
+	short failed;
+
+	/* text of the element being read - only kept for elements without children */
+	char *text;
+	int num_text;
+	int alloc_text;
+
+	/* counters of the lists being filled */
+	int objects_idx;
+	int agent_group_idx;
+	int agent_idx;
+	int sensor_idx;
+	int actuator_idx;
+	objects_t *object;
+
+	/* the events recorded for the scenario cache - NULL when not recording */
+	short record;
+	char *events;
+	size_t num_events;
+	size_t alloc_events;
+	const char **names;
+	int num_names;
+	int alloc_names;
+};
+
+void config_element_start(config_reader_t *reader, const char *name);
+void config_element_text(config_reader_t *reader, const char *text, int length);
+void config_element_end(config_reader_t *reader, const char *text);
+void config_system_value(const char *name, const char *text);
+void config_environment_value(const char *name, const char *text);
+void config_shape_value(objects_t *object, const char *shape, const char *name, const char *text);
+void config_agent_group_value(config_reader_t *reader, agent_group_t *agent_group, const char *parent, const char *name, const char *text);
+short config_stream_xml(config_reader_t *reader, char *config_file_name, const char *config_data, size_t config_size);
+void config_record(config_reader_t *reader, const void *data, size_t size);
+short scenario_cache_replay(config_reader_t *reader, const char *cache_file_name, uint64_t config_hash, uint64_t config_size);
+void scenario_cache_write(config_reader_t *reader, const char *cache_file_name, uint64_t config_hash, uint64_t config_size);
+uint64_t config_hash(const char *data, size_t size);
 
 /*-------------------------------------------------------------------------
  * (function: read_config_file)
@@ -50,503 +123,954 @@ void read_xml_object(objects_t *object, xmlNodePtr shape_xmlptr, xmlDocPtr doc);
  *-----------------------------------------------------------------------*/
 void read_config_file(char *config_file_name)
 {
-	xmlDocPtr doc;
-	xmlNodePtr top_xmlptr;
-	int i, j;
+	read_config_file_with_cache(config_file_name, NULL);
+}
 
-	doc = xmlParseFile(config_file_name);
-	
-	if (doc == NULL ) 
+/*-------------------------------------------------------------------------
+ * (function: read_config_file_with_cache)
+ * The config is streamed with an xmlTextReader so no DOM of the agent list
+ * is ever built - each element is handled as it goes past.  With a
+ * cache_dir the elements seen are also kept in cache_dir/<hash>.scenario,
+ * keyed by a hash of the config bytes, and the next launch of the same
+ * config maps that file and replays it through the same handlers instead
+ * of parsing the XML.
+ *-----------------------------------------------------------------------*/
+void read_config_file_with_cache(char *config_file_name, char *cache_dir)
+{
+	config_reader_t reader;
+	char cache_file_name[4096];
+	struct stat config_stat;
+	const char *config_data;
+	uint64_t hash;
+	short read_ok;
+	int fd;
+
+	/* defaults for what the config does not have to give */
+	environment.check_collisions = TRUE;
+	environment.stop_on_collision = FALSE;
+	environment.agent_index = AGENT_INDEX_GRID;
+	sim_system.checkpoint_every_s = 0;
+	sim_system.checkpoint_file_out = (char*)"checkpoint.ckpt";
+
+	memset(&reader, 0, sizeof(config_reader_t));
+
+	fd = open(config_file_name, O_RDONLY);
+	if (fd < 0 || fstat(fd, &config_stat) != 0 || config_stat.st_size == 0)
 	{
 		fprintf(stderr,"Document not parsed successfully. \n");
+		if (fd >= 0)
+			close(fd);
 		return;
 	}
-	
-	top_xmlptr = xmlDocGetRootElement(doc);
-	
-	if (top_xmlptr == NULL) 
+	config_data = (const char*)mmap(NULL, config_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	oassert(config_data != MAP_FAILED);
+
+	if (cache_dir != NULL)
 	{
-		fprintf(stderr,"empty document\n");
-		xmlFreeDoc(doc);
-		return;
+		hash = config_hash(config_data, config_stat.st_size);
+		snprintf(cache_file_name, sizeof(cache_file_name), "%s/%016llx.scenario", cache_dir, (unsigned long long)hash);
+
+		if (scenario_cache_replay(&reader, cache_file_name, hash, config_stat.st_size) == TRUE)
+		{
+			printf("Scenario read from cache %s\n", cache_file_name);
+		}
+		else
+		{
+			reader.record = TRUE;
+			read_ok = config_stream_xml(&reader, config_file_name, config_data, config_stat.st_size);
+			if (read_ok == TRUE)
+				scenario_cache_write(&reader, cache_file_name, hash, config_stat.st_size);
+		}
 	}
-	
-	if (xmlStrcmp(top_xmlptr->name, (const xmlChar *) "centurion_config")) 
+	else
 	{
-		fprintf(stderr,"document of the wrong type, root node != centurion_config");
-		xmlFreeDoc(doc);
-		return;
+		config_stream_xml(&reader, config_file_name, config_data, config_stat.st_size);
+	}
+
+	munmap((void*)config_data, config_stat.st_size);
+	free(reader.text);
+	free(reader.events);
+	free(reader.names);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: read_config_override)
+ * Changes one value of the config already read, by the name of its
+ * element - system.<name>, environment.<name> or
+ * agent_group.<idx>.control_algorithm.  Only values read as the run goes
+ * make sense to change once the simulation is set up (sim_time_s,
+ * check_collisions, stop_on_collision, the sim_log options and the
+ * control algorithms).
+ *
+ * returns FALSE if name is not one of these
+ *-----------------------------------------------------------------------*/
+short read_config_override(char *name, char *value)
+{
+	int agent_group_idx;
+	char control_name[4096];
+
+	if (strncmp(name, "system.", strlen("system.")) == 0)
+	{
+		config_system_value(name + strlen("system."), value);
+	}
+	else if (strncmp(name, "environment.", strlen("environment.")) == 0)
+	{
+		/* the agent index is already built */
+		if (strcmp(name, "environment.agent_index") == 0)
+			return FALSE;
+		config_environment_value(name + strlen("environment."), value);
+	}
+	else if (sscanf(name, "agent_group.%d.%4095s", &agent_group_idx, control_name) == 2 && strcmp(control_name, "control_algorithm") == 0)
+	{
+		if (agent_group_idx < 0 || agent_group_idx >= agent_groups.num_agent_groups)
+			return FALSE;
+
+		/* the agents carry on in the states they are in */
+		setup_function_for_control(agent_groups.agent_group[agent_group_idx], value);
+		setup_group_kernels();
 	}
-	
-	top_xmlptr = top_xmlptr->xmlChildrenNode;
-	while (top_xmlptr != NULL) 
+	else
+	{
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: config_stream_xml)
+ * Pulls the elements of the config one at a time and hands them to the
+ * start/text/end handlers.
+ *
+ * returns TRUE if the whole config was read
+ *-----------------------------------------------------------------------*/
+short config_stream_xml(config_reader_t *reader, char *config_file_name, const char *config_data, size_t config_size)
+{
+	xmlTextReaderPtr xml_reader;
+	const xmlChar *value;
+	int ret;
+
+	xml_reader = xmlReaderForMemory(config_data, config_size, config_file_name, NULL, 0);
+	if (xml_reader == NULL)
 	{
-		xmlChar *string_data;
+		fprintf(stderr,"Document not parsed successfully. \n");
+		return FALSE;
+	}
 
-		if ((!xmlStrcmp(top_xmlptr->name, (const xmlChar *)"system")))
+	while (reader->failed == FALSE && (ret = xmlTextReaderRead(xml_reader)) == 1)
+	{
+		switch (xmlTextReaderNodeType(xml_reader))
 		{
-			xmlNodePtr system_params_xmlptr = top_xmlptr->xmlChildrenNode;
-			while (system_params_xmlptr != NULL) 
-			{
-				if ((!xmlStrcmp(system_params_xmlptr->name, (const xmlChar *)"rand_seed")))
-				{
-					string_data = xmlNodeListGetString(doc, system_params_xmlptr->xmlChildrenNode, 1);
-					sim_system.rand_seed = atoi((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(system_params_xmlptr->name, (const xmlChar *)"simulation_type")))
-				{
-					string_data = xmlNodeListGetString(doc, system_params_xmlptr->xmlChildrenNode, 1);
-					sim_system.simulation_type = (char*)string_data;
-				}
-				else if ((!xmlStrcmp(system_params_xmlptr->name, (const xmlChar *)"debug_file_out")))
-				{
-					string_data = xmlNodeListGetString(doc, system_params_xmlptr->xmlChildrenNode, 1);
-					sim_system.debug_file_out = (char*)string_data;
-				}
-				else if ((!xmlStrcmp(system_params_xmlptr->name, (const xmlChar *)"sim_log_file_out")))
-				{
-					string_data = xmlNodeListGetString(doc, system_params_xmlptr->xmlChildrenNode, 1);
-					sim_system.sim_log_file_out = (char*)string_data;
-				}
+			case XML_READER_TYPE_ELEMENT:
+				config_element_start(reader, (const char*)xmlTextReaderConstName(xml_reader));
+				if (xmlTextReaderIsEmptyElement(xml_reader))
+					config_element_end(reader, "");
+				break;
+			case XML_READER_TYPE_END_ELEMENT:
+				if (reader->has_children[reader->depth-1] == TRUE)
+					config_element_end(reader, NULL);
+				else
+					config_element_end(reader, (reader->num_text > 0) ? reader->text : "");
+				break;
+			case XML_READER_TYPE_TEXT:
+			case XML_READER_TYPE_CDATA:
+			case XML_READER_TYPE_WHITESPACE:
+			case XML_READER_TYPE_SIGNIFICANT_WHITESPACE:
+				value = xmlTextReaderConstValue(xml_reader);
+				config_element_text(reader, (const char*)value, strlen((const char*)value));
+				break;
+			default:
+				break;
+		}
+	}
 
-				system_params_xmlptr = system_params_xmlptr->next;
-			}
+	xmlFreeTextReader(xml_reader);
+
+	if (reader->failed == FALSE && ret != 0)
+	{
+		fprintf(stderr,"Document not parsed successfully. \n");
+		return FALSE;
+	}
+
+	return (reader->failed == FALSE) ? TRUE : FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: config_element_start)
+ * An element opens - the lists that are filled element by element get
+ * their counters and shapes here.
+ *-----------------------------------------------------------------------*/
+void config_element_start(config_reader_t *reader, const char *name)
+{
+	const char *parent;
+	int name_id;
+	uint16_t name_length;
+	uint16_t name_id16;
+	char event;
+
+	if (reader->record == TRUE)
+	{
+		/* names are few so a new one is written once and then used by number */
+		for (name_id = 0; name_id < reader->num_names; name_id++)
+		{
+			if (strcmp(reader->names[name_id], name) == 0)
+				break;
 		}
-		else if ((!xmlStrcmp(top_xmlptr->name, (const xmlChar *)"environment")))
+		if (name_id == reader->num_names)
 		{
-			xmlNodePtr environment_params_xmlptr = top_xmlptr->xmlChildrenNode;
-			while (environment_params_xmlptr != NULL) 
+			if (reader->num_names == reader->alloc_names)
 			{
-				if ((!xmlStrcmp(environment_params_xmlptr->name, (const xmlChar *)"real_size_x_in_m")))
-				{
-					string_data = xmlNodeListGetString(doc, environment_params_xmlptr->xmlChildrenNode, 1);
-					environment.real_size_x_in_m = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(environment_params_xmlptr->name, (const xmlChar *)"real_size_y_in_m")))
-				{
-					string_data = xmlNodeListGetString(doc, environment_params_xmlptr->xmlChildrenNode, 1);
-					environment.real_size_y_in_m = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(environment_params_xmlptr->name, (const xmlChar *)"sim_time_computation_epoch_s")))
-				{
-					string_data = xmlNodeListGetString(doc, environment_params_xmlptr->xmlChildrenNode, 1);
-					environment.sim_time_computation_epoch_s = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(environment_params_xmlptr->name, (const xmlChar *)"sim_time_s")))
-				{
-					string_data = xmlNodeListGetString(doc, environment_params_xmlptr->xmlChildrenNode, 1);
-					environment.sim_time_s = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(environment_params_xmlptr->name, (const xmlChar *)"boundary_walls")))
-				{
-					string_data = xmlNodeListGetString(doc, environment_params_xmlptr->xmlChildrenNode, 1);
-					if (strcmp((char*)string_data, "FALSE") == 0)
-					{
-						environment.boundary_walls = FALSE;
-					}
-					else
-					{
-						environment.boundary_walls = TRUE;
-					}
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(environment_params_xmlptr->name, (const xmlChar *)"objects")))
-				{
-					xmlNodePtr objects_xmlptr = environment_params_xmlptr->xmlChildrenNode;
-					int objects_idx;
-					while (objects_xmlptr != NULL) 
-					{
-						if ((!xmlStrcmp(objects_xmlptr->name, (const xmlChar *)"num_objects")))
-						{
-							string_data = xmlNodeListGetString(doc, objects_xmlptr->xmlChildrenNode, 1);
-							environment.num_objects = atoi((char*)string_data);
-							xmlFree(string_data);
-							/* allocate the object data structures */
-							environment.objects = (objects_t**)malloc(sizeof(objects_t*)*environment.num_objects);
-							for (i = 0; i < environment.num_objects; i++)
-							{
-								environment.objects[i] = (objects_t*)malloc(sizeof(objects_t));
-							}
-
-							objects_idx = 0;
-						}
-						else if ((!xmlStrcmp(objects_xmlptr->name, (const xmlChar *)"object")))
-						{
-							read_xml_object(environment.objects[objects_idx], objects_xmlptr->xmlChildrenNode, doc);
-							objects_idx ++;
-						}
-
-						objects_xmlptr = objects_xmlptr->next;
-					}
-					oassert(objects_idx == environment.num_objects) 
-				}
-
-				environment_params_xmlptr = environment_params_xmlptr->next;
+				reader->alloc_names = (reader->alloc_names == 0) ? 64 : reader->alloc_names * 2;
+				reader->names = (const char**)realloc(reader->names, sizeof(const char*) * reader->alloc_names);
 			}
+			reader->names[reader->num_names++] = name;
+
+			event = SCENARIO_CACHE_NAME;
+			name_length = strlen(name);
+			config_record(reader, &event, 1);
+			config_record(reader, &name_length, sizeof(uint16_t));
+			config_record(reader, name, name_length + 1);
+		}
+		event = SCENARIO_CACHE_START;
+		name_id16 = name_id;
+		config_record(reader, &event, 1);
+		config_record(reader, &name_id16, sizeof(uint16_t));
+	}
+
+	if (reader->depth == 0 && strcmp(name, "centurion_config") != 0)
+	{
+		fprintf(stderr,"document of the wrong type, root node != centurion_config");
+		reader->failed = TRUE;
+		return;
+	}
+	oassert(reader->depth < CONFIG_MAX_DEPTH);
+
+	if (reader->depth > 0)
+		reader->has_children[reader->depth-1] = TRUE;
+	reader->element[reader->depth] = name;
+	reader->has_children[reader->depth] = FALSE;
+	reader->depth ++;
+	reader->num_text = 0;
+
+	parent = (reader->depth >= 2) ? reader->element[reader->depth-2] : "";
+
+	if (strcmp(name, "object") == 0)
+	{
+		if (strcmp(parent, "objects") == 0)
+		{
+			reader->object = environment.objects[reader->objects_idx];
+		}
+		else if (strcmp(parent, "agent_group") == 0)
+		{
+			agent_groups.agent_group[reader->agent_group_idx]->shape = (objects_t*)malloc(sizeof(objects_t));
+			reader->object = agent_groups.agent_group[reader->agent_group_idx]->shape;
 		}
-		else if ((!xmlStrcmp(top_xmlptr->name, (const xmlChar *)"agents")))
+		if (reader->object != NULL)
 		{
-			xmlNodePtr agent_groups_xmlptr = top_xmlptr->xmlChildrenNode;
-			int agent_group_idx = 0;
+			reader->object->circle = NULL;
+			reader->object->rectangle = NULL;
+		}
+	}
+	else if (strcmp(name, "circle") == 0 && strcmp(parent, "object") == 0 && reader->object != NULL)
+	{
+		reader->object->circle = (circle_t*)malloc(sizeof(circle_t));
+		reader->object->type = CIRCLE;
+	}
+	else if (strcmp(name, "rectangle") == 0 && strcmp(parent, "object") == 0 && reader->object != NULL)
+	{
+		reader->object->rectangle = (oriented_rectangle_t*)malloc(sizeof(oriented_rectangle_t));
+		reader->object->type = RECTANGLE;
+	}
+	else if (strcmp(name, "list") == 0)
+	{
+		reader->agent_idx = 0;
+	}
+	else if (strcmp(name, "sensors") == 0)
+	{
+		reader->sensor_idx = 0;
+	}
+	else if (strcmp(name, "actuators") == 0)
+	{
+		reader->actuator_idx = 0;
+	}
+	else if (strcmp(name, "agents") == 0)
+	{
+		reader->agent_group_idx = 0;
+	}
+	else if (strcmp(name, "objects") == 0)
+	{
+		reader->objects_idx = 0;
+	}
+}
 
-			while (agent_groups_xmlptr != NULL) 
-			{
-				if ((!xmlStrcmp(agent_groups_xmlptr->name, (const xmlChar *)"num_agent_groups")))
-				{
-					string_data = xmlNodeListGetString(doc, agent_groups_xmlptr->xmlChildrenNode, 1);
-					agent_groups.num_agent_groups = atoi((char*)string_data);
-					xmlFree(string_data);
-					/* allocate the groups */
-					agent_groups.agent_group = (agent_group_t**)malloc(sizeof(agent_group_t*)*agent_groups.num_agent_groups);
-					for (i = 0; i < agent_groups.num_agent_groups; i++)
-					{
-						agent_groups.agent_group[i] = (agent_group_t*)malloc(sizeof(agent_group_t)*agent_groups.num_agent_groups);
-					}
-					agent_group_idx = 0;
-				}
-				else if ((!xmlStrcmp(agent_groups_xmlptr->name, (const xmlChar *)"agent_group")))
-				{
-					xmlNodePtr agent_group_xmlptr = agent_groups_xmlptr->xmlChildrenNode;
-
-					while (agent_group_xmlptr != NULL) 
-					{
-						if ((!xmlStrcmp(agent_group_xmlptr->name, (const xmlChar *)"num_agents")))
-						{
-							string_data = xmlNodeListGetString(doc, agent_group_xmlptr->xmlChildrenNode, 1);
-							agent_groups.agent_group[agent_group_idx]->num_agents = atoi((char*)string_data);
-							xmlFree(string_data);
-							/* allocate the agents */
-							agent_groups.agent_group[agent_group_idx]->agents = (agent_t**)malloc(sizeof(agent_t*)*agent_groups.agent_group[agent_group_idx]->num_agents);
-
-							for (i = 0; i < agent_groups.agent_group[agent_group_idx]->num_agents; i++)
-							{
-								agent_groups.agent_group[agent_group_idx]->agents[i] = (agent_t*)malloc(sizeof(agent_t));
-								/* setup the back pointer so we can get from an individual to it's groups data */
-								agent_groups.agent_group[agent_group_idx]->agents[i]->agent_group = agent_groups.agent_group[agent_group_idx];
-								/* all agents start in state 0 */
-								agent_groups.agent_group[agent_group_idx]->agents[i]->CURRENT_STATE = 0;
-								/* allocate a circle */
-								agent_groups.agent_group[agent_group_idx]->agents[i]->circle = (circle_t*)malloc(sizeof(circle_t));
-								agent_groups.agent_group[agent_group_idx]->agents[i]->not_physical_agent = TRUE;
-							}
-						}
-						else if ((!xmlStrcmp(agent_group_xmlptr->name, (const xmlChar *)"initialization_of_agents")))
-						{
-							xmlNodePtr initialization_xmlptr = agent_group_xmlptr->xmlChildrenNode;
-							int agent_idx;
-
-							while (initialization_xmlptr != NULL)
-							{
-								if ((!xmlStrcmp(initialization_xmlptr->name, (const xmlChar *)"list")))
-								{
-									xmlNodePtr list_xmlptr = initialization_xmlptr->xmlChildrenNode;
-	
-									agent_idx = 0;
-									while (list_xmlptr != NULL)
-									{
-										if ((!xmlStrcmp(list_xmlptr->name, (const xmlChar *)"x")))
-				                                                {
-				                                                        string_data = xmlNodeListGetString(doc, list_xmlptr->xmlChildrenNode, 1);
-				                                                        agent_groups.agent_group[agent_group_idx]->agents[agent_idx]->circle->center.x = atof((char*)string_data);
-				                                                        xmlFree(string_data);
-										}
-										else if ((!xmlStrcmp(list_xmlptr->name, (const xmlChar *)"y")))
-				                                                {
-				                                                        string_data = xmlNodeListGetString(doc, list_xmlptr->xmlChildrenNode, 1);
-				                                                        agent_groups.agent_group[agent_group_idx]->agents[agent_idx]->circle->center.y = atof((char*)string_data);
-				                                                        xmlFree(string_data);
-										}
-										else if ((!xmlStrcmp(list_xmlptr->name, (const xmlChar *)"angle")))
-				                                                {
-				                                                        string_data = xmlNodeListGetString(doc, list_xmlptr->xmlChildrenNode, 1);
-				                                                        agent_groups.agent_group[agent_group_idx]->agents[agent_idx]->angle = atof((char*)string_data);
-				                                                        xmlFree(string_data);
-	
-											agent_idx ++;
-										}
-										list_xmlptr = list_xmlptr->next;
-									}
-
-									oassert (agent_idx == agent_groups.agent_group[agent_group_idx]->num_agents);
-								}
-								else if ((!xmlStrcmp(initialization_xmlptr->name, (const xmlChar *)"all_agent_function")))
-								{
-									string_data = xmlNodeListGetString(doc, initialization_xmlptr->xmlChildrenNode, 1);
-									agent_groups.agent_group[agent_group_idx]->initialization_function = (char*)string_data;
-									/* point where an initialization function would be called */
-									oassert(FALSE);
-
-									agent_idx ++;
-								}
-
-								initialization_xmlptr = initialization_xmlptr->next;
-							}
-			                        }
-						else if ((!xmlStrcmp(agent_group_xmlptr->name, (const xmlChar *)"object")))
-						{
-							agent_groups.agent_group[agent_group_idx]->shape = (objects_t*)malloc(sizeof(objects_t));	
-							read_xml_object(agent_groups.agent_group[agent_group_idx]->shape, agent_group_xmlptr->xmlChildrenNode, doc);
-
-							/* update the radius of the robot from the agent group shape - assumes agents already initialized */
-							for (i = 0; i < agent_groups.agent_group[agent_group_idx]->num_agents; i++)
-							{
-								agent_groups.agent_group[agent_group_idx]->agents[i]->circle->radius = agent_groups.agent_group[agent_group_idx]->shape->circle->radius;
-								agent_groups.agent_group[agent_group_idx]->agents[i]->not_physical_agent = FALSE;
-							}
-						}
-						else if ((!xmlStrcmp(agent_group_xmlptr->name, (const xmlChar *)"sensors")))
-						{
-							xmlNodePtr sensors_xmlptr = agent_group_xmlptr->xmlChildrenNode;
-							int sensor_idx = 0;
-							while (sensors_xmlptr != NULL)
-							{
-								if ((!xmlStrcmp(sensors_xmlptr->name, (const xmlChar *)"num_sensors")))
-		                                                {
-		                                                        string_data = xmlNodeListGetString(doc, sensors_xmlptr->xmlChildrenNode, 1);
-		                                                        agent_groups.agent_group[agent_group_idx]->num_sensors = atoi((char*)string_data);
-		                                                        xmlFree(string_data);
-									/* allocate sensors */
-		                                                        agent_groups.agent_group[agent_group_idx]->sensors = (sensor_t**)malloc(sizeof(sensor_t*)*agent_groups.agent_group[agent_group_idx]->num_sensors);
-									for (i = 0; i < agent_groups.agent_group[agent_group_idx]->num_sensors; i++)
-									{
-										agent_groups.agent_group[agent_group_idx]->sensors[i] = (sensor_t*)malloc(sizeof(sensor_t));
-										agent_groups.agent_group[agent_group_idx]->sensors[i]->sensor_idx = i;
-									}
-
-									for (i = 0; i < agent_groups.agent_group[agent_group_idx]->num_agents; i++)
-									{
-										/* allocate the sensor memory per agent */
-										agent_groups.agent_group[agent_group_idx]->agents[i]->sensor_memories = (void**)malloc(sizeof(void*)*agent_groups.agent_group[agent_group_idx]->num_sensors);
-										for (j = 0; j < agent_groups.agent_group[agent_group_idx]->num_sensors; j++)
-                                                                        	{
-											agent_groups.agent_group[agent_group_idx]->agents[i]->sensor_memories[j] = NULL;
-										}
-									}
-									sensor_idx = 0;
-
-								}
-								else if ((!xmlStrcmp(sensors_xmlptr->name, (const xmlChar *)"sensor")))
-								{
-									xmlNodePtr sensor_xmlptr = sensors_xmlptr->xmlChildrenNode;
-
-		                                                        while (sensor_xmlptr != NULL)
-		                                                        {
-		                                                                if ((!xmlStrcmp(sensor_xmlptr->name, (const xmlChar *)"type")))
-		                                                                {
-		                                                                        string_data = xmlNodeListGetString(doc, sensor_xmlptr->xmlChildrenNode, 1);
-
-											/* setup function call */
-											setup_function_for_sensor(agent_groups.agent_group[agent_group_idx]->sensors[sensor_idx], (char*)string_data);
-
-		                                                                        xmlFree(string_data);
-		                                                                }
-		                                                                else if ((!xmlStrcmp(sensor_xmlptr->name, (const xmlChar *)"direction_on_agent")))
-		                                                                {
-		                                                                        string_data = xmlNodeListGetString(doc, sensor_xmlptr->xmlChildrenNode, 1);
-		                                                                       	agent_groups.agent_group[agent_group_idx]->sensors[sensor_idx]->angle = atof((char*)string_data);
-		                                                                        xmlFree(string_data);
-										}
-										else if ((!xmlStrcmp(sensor_xmlptr->name, (const xmlChar *)"sim_time_computation_epoch_s")))
-		                                                                {
-		                                                                        string_data = xmlNodeListGetString(doc, sensor_xmlptr->xmlChildrenNode, 1);
-		                                                                       	agent_groups.agent_group[agent_group_idx]->sensors[sensor_idx]->sim_time_computation_epoch_s = atof((char*)string_data);
-		                                                                        xmlFree(string_data);
-											sensor_idx ++;
-										}
-		
-		                                                                sensor_xmlptr = sensor_xmlptr->next;
-		                                                        }
-								}
-							
-								sensors_xmlptr = sensors_xmlptr->next;
-							}
-							oassert(sensor_idx == agent_groups.agent_group[agent_group_idx]->num_sensors);
-			                        }
-						else if ((!xmlStrcmp(agent_group_xmlptr->name, (const xmlChar *)"actuators")))
-						{
-							xmlNodePtr actuators_xmlptr = agent_group_xmlptr->xmlChildrenNode;
-							int actuator_idx = 0;
-							while (actuators_xmlptr != NULL)
-							{
-								if ((!xmlStrcmp(actuators_xmlptr->name, (const xmlChar *)"num_actuators")))
-		                                                {
-		                                                        string_data = xmlNodeListGetString(doc, actuators_xmlptr->xmlChildrenNode, 1);
-		                                                        agent_groups.agent_group[agent_group_idx]->num_actuators = atoi((char*)string_data);
-		                                                        xmlFree(string_data);
-									/* allocate actuators */
-		                                                        agent_groups.agent_group[agent_group_idx]->actuators = (actuator_t**)malloc(sizeof(actuator_t*)*agent_groups.agent_group[agent_group_idx]->num_actuators);
-									for (i = 0; i < agent_groups.agent_group[agent_group_idx]->num_actuators; i++)
-									{
-										agent_groups.agent_group[agent_group_idx]->actuators[i] = (actuator_t*)malloc(sizeof(actuator_t));
-										agent_groups.agent_group[agent_group_idx]->actuators[i]->actuator_idx = i;
-									}
-
-									for (i = 0; i < agent_groups.agent_group[agent_group_idx]->num_agents; i++)
-									{
-										/* allocate the actuator memory per agent */
-										agent_groups.agent_group[agent_group_idx]->agents[i]->actuator_memories = (void**)malloc(sizeof(void*)*agent_groups.agent_group[agent_group_idx]->num_actuators);
-										for (j = 0; j < agent_groups.agent_group[agent_group_idx]->num_actuators; j++)
-                                                                        	{
-											agent_groups.agent_group[agent_group_idx]->agents[i]->actuator_memories[j] = NULL;
-										}
-									}
-									actuator_idx = 0;
-								}
-								else if ((!xmlStrcmp(actuators_xmlptr->name, (const xmlChar *)"actuator")))
-								{
-									xmlNodePtr actuator_xmlptr = actuators_xmlptr->xmlChildrenNode;
-
-		                                                        while (actuator_xmlptr != NULL)
-		                                                        {
-		                                                                if ((!xmlStrcmp(actuator_xmlptr->name, (const xmlChar *)"type")))
-		                                                                {
-		                                                                        string_data = xmlNodeListGetString(doc, actuator_xmlptr->xmlChildrenNode, 1);
-											/* setup actuator function */
-											setup_function_for_actuator(agent_groups.agent_group[agent_group_idx]->actuators[actuator_idx], (char*)string_data);
-
-											actuator_idx++;
-		                                                                }
-		
-		                                                                actuator_xmlptr = actuator_xmlptr->next;
-		                                                        }
-								}
-								actuators_xmlptr = actuators_xmlptr->next;
-							}
-							oassert(actuator_idx == agent_groups.agent_group[agent_group_idx]->num_actuators);
-			                        }
-						else if ((!xmlStrcmp(agent_group_xmlptr->name, (const xmlChar *)"control")))
-						{
-							xmlNodePtr control_xmlptr = agent_group_xmlptr->xmlChildrenNode;
-
-							while (control_xmlptr != NULL)
-							{
-								if ((!xmlStrcmp(control_xmlptr->name, (const xmlChar *)"control_algorithm")))
-		                                                {
-		                                                        string_data = xmlNodeListGetString(doc, control_xmlptr->xmlChildrenNode, 1);
-									/* hookup the control function */
-									setup_function_for_control(agent_groups.agent_group[agent_group_idx], (char*)string_data);
-									xmlFree(string_data);
-								}
-								control_xmlptr = control_xmlptr->next;
-							}
-							/* NOTE assumes control is last item and always there */
-							agent_group_idx ++;
-			                        }
-
-						agent_group_xmlptr = agent_group_xmlptr->next;
-					}
-				}
+/*-------------------------------------------------------------------------
+ * (function: config_element_text)
+ * Text can come in pieces so it is gathered until the element closes.
+ *-----------------------------------------------------------------------*/
+void config_element_text(config_reader_t *reader, const char *text, int length)
+{
+	if (reader->num_text + length + 1 > reader->alloc_text)
+	{
+		reader->alloc_text = (reader->num_text + length + 1) * 2;
+		reader->text = (char*)realloc(reader->text, reader->alloc_text);
+	}
+	memcpy(reader->text + reader->num_text, text, length);
+	reader->num_text += length;
+	reader->text[reader->num_text] = '\0';
+}
 
-				agent_groups_xmlptr = agent_groups_xmlptr->next;
-			}
-			oassert(agent_group_idx == agent_groups.num_agent_groups)
+/*-------------------------------------------------------------------------
+ * (function: config_element_end)
+ * An element closes.  text is what was inside it when it has no child
+ * elements and NULL when it does.  The parent is enough to tell the
+ * sections apart (an x in a list is an agent, an x in a circle is a shape).
+ *-----------------------------------------------------------------------*/
+void config_element_end(config_reader_t *reader, const char *text)
+{
+	const char *name;
+	const char *parent;
+	agent_group_t *agent_group;
+	uint32_t text_length;
+	char event;
+	int i;
+
+	if (reader->record == TRUE)
+	{
+		event = SCENARIO_CACHE_END;
+		text_length = (text == NULL) ? SCENARIO_CACHE_NO_TEXT : strlen(text);
+		config_record(reader, &event, 1);
+		config_record(reader, &text_length, sizeof(uint32_t));
+		if (text != NULL)
+			config_record(reader, text, text_length + 1);
+	}
+
+	reader->depth --;
+	oassert(reader->depth >= 0);
+	name = reader->element[reader->depth];
+	parent = (reader->depth >= 1) ? reader->element[reader->depth-1] : "";
+	agent_group = (agent_groups.agent_group != NULL && reader->agent_group_idx < agent_groups.num_agent_groups) ? agent_groups.agent_group[reader->agent_group_idx] : NULL;
+
+	/* the agent list is most of a big config so it is looked at first */
+	if (strcmp(parent, "list") == 0 && text != NULL)
+	{
+		if (strcmp(name, "x") == 0)
+		{
+			agent_store.x[agent_group->agents[reader->agent_idx]->agent_idx] = atof(text);
 		}
-		else if ((!xmlStrcmp(top_xmlptr->name, (const xmlChar *)"atons")))
+		else if (strcmp(name, "y") == 0)
 		{
-			xmlNodePtr aton_xmlptr = top_xmlptr->xmlChildrenNode;
-			while (aton_xmlptr != NULL) 
-			{
-				aton_xmlptr = aton_xmlptr->next;
-			}
+			agent_store.y[agent_group->agents[reader->agent_idx]->agent_idx] = atof(text);
+		}
+		else if (strcmp(name, "angle") == 0)
+		{
+			agent_store.angle[agent_group->agents[reader->agent_idx]->agent_idx] = atof(text);
+			reader->agent_idx ++;
+		}
+	}
+	else if ((strcmp(parent, "circle") == 0 || strcmp(parent, "rectangle") == 0) && text != NULL)
+	{
+		if (reader->object != NULL)
+			config_shape_value(reader->object, parent, name, text);
+	}
+	else if (strcmp(parent, "system") == 0 && text != NULL)
+	{
+		config_system_value(name, text);
+	}
+	else if (strcmp(parent, "environment") == 0 && text != NULL)
+	{
+		config_environment_value(name, text);
+	}
+	else if (strcmp(name, "rectangle") == 0 && reader->object != NULL && reader->object->rectangle != NULL)
+	{
+		/* the rectangles do not move so their corners are worked out once */
+		oriented_rectangle_update(reader->object->rectangle);
+	}
+	else if (strcmp(name, "object") == 0 && strcmp(parent, "objects") == 0)
+	{
+		reader->objects_idx ++;
+		reader->object = NULL;
+	}
+	else if (strcmp(name, "object") == 0 && strcmp(parent, "agent_group") == 0)
+	{
+		/* update the radius of the robot from the agent group shape - assumes agents already initialized */
+		for (i = 0; i < agent_group->num_agents; i++)
+		{
+			agent_store.radius[agent_group->agents[i]->agent_idx] = agent_group->shape->circle->radius;
+			agent_store.not_physical[agent_group->agents[i]->agent_idx] = FALSE;
+		}
+		reader->object = NULL;
+	}
+	else if (strcmp(parent, "objects") == 0 && strcmp(name, "num_objects") == 0 && text != NULL)
+	{
+		environment.num_objects = atoi(text);
+		/* allocate the object data structures */
+		environment.objects = (objects_t**)malloc(sizeof(objects_t*)*environment.num_objects);
+		for (i = 0; i < environment.num_objects; i++)
+		{
+			environment.objects[i] = (objects_t*)malloc(sizeof(objects_t));
+		}
+		reader->objects_idx = 0;
+	}
+	else if (strcmp(name, "objects") == 0)
+	{
+		oassert(reader->objects_idx == environment.num_objects) 
+	}
+	else if (strcmp(parent, "agents") == 0 && strcmp(name, "num_agent_groups") == 0 && text != NULL)
+	{
+		agent_groups.num_agent_groups = atoi(text);
+		/* allocate the groups */
+		agent_groups.agent_group = (agent_group_t**)malloc(sizeof(agent_group_t*)*agent_groups.num_agent_groups);
+		for (i = 0; i < agent_groups.num_agent_groups; i++)
+		{
+			agent_groups.agent_group[i] = (agent_group_t*)malloc(sizeof(agent_group_t)*agent_groups.num_agent_groups);
+			/* a group like the OVERLORD has no sensors or actuators */
+			agent_groups.agent_group[i]->num_sensors = 0;
+			agent_groups.agent_group[i]->sensors = NULL;
+			agent_groups.agent_group[i]->num_actuators = 0;
+			agent_groups.agent_group[i]->actuators = NULL;
+		}
+		reader->agent_group_idx = 0;
+	}
+	else if (strcmp(name, "agents") == 0)
+	{
+		oassert(reader->agent_group_idx == agent_groups.num_agent_groups)
+	}
+	else if (strcmp(name, "list") == 0)
+	{
+		oassert (reader->agent_idx == agent_group->num_agents);
+	}
+	else if (strcmp(name, "sensors") == 0 && strcmp(parent, "agent_group") == 0)
+	{
+		oassert(reader->sensor_idx == agent_group->num_sensors);
+	}
+	else if (strcmp(name, "actuators") == 0 && strcmp(parent, "agent_group") == 0)
+	{
+		oassert(reader->actuator_idx == agent_group->num_actuators);
+	}
+	else if (strcmp(name, "control") == 0 && strcmp(parent, "agent_group") == 0)
+	{
+		/* NOTE assumes control is last item and always there */
+		reader->agent_group_idx ++;
+	}
+	else if (text != NULL && agent_group != NULL)
+	{
+		config_agent_group_value(reader, agent_group, parent, name, text);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: config_system_value)
+ *-----------------------------------------------------------------------*/
+void config_system_value(const char *name, const char *text)
+{
+	if (strcmp(name, "rand_seed") == 0)
+	{
+		sim_system.rand_seed = atoi(text);
+	}
+	else if (strcmp(name, "simulation_type") == 0)
+	{
+		sim_system.simulation_type = strdup(text);
+	}
+	else if (strcmp(name, "debug_file_out") == 0)
+	{
+		sim_system.debug_file_out = strdup(text);
+	}
+	else if (strcmp(name, "sim_log_file_out") == 0)
+	{
+		sim_system.sim_log_file_out = strdup(text);
+	}
+	else if (strcmp(name, "sim_log_format") == 0)
+	{
+		if (strcmp(text, "xml") == 0)
+			sim_system.sim_log_format = LOG_XML;
+		else if (strcmp(text, "binary") == 0)
+			sim_system.sim_log_format = LOG_BINARY;
+		else if (strcmp(text, "binary32") == 0)
+			sim_system.sim_log_format = LOG_BINARY32;
+		else
+		{
+			printf("Unsupported sim_log_format %s\n", text);
+			oassert(FALSE);
+		}
+	}
+	else if (strcmp(name, "sim_log_writer") == 0)
+	{
+		if (strcmp(text, "stdio") == 0)
+			sim_system.sim_log_writer = LOG_WRITER_STDIO;
+		else if (strcmp(text, "async") == 0)
+			sim_system.sim_log_writer = LOG_WRITER_ASYNC;
+		else
+		{
+			printf("Unsupported sim_log_writer %s\n", text);
+			oassert(FALSE);
+		}
+	}
+	else if (strcmp(name, "sim_log_every_epochs") == 0)
+	{
+		sim_system.sim_log_every_epochs = atoi(text);
+	}
+	else if (strcmp(name, "sim_log_beam_every_epochs") == 0)
+	{
+		sim_system.sim_log_beam_every_epochs = atoi(text);
+	}
+	else if (strcmp(name, "sim_log_changes_only") == 0)
+	{
+		if (strcmp(text, "FALSE") == 0)
+			sim_system.sim_log_changes_only = FALSE;
+		else
+			sim_system.sim_log_changes_only = TRUE;
+	}
+	else if (strcmp(name, "sim_log_move_threshold_in_m") == 0)
+	{
+		sim_system.sim_log_move_threshold_in_m = atof(text);
+	}
+	else if (strcmp(name, "sim_log_turn_threshold_in_degrees") == 0)
+	{
+		sim_system.sim_log_turn_threshold_in_degrees = atof(text);
+	}
+	else if (strcmp(name, "checkpoint_every_s") == 0)
+	{
+		sim_system.checkpoint_every_s = atof(text);
+	}
+	else if (strcmp(name, "checkpoint_file_out") == 0)
+	{
+		sim_system.checkpoint_file_out = strdup(text);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: config_environment_value)
+ *-----------------------------------------------------------------------*/
+void config_environment_value(const char *name, const char *text)
+{
+	if (strcmp(name, "real_size_x_in_m") == 0)
+	{
+		environment.real_size_x_in_m = atof(text);
+	}
+	else if (strcmp(name, "real_size_y_in_m") == 0)
+	{
+		environment.real_size_y_in_m = atof(text);
+	}
+	else if (strcmp(name, "sim_time_computation_epoch_s") == 0)
+	{
+		environment.sim_time_computation_epoch_s = atof(text);
+	}
+	else if (strcmp(name, "sim_grid_size_in_m") == 0)
+	{
+		environment.sim_grid_size_in_m = atof(text);
+	}
+	else if (strcmp(name, "agent_index") == 0)
+	{
+		if (strcmp(text, "GRID") == 0)
+		{
+			environment.agent_index = AGENT_INDEX_GRID;
+		}
+		else if (strcmp(text, "LOOSE_QUADTREE") == 0)
+		{
+			environment.agent_index = AGENT_INDEX_LOOSE_QUADTREE;
+		}
+		else
+		{
+			printf("Unsupported agent_index %s\n", text);
+			oassert(FALSE);
+		}
+	}
+	else if (strcmp(name, "sim_time_s") == 0)
+	{
+		environment.sim_time_s = atof(text);
+	}
+	else if (strcmp(name, "boundary_walls") == 0)
+	{
+		if (strcmp(text, "FALSE") == 0)
+		{
+			environment.boundary_walls = FALSE;
+		}
+		else
+		{
+			environment.boundary_walls = TRUE;
+		}
+	}
+	else if (strcmp(name, "check_collisions") == 0)
+	{
+		if (strcmp(text, "FALSE") == 0)
+		{
+			environment.check_collisions = FALSE;
+		}
+		else
+		{
+			environment.check_collisions = TRUE;
+		}
+	}
+	else if (strcmp(name, "stop_on_collision") == 0)
+	{
+		if (strcmp(text, "FALSE") == 0)
+		{
+			environment.stop_on_collision = FALSE;
 		}
+		else
+		{
+			environment.stop_on_collision = TRUE;
+		}
+	}
+}
 
-		top_xmlptr = top_xmlptr->next;
+/*-------------------------------------------------------------------------
+ * (function: config_shape_value)
+ * A value of a circle or rectangle of an environment object or of the
+ * shape of an agent group.
+ *-----------------------------------------------------------------------*/
+void config_shape_value(objects_t *object, const char *shape, const char *name, const char *text)
+{
+	if (strcmp(shape, "circle") == 0)
+	{
+		if (strcmp(name, "x") == 0)
+		{
+			object->circle->center.x = atof(text);
+		}
+		else if (strcmp(name, "y") == 0)
+		{
+			object->circle->center.y = atof(text);
+		}
+		else if (strcmp(name, "radius") == 0)
+		{
+			object->circle->radius = atof(text);
+		}
+	}
+	else
+	{
+		if (strcmp(name, "center_x") == 0)
+		{
+			object->rectangle->center.x = atof(text);
+		}
+		else if (strcmp(name, "center_y") == 0)
+		{
+			object->rectangle->center.y = atof(text);
+		}
+		else if (strcmp(name, "halfExtend_x") == 0)
+		{
+			object->rectangle->halfExtend.x = atof(text);
+		}
+		else if (strcmp(name, "halfExtend_y") == 0)
+		{
+			object->rectangle->halfExtend.y = atof(text);
+		}
+		else if (strcmp(name, "rotation") == 0)
+		{
+			object->rectangle->rotation = atof(text);
+		}
 	}
-	
-	xmlFreeDoc(doc);
-	return;
 }
 
 /*-------------------------------------------------------------------------
- * (function: read_xml_object)
+ * (function: config_agent_group_value)
+ * The values inside an agent_group - the group itself, its sensors,
+ * actuators, initialization and control.
  *-----------------------------------------------------------------------*/
-void read_xml_object(objects_t *object, xmlNodePtr shape_xmlptr, xmlDocPtr doc)
+void config_agent_group_value(config_reader_t *reader, agent_group_t *agent_group, const char *parent, const char *name, const char *text)
 {
-	xmlChar *string_data;
+	agent_t *agents;
+	int i, j;
 
-	object->circle = NULL;
-	object->rectangle = NULL;
+	if (strcmp(parent, "agent_group") == 0 && strcmp(name, "num_agents") == 0)
+	{
+		agent_group->num_agents = atoi(text);
+		/* allocate the agents - one block per group so the group's agents sit together */
+		agent_group->agents = (agent_t**)malloc(sizeof(agent_t*)*agent_group->num_agents);
+		agents = (agent_t*)malloc(sizeof(agent_t)*agent_group->num_agents);
+		agent_store_reserve(&agent_store, agent_store.num_agents + agent_group->num_agents);
 
-	while (shape_xmlptr != NULL)
+		for (i = 0; i < agent_group->num_agents; i++)
+		{
+			agent_group->agents[i] = &agents[i];
+			/* setup the back pointer so we can get from an individual to it's groups data */
+			agent_group->agents[i]->agent_group = agent_group;
+			agent_group->agents[i]->wake_time = 0;
+			agent_group->agents[i]->moving_until_time = 0;
+			agent_group->agents[i]->beam_hit_logs = NULL;
+			agent_group->agents[i]->num_beam_hit_logs = 0;
+			agent_group->agents[i]->alloc_beam_hit_logs = 0;
+			agent_group->agents[i]->contacts = NULL;
+			agent_group->agents[i]->num_contacts = 0;
+			agent_group->agents[i]->alloc_contacts = 0;
+			agent_group->agents[i]->last_contacts = NULL;
+			agent_group->agents[i]->num_last_contacts = 0;
+			agent_group->agents[i]->alloc_last_contacts = 0;
+			/* memories are made by the control, sensors and actuators the first time they run */
+			agent_group->agents[i]->general_memory = NULL;
+			agent_group->agents[i]->sensor_memories = NULL;
+			agent_group->agents[i]->actuator_memories = NULL;
+			agent_group->agents[i]->time_in_state = 0;
+			agent_group->agents[i]->last_time = 0;
+			/* pose and state live in the store - all agents start in state 0 */
+			agent_store_add(&agent_store, agent_group->agents[i], reader->agent_group_idx);
+		}
+	}
+	else if (strcmp(parent, "initialization_of_agents") == 0 && strcmp(name, "all_agent_function") == 0)
+	{
+		agent_group->initialization_function = strdup(text);
+		/* point where an initialization function would be called */
+		oassert(FALSE);
+	}
+	else if (strcmp(parent, "sensors") == 0 && strcmp(name, "num_sensors") == 0)
 	{
-		if ((!xmlStrcmp(shape_xmlptr->name, (const xmlChar *)"circle")))
+		agent_group->num_sensors = atoi(text);
+		/* allocate sensors */
+		agent_group->sensors = (sensor_t**)malloc(sizeof(sensor_t*)*agent_group->num_sensors);
+		for (i = 0; i < agent_group->num_sensors; i++)
 		{
-			xmlNodePtr shape_details_xmlptr = shape_xmlptr->xmlChildrenNode;
-	               	object->circle = (circle_t*)malloc(sizeof(circle_t));
-			object->type = CIRCLE;
-	
-			while (shape_details_xmlptr != NULL)
+			agent_group->sensors[i] = (sensor_t*)malloc(sizeof(sensor_t));
+			agent_group->sensors[i]->sensor_idx = i;
+			/* a full turn of 1 degree beams out to 50cm unless the LIDAR says otherwise */
+			agent_group->sensors[i]->num_beams = 360;
+			agent_group->sensors[i]->field_of_view = 2*M_PI;
+			agent_group->sensors[i]->range_in_m = 0.5;
+		}
+
+		for (i = 0; i < agent_group->num_agents; i++)
+		{
+			/* allocate the sensor memory per agent */
+			agent_group->agents[i]->sensor_memories = (void**)malloc(sizeof(void*)*agent_group->num_sensors);
+			for (j = 0; j < agent_group->num_sensors; j++)
 			{
-				if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"x")))
-	                       	{
-	                       		string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-	               			object->circle->center.x = atof((char*)string_data);
-	                               	xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"y")))
-				{
-					string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-	               			object->circle->center.y = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"radius")))
-				{
-					string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-	               			object->circle->radius = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				shape_details_xmlptr = shape_details_xmlptr->next;
+				agent_group->agents[i]->sensor_memories[j] = NULL;
 			}
 		}
-		else if ((!xmlStrcmp(shape_xmlptr->name, (const xmlChar *)"rectangle")))
+		reader->sensor_idx = 0;
+	}
+	else if (strcmp(parent, "sensor") == 0)
+	{
+		if (strcmp(name, "type") == 0)
+		{
+			/* setup function call */
+			setup_function_for_sensor(agent_group->sensors[reader->sensor_idx], (char*)text);
+		}
+		else if (strcmp(name, "direction_on_agent") == 0)
+		{
+			agent_group->sensors[reader->sensor_idx]->angle = atof(text);
+		}
+		else if (strcmp(name, "num_beams") == 0)
+		{
+			agent_group->sensors[reader->sensor_idx]->num_beams = atoi(text);
+			oassert(agent_group->sensors[reader->sensor_idx]->num_beams > 0);
+		}
+		else if (strcmp(name, "field_of_view_degrees") == 0)
+		{
+			agent_group->sensors[reader->sensor_idx]->field_of_view = degrees_to_radian(atof(text));
+		}
+		else if (strcmp(name, "range_in_m") == 0)
 		{
-			xmlNodePtr shape_details_xmlptr = shape_xmlptr->xmlChildrenNode;
-	               	object->rectangle = (oriented_rectangle_t*)malloc(sizeof(oriented_rectangle_t));
-			object->type = RECTANGLE;
-	
-			while (shape_details_xmlptr != NULL)
+			agent_group->sensors[reader->sensor_idx]->range_in_m = atof(text);
+		}
+		else if (strcmp(name, "sim_time_computation_epoch_s") == 0)
+		{
+			agent_group->sensors[reader->sensor_idx]->sim_time_computation_epoch_s = atof(text);
+			reader->sensor_idx ++;
+		}
+	}
+	else if (strcmp(parent, "actuators") == 0 && strcmp(name, "num_actuators") == 0)
+	{
+		agent_group->num_actuators = atoi(text);
+		/* allocate actuators */
+		agent_group->actuators = (actuator_t**)malloc(sizeof(actuator_t*)*agent_group->num_actuators);
+		for (i = 0; i < agent_group->num_actuators; i++)
+		{
+			agent_group->actuators[i] = (actuator_t*)malloc(sizeof(actuator_t));
+			agent_group->actuators[i]->actuator_idx = i;
+		}
+
+		for (i = 0; i < agent_group->num_agents; i++)
+		{
+			/* allocate the actuator memory per agent */
+			agent_group->agents[i]->actuator_memories = (void**)malloc(sizeof(void*)*agent_group->num_actuators);
+			for (j = 0; j < agent_group->num_actuators; j++)
 			{
-				if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"center_x")))
-				{
-					string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-					object->rectangle->center.x = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"center_y")))
-				{
-					string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-					object->rectangle->center.y = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"halfExtend_x")))
-				{
-					string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-					object->rectangle->halfExtend.x = atof((char*)string_data);
-					xmlFree(string_data);
-				}
-				else if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"halfExtend_y")))
+				agent_group->agents[i]->actuator_memories[j] = NULL;
+			}
+		}
+		reader->actuator_idx = 0;
+	}
+	else if (strcmp(parent, "actuator") == 0 && strcmp(name, "type") == 0)
+	{
+		/* setup actuator function */
+		setup_function_for_actuator(agent_group->actuators[reader->actuator_idx], (char*)text);
+		reader->actuator_idx ++;
+	}
+	else if (strcmp(parent, "control") == 0 && strcmp(name, "control_algorithm") == 0)
+	{
+		/* hookup the control function */
+		setup_function_for_control(agent_group, (char*)text);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: config_record)
+ * Appends to the events that go in the scenario cache.
+ *-----------------------------------------------------------------------*/
+void config_record(config_reader_t *reader, const void *data, size_t size)
+{
+	if (reader->num_events + size > reader->alloc_events)
+	{
+		reader->alloc_events = (reader->num_events + size) * 2;
+		reader->events = (char*)realloc(reader->events, reader->alloc_events);
+	}
+	memcpy(reader->events + reader->num_events, data, size);
+	reader->num_events += size;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: scenario_cache_write)
+ * Writes the recorded events next to a header that says which config they
+ * came from.  The file is written aside and renamed so a run reading the
+ * cache never sees half of one.
+ *-----------------------------------------------------------------------*/
+void scenario_cache_write(config_reader_t *reader, const char *cache_file_name, uint64_t config_hash, uint64_t config_size)
+{
+	scenario_cache_header_t header;
+	char temp_file_name[4096+32];
+	FILE *fout;
+	short written;
+
+	memset(&header, 0, sizeof(scenario_cache_header_t));
+	memcpy(header.magic, SCENARIO_CACHE_MAGIC, 8);
+	header.version = SCENARIO_CACHE_VERSION;
+	header.num_names = reader->num_names;
+	header.config_hash = config_hash;
+	header.config_size = config_size;
+	header.events_size = reader->num_events;
+
+	snprintf(temp_file_name, sizeof(temp_file_name), "%s.%d", cache_file_name, (int)getpid());
+	fout = fopen(temp_file_name, "wb");
+	if (fout == NULL)
+	{
+		printf("Could not write scenario cache %s\n", cache_file_name);
+		return;
+	}
+
+	written = (fwrite(&header, sizeof(scenario_cache_header_t), 1, fout) == 1);
+	written = written && (fwrite(reader->events, 1, reader->num_events, fout) == reader->num_events);
+	written = (fclose(fout) == 0) && written;
+
+	if (written && rename(temp_file_name, cache_file_name) == 0)
+	{
+		printf("Scenario cached in %s\n", cache_file_name);
+	}
+	else
+	{
+		printf("Could not write scenario cache %s\n", cache_file_name);
+		remove(temp_file_name);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: scenario_cache_replay)
+ * Maps a scenario cache and plays its events through the element handlers.
+ * The text of each element is stored with its terminator so the handlers
+ * read it straight out of the mapping.
+ *
+ * returns FALSE if there is no cache for this config (nothing is read then)
+ *-----------------------------------------------------------------------*/
+short scenario_cache_replay(config_reader_t *reader, const char *cache_file_name, uint64_t config_hash, uint64_t config_size)
+{
+	scenario_cache_header_t header;
+	struct stat cache_stat;
+	const char *cache_data;
+	const char *event;
+	const char *end;
+	const char **names;
+	int num_names = 0;
+	uint16_t name_length;
+	uint16_t name_id;
+	uint32_t text_length;
+	int fd;
+
+	fd = open(cache_file_name, O_RDONLY);
+	if (fd < 0)
+		return FALSE;
+	if (fstat(fd, &cache_stat) != 0 || (size_t)cache_stat.st_size < sizeof(scenario_cache_header_t))
+	{
+		close(fd);
+		return FALSE;
+	}
+	cache_data = (const char*)mmap(NULL, cache_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (cache_data == MAP_FAILED)
+		return FALSE;
+
+	memcpy(&header, cache_data, sizeof(scenario_cache_header_t));
+	if (memcmp(header.magic, SCENARIO_CACHE_MAGIC, 8) != 0 
+		|| header.version != SCENARIO_CACHE_VERSION
+		|| header.config_hash != config_hash
+		|| header.config_size != config_size
+		|| header.events_size != cache_stat.st_size - sizeof(scenario_cache_header_t))
+	{
+		munmap((void*)cache_data, cache_stat.st_size);
+		return FALSE;
+	}
+
+	names = (const char**)malloc(sizeof(const char*) * (header.num_names + 1));
+
+	event = cache_data + sizeof(scenario_cache_header_t);
+	end = event + header.events_size;
+	while (event < end && reader->failed == FALSE)
+	{
+		switch (*event++)
+		{
+			case SCENARIO_CACHE_NAME:
+				memcpy(&name_length, event, sizeof(uint16_t));
+				event += sizeof(uint16_t);
+				oassert(num_names < (int)header.num_names);
+				names[num_names++] = event;
+				event += name_length + 1;
+				break;
+			case SCENARIO_CACHE_START:
+				memcpy(&name_id, event, sizeof(uint16_t));
+				event += sizeof(uint16_t);
+				oassert(name_id < num_names);
+				config_element_start(reader, names[name_id]);
+				break;
+			case SCENARIO_CACHE_END:
+				memcpy(&text_length, event, sizeof(uint32_t));
+				event += sizeof(uint32_t);
+				if (text_length == SCENARIO_CACHE_NO_TEXT)
 				{
-					string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-					object->rectangle->halfExtend.y = atof((char*)string_data);
-					xmlFree(string_data);
+					config_element_end(reader, NULL);
 				}
-				else if ((!xmlStrcmp(shape_details_xmlptr->name, (const xmlChar *)"rotation")))
+				else
 				{
-					string_data = xmlNodeListGetString(doc, shape_details_xmlptr->xmlChildrenNode, 1);
-					object->rectangle->rotation = atof((char*)string_data);
-					xmlFree(string_data);
+					config_element_end(reader, event);
+					event += text_length + 1;
 				}
-				shape_details_xmlptr = shape_details_xmlptr->next;
-			}
+				break;
+			default:
+				/* the header matched so this is a damaged file */
+				oassert(FALSE);
+				break;
 		}
+	}
+
+	free(names);
+	munmap((void*)cache_data, cache_stat.st_size);
+
+	return TRUE;
+}
 
-		shape_xmlptr = shape_xmlptr->next;
+/*-------------------------------------------------------------------------
+ * (function: config_hash)
+ * 64 bit FNV-1a of the config bytes - the key of the scenario cache.
+ *-----------------------------------------------------------------------*/
+uint64_t config_hash(const char *data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	size_t i;
+
+	for (i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
 	}
+
+	return hash;
 }
 
 /*-------------------------------------------------------------------------
@@ -30,6 +30,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "types.h"
 
 extern void read_config_file(char *file_name);
+extern void read_config_file_with_cache(char *file_name, char *cache_dir);
+extern short read_config_override(char *name, char *value);
 extern void free_configuration(char *config_file_name);
 
 #endif
@@ -0,0 +1,256 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "rng.h"
+
+/* 
+ * Noise of the sensors and actuators.  Philox4x32-10 (Salmon et al.,
+ * "Parallel random numbers: as easy as 1, 2, 3", SC 2011) turns a 128 bit
+ * counter and 64 bit key into 128 random bits with no state in between.
+ * The key is (seed, agent) and the counter is (block, device, epoch), so
+ * what an agent's device draws in an epoch does not depend on which
+ * thread runs it, what order the agents run in or what anyone else drew.
+ * Normals come from a ziggurat on the Philox words.
+ */
+
+/* globals */
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+/* ziggurat of Marsaglia and Tsang, "The Ziggurat Method for Generating
+ * Random Variables", J. Stat. Software 2000 - 128 layers */
+#define ZIGGURAT_LAYERS 128
+#define ZIGGURAT_R 3.442619855899
+#define ZIGGURAT_V 9.91256303526217e-3
+
+unsigned int ziggurat_k[ZIGGURAT_LAYERS]; // |word| under this is inside the layer's rectangle
+double ziggurat_w[ZIGGURAT_LAYERS]; // word to x
+double ziggurat_f[ZIGGURAT_LAYERS]; // exp(-x^2/2) at the layer edge
+short ziggurat_built = FALSE;
+
+void philox4x32(unsigned int counter[4], unsigned int key[2], unsigned int out[4]);
+double ziggurat_outside(rng_stream_t *stream, int word, int layer);
+
+/*-------------------------------------------------------------------------
+ * (function: rng_setup)
+ * Builds the ziggurat - called from setup_simulation before any thread
+ * draws.
+ *-----------------------------------------------------------------------*/
+void rng_setup()
+{
+	int i;
+	double m1 = 2147483648.0;
+	double dn = ZIGGURAT_R;
+	double tn = dn;
+	double q = ZIGGURAT_V / exp(-0.5 * dn * dn);
+
+	if (ziggurat_built == TRUE)
+		return;
+
+	ziggurat_k[0] = (unsigned int)((dn / q) * m1);
+	ziggurat_k[1] = 0;
+	ziggurat_w[0] = q / m1;
+	ziggurat_w[ZIGGURAT_LAYERS-1] = dn / m1;
+	ziggurat_f[0] = 1.0;
+	ziggurat_f[ZIGGURAT_LAYERS-1] = exp(-0.5 * dn * dn);
+
+	for (i = ZIGGURAT_LAYERS-2; i >= 1; i--)
+	{
+		dn = sqrt(-2.0 * log(ZIGGURAT_V / dn + exp(-0.5 * dn * dn)));
+		ziggurat_k[i+1] = (unsigned int)((dn / tn) * m1);
+		tn = dn;
+		ziggurat_f[i] = exp(-0.5 * dn * dn);
+		ziggurat_w[i] = dn / m1;
+	}
+
+	ziggurat_built = TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: rng_stream_start)
+ *-----------------------------------------------------------------------*/
+void rng_stream_start(rng_stream_t *stream, unsigned int seed, int agent_idx, int device_id, long long epoch)
+{
+	stream->key[0] = seed;
+	stream->key[1] = (unsigned int)agent_idx;
+	stream->counter[0] = 0; // block within the stream
+	stream->counter[1] = (unsigned int)device_id;
+	stream->counter[2] = (unsigned int)((unsigned long long)epoch & 0xFFFFFFFFu);
+	stream->counter[3] = (unsigned int)((unsigned long long)epoch >> 32);
+	stream->num_used = 4;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: agent_noise_stream)
+ * The stream of one device of an agent at the epoch of current_time.
+ *-----------------------------------------------------------------------*/
+void agent_noise_stream(rng_stream_t *stream, agent_t *agent, int device_id, double current_time)
+{
+	rng_stream_start(stream, agent_store.rand_seed, agent->agent_idx, device_id, llround(current_time / environment.sim_time_computation_epoch_s));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: rng_uint32)
+ *-----------------------------------------------------------------------*/
+unsigned int rng_uint32(rng_stream_t *stream)
+{
+	if (stream->num_used == 4)
+	{
+		philox4x32(stream->counter, stream->key, stream->block);
+		stream->counter[0] ++;
+		stream->num_used = 0;
+	}
+
+	return stream->block[stream->num_used++];
+}
+
+/*-------------------------------------------------------------------------
+ * (function: rng_uniform)
+ * 53 bits in (0, 1) - never 0 so it can go in a log.
+ *-----------------------------------------------------------------------*/
+double rng_uniform(rng_stream_t *stream)
+{
+	unsigned int high = rng_uint32(stream) >> 5;
+	unsigned int low = rng_uint32(stream) >> 6;
+
+	return ((double)high * 67108864.0 + (double)low + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: rng_gaussian)
+ * Standard normal by the ziggurat.  One 32 bit word picks the layer and
+ * the value, and 98.8% of the time that is all - a table lookup, compare
+ * and multiply.
+ *-----------------------------------------------------------------------*/
+double rng_gaussian(rng_stream_t *stream)
+{
+	int word = (int)rng_uint32(stream);
+	int layer = word & (ZIGGURAT_LAYERS-1);
+	unsigned int magnitude = (word < 0) ? 0u - (unsigned int)word : (unsigned int)word;
+
+	if (magnitude < ziggurat_k[layer])
+		return word * ziggurat_w[layer];
+
+	return ziggurat_outside(stream, word, layer);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: rng_gaussians)
+ * num_gaussians standard normals from the stream - the same numbers as
+ * that many rng_gaussian calls.
+ *-----------------------------------------------------------------------*/
+void rng_gaussians(rng_stream_t *stream, double *gaussians, int num_gaussians)
+{
+	int i;
+
+	for (i = 0; i < num_gaussians; i++)
+	{
+		gaussians[i] = rng_gaussian(stream);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: ziggurat_outside)
+ * The word fell outside its layer's rectangle - the wedge test or, in the
+ * bottom layer, the tail past ZIGGURAT_R.
+ *-----------------------------------------------------------------------*/
+double ziggurat_outside(rng_stream_t *stream, int word, int layer)
+{
+	double x;
+	double y;
+
+	while (TRUE)
+	{
+		unsigned int magnitude;
+
+		x = word * ziggurat_w[layer];
+
+		if (layer == 0)
+		{
+			do
+			{
+				x = -log(rng_uniform(stream)) / ZIGGURAT_R;
+				y = -log(rng_uniform(stream));
+			} while (y + y < x * x);
+
+			return (word > 0) ? ZIGGURAT_R + x : -ZIGGURAT_R - x;
+		}
+
+		if (ziggurat_f[layer] + rng_uniform(stream) * (ziggurat_f[layer-1] - ziggurat_f[layer]) < exp(-0.5 * x * x))
+			return x;
+
+		word = (int)rng_uint32(stream);
+		layer = word & (ZIGGURAT_LAYERS-1);
+		magnitude = (word < 0) ? 0u - (unsigned int)word : (unsigned int)word;
+		if (magnitude < ziggurat_k[layer])
+			return word * ziggurat_w[layer];
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: philox4x32)
+ *-----------------------------------------------------------------------*/
+void philox4x32(unsigned int counter[4], unsigned int key[2], unsigned int out[4])
+{
+	int i;
+	unsigned int x0 = counter[0];
+	unsigned int x1 = counter[1];
+	unsigned int x2 = counter[2];
+	unsigned int x3 = counter[3];
+	unsigned int k0 = key[0];
+	unsigned int k1 = key[1];
+
+	for (i = 0; i < PHILOX_ROUNDS; i++)
+	{
+		unsigned long long product0 = (unsigned long long)PHILOX_M0 * x0;
+		unsigned long long product1 = (unsigned long long)PHILOX_M1 * x2;
+
+		x0 = (unsigned int)(product1 >> 32) ^ x1 ^ k0;
+		x1 = (unsigned int)product1;
+		x2 = (unsigned int)(product0 >> 32) ^ x3 ^ k1;
+		x3 = (unsigned int)product0;
+
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = x0;
+	out[1] = x1;
+	out[2] = x2;
+	out[3] = x3;
+}
@@ -0,0 +1,44 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef RNG_H
+#define RNG_H
+
+#include "types.h"
+
+/* devices of an agent - each has its own noise streams */
+#define RNG_SENSOR_DEVICE(sensor_idx) (sensor_idx)
+#define RNG_ACTUATOR_DEVICE(actuator_idx) (0x10000 + (actuator_idx))
+
+void rng_setup();
+void rng_stream_start(rng_stream_t *stream, unsigned int seed, int agent_idx, int device_id, long long epoch);
+void agent_noise_stream(rng_stream_t *stream, agent_t *agent, int device_id, double current_time);
+unsigned int rng_uint32(rng_stream_t *stream);
+double rng_uniform(rng_stream_t *stream);
+double rng_gaussian(rng_stream_t *stream);
+void rng_gaussians(rng_stream_t *stream, double *gaussians, int num_gaussians);
+
+#endif
@@ -32,6 +32,8 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "utils.h"
 
 #include "control_sensors_actuators.h"
+#include "profile.h"
+#include "group_kernel.h"
 
 /* globals */
 int num_control_algorithm_names = 5;
@@ -53,10 +55,24 @@ void run_agent_control(
 		double current_time
 	) 
 {
+	PROFILE_SCOPE(PROFILE_CONTROL);
+
 	/* call the control function of the current simulated robot */
 	(*(agent->agent_group->fptr_control_algorithm))(agent, current_time);	
 }
 
+/*-------------------------------------------------------------------------
+ * (function: schedule_agent_wake)
+ * Sensors, actuators and controls call this with the time after which
+ * they next have something to do.  The event simulation runs the control
+ * at the first epoch after the earliest of these.
+ *-----------------------------------------------------------------------*/
+void schedule_agent_wake(agent_t *agent, double wake_after_time)
+{
+	if (wake_after_time < agent->wake_time)
+		agent->wake_time = wake_after_time;
+}
+
 /*-------------------------------------------------------------------------
  * (function: setup_function_for_control)
  *-----------------------------------------------------------------------*/
@@ -68,6 +84,12 @@ void setup_function_for_control(agent_group_t *agent_group, char *function_name)
 
         control_function_id = return_string_in_list(function_name, (char**)control_algorithm_name, num_control_algorithm_names);
 
+	/* a control with a batch version sets it below */
+	agent_group->fptr_control_algorithm_batch = NULL;
+	/* and a control with a general_memory how to checkpoint it */
+	agent_group->fptr_control_memory_save = NULL;
+	agent_group->fptr_control_memory_load = NULL;
+
         switch(control_function_id)
         {
                 /* PERMUTATION ENCODINGS */
@@ -76,9 +98,13 @@ void setup_function_for_control(agent_group_t *agent_group, char *function_name)
 			break;
                 case BASIC_AVOID_ICRA:
                         agent_group->fptr_control_algorithm = control_algorithm_BASIC_AVOID_ICRA;
+			agent_group->fptr_control_memory_save = control_memory_save_BASIC_AVOID_ICRA;
+			agent_group->fptr_control_memory_load = control_memory_load_BASIC_AVOID_ICRA;
 			break;
                 case BASIC_AVOID_ICRA_W_BAYESIAN:
                         agent_group->fptr_control_algorithm = control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN;
+			agent_group->fptr_control_memory_save = control_memory_save_BASIC_AVOID_ICRA_W_BAYESIAN;
+			agent_group->fptr_control_memory_load = control_memory_load_BASIC_AVOID_ICRA_W_BAYESIAN;
 			break;
                 case BOIDS:
                         agent_group->fptr_control_algorithm = NULL;
@@ -86,6 +112,8 @@ void setup_function_for_control(agent_group_t *agent_group, char *function_name)
 			break;
                 case SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE:
                         agent_group->fptr_control_algorithm = control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE;
+			agent_group->fptr_control_memory_save = control_memory_save_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE;
+			agent_group->fptr_control_memory_load = control_memory_load_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE;
 			break;
 		default:
 			printf("EXIT - Agent with no control algorithm\n");
@@ -93,3 +121,38 @@ void setup_function_for_control(agent_group_t *agent_group, char *function_name)
 			break;
 	}
 }
+
+/*-------------------------------------------------------------------------
+ * (function: setup_group_kernels)
+ * Once the sensors, actuators and agent_store are set up, gives each
+ * group without its own batch control the group kernel of its control,
+ * sensor and actuator.  Groups with neither run per agent.  Profiled
+ * builds stay per agent so the control, sensor and actuator timers still
+ * see every call.
+ *-----------------------------------------------------------------------*/
+void setup_group_kernels()
+{
+	int i;
+
+	for (i = 0; i < agent_groups.num_agent_groups; i++)
+	{
+		agent_group_t *agent_group = agent_groups.agent_group[i];
+
+		agent_group->first_agent_idx = (agent_group->num_agents > 0) ? agent_group->agents[0]->agent_idx : 0;
+
+		/* the control's own batch comes first */
+		if (agent_group->fptr_control_algorithm_batch != NULL)
+			continue;
+
+#ifndef CENTURION_PROFILE
+		if (agent_group->fptr_control_algorithm == control_algorithm_OVERLORD)
+			agent_group->fptr_control_algorithm_batch = group_kernel_batch<control_algorithm_OVERLORD>;
+		else if (agent_group->fptr_control_algorithm == control_algorithm_BASIC_AVOID_ICRA)
+			specialize_control_algorithm_BASIC_AVOID_ICRA(agent_group);
+		else if (agent_group->fptr_control_algorithm == control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN)
+			specialize_control_algorithm_BASIC_AVOID_ICRA_W_BAYESIAN(agent_group);
+		else if (agent_group->fptr_control_algorithm == control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE)
+			specialize_control_algorithm_SIMPLE_MOVE_IN_SQUARE_AND_STOP_W_OBSTACLE(agent_group);
+#endif
+	}
+}
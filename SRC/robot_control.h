@@ -35,6 +35,7 @@ extern void run_agent_control(
 	);
 
 extern void setup_function_for_control(agent_group_t *agent_group, char *function_name);
+extern void setup_group_kernels();
 
 #endif
 
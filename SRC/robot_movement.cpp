@@ -38,11 +38,15 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 /*-------------------------------------------------------------------------
  * (function: move_forward)
+ * Movement only changes the next pose of the agent.  Other agents see it
+ * after the commit at the end of the epoch.
  *-----------------------------------------------------------------------*/
 void move(agent_t *agent, double distance_in_m)
 {
-	agent->circle->center.x = agent->circle->center.x + cos(agent->angle) * distance_in_m;
-	agent->circle->center.y = agent->circle->center.y + sin(agent->angle) * distance_in_m;
+	int a = agent->agent_idx;
+
+	agent_store.next_x[a] = agent_store.next_x[a] + cos(agent_store.next_angle[a]) * distance_in_m;
+	agent_store.next_y[a] = agent_store.next_y[a] + sin(agent_store.next_angle[a]) * distance_in_m;
 }
 
 /*-------------------------------------------------------------------------
@@ -50,8 +54,10 @@ void move(agent_t *agent, double distance_in_m)
  *-----------------------------------------------------------------------*/
 void move_with_drift(agent_t *agent, double distance_in_m, double angle_offset)
 {
-	agent->circle->center.x = agent->circle->center.x + cos(agent->angle+angle_offset) * distance_in_m;
-	agent->circle->center.y = agent->circle->center.y + sin(agent->angle+angle_offset) * distance_in_m;
+	int a = agent->agent_idx;
+
+	agent_store.next_x[a] = agent_store.next_x[a] + cos(agent_store.next_angle[a]+angle_offset) * distance_in_m;
+	agent_store.next_y[a] = agent_store.next_y[a] + sin(agent_store.next_angle[a]+angle_offset) * distance_in_m;
 }
 
 
@@ -60,15 +66,17 @@ void move_with_drift(agent_t *agent, double distance_in_m, double angle_offset)
  *-----------------------------------------------------------------------*/
 void turn(agent_t *agent, double angle_in_rad)
 {
-	agent->angle = agent->angle + angle_in_rad;
+	int a = agent->agent_idx;
+
+	agent_store.next_angle[a] = agent_store.next_angle[a] + angle_in_rad;
 
 	/* keep angle between 0 and 360 degrees from a Radian point of view 0 to 2PI */
-	if (agent->angle > twoPI)
+	if (agent_store.next_angle[a] > twoPI)
 	{
-		agent->angle -= twoPI;
+		agent_store.next_angle[a] -= twoPI;
 	}
-	else if (agent->angle < 0)
+	else if (agent_store.next_angle[a] < 0)
 	{
-		agent->angle += twoPI;
+		agent_store.next_angle[a] += twoPI;
 	}
 }
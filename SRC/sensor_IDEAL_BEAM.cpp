@@ -34,14 +34,16 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #include "control_sensors_actuators.h"
 #include "sensors.h"
+#include "checkpoint.h"
 
 /* globals */
 
-typedef struct sensor_state_t_t sensor_state_t;
-struct sensor_state_t_t
+typedef struct ideal_beam_state_t_t ideal_beam_state_t;
+struct ideal_beam_state_t_t
 {
 	double sense_completed_in_s;
 	beam_sensor_t *sensor_reading;
+	beam_cache_t beam_cache; // not checkpointed - a resumed run casts again
 };
 
 /*-------------------------------------------------------------------------
@@ -50,12 +52,13 @@ struct sensor_state_t_t
 void* sensor_function_IDEAL_BEAM(sensor_t *sensor, agent_t *agent, double current_time) 
 {
 	beam_sensor_t *sensor_reading;
-	sensor_state_t* sensor_state;
+	ideal_beam_state_t* sensor_state;
 
 	if (agent->sensor_memories[sensor->sensor_idx] == NULL)
 	{	
-		sensor_state = (sensor_state_t*)malloc(sizeof(sensor_state_t));
+		sensor_state = (ideal_beam_state_t*)malloc(sizeof(ideal_beam_state_t));
 		sensor_state->sense_completed_in_s = 0;
+		sensor_state->beam_cache.valid = FALSE;
 		sensor_reading = (beam_sensor_t*)malloc(sizeof(beam_sensor_t));
 		sensor_state->sensor_reading = sensor_reading;
 
@@ -65,7 +68,7 @@ void* sensor_function_IDEAL_BEAM(sensor_t *sensor, agent_t *agent, double curren
 	else
 	{
 		/* extract memory */
-		sensor_state = (sensor_state_t*)(agent->sensor_memories[sensor->sensor_idx]);
+		sensor_state = (ideal_beam_state_t*)(agent->sensor_memories[sensor->sensor_idx]);
 		sensor_reading = sensor_state->sensor_reading;
 	}
 
@@ -75,8 +78,8 @@ void* sensor_function_IDEAL_BEAM(sensor_t *sensor, agent_t *agent, double curren
 		sensor_state->sense_completed_in_s = current_time + sensor->sim_time_computation_epoch_s;
 
 		/* get current reading */
-		//find_closest_object_on_beam_projection(&sensor_reading, agent, agent->circle->center.x, agent->circle->center.y, agent->circle->radius+.5, agent->angle);
-		find_closest_object_on_beam_projection(&sensor_reading, agent, agent->circle->center.x + (cos(agent->angle)*agent->circle->radius) , agent->circle->center.y + (sin(agent->angle)*agent->circle->radius), .5, agent->angle);
+		//find_closest_object_on_beam_projection(&sensor_reading, agent, agent_store.x[agent->agent_idx], agent_store.y[agent->agent_idx], agent_store.radius[agent->agent_idx]+.5, agent_store.angle[agent->agent_idx]);
+		find_closest_object_on_beam_projection(&sensor_reading, agent, agent_store.x[agent->agent_idx] + (cos(agent_store.angle[agent->agent_idx])*agent_store.radius[agent->agent_idx]) , agent_store.y[agent->agent_idx] + (sin(agent_store.angle[agent->agent_idx])*agent_store.radius[agent->agent_idx]), .5, agent_store.angle[agent->agent_idx], &sensor_state->beam_cache);
 		sensor_reading->new_data = TRUE;
 	}
 	else
@@ -84,7 +87,35 @@ void* sensor_function_IDEAL_BEAM(sensor_t *sensor, agent_t *agent, double curren
 		sensor_reading->new_data = FALSE;
 	}
 
+	/* nothing new to read until the next sense */
+	schedule_agent_wake(agent, sensor_state->sense_completed_in_s);
+
 	return (void*)sensor_reading;
 }
 
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_save_IDEAL_BEAM)
+ *-----------------------------------------------------------------------*/
+void sensor_memory_save_IDEAL_BEAM(void *memory, checkpoint_t *checkpoint)
+{
+	ideal_beam_state_t* sensor_state = (ideal_beam_state_t*)memory;
+
+	checkpoint_put(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	checkpoint_put(checkpoint, sensor_state->sensor_reading, sizeof(beam_sensor_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_load_IDEAL_BEAM)
+ *-----------------------------------------------------------------------*/
+void* sensor_memory_load_IDEAL_BEAM(checkpoint_t *checkpoint)
+{
+	ideal_beam_state_t* sensor_state;
+
+	sensor_state = (ideal_beam_state_t*)malloc(sizeof(ideal_beam_state_t));
+	sensor_state->sensor_reading = (beam_sensor_t*)malloc(sizeof(beam_sensor_t));
+	checkpoint_get(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	sensor_state->beam_cache.valid = FALSE;
+	checkpoint_get(checkpoint, sensor_state->sensor_reading, sizeof(beam_sensor_t));
 
+	return (void*)sensor_state;
+}
@@ -34,28 +34,35 @@ OTHER DEALINGS IN THE SOFTWARE.
 
 #include "control_sensors_actuators.h"
 #include "sensors.h"
+#include "bayesian_filter.h"
+#include "rng.h"
+#include "checkpoint.h"
 
 /* globals */
 
 #define BAYESIAN_STATE_SIZE  591
 #define BAYESIAN_READS  4
 
+/* the states are distances in cm from 1 in steps of 0.1 */
+bayesian_table_t bayesian_table_IR;
+
 typedef struct sensor_state_t_t sensor_state_t;
 struct sensor_state_t_t
 {
 	double sense_completed_in_s;
 	beam_sensor_t *sensor_reading;
+	beam_cache_t beam_cache; // not checkpointed - a resumed run casts again
 	double *probability_array;
 	short after_bayesian_reads;
 };
 
 
-double sum_array_IR(double array[], int num_elements);
-void normalize_array_IR(double array[], int num_elements);
+double reading_mean_IR(double state);
+double reading_std_IR(double state);
 double make_bayesian_prediction_IR(double *prob_array, double actual_distance, int restart) ;
-double randnorm_IR(double mu, double sigma);
-double generate_characterized_sensor_read_IR(double distance);
-double generate_characterized_sensor_read_with_bayesian_IR(double distance, double *probability_array, int num_reads);
+double randnorm_IR(double mu, double sigma, rng_stream_t *noise);
+double generate_characterized_sensor_read_IR(double distance, rng_stream_t *noise);
+double generate_characterized_sensor_read_with_bayesian_IR(double distance, double *probability_array, int num_reads, rng_stream_t *noise);
 
 /* GAUSSIAN code from
  * https://kcru.lawsonresearch.ca/research/srk/normalDBN_random.html
@@ -74,9 +81,11 @@ void* sensor_function_IR_W_BAYESIAN(sensor_t *sensor, agent_t *agent, double cur
 	{	
 		sensor_state = (sensor_state_t*)malloc(sizeof(sensor_state_t));
 		sensor_state->sense_completed_in_s = 0;
+		sensor_state->beam_cache.valid = FALSE;
 		sensor_reading = (beam_sensor_t*)malloc(sizeof(beam_sensor_t));
 		sensor_state->sensor_reading = sensor_reading;
-		probability_array = (double*)malloc(sizeof(double)*571);
+		probability_array = (double*)malloc(sizeof(double)*BAYESIAN_STATE_SIZE);
+		bayesian_reset(&bayesian_table_IR, probability_array);
 		sensor_state->probability_array = probability_array;
 		sensor_state->after_bayesian_reads = 0;
 
@@ -101,15 +110,18 @@ void* sensor_function_IR_W_BAYESIAN(sensor_t *sensor, agent_t *agent, double cur
 			sensor_state->after_bayesian_reads ++;
 
 		/* get current reading */
-		//find_closest_object_on_beam_projection(&sensor_reading, agent, agent->circle->center.x, agent->circle->center.y, agent->circle->radius+.5, agent->angle);
-		find_closest_object_on_beam_projection(&sensor_reading, agent, agent->circle->center.x + (cos(agent->angle)*agent->circle->radius) , agent->circle->center.y + (sin(agent->angle)*agent->circle->radius), .5, agent->angle);
+		//find_closest_object_on_beam_projection(&sensor_reading, agent, agent_store.x[agent->agent_idx], agent_store.y[agent->agent_idx], agent_store.radius[agent->agent_idx]+.5, agent_store.angle[agent->agent_idx]);
+		find_closest_object_on_beam_projection(&sensor_reading, agent, agent_store.x[agent->agent_idx] + (cos(agent_store.angle[agent->agent_idx])*agent_store.radius[agent->agent_idx]) , agent_store.y[agent->agent_idx] + (sin(agent_store.angle[agent->agent_idx])*agent_store.radius[agent->agent_idx]), .5, agent_store.angle[agent->agent_idx], &sensor_state->beam_cache);
 		/* if we get a read use characterization */
 		if (sensor_reading->in_m != -1)
 		{
-			printf("read:%d: Object is %f", sensor_state->after_bayesian_reads, sensor_reading->in_m);
+			rng_stream_t noise;
+
+			agent_noise_stream(&noise, agent, RNG_SENSOR_DEVICE(sensor->sensor_idx), current_time);
+			//printf("read:%d: Object is %f", sensor_state->after_bayesian_reads, sensor_reading->in_m);
 			/* the function is written in cm hence the *100 and /100 */
-			sensor_reading->in_m = generate_characterized_sensor_read_with_bayesian_IR(100*sensor_reading->in_m, probability_array, sensor_state->after_bayesian_reads) / 100; 
-			printf(" but sensor read is %f\n", sensor_reading->in_m);
+			sensor_reading->in_m = generate_characterized_sensor_read_with_bayesian_IR(100*sensor_reading->in_m, probability_array, sensor_state->after_bayesian_reads, &noise) / 100; 
+			//printf(" but sensor read is %f\n", sensor_reading->in_m);
 		}
 
 		sensor_reading->new_data = TRUE;
@@ -120,6 +132,9 @@ void* sensor_function_IR_W_BAYESIAN(sensor_t *sensor, agent_t *agent, double cur
 		sensor_reading->new_data = FALSE;
 	}
 
+	/* nothing new to read until the next sense */
+	schedule_agent_wake(agent, sensor_state->sense_completed_in_s);
+
 	return (void*)sensor_reading;
 }
 
@@ -136,6 +151,7 @@ void* sensor_function_IR(sensor_t *sensor, agent_t *agent, double current_time)
 	{	
 		sensor_state = (sensor_state_t*)malloc(sizeof(sensor_state_t));
 		sensor_state->sense_completed_in_s = 0;
+		sensor_state->beam_cache.valid = FALSE;
 		sensor_reading = (beam_sensor_t*)malloc(sizeof(beam_sensor_t));
 		sensor_state->sensor_reading = sensor_reading;
 
@@ -155,14 +171,17 @@ void* sensor_function_IR(sensor_t *sensor, agent_t *agent, double current_time)
 		sensor_state->sense_completed_in_s = current_time + sensor->sim_time_computation_epoch_s;
 
 		/* get current reading */
-		//find_closest_object_on_beam_projection(&sensor_reading, agent, agent->circle->center.x, agent->circle->center.y, agent->circle->radius+.5, agent->angle);
-		find_closest_object_on_beam_projection(&sensor_reading, agent, agent->circle->center.x + (cos(agent->angle)*agent->circle->radius) , agent->circle->center.y + (sin(agent->angle)*agent->circle->radius), .5, agent->angle);
+		//find_closest_object_on_beam_projection(&sensor_reading, agent, agent_store.x[agent->agent_idx], agent_store.y[agent->agent_idx], agent_store.radius[agent->agent_idx]+.5, agent_store.angle[agent->agent_idx]);
+		find_closest_object_on_beam_projection(&sensor_reading, agent, agent_store.x[agent->agent_idx] + (cos(agent_store.angle[agent->agent_idx])*agent_store.radius[agent->agent_idx]) , agent_store.y[agent->agent_idx] + (sin(agent_store.angle[agent->agent_idx])*agent_store.radius[agent->agent_idx]), .5, agent_store.angle[agent->agent_idx], &sensor_state->beam_cache);
 		/* if we get a read use characterization */
 		if (sensor_reading->in_m != -1)
 		{
-			printf("Object is %f", sensor_reading->in_m);
-			sensor_reading->in_m = generate_characterized_sensor_read_IR(100*sensor_reading->in_m) / 100; 
-			printf(" but sensor read is %f\n", sensor_reading->in_m);
+			rng_stream_t noise;
+
+			agent_noise_stream(&noise, agent, RNG_SENSOR_DEVICE(sensor->sensor_idx), current_time);
+			//printf("Object is %f", sensor_reading->in_m);
+			sensor_reading->in_m = generate_characterized_sensor_read_IR(100*sensor_reading->in_m, &noise) / 100; 
+			//printf(" but sensor read is %f\n", sensor_reading->in_m);
 		}
 
 		sensor_reading->new_data = TRUE;
@@ -172,34 +191,10 @@ void* sensor_function_IR(sensor_t *sensor, agent_t *agent, double current_time)
 		sensor_reading->new_data = FALSE;
 	}
 
-	return (void*)sensor_reading;
-}
+	/* nothing new to read until the next sense */
+	schedule_agent_wake(agent, sensor_state->sense_completed_in_s);
 
-double sum_array_IR(double array[], int num_elements)
-{
-	double sum = 0;
-	for (int i = 0; i<num_elements; i++)
-	{
-		sum = sum + array[i];
-	}
-	return(sum);
-}
-/*
- * Function:  normalize_array
- * --------------------
- * normalize the given array by dividing all the elements by the sum of them
- *
- *  array[]: the array to be sum
- *  num_elements: size of the given array
- *  returns: void
- */
-void normalize_array_IR(double array[], int num_elements)
-{
-	double sum = sum_array_IR(array, num_elements);
-	for (int i = 0; i<num_elements; i++)
-	{
-		array[i] = array[i] / sum;
-	}
+	return (void*)sensor_reading;
 }
 
 /*
@@ -214,66 +209,50 @@ void normalize_array_IR(double array[], int num_elements)
 
 double make_bayesian_prediction_IR(double *prob_array, double actual_distance, int restart) 
 {
-	int i;
-	int at_idx = 0;
-	double return_distance;
-	double find_max = -1;
-	// Variable to keep track of iteration
-	static int sampleCount = 0;
-	static int init = 1;
-	/* Storing finite number of state */
-	double state[BAYESIAN_STATE_SIZE];
-	double num = 1;
-	for (int i = 0; i < BAYESIAN_STATE_SIZE; i++) {
-		state[i] = num;
-		num += 0.1;
-	}
-	/* Array to store prediction probability */
-	double en = 1.0 / (double)BAYESIAN_STATE_SIZE;
-	//static double prob_array[BAYESIAN_STATE_SIZE];
 	// Not sure why iteration is here - paj commented out
 	// RESTART after BAYESIAN_READS
-	if ((init == 1) || (restart == 0)) 
-	//if ((init == 1) || (sampleCount >= iteration) || (restart == 1)) 
+	/* the sensor starts every agent's array uniform so only restarts are needed here */
+	if (restart == 0) 
 	{
-		sampleCount = 0;
-		init = 0;
-		for (int i = 0; i < BAYESIAN_STATE_SIZE; i++) 
-		{
-			prob_array[i] = en;
-		}
+		bayesian_reset(&bayesian_table_IR, prob_array);
 	}
-	/* ===== Start Predicting ======== */
-	static double mean_k1 = 11955.224610613135;
-	static double mean_k2 = -0.9738407600162202;
-	static double std_k1 = 5.574431613205327;
-	static double std_k2 = 0.14072513618767238;
 
-	for (int i = 0; i < BAYESIAN_STATE_SIZE; i++) {
-		double mean = mean_k1 * (pow(state[i], mean_k2));
-		double std = std_k1 * pow(M_E, (std_k2*state[i]));
-		double variance = pow((std), 2.0);
-		double prob = ((1.0 / (std * sqrt(2.0 * M_PI))) * (pow(M_E, -1.0 * ((pow((actual_distance - mean), 2.0)) / (variance * 2.0)))));
-		prob_array[i] = prob * prob_array[i];
-	}
-	normalize_array_IR(prob_array, BAYESIAN_STATE_SIZE);
-	sampleCount++;
+	/* most confident state - the distance at the state, not mean_k1 * (pow(state, mean_k2)) */
+	return bayesian_update(&bayesian_table_IR, prob_array, actual_distance);
+}
 
-	/* find most confident and return value */
-	for (i = 0; i < BAYESIAN_STATE_SIZE; i++)
-	{
-		if (prob_array[i] > find_max)
-		{
-			find_max = prob_array[i];
-			at_idx = i;
-		}
-	}
+/*-------------------------------------------------------------------------
+ * (function: setup_bayesian_table_IR)
+ * Called when a sensor is set to this type so the table is there before
+ * the threads start.
+ *-----------------------------------------------------------------------*/
+void setup_bayesian_table_IR()
+{
+	if (bayesian_table_IR.num_states == 0)
+		bayesian_table_build(&bayesian_table_IR, BAYESIAN_STATE_SIZE, 1, 0.1, reading_mean_IR, reading_std_IR);
+}
 
-	// Generate the random numbers that follows the Gausian Distribution
-	//return mean_k1 * (pow(state[at_idx], mean_k2));
-	// Distance at state
-	
-	return state[at_idx];
+/*-------------------------------------------------------------------------
+ * (function: reading_mean_IR)
+ * Mean reading at a distance state (in cm) from the characterization.
+ *-----------------------------------------------------------------------*/
+double reading_mean_IR(double state)
+{
+	double mean_k1 = 11955.224610613135;
+	double mean_k2 = -0.9738407600162202;
+
+	return mean_k1 * (pow(state, mean_k2));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: reading_std_IR)
+ *-----------------------------------------------------------------------*/
+double reading_std_IR(double state)
+{
+	double std_k1 = 5.574431613205327;
+	double std_k2 = 0.14072513618767238;
+
+	return std_k1 * pow(M_E, (std_k2*state));
 }
 
 /*
@@ -283,34 +262,12 @@ double make_bayesian_prediction_IR(double *prob_array, double actual_distance, i
  *
  *  mu: mean of the normal distribution
  *  sigma: standard deviation of the normal distribution
+ *  noise: the stream of this sensor of the agent this epoch (see rng.cpp)
  *  returns: a single double that is taken from a normal distribution with a given mean and standard deviation
  */
-double randnorm_IR(double mu, double sigma)
+double randnorm_IR(double mu, double sigma, rng_stream_t *noise)
 {
-	double U1, U2, W, mult;
-	static double X1, X2;
-	static int call = 0;
-
-	if (call == 1)
-	{
-		call = !call;
-		return (mu + sigma * (double)X2);
-	}
-
-	do
-	{
-		U1 = -1 + ((double)rand() / RAND_MAX) * 2;
-		U2 = -1 + ((double)rand() / RAND_MAX) * 2;
-		W = pow(U1, 2) + pow(U2, 2);
-	} while (W >= 1 || W == 0);
-
-	mult = sqrt((-2 * log(W)) / W);
-	X1 = U1 * mult;
-	X2 = U2 * mult;
-
-	call = !call;
-
-	return (mu + sigma * (double)X1);
+	return (mu + sigma * rng_gaussian(noise));
 }
 
  /* Function:  generate_data
@@ -320,7 +277,7 @@ double randnorm_IR(double mu, double sigma)
  *  distance: distance of the object measured from the sensor
  *  returns: a single double that is taken from a normal distribution with a calculated mean and standard deviation
  */
-double generate_characterized_sensor_read_IR(double distance) 
+double generate_characterized_sensor_read_IR(double distance, rng_stream_t *noise) 
 {
 	// Constant to calculate to mean and standard deviation from the given distance
 	static double mean_k1 = 11955.224610613135;
@@ -333,7 +290,7 @@ double generate_characterized_sensor_read_IR(double distance)
 	double std = std_k1 * pow(M_E, (std_k2*distance));
 
 	// Generate the random numbers that follows the Gausian Distribution
-	return randnorm_IR(mean, std);
+	return randnorm_IR(mean, std, noise);
 }
 
 /*-------------------------------------------------------------------------
@@ -341,7 +298,68 @@ double generate_characterized_sensor_read_IR(double distance)
  * Wrapper for the IR with bayesian such that the prediction is made using
  * a version of the sensor read
  *-----------------------------------------------------------------------*/
-double generate_characterized_sensor_read_with_bayesian_IR(double distance, double *probability_array, int num_reads) 
+double generate_characterized_sensor_read_with_bayesian_IR(double distance, double *probability_array, int num_reads, rng_stream_t *noise) 
+{
+	return make_bayesian_prediction_IR(probability_array, generate_characterized_sensor_read_IR(distance, noise), num_reads); 
+}
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_save_IR)
+ *-----------------------------------------------------------------------*/
+void sensor_memory_save_IR(void *memory, checkpoint_t *checkpoint)
 {
-	return make_bayesian_prediction_IR(probability_array, generate_characterized_sensor_read_IR(distance), num_reads); 
+	sensor_state_t* sensor_state = (sensor_state_t*)memory;
+
+	checkpoint_put(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	checkpoint_put(checkpoint, sensor_state->sensor_reading, sizeof(beam_sensor_t));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_load_IR)
+ *-----------------------------------------------------------------------*/
+void* sensor_memory_load_IR(checkpoint_t *checkpoint)
+{
+	sensor_state_t* sensor_state;
+
+	sensor_state = (sensor_state_t*)malloc(sizeof(sensor_state_t));
+	sensor_state->sensor_reading = (beam_sensor_t*)malloc(sizeof(beam_sensor_t));
+	checkpoint_get(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	sensor_state->beam_cache.valid = FALSE;
+	checkpoint_get(checkpoint, sensor_state->sensor_reading, sizeof(beam_sensor_t));
+
+	return (void*)sensor_state;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_save_IR_W_BAYESIAN)
+ * The filter's belief is kept with the reading so the resumed agent does
+ * not start over from a reset filter.
+ *-----------------------------------------------------------------------*/
+void sensor_memory_save_IR_W_BAYESIAN(void *memory, checkpoint_t *checkpoint)
+{
+	sensor_state_t* sensor_state = (sensor_state_t*)memory;
+
+	checkpoint_put(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	checkpoint_put(checkpoint, sensor_state->sensor_reading, sizeof(beam_sensor_t));
+	checkpoint_put(checkpoint, sensor_state->probability_array, sizeof(double)*BAYESIAN_STATE_SIZE);
+	checkpoint_put(checkpoint, &sensor_state->after_bayesian_reads, sizeof(short));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_load_IR_W_BAYESIAN)
+ *-----------------------------------------------------------------------*/
+void* sensor_memory_load_IR_W_BAYESIAN(checkpoint_t *checkpoint)
+{
+	sensor_state_t* sensor_state;
+
+	sensor_state = (sensor_state_t*)malloc(sizeof(sensor_state_t));
+	sensor_state->sensor_reading = (beam_sensor_t*)malloc(sizeof(beam_sensor_t));
+	sensor_state->probability_array = (double*)malloc(sizeof(double)*BAYESIAN_STATE_SIZE);
+	checkpoint_get(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	sensor_state->beam_cache.valid = FALSE;
+	checkpoint_get(checkpoint, sensor_state->sensor_reading, sizeof(beam_sensor_t));
+	checkpoint_get(checkpoint, sensor_state->probability_array, sizeof(double)*BAYESIAN_STATE_SIZE);
+	checkpoint_get(checkpoint, &sensor_state->after_bayesian_reads, sizeof(short));
+
+	return (void*)sensor_state;
 }
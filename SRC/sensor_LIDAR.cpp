@@ -0,0 +1,526 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "control_sensors_actuators.h"
+#include "sensors.h"
+#include "agent_index.h"
+#include "bvh.h"
+#include "agent_store.h"
+#include "checkpoint.h"
+
+/* globals */
+
+/* 
+ * A LIDAR casts the whole fan from the center of the agent at once.  The
+ * objects near enough to be hit are gathered once per scan and each is
+ * then tested against every beam in a flat loop over arrays of the beam
+ * directions, two beams at a time with SSE2 when __SSE2__ is defined.
+ * The one beam left over goes through the same arithmetic in doubles so
+ * every beam gets the same rounding.
+ */
+typedef struct lidar_state_t_t lidar_state_t;
+struct lidar_state_t_t
+{
+	double sense_completed_in_s;
+	scan_sensor_t *sensor_reading;
+
+	/* beam i points at the heading turned by these - fixed for the sensor */
+	double *offset_cosine;
+	double *offset_sine;
+	/* this scan's beam directions and the nearest hit along each */
+	double *direction_x;
+	double *direction_y;
+	double *nearest;
+
+	/* sim objects near enough to be hit this scan */
+	int *candidates;
+	int num_candidates;
+	int alloc_candidates;
+	agent_t *agent_self;
+
+	/* nearest is used again while neither the agent nor anything in reach has moved - not checkpointed */
+	short cached;
+	unsigned int pose_version;
+	unsigned int index_version;
+};
+
+lidar_state_t* lidar_state_allocate(sensor_t *sensor);
+void lidar_found_candidate(int sim_object_idx, void *context);
+void lidar_scan(lidar_state_t *sensor_state, agent_t *agent, double range_in_m);
+void lidar_cast(lidar_state_t *sensor_state, agent_t *agent, rectangle_t *reach, double beam_length);
+void lidar_beams_hit_circle(circle_t *circle, double x, double y, double start, double *direction_x, double *direction_y, double *nearest, int num_beams);
+void lidar_beams_hit_rectangle(oriented_rectangle_t *rectangle, double x, double y, double start, double *direction_x, double *direction_y, double *nearest, int num_beams);
+#ifdef __SSE2__
+inline __m128d lidar_select_2(__m128d mask, __m128d if_set, __m128d if_clear);
+#endif
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_function_LIDAR)
+ *-----------------------------------------------------------------------*/
+void* sensor_function_LIDAR(sensor_t *sensor, agent_t *agent, double current_time) 
+{
+	scan_sensor_t *sensor_reading;
+	lidar_state_t* sensor_state;
+
+	if (agent->sensor_memories[sensor->sensor_idx] == NULL)
+	{	
+		sensor_state = lidar_state_allocate(sensor);
+		sensor_state->sense_completed_in_s = 0;
+		sensor_reading = sensor_state->sensor_reading;
+
+		/* store as memory */
+		agent->sensor_memories[sensor->sensor_idx] = (void*)sensor_state;
+	}
+	else
+	{
+		/* extract memory */
+		sensor_state = (lidar_state_t*)(agent->sensor_memories[sensor->sensor_idx]);
+		sensor_reading = sensor_state->sensor_reading;
+	}
+
+	if (sensor_state->sense_completed_in_s < current_time)
+	{
+		/* next sense completed at */
+		sensor_state->sense_completed_in_s = current_time + sensor->sim_time_computation_epoch_s;
+
+		/* get current reading */
+		lidar_scan(sensor_state, agent, sensor->range_in_m);
+		sensor_reading->center_beam.new_data = TRUE;
+	}
+	else
+	{
+		sensor_reading->center_beam.new_data = FALSE;
+	}
+
+	/* nothing new to read until the next sense */
+	schedule_agent_wake(agent, sensor_state->sense_completed_in_s);
+
+	return (void*)sensor_reading;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: lidar_state_allocate)
+ * The fan is centered on the sensor's direction.  A full turn spaces the
+ * beams so the last does not land on the first and has a beam right on
+ * the direction.
+ *-----------------------------------------------------------------------*/
+lidar_state_t* lidar_state_allocate(sensor_t *sensor)
+{
+	int i;
+	int num_beams = sensor->num_beams;
+	lidar_state_t *sensor_state;
+	scan_sensor_t *sensor_reading;
+
+	sensor_state = (lidar_state_t*)malloc(sizeof(lidar_state_t));
+	sensor_reading = (scan_sensor_t*)malloc(sizeof(scan_sensor_t));
+	sensor_state->sensor_reading = sensor_reading;
+
+	sensor_reading->num_beams = num_beams;
+	sensor_reading->center_beam_idx = num_beams / 2;
+	if (sensor->field_of_view >= 2*M_PI - 1e-9 || num_beams == 1)
+	{
+		sensor_reading->angle_step = sensor->field_of_view / num_beams;
+		sensor_reading->first_angle = sensor->angle - sensor_reading->angle_step * sensor_reading->center_beam_idx;
+	}
+	else
+	{
+		sensor_reading->angle_step = sensor->field_of_view / (num_beams - 1);
+		sensor_reading->first_angle = sensor->angle - sensor->field_of_view / 2;
+		sensor_reading->center_beam_idx = (num_beams - 1) / 2;
+	}
+	sensor_reading->in_m = (double*)malloc(sizeof(double) * num_beams);
+	sensor_reading->center_beam.in_m = -1;
+	sensor_reading->center_beam.angle_phi = 0.0;
+	sensor_reading->center_beam.new_data = FALSE;
+	sensor_reading->center_beam.reads = 0;
+
+	sensor_state->offset_cosine = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->offset_sine = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->direction_x = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->direction_y = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->nearest = (double*)malloc(sizeof(double) * num_beams);
+	for (i = 0; i < num_beams; i++)
+	{
+		double angle = sensor_reading->first_angle + i * sensor_reading->angle_step;
+
+		sensor_state->offset_cosine[i] = cos(angle);
+		sensor_state->offset_sine[i] = sin(angle);
+		sensor_reading->in_m[i] = -1;
+	}
+
+	sensor_state->candidates = NULL;
+	sensor_state->num_candidates = 0;
+	sensor_state->alloc_candidates = 0;
+	sensor_state->agent_self = NULL;
+	sensor_state->cached = FALSE;
+
+	return sensor_state;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: lidar_scan)
+ * Fills the reading with the distance each beam travels past the edge of
+ * the agent before it hits something - -1 if it gets past range_in_m.  The
+ * last cast is used again if the agent has not moved and nothing in reach
+ * has since.  The static objects never move.
+ *-----------------------------------------------------------------------*/
+void lidar_scan(lidar_state_t *sensor_state, agent_t *agent, double range_in_m)
+{
+	int i;
+	scan_sensor_t *sensor_reading = sensor_state->sensor_reading;
+	int num_beams = sensor_reading->num_beams;
+	int agent_idx = agent->agent_idx;
+	double x = agent_store.x[agent_idx];
+	double y = agent_store.y[agent_idx];
+	double radius = agent_store.radius[agent_idx];
+	double beam_length = radius + range_in_m;
+	double *direction_x = sensor_state->direction_x;
+	double *direction_y = sensor_state->direction_y;
+	double *nearest = sensor_state->nearest;
+	rectangle_t reach;
+
+	/* everything any beam could reach */
+	reach.origin.x = x - beam_length;
+	reach.origin.y = y - beam_length;
+	reach.size.x = 2 * beam_length;
+	reach.size.y = 2 * beam_length;
+
+	if (sensor_state->cached == FALSE || sensor_state->pose_version != agent_store.pose_version[agent_idx] 
+			|| agent_index_unchanged_since(&reach, sensor_state->index_version) == FALSE)
+	{
+		lidar_cast(sensor_state, agent, &reach, beam_length);
+	}
+
+	for (i = 0; i < num_beams; i++)
+	{
+		if (nearest[i] < beam_length)
+		{
+			line_segment_t beam_segment;
+			vector_2D_t point_of_intersect;
+			double from_edge = nearest[i] - radius;
+
+			sensor_reading->in_m[i] = from_edge;
+
+			/* output sensor hit to log file when the epoch is committed */
+			beam_segment.point1.x = x + direction_x[i] * radius;
+			beam_segment.point1.y = y + direction_y[i] * radius;
+			beam_segment.point2.x = x + direction_x[i] * beam_length;
+			beam_segment.point2.y = y + direction_y[i] * beam_length;
+			point_of_intersect.x = x + direction_x[i] * nearest[i];
+			point_of_intersect.y = y + direction_y[i] * nearest[i];
+			queue_beam_hit_log(agent, &beam_segment, &point_of_intersect, from_edge);
+		}
+		else
+		{
+			sensor_reading->in_m[i] = -1;
+		}
+	}
+
+	sensor_reading->center_beam.in_m = sensor_reading->in_m[sensor_reading->center_beam_idx];
+	sensor_reading->center_beam.angle_phi = 0.0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: lidar_cast)
+ * Points the beams the way the agent faces and finds the nearest hit
+ * along each from the center of the agent out to beam_length.
+ *-----------------------------------------------------------------------*/
+void lidar_cast(lidar_state_t *sensor_state, agent_t *agent, rectangle_t *reach, double beam_length)
+{
+	int i;
+	int num_beams = sensor_state->sensor_reading->num_beams;
+	int agent_idx = agent->agent_idx;
+	double x = agent_store.x[agent_idx];
+	double y = agent_store.y[agent_idx];
+	double radius = agent_store.radius[agent_idx];
+	double heading_cosine = cos(agent_store.angle[agent_idx]);
+	double heading_sine = sin(agent_store.angle[agent_idx]);
+	double *direction_x = sensor_state->direction_x;
+	double *direction_y = sensor_state->direction_y;
+	double *nearest = sensor_state->nearest;
+
+	__atomic_fetch_add(&num_sensor_beams_cast, num_beams, __ATOMIC_RELAXED);
+
+	for (i = 0; i < num_beams; i++)
+	{
+		direction_x[i] = heading_cosine * sensor_state->offset_cosine[i] - heading_sine * sensor_state->offset_sine[i];
+		direction_y[i] = heading_sine * sensor_state->offset_cosine[i] + heading_cosine * sensor_state->offset_sine[i];
+		nearest[i] = beam_length;
+	}
+
+	sensor_state->num_candidates = 0;
+	sensor_state->agent_self = agent;
+	bvh_query_overlap(&sim_bvh, reach, lidar_found_candidate, (void*)sensor_state);
+	agent_index_query_overlap(reach, lidar_found_candidate, (void*)sensor_state);
+
+	for (i = 0; i < sensor_state->num_candidates; i++)
+	{
+		sim_obj_t *candidate = sim_objects[sensor_state->candidates[i]];
+
+		if (candidate->type == AGENT)
+		{
+			/* assume robots only spheres */
+			circle_t agent_circle = agent_store_circle(&agent_store, candidate->agent->agent_idx);
+			lidar_beams_hit_circle(&agent_circle, x, y, radius, direction_x, direction_y, nearest, num_beams);
+		}
+		else if (candidate->object->type == CIRCLE)
+		{
+			lidar_beams_hit_circle(candidate->object->circle, x, y, radius, direction_x, direction_y, nearest, num_beams);
+		}
+		else if (candidate->object->type == RECTANGLE)
+		{
+			lidar_beams_hit_rectangle(candidate->object->rectangle, x, y, radius, direction_x, direction_y, nearest, num_beams);
+		}
+	}
+
+	sensor_state->cached = TRUE;
+	sensor_state->pose_version = agent_store.pose_version[agent_idx];
+	sensor_state->index_version = agent_index_version();
+}
+
+/*-------------------------------------------------------------------------
+ * (function: lidar_found_candidate)
+ *-----------------------------------------------------------------------*/
+void lidar_found_candidate(int sim_object_idx, void *context)
+{
+	lidar_state_t *sensor_state = (lidar_state_t*)context;
+	sim_obj_t *candidate = sim_objects[sim_object_idx];
+
+	if (candidate->type == AGENT)
+	{
+		if (candidate->agent == sensor_state->agent_self || agent_store.not_physical[candidate->agent->agent_idx] == TRUE)
+			return;
+		oassert(candidate->agent->agent_group->shape->type == CIRCLE);
+	}
+
+	if (sensor_state->num_candidates == sensor_state->alloc_candidates)
+	{
+		sensor_state->alloc_candidates = (sensor_state->alloc_candidates == 0) ? 16 : sensor_state->alloc_candidates * 2;
+		sensor_state->candidates = (int*)realloc(sensor_state->candidates, sizeof(int) * sensor_state->alloc_candidates);
+	}
+	sensor_state->candidates[sensor_state->num_candidates++] = sim_object_idx;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: lidar_beams_hit_circle)
+ * Lowers nearest[i] to where beam i from (x, y) first crosses the edge of
+ * the circle past start.  Like the single beam sensors starting at the edge
+ * of the agent - something the agent is already touching is seen where
+ * the beam leaves it.
+ *-----------------------------------------------------------------------*/
+void lidar_beams_hit_circle(circle_t *circle, double x, double y, double start, double *direction_x, double *direction_y, double *nearest, int num_beams)
+{
+	int i = 0;
+	double fx = x - circle->center.x;
+	double fy = y - circle->center.y;
+	double c = fx*fx + fy*fy - circle->radius*circle->radius;
+
+#ifdef __SSE2__
+	__m128d fx_2 = _mm_set1_pd(fx);
+	__m128d fy_2 = _mm_set1_pd(fy);
+	__m128d c_2 = _mm_set1_pd(c);
+	__m128d start_2 = _mm_set1_pd(start);
+	__m128d sign_bit = _mm_set1_pd(-0.0);
+
+	for (; i + 1 < num_beams; i += 2)
+	{
+		__m128d nearest_2 = _mm_loadu_pd(&nearest[i]);
+		__m128d b = _mm_add_pd(_mm_mul_pd(fx_2, _mm_loadu_pd(&direction_x[i])), _mm_mul_pd(fy_2, _mm_loadu_pd(&direction_y[i])));
+		__m128d discriminant = _mm_sub_pd(_mm_mul_pd(b, b), c_2);
+		__m128d half_chord = _mm_sqrt_pd(_mm_andnot_pd(sign_bit, discriminant));
+		__m128d minus_b = _mm_xor_pd(b, sign_bit);
+		__m128d near_root = _mm_sub_pd(minus_b, half_chord);
+		__m128d root = lidar_select_2(_mm_cmpge_pd(near_root, start_2), near_root, _mm_add_pd(minus_b, half_chord));
+		__m128d hit = _mm_and_pd(_mm_cmpge_pd(discriminant, _mm_setzero_pd()), _mm_and_pd(_mm_cmpge_pd(root, start_2), _mm_cmplt_pd(root, nearest_2)));
+
+		_mm_storeu_pd(&nearest[i], lidar_select_2(hit, root, nearest_2));
+	}
+#endif
+	for (; i < num_beams; i++)
+	{
+		double b = fx*direction_x[i] + fy*direction_y[i];
+		double discriminant = b*b - c;
+		/* a miss has a negative discriminant - the fabs only keeps sqrt branch free */
+		double half_chord = sqrt(fabs(discriminant));
+		double near_root = -b - half_chord;
+		double root = (near_root >= start) ? near_root : -b + half_chord;
+		short hit = (discriminant >= 0) & (root >= start) & (root < nearest[i]);
+
+		nearest[i] = hit ? root : nearest[i];
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: lidar_beams_hit_rectangle)
+ * Same as lidar_beams_hit_circle with a slab test in the frame of the
+ * rectangle.  A beam parallel to two edges has an infinite inverse there
+ * and if it runs right along one of them the slab bound is 0 * inf, a NaN.
+ * That beam grazes the edge, so it is taken as inside that slab (-inf to
+ * inf) and the other slab decides - it is seen at the near corner.
+ *-----------------------------------------------------------------------*/
+void lidar_beams_hit_rectangle(oriented_rectangle_t *rectangle, double x, double y, double start, double *direction_x, double *direction_y, double *nearest, int num_beams)
+{
+	int i = 0;
+	double cosine = rectangle->cosine;
+	double sine = rectangle->sine;
+	double half_x = rectangle->halfExtend.x;
+	double half_y = rectangle->halfExtend.y;
+	/* the beam start turned into the rectangle - see rotate_vector_into_rectangle */
+	double px = (x - rectangle->center.x) * cosine + (y - rectangle->center.y) * sine;
+	double py = (y - rectangle->center.y) * cosine - (x - rectangle->center.x) * sine;
+
+#ifdef __SSE2__
+	__m128d cosine_2 = _mm_set1_pd(cosine);
+	__m128d sine_2 = _mm_set1_pd(sine);
+	__m128d low_x = _mm_set1_pd(-half_x - px);
+	__m128d high_x = _mm_set1_pd(half_x - px);
+	__m128d low_y = _mm_set1_pd(-half_y - py);
+	__m128d high_y = _mm_set1_pd(half_y - py);
+	__m128d start_2 = _mm_set1_pd(start);
+	__m128d one = _mm_set1_pd(1.0);
+	__m128d infinity = _mm_set1_pd(HUGE_VAL);
+	__m128d minus_infinity = _mm_set1_pd(-HUGE_VAL);
+
+	for (; i + 1 < num_beams; i += 2)
+	{
+		__m128d nearest_2 = _mm_loadu_pd(&nearest[i]);
+		__m128d dx = _mm_loadu_pd(&direction_x[i]);
+		__m128d dy = _mm_loadu_pd(&direction_y[i]);
+		__m128d inverse_x = _mm_div_pd(one, _mm_add_pd(_mm_mul_pd(dx, cosine_2), _mm_mul_pd(dy, sine_2)));
+		__m128d inverse_y = _mm_div_pd(one, _mm_sub_pd(_mm_mul_pd(dy, cosine_2), _mm_mul_pd(dx, sine_2)));
+		__m128d tx1 = _mm_mul_pd(low_x, inverse_x);
+		__m128d tx2 = _mm_mul_pd(high_x, inverse_x);
+		__m128d ty1 = _mm_mul_pd(low_y, inverse_y);
+		__m128d ty2 = _mm_mul_pd(high_y, inverse_y);
+		__m128d on_x_edge = _mm_cmpunord_pd(tx1, tx2);
+		__m128d on_y_edge = _mm_cmpunord_pd(ty1, ty2);
+		/* minpd and maxpd give the second operand unless the compare holds - the same picks as the ternaries below */
+		__m128d tx_near = lidar_select_2(on_x_edge, minus_infinity, _mm_min_pd(tx1, tx2));
+		__m128d tx_far = lidar_select_2(on_x_edge, infinity, _mm_max_pd(tx2, tx1));
+		__m128d ty_near = lidar_select_2(on_y_edge, minus_infinity, _mm_min_pd(ty1, ty2));
+		__m128d ty_far = lidar_select_2(on_y_edge, infinity, _mm_max_pd(ty2, ty1));
+		__m128d t_near = _mm_max_pd(tx_near, ty_near);
+		__m128d t_far = _mm_min_pd(tx_far, ty_far);
+		__m128d root = lidar_select_2(_mm_cmpge_pd(t_near, start_2), t_near, t_far);
+		__m128d hit = _mm_and_pd(_mm_cmple_pd(t_near, t_far), _mm_and_pd(_mm_cmpge_pd(root, start_2), _mm_cmplt_pd(root, nearest_2)));
+
+		_mm_storeu_pd(&nearest[i], lidar_select_2(hit, root, nearest_2));
+	}
+#endif
+	for (; i < num_beams; i++)
+	{
+		double inverse_x = 1.0 / (direction_x[i] * cosine + direction_y[i] * sine);
+		double inverse_y = 1.0 / (direction_y[i] * cosine - direction_x[i] * sine);
+		double tx1 = (-half_x - px) * inverse_x;
+		double tx2 = (half_x - px) * inverse_x;
+		double ty1 = (-half_y - py) * inverse_y;
+		double ty2 = (half_y - py) * inverse_y;
+		short on_x_edge = (tx1 != tx1) | (tx2 != tx2);
+		short on_y_edge = (ty1 != ty1) | (ty2 != ty2);
+		double tx_near = on_x_edge ? -HUGE_VAL : ((tx1 < tx2) ? tx1 : tx2);
+		double tx_far = on_x_edge ? HUGE_VAL : ((tx1 < tx2) ? tx2 : tx1);
+		double ty_near = on_y_edge ? -HUGE_VAL : ((ty1 < ty2) ? ty1 : ty2);
+		double ty_far = on_y_edge ? HUGE_VAL : ((ty1 < ty2) ? ty2 : ty1);
+		double t_near = (tx_near > ty_near) ? tx_near : ty_near;
+		double t_far = (tx_far < ty_far) ? tx_far : ty_far;
+		double root = (t_near >= start) ? t_near : t_far;
+		short hit = (t_near <= t_far) & (root >= start) & (root < nearest[i]);
+
+		nearest[i] = hit ? root : nearest[i];
+	}
+}
+
+#ifdef __SSE2__
+/*-------------------------------------------------------------------------
+ * (function: lidar_select_2)
+ * if_set where mask is all ones, if_clear where it is 0.
+ *-----------------------------------------------------------------------*/
+inline __m128d lidar_select_2(__m128d mask, __m128d if_set, __m128d if_clear)
+{
+	return _mm_or_pd(_mm_and_pd(mask, if_set), _mm_andnot_pd(mask, if_clear));
+}
+#endif
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_save_LIDAR)
+ *-----------------------------------------------------------------------*/
+void sensor_memory_save_LIDAR(void *memory, checkpoint_t *checkpoint)
+{
+	lidar_state_t* sensor_state = (lidar_state_t*)memory;
+	scan_sensor_t *sensor_reading = sensor_state->sensor_reading;
+
+	checkpoint_put(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	checkpoint_put(checkpoint, sensor_reading, sizeof(scan_sensor_t));
+	checkpoint_put(checkpoint, sensor_reading->in_m, sizeof(double) * sensor_reading->num_beams);
+	checkpoint_put(checkpoint, sensor_state->offset_cosine, sizeof(double) * sensor_reading->num_beams);
+	checkpoint_put(checkpoint, sensor_state->offset_sine, sizeof(double) * sensor_reading->num_beams);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: sensor_memory_load_LIDAR)
+ *-----------------------------------------------------------------------*/
+void* sensor_memory_load_LIDAR(checkpoint_t *checkpoint)
+{
+	lidar_state_t* sensor_state;
+	scan_sensor_t *sensor_reading;
+	int num_beams;
+
+	sensor_state = (lidar_state_t*)malloc(sizeof(lidar_state_t));
+	sensor_reading = (scan_sensor_t*)malloc(sizeof(scan_sensor_t));
+	sensor_state->sensor_reading = sensor_reading;
+	checkpoint_get(checkpoint, &sensor_state->sense_completed_in_s, sizeof(double));
+	checkpoint_get(checkpoint, sensor_reading, sizeof(scan_sensor_t));
+
+	num_beams = sensor_reading->num_beams;
+	sensor_reading->in_m = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->offset_cosine = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->offset_sine = (double*)malloc(sizeof(double) * num_beams);
+	checkpoint_get(checkpoint, sensor_reading->in_m, sizeof(double) * num_beams);
+	checkpoint_get(checkpoint, sensor_state->offset_cosine, sizeof(double) * num_beams);
+	checkpoint_get(checkpoint, sensor_state->offset_sine, sizeof(double) * num_beams);
+
+	sensor_state->direction_x = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->direction_y = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->nearest = (double*)malloc(sizeof(double) * num_beams);
+	sensor_state->candidates = NULL;
+	sensor_state->num_candidates = 0;
+	sensor_state->alloc_candidates = 0;
+	sensor_state->agent_self = NULL;
+	sensor_state->cached = FALSE;
+
+	return (void*)sensor_state;
+}
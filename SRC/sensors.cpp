@@ -32,20 +32,27 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "globals.h"
 #include "utils.h"
 
+#include "sensors.h"
 #include "control_sensors_actuators.h"
 #include "collision_detection.h"
-#include "log_file_xml.h"
+#include "agent_index.h"
+#include "bvh.h"
+#include "agent_store.h"
+#include "profile.h"
 
 /* globals */
-int num_sensor_names = 5; // number of strings below and in enum
+int num_sensor_names = 6; // number of strings below and in enum
 const char *sensor_names[] = { 
                                         "IDEAL_BEAM", 
                                         "ULTRASONIC",
                                         "ULTRASONIC_W_BAYESIAN",
-                                        "IR" 
-                                        "IR_W_BAYESIAN" 
+                                        "IR", 
+                                        "IR_W_BAYESIAN",
+                                        "LIDAR"
                                         };
-enum sensor_types {IDEAL_BEAM = 0, ULTRASONIC, ULTRASONIC_W_BAYESIAN, IR, IR_W_BAYESIAN, NO_SENSOR};
+enum sensor_types {IDEAL_BEAM = 0, ULTRASONIC, ULTRASONIC_W_BAYESIAN, IR, IR_W_BAYESIAN, LIDAR, NO_SENSOR};
+
+long long num_sensor_beams_cast = 0; // for benchmarks - every thread adds to it
 
 /*-------------------------------------------------------------------------
  * (function: run_sensor)
@@ -56,6 +63,8 @@ void* run_sensor(
 		double current_time
 	) 
 {
+	PROFILE_SCOPE(PROFILE_SENSOR);
+
 	/* call the control function of the current simulated robot */
 	return (*(sensor->fptr_sensor))(sensor, agent, current_time);	
 }
@@ -76,18 +85,35 @@ void setup_function_for_sensor(sensor_t *sensor, char *function_name)
                 /* PERMUTATION ENCODINGS */
                 case IDEAL_BEAM:
                         sensor->fptr_sensor = sensor_function_IDEAL_BEAM;
+			sensor->fptr_sensor_memory_save = sensor_memory_save_IDEAL_BEAM;
+			sensor->fptr_sensor_memory_load = sensor_memory_load_IDEAL_BEAM;
 			break;
                 case ULTRASONIC:
                         sensor->fptr_sensor = sensor_function_ULTRASONIC;
+			sensor->fptr_sensor_memory_save = sensor_memory_save_ULTRASONIC;
+			sensor->fptr_sensor_memory_load = sensor_memory_load_ULTRASONIC;
 			break;
                 case ULTRASONIC_W_BAYESIAN:
                         sensor->fptr_sensor = sensor_function_ULTRASONIC_W_BAYESIAN;
+			sensor->fptr_sensor_memory_save = sensor_memory_save_ULTRASONIC_W_BAYESIAN;
+			sensor->fptr_sensor_memory_load = sensor_memory_load_ULTRASONIC_W_BAYESIAN;
+			setup_bayesian_table_ULTRASONIC();
 			break;
                 case IR:
                         sensor->fptr_sensor = sensor_function_IR;
+			sensor->fptr_sensor_memory_save = sensor_memory_save_IR;
+			sensor->fptr_sensor_memory_load = sensor_memory_load_IR;
 			break;
                 case IR_W_BAYESIAN:
                         sensor->fptr_sensor = sensor_function_IR_W_BAYESIAN;
+			sensor->fptr_sensor_memory_save = sensor_memory_save_IR_W_BAYESIAN;
+			sensor->fptr_sensor_memory_load = sensor_memory_load_IR_W_BAYESIAN;
+			setup_bayesian_table_IR();
+			break;
+                case LIDAR:
+                        sensor->fptr_sensor = sensor_function_LIDAR;
+			sensor->fptr_sensor_memory_save = sensor_memory_save_LIDAR;
+			sensor->fptr_sensor_memory_load = sensor_memory_load_LIDAR;
 			break;
 		default:
 			printf("EXIT - Agent with no sensor algorithm\n");
@@ -96,14 +122,27 @@ void setup_function_for_sensor(sensor_t *sensor, char *function_name)
 	}
 }
 
+/* what a beam has hit so far while walking the agent index */
+typedef struct beam_hit_context_t_t beam_hit_context_t;
+struct beam_hit_context_t_t
+{
+	agent_t *agent_self;
+	line_segment_t *beam_segment;
+	sim_obj_t *closest_obj;
+	double min_distance;
+	vector_2D_t point_of_intersect;
+};
+
+double beam_hit_on_sim_object(int sim_object_idx, void *context);
+
 /*-------------------------------------------------------------------------
  * (function: find_closest_object_on_beam_projection )
+ * With a cache the hit of the last cast is used again if the agent has not
+ * moved and nothing in the cells around the beam has since.  The static
+ * objects never move.  NULL casts every time.
  *-----------------------------------------------------------------------*/
-beam_sensor_t* find_closest_object_on_beam_projection(beam_sensor_t **sensor_reading, agent_t *agent_self, double x, double y, double beam_distance, double angle_radians)
+beam_sensor_t* find_closest_object_on_beam_projection(beam_sensor_t **sensor_reading, agent_t *agent_self, double x, double y, double beam_distance, double angle_radians, beam_cache_t *cache)
 {
-	int i, j;
-	points_t *points_of_intersect;
-
 	vector_2D_t start_point;
 	start_point.x = x;
 	start_point.y = y;
@@ -116,147 +155,183 @@ beam_sensor_t* find_closest_object_on_beam_projection(beam_sensor_t **sensor_rea
 	beam_segment.point1 = start_point;
 	beam_segment.point2 = end_point;
 
-	circle_t *circle;
-	oriented_rectangle_t *rectangle;
-
 	//printf("sensor_beam line_segemnt -> x=%f y=%f to x1=%f y=%f\n", start_point.x, start_point.y, end_point.x, end_point.y);
 
-	vector_2D_t point_of_intersect;
-	sim_obj_t *closest_obj = NULL;
-	double min_distance = 2*beam_distance;
-
-	for (i = 0; i < num_sim_objects; i++)
+	if (cache != NULL && cache->valid == TRUE && cache->pose_version == agent_store.pose_version[agent_self->agent_idx])
 	{
-		circle = NULL;
-		rectangle = NULL;
+		rectangle_t beam_box;
 
-		sim_obj_t *potential_closest = sim_objects[i];
-		double min_distance_pot = 0;
+		beam_box.origin.x = minimum(start_point.x, end_point.x);
+		beam_box.origin.y = minimum(start_point.y, end_point.y);
+		beam_box.size.x = fabs(end_point.x - start_point.x);
+		beam_box.size.y = fabs(end_point.y - start_point.y);
 
-		if (sim_objects[i]->type == OBJECT)
+		if (agent_index_unchanged_since(&beam_box, cache->index_version) == TRUE)
 		{
-			if (sim_objects[i]->object->type == CIRCLE)
+			if (cache->hit == TRUE)
 			{
-				circle = sim_objects[i]->object->circle;
+				sensor_reading[0]->in_m = cache->hit_log.distance;
+				queue_beam_hit_log(agent_self, &cache->hit_log.sensor_beam, &cache->hit_log.point_intersect, cache->hit_log.distance);
 			}
-			else if (sim_objects[i]->object->type == RECTANGLE)
+			else
 			{
-				rectangle = sim_objects[i]->object->rectangle;
+				sensor_reading[0]->in_m = -1;
 			}
+			sensor_reading[0]->angle_phi = 0.0;
+
+			return sensor_reading[0];
 		}
-		else if (sim_objects[i]->type == AGENT)
+	}
+
+	beam_hit_context_t hit;
+	hit.agent_self = agent_self;
+	hit.beam_segment = &beam_segment;
+	hit.closest_obj = NULL;
+	hit.min_distance = 2*beam_distance;
+
+	__atomic_fetch_add(&num_sensor_beams_cast, 1, __ATOMIC_RELAXED);
+
+	/* static objects first, then only agents in the cells the beam crosses up to that hit */
+	bvh_raycast(&sim_bvh, &beam_segment, beam_hit_on_sim_object, (void*)&hit);
+	if (hit.closest_obj != NULL)
+	{
+		line_segment_t short_segment;
+		short_segment.point1 = start_point;
+		short_segment.point2.x = x + cos(angle_radians) * hit.min_distance;
+		short_segment.point2.y = y + sin(angle_radians) * hit.min_distance;
+		agent_index_raycast(&short_segment, beam_hit_on_sim_object, (void*)&hit);
+	}
+	else
+	{
+		agent_index_raycast(&beam_segment, beam_hit_on_sim_object, (void*)&hit);
+	}
+
+	if (hit.closest_obj != NULL)
+	{
+		sensor_reading[0]->in_m = hit.min_distance;
+		sensor_reading[0]->angle_phi = 0.0;
+		/* output sensor hit to log file when the epoch is committed */
+		queue_beam_hit_log(agent_self, &beam_segment, &hit.point_of_intersect, hit.min_distance);
+	}
+	else
+	{
+		sensor_reading[0]->in_m = -1;
+		sensor_reading[0]->angle_phi = 0.0;
+	}
+
+	if (cache != NULL)
+	{
+		cache->valid = TRUE;
+		cache->pose_version = agent_store.pose_version[agent_self->agent_idx];
+		cache->index_version = agent_index_version();
+		cache->hit = (hit.closest_obj != NULL) ? TRUE : FALSE;
+		if (cache->hit == TRUE)
 		{
-			if (sim_objects[i]->agent == agent_self || sim_objects[i]->agent->not_physical_agent == TRUE)
-				continue;
-			else 
-			{
-				/* assume robots only spheres */
-				oassert(sim_objects[i]->agent->agent_group->shape->type == CIRCLE);
-				circle = sim_objects[i]->agent->circle;
-			}
+			cache->hit_log.sensor_beam = beam_segment;
+			cache->hit_log.point_intersect = hit.point_of_intersect;
+			cache->hit_log.distance = hit.min_distance;
 		}
+	}
 
-		if (circle != NULL)
-		{
-			points_of_intersect = segment_intersects_circle_at(&beam_segment, circle); 
+	return sensor_reading[0];
+}
 
-			if (points_of_intersect == NULL)
-			{
-				printf("NO BEAM HIT on CIRCLE (%f, %f, %f)\n", circle->center.x, circle->center.y, circle->radius);
-			}
-			else
-			{
+/*-------------------------------------------------------------------------
+ * (function: beam_hit_on_sim_object)
+ * Intersects the beam with one sim object and keeps it if it is the
+ * closest so far.
+ *
+ * returns distance to the nearest intersection or -1 if missed
+ *-----------------------------------------------------------------------*/
+double beam_hit_on_sim_object(int sim_object_idx, void *context)
+{
+	int j;
+	beam_hit_context_t *hit = (beam_hit_context_t*)context;
+	segment_hits_t hits;
+	circle_t *circle = NULL;
+	circle_t agent_circle;
+	oriented_rectangle_t *rectangle = NULL;
+	vector_2D_t *start_point = &hit->beam_segment->point1;
+	sim_obj_t *potential_closest = sim_objects[sim_object_idx];
+	vector_2D_t *nearest_point = NULL;
+	double nearest_distance = -1;
 
-				printf("BEAM HIT CIRCLE(%f, %f, %f)\n", circle->center.x, circle->center.y, circle->radius);
-				for (j = 0; j < points_of_intersect->num_points; j++)
-				{
-					printf("	POINT %d -> x=%f y=%f\n", j, points_of_intersect->points[j]->x, points_of_intersect->points[j]->y);
-				}
+	hits.num_points = 0;
 
-			}
+	if (potential_closest->type == OBJECT)
+	{
+		if (potential_closest->object->type == CIRCLE)
+		{
+			circle = potential_closest->object->circle;
 		}
-		else if (rectangle != NULL)
+		else if (potential_closest->object->type == RECTANGLE)
 		{
-			points_of_intersect = segment_intersects_oriented_rectangle_at(&beam_segment, rectangle);
+			rectangle = potential_closest->object->rectangle;
+		}
+	}
+	else if (potential_closest->type == AGENT)
+	{
+		if (potential_closest->agent == hit->agent_self || agent_store.not_physical[potential_closest->agent->agent_idx] == TRUE)
+			return -1;
+		else 
+		{
+			/* assume robots only spheres */
+			oassert(potential_closest->agent->agent_group->shape->type == CIRCLE);
+			agent_circle = agent_store_circle(&agent_store, potential_closest->agent->agent_idx);
+			circle = &agent_circle;
+		}
+	}
 
-			vector_2D_t a;
-			vector_2D_t b;
-			vector_2D_t c;
-			vector_2D_t d;
-			oriented_rectangle_to_points(&a, &b, &c, &d, rectangle);
+	if (circle != NULL)
+	{
+		hits = segment_intersects_circle_hits(hit->beam_segment, circle);
+	}
+	else if (rectangle != NULL)
+	{
+		hits = segment_intersects_oriented_rectangle_hits(hit->beam_segment, rectangle);
+	}
 
-			if (points_of_intersect == NULL)
-			{
-				printf("NO BEAM HIT on RECTANGLE ((%f,%f), (%f,%f), (%f,%f), (%f,%f))\n", a.x, a.y, b.x, b.y, c.x, c.y, d.x, d.y);
-			}
-			else
-			{
-				printf("BEAM HIT on RECTANGLE ((%f,%f), (%f,%f), (%f,%f), (%f,%f))\n", a.x, a.y, b.x, b.y, c.x, c.y, d.x, d.y);
-				for (j = 0; j < points_of_intersect->num_points; j++)
-				{
-					printf("	POINT %d -> x=%f y=%f\n", j, points_of_intersect->points[j]->x, points_of_intersect->points[j]->y);
-				}
-			}
-		}
+	/* see if this point is closer than previous ones */
+	for (j = 0; j < hits.num_points; j++)
+	{
+		double distance = two_points_distance(&hits.points[j], start_point);
 
-		if (points_of_intersect != NULL)
+		if (nearest_point == NULL || distance < nearest_distance)
 		{
-			/* see if this point is closer than previous ones */
-			if (points_of_intersect->num_points == 2)
-			{
-				double d0 = two_points_distance(points_of_intersect->points[0], &start_point);
-				double d1 = two_points_distance(points_of_intersect->points[1], &start_point);
-	
-				if (d0 < min_distance && d0 < d1)
-				{
-					min_distance = d0;
-					closest_obj = potential_closest;
-					point_of_intersect.x = points_of_intersect->points[0]->x;
-					point_of_intersect.y = points_of_intersect->points[0]->y;
-				}
-				else if (d1 < min_distance)
-				{
-					min_distance = d1;
-					closest_obj = potential_closest;
-					point_of_intersect.x = points_of_intersect->points[1]->x;
-					point_of_intersect.y = points_of_intersect->points[1]->y;
-				}
-	
-				free (points_of_intersect->points[0]);
-				free (points_of_intersect->points[1]);
-				free (points_of_intersect->points);
-				free (points_of_intersect);
-			}
-			else if (points_of_intersect->num_points == 1)
-			{
-				double d0 = two_points_distance(points_of_intersect->points[0], &start_point);
-	
-				if (d0 < min_distance)
-				{
-					min_distance = d0;
-					closest_obj = potential_closest;
-					point_of_intersect.x = points_of_intersect->points[0]->x;
-					point_of_intersect.y = points_of_intersect->points[0]->y;
-				}
-	
-				free (points_of_intersect->points[0]);
-				free (points_of_intersect->points);
-				free (points_of_intersect);
-			}
+			nearest_distance = distance;
+			nearest_point = &hits.points[j];
 		}
 	}
 
-	if (closest_obj != NULL)
+	if (nearest_point != NULL && nearest_distance < hit->min_distance)
 	{
-		sensor_reading[0]->in_m = min_distance;
-		sensor_reading[0]->angle_phi = 0.0;
-		/* output sensor hit to log file */
-		sim_system.output_log_tab_step = output_log_file_xml_time_step_sensor_beam_hit(sim_system.output_log_tab_step, &beam_segment, &point_of_intersect, min_distance);
+		hit->min_distance = nearest_distance;
+		hit->closest_obj = potential_closest;
+		hit->point_of_intersect.x = nearest_point->x;
+		hit->point_of_intersect.y = nearest_point->y;
 	}
-	else
+
+	return nearest_distance;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: queue_beam_hit_log)
+ * Agents sense in parallel so each keeps its own hits until the commit
+ * writes them to the log in agent order.
+ *-----------------------------------------------------------------------*/
+void queue_beam_hit_log(agent_t *agent, line_segment_t *sensor_beam, vector_2D_t *point_intersect, double distance)
+{
+	beam_hit_log_t *hit_log;
+
+	if (agent->num_beam_hit_logs == agent->alloc_beam_hit_logs)
 	{
-		sensor_reading[0]->in_m = -1;
-		sensor_reading[0]->angle_phi = 0.0;
+		agent->alloc_beam_hit_logs = (agent->alloc_beam_hit_logs == 0) ? 4 : agent->alloc_beam_hit_logs * 2;
+		agent->beam_hit_logs = (beam_hit_log_t*)realloc(agent->beam_hit_logs, sizeof(beam_hit_log_t) * agent->alloc_beam_hit_logs);
 	}
 
+	hit_log = &agent->beam_hit_logs[agent->num_beam_hit_logs];
+	hit_log->sensor_beam = *sensor_beam;
+	hit_log->point_intersect = *point_intersect;
+	hit_log->distance = distance;
+	agent->num_beam_hit_logs ++;
 }
@@ -30,13 +30,16 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "types.h"
 #include "control_sensors_actuators.h"
 
+extern long long num_sensor_beams_cast;
+
 void* run_sensor(
 		sensor_t *sensor,
 		agent_t *agent,
 		double current_time
 	);
 void setup_function_for_sensor(sensor_t *sensor, char *function_name);
-beam_sensor_t* find_closest_object_on_beam_projection(beam_sensor_t **sensor_reading, agent_t *agent_self, double x, double y, double beam_distance, double angle_radians);
+beam_sensor_t* find_closest_object_on_beam_projection(beam_sensor_t **sensor_reading, agent_t *agent_self, double x, double y, double beam_distance, double angle_radians, beam_cache_t *cache);
+void queue_beam_hit_log(agent_t *agent, line_segment_t *sensor_beam, vector_2D_t *point_intersect, double distance);
 
 #endif
 
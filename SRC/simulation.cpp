@@ -26,16 +26,51 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 #include "types.h"
 #include "globals.h"
 #include "utils.h"
+#include "simulation.h"
 #include "robot_control.h"
-#include "log_file_xml.h"
+#include "log_file.h"
+#include "agent_index.h"
+#include "bvh.h"
+#include "agent_store.h"
+#include "thread_pool.h"
+#include "event_queue.h"
+#include "crash_check.h"
+#include "actuators.h"
+#include "profile.h"
+#include "rng.h"
+#include "checkpoint.h"
+#include "batch.h"
 
 /* globals */
 sim_obj_t **sim_objects;
 int num_sim_objects;
+spatial_grid_t sim_grid;
+loose_quadtree_t sim_quadtree;
+bvh_t sim_bvh;
+
+/* what the threads of one epoch of the event simulation work on */
+typedef struct event_epoch_t_t event_epoch_t;
+struct event_epoch_t_t
+{
+	double current_time;
+	double *epoch_times; // time of every epoch so far
+	int to_epoch; // catch agents up to here
+	int *synced_epoch; // per agent the last epoch its actuators have been run for
+	int *woken;
+	int num_woken;
+};
+
+void run_agent_control_range(int first_agent, int last_agent, void *context);
+void commit_agent_moves();
+void run_woken_agent_control_range(int first_woken, int last_woken, void *context);
+void catch_up_agent_range(int first_agent, int last_agent, void *context);
+void event_simulation_checkpoint_save(checkpoint_t *checkpoint, double current_time, int epoch, event_epoch_t *event_epoch, event_queue_t *queue);
+void event_simulation_checkpoint_load(checkpoint_t *checkpoint, double *current_time, int *epoch, int *alloc_epochs, event_epoch_t *event_epoch, event_queue_t *queue);
 
 /*-------------------------------------------------------------------------
  * (function: setup_simulation)
@@ -80,19 +115,41 @@ void setup_simulation()
 		{
 			sim_objects[sim_object_idx]->type = AGENT;
 			sim_objects[sim_object_idx]->agent = agent_groups.agent_group[i]->agents[j];
+			agent_groups.agent_group[i]->agents[j]->sim_object_idx = sim_object_idx;
+			/* the store is filled in the same order */
+			oassert(sim_object_idx == environment.num_objects + agent_groups.agent_group[i]->agents[j]->agent_idx);
 
 			sim_object_idx ++;
 		}
 	}
+
+	/* next pose and noise of each agent */
+	agent_store_start(&agent_store, sim_system.rand_seed);
+	rng_setup();
+	/* one loop per group with its control, sensor and actuator built in */
+	setup_group_kernels();
+
+	/* the objects never move so their hierarchy is built once */
+	bvh_build(&sim_bvh, environment.objects, environment.num_objects);
+	/* index the agents so sensors only look at what is near the beam */
+	agent_index_build();
 }
 /*-------------------------------------------------------------------------
  * (function: simulation_loop)
  *-----------------------------------------------------------------------*/
-void simulation_loop() 
+void simulation_loop(checkpoint_t *resume) 
 {
-	int i;
 	double current_time = 0;
 	short exit = FALSE;
+	checkpoint_t *checkpoint;
+
+	/* carry on from the end of the epoch the checkpoint was taken at */
+	if (resume != NULL)
+	{
+		checkpoint_load_simulation(resume, &current_time, FALSE);
+		checkpoint_close(resume);
+	}
+	checkpoint_start(current_time);
 
 	while (exit == FALSE)
 	{
@@ -100,44 +157,358 @@ void simulation_loop()
 		current_time += environment.sim_time_computation_epoch_s;
 
 		/* start logging in file */
-		sim_system.output_log_tab_step = output_log_file_xml_time_step_start(sim_system.output_log_tab_step, current_time);
+		output_log_time_step_start(current_time);
+
+		/* sense and decide in parallel - agents see the world as it was at the end of the last epoch and only change their own next pose */
+		run_agent_controls(current_time);
 
-		/* do processing of objects */
-		for (i = 0; i < num_sim_objects; i++)
+		/* update world */
+		commit_epoch();
+
+		/* check for crashes - on the new poses */
+		check_for_crashes(current_time);
+
+		output_log_time_step_stop();
+		PROFILE_EPOCH_DONE();
+
+		/* check for exit */
+		if (environment.sim_time_s < current_time)
 		{
-			if (sim_objects[i]->type == OBJECT)
-			{
-				continue;
-			}
-			else if (sim_objects[i]->type == AGENT)
-			{
-				run_agent_control(sim_objects[i]->agent, current_time);
-			}
+			printf("Simulation done at time: %f\n", current_time);
+			exit = TRUE;
+		}
+		else if (checkpoint_due(current_time) == TRUE)
+		{
+			checkpoint = checkpoint_open_write(sim_system.checkpoint_file_out);
+			checkpoint_save_simulation(checkpoint, current_time, FALSE);
+			checkpoint_close(checkpoint);
 		}
 
-		/* check for crashes */
+		/* a run_branches prefix forks its branches here and stops */
+		if (exit == FALSE && batch_branch_due(current_time) == TRUE && batch_branch_point(current_time) == TRUE)
+			exit = TRUE;
+	}
+}
+	
 
-		/* update world */
-		for (i = 0; i < num_sim_objects; i++)
+/*-------------------------------------------------------------------------
+ * (function: run_agent_controls)
+ * One epoch of control for every agent on the thread pool.
+ *-----------------------------------------------------------------------*/
+void run_agent_controls(double current_time)
+{
+	thread_pool_run(agent_store.num_agents, run_agent_control_range, (void*)&current_time);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: run_agent_control_range)
+ * Runs the control of agents first_agent to last_agent-1 for one epoch.
+ *-----------------------------------------------------------------------*/
+void run_agent_control_range(int first_agent, int last_agent, void *context)
+{
+	int i;
+	int group_last;
+	double current_time = *(double*)context;
+	agent_group_t *agent_group;
+
+	/* the range can cross groups - each piece goes to its group's batch control or runs per agent */
+	i = first_agent;
+	while (i < last_agent)
+	{
+		agent_group = agent_store.agents[i]->agent_group;
+		group_last = agent_group->first_agent_idx + agent_group->num_agents;
+		if (group_last > last_agent)
+			group_last = last_agent;
+
+		if (agent_group->fptr_control_algorithm_batch != NULL)
 		{
-			if (sim_objects[i]->type == OBJECT)
+			(*(agent_group->fptr_control_algorithm_batch))(agent_group, i, group_last, current_time);
+			i = group_last;
+		}
+		else
+		{
+			for (; i < group_last; i++)
 			{
-				continue;
+				run_agent_control(agent_store.agents[i], current_time);
 			}
-			else if (sim_objects[i]->type == AGENT && sim_objects[i]->agent->not_physical_agent == FALSE)
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: commit_epoch)
+ * Applies the moves of the epoch and logs it.  This is done by one thread
+ * in agent order so the log does not depend on the number of threads.
+ *-----------------------------------------------------------------------*/
+void commit_epoch()
+{
+	int i, j;
+	PROFILE_SCOPE(PROFILE_COMMIT);
+
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		agent_t *agent = agent_store.agents[i];
+
+		for (j = 0; j < agent->num_beam_hit_logs; j++)
+		{
+			output_log_time_step_sensor_beam_hit(&agent->beam_hit_logs[j].sensor_beam, &agent->beam_hit_logs[j].point_intersect, agent->beam_hit_logs[j].distance);
+		}
+		agent->num_beam_hit_logs = 0;
+	}
+
+	commit_agent_moves();
+
+	/* agents are after the objects in sim_objects which is the id in the log */
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		if (agent_store.not_physical[i] == FALSE)
+		{
+			output_log_time_step_agent(environment.num_objects + i, agent_store.x[i], agent_store.y[i], agent_store.angle[i]);
+//			fprintf(sim_system.Fsim_log_out, "time:%f - %d - x:%f, y:%f, angle:%f, angle_d:%f\n", current_time, i, agent_store.x[i], agent_store.y[i], agent_store.angle[i], agent_store.angle[i] * (180.0 / PI));
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: commit_agent_moves)
+ *-----------------------------------------------------------------------*/
+void commit_agent_moves()
+{
+	int i;
+
+	/* sensor reads cached before these moves see them as newer */
+	agent_index_next_version();
+
+	for (i = 0; i < agent_store.num_agents; i++)
+	{
+		if (agent_store_commit(&agent_store, i) == TRUE)
+			agent_index_update_object(agent_store.agents[i]->sim_object_idx);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_simulation_loop)
+ * Same epochs as simulation_loop() but the control of an agent only runs
+ * at the first epoch after the wake time its sensors, actuators and
+ * control asked for (see schedule_agent_wake).  Agents that are moving in
+ * between have just their actuators stepped through the skipped epochs so
+ * poses come out as in the discrete simulation - that is still per agent
+ * per epoch work for every moving agent.  Only the epochs where some agent
+ * wakes are logged and crash checked, so a contact in between is found
+ * late.
+ *-----------------------------------------------------------------------*/
+void event_simulation_loop(checkpoint_t *resume)
+{
+	int i;
+	int epoch = 0;
+	int alloc_epochs = 1024;
+	int num_woken;
+	double current_time = 0;
+	double next_wake;
+	short last_epoch = FALSE;
+	event_queue_t queue = {0, 0, NULL, NULL};
+	event_epoch_t event_epoch;
+	checkpoint_t *checkpoint;
+
+	event_epoch.epoch_times = (double*)malloc(sizeof(double) * alloc_epochs);
+	event_epoch.epoch_times[0] = 0;
+	event_epoch.synced_epoch = (int*)calloc(agent_store.num_agents, sizeof(int));
+	event_epoch.woken = (int*)malloc(sizeof(int) * agent_store.num_agents);
+
+	if (resume != NULL)
+	{
+		/* carry on with the queue and epochs as they were at the checkpoint */
+		event_simulation_checkpoint_load(resume, &current_time, &epoch, &alloc_epochs, &event_epoch, &queue);
+		checkpoint_close(resume);
+	}
+	else
+	{
+		/* everyone runs at the first epoch */
+		for (i = 0; i < agent_store.num_agents; i++)
+		{
+			event_queue_push(&queue, 0, i);
+		}
+	}
+	checkpoint_start(current_time);
+
+	while (last_epoch == FALSE)
+	{
+		/* skip to the first epoch after the next wake - time is added up the same way as the discrete loop */
+		next_wake = event_queue_next_time(&queue);
+		do
+		{
+			current_time += environment.sim_time_computation_epoch_s;
+			epoch ++;
+			if (epoch == alloc_epochs)
 			{
-				sim_system.output_log_tab_step = output_log_file_xml_time_step_agent(sim_system.output_log_tab_step, i, sim_objects[i]->agent->circle->center.x, sim_objects[i]->agent->circle->center.y, sim_objects[i]->agent->angle);
-//				fprintf(sim_system.Fsim_log_out, "time:%f - %d - x:%f, y:%f, angle:%f, angle_d:%f\n", current_time, i, sim_objects[i]->agent->circle->center.x, sim_objects[i]->agent->circle->center.y, sim_objects[i]->agent->angle, sim_objects[i]->agent->angle * (180.0 / PI));
+				alloc_epochs *= 2;
+				event_epoch.epoch_times = (double*)realloc(event_epoch.epoch_times, sizeof(double) * alloc_epochs);
 			}
+			event_epoch.epoch_times[epoch] = current_time;
+
+			if (environment.sim_time_s < current_time)
+				last_epoch = TRUE;
+		} while (current_time <= next_wake && last_epoch == FALSE);
+
+		/* sensors see everyone where they were at the end of the last epoch */
+		event_epoch.to_epoch = epoch - 1;
+		thread_pool_run(agent_store.num_agents, catch_up_agent_range, (void*)&event_epoch);
+		commit_agent_moves();
+
+		num_woken = 0;
+		while (event_queue_next_time(&queue) < current_time)
+		{
+			i = event_queue_pop(&queue);
+			agent_store.agents[i]->wake_time = HUGE_VAL;
+			event_epoch.woken[num_woken++] = i;
 		}
-		sim_system.output_log_tab_step = output_log_file_xml_time_step_stop(sim_system.output_log_tab_step);
 
-		/* check for exit */
-		if (environment.sim_time_s < current_time)
+		event_epoch.num_woken = num_woken;
+		event_epoch.current_time = current_time;
+		thread_pool_run(num_woken, run_woken_agent_control_range, (void*)&event_epoch);
+
+		for (i = 0; i < num_woken; i++)
 		{
-			printf("Simulation done at time: %f\n", current_time);
-			exit = TRUE;
+			agent_t *agent = agent_store.agents[event_epoch.woken[i]];
+
+			event_epoch.synced_epoch[event_epoch.woken[i]] = epoch;
+			/* nothing asked for means it can not tell so run it again next epoch */
+			if (agent->wake_time == HUGE_VAL)
+				agent->wake_time = current_time;
+			event_queue_push(&queue, agent->wake_time, event_epoch.woken[i]);
+		}
+
+		/* the rest move through this epoch too so the log has everyone where they are */
+		event_epoch.to_epoch = epoch;
+		thread_pool_run(agent_store.num_agents, catch_up_agent_range, (void*)&event_epoch);
+
+		output_log_time_step_start(current_time);
+		commit_epoch();
+		/* only where someone woke - contacts in the epochs between show up at the next one */
+		check_for_crashes(current_time);
+		output_log_time_step_stop();
+		PROFILE_EPOCH_DONE();
+
+		if (last_epoch == FALSE && checkpoint_due(current_time) == TRUE)
+		{
+			checkpoint = checkpoint_open_write(sim_system.checkpoint_file_out);
+			event_simulation_checkpoint_save(checkpoint, current_time, epoch, &event_epoch, &queue);
+			checkpoint_close(checkpoint);
 		}
+
+		/* a run_branches prefix forks its branches here and stops */
+		if (last_epoch == FALSE && batch_branch_due(current_time) == TRUE && batch_branch_point(current_time) == TRUE)
+			last_epoch = TRUE;
+	}
+
+	printf("Simulation done at time: %f\n", current_time);
+
+	event_queue_free(&queue);
+	free(event_epoch.epoch_times);
+	free(event_epoch.synced_epoch);
+	free(event_epoch.woken);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_simulation_checkpoint_save)
+ * The event loop also needs its queue and how far each agent's actuators
+ * have been stepped, with the times of the epochs they will catch up on.
+ *-----------------------------------------------------------------------*/
+void event_simulation_checkpoint_save(checkpoint_t *checkpoint, double current_time, int epoch, event_epoch_t *event_epoch, event_queue_t *queue)
+{
+	checkpoint_save_simulation(checkpoint, current_time, TRUE);
+
+	checkpoint_put(checkpoint, &epoch, sizeof(int));
+	checkpoint_put(checkpoint, event_epoch->epoch_times, sizeof(double) * (epoch + 1));
+	checkpoint_put(checkpoint, event_epoch->synced_epoch, sizeof(int) * agent_store.num_agents);
+	event_queue_checkpoint_save(queue, checkpoint);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: event_simulation_checkpoint_load)
+ *-----------------------------------------------------------------------*/
+void event_simulation_checkpoint_load(checkpoint_t *checkpoint, double *current_time, int *epoch, int *alloc_epochs, event_epoch_t *event_epoch, event_queue_t *queue)
+{
+	checkpoint_load_simulation(checkpoint, current_time, TRUE);
+
+	checkpoint_get(checkpoint, epoch, sizeof(int));
+	while (*epoch >= *alloc_epochs)
+	{
+		*alloc_epochs *= 2;
+	}
+	event_epoch->epoch_times = (double*)realloc(event_epoch->epoch_times, sizeof(double) * (*alloc_epochs));
+	checkpoint_get(checkpoint, event_epoch->epoch_times, sizeof(double) * (*epoch + 1));
+	checkpoint_get(checkpoint, event_epoch->synced_epoch, sizeof(int) * agent_store.num_agents);
+	event_queue_checkpoint_load(queue, checkpoint);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: run_woken_agent_control_range)
+ * Woken agents next to each other in the same group with a batch control
+ * are run as one batch.
+ *-----------------------------------------------------------------------*/
+void run_woken_agent_control_range(int first_woken, int last_woken, void *context)
+{
+	int i, j;
+	int agent_idx;
+	event_epoch_t *event_epoch = (event_epoch_t*)context;
+	agent_group_t *agent_group;
+
+	i = first_woken;
+	while (i < last_woken)
+	{
+		agent_idx = event_epoch->woken[i];
+		agent_group = agent_store.agents[agent_idx]->agent_group;
+
+		if (agent_group->fptr_control_algorithm_batch != NULL)
+		{
+			/* woken is in agent order so the run ends at a gap or the end of the group */
+			for (j = i + 1; j < last_woken && event_epoch->woken[j] == agent_idx + (j - i) && event_epoch->woken[j] < agent_group->first_agent_idx + agent_group->num_agents; j++);
+
+			(*(agent_group->fptr_control_algorithm_batch))(agent_group, agent_idx, agent_idx + (j - i), event_epoch->current_time);
+			i = j;
+		}
+		else
+		{
+			run_agent_control(agent_store.agents[agent_idx], event_epoch->current_time);
+			i++;
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: catch_up_agent_range)
+ * Steps the actuators of each agent through the epochs since it was last
+ * synced with no new instruction, which is what the control would have
+ * given them.  Agents that stopped moving are skipped.
+ *-----------------------------------------------------------------------*/
+void catch_up_agent_range(int first_agent, int last_agent, void *context)
+{
+	int i, j, k;
+	event_epoch_t *event_epoch = (event_epoch_t*)context;
+	act_inputs_t no_instruction;
+
+	no_instruction.left = 0;
+	no_instruction.right = 0;
+	no_instruction.time_in_s = 0;
+	no_instruction.new_instruction = FALSE;
+
+	for (i = first_agent; i < last_agent; i++)
+	{
+		agent_t *agent = agent_store.agents[i];
+
+		for (j = event_epoch->synced_epoch[i] + 1; j <= event_epoch->to_epoch; j++)
+		{
+			if (event_epoch->epoch_times[j] >= agent->moving_until_time)
+				break;
+
+			for (k = 0; k < agent->agent_group->num_actuators; k++)
+			{
+				run_actuator(agent->agent_group->actuators[k], agent, &no_instruction, event_epoch->epoch_times[j]);
+			}
+		}
+
+		if (event_epoch->synced_epoch[i] < event_epoch->to_epoch)
+			event_epoch->synced_epoch[i] = event_epoch->to_epoch;
 	}
 }
-	
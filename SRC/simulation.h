@@ -30,7 +30,11 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include "types.h"
 
 extern void setup_simulation() ;
-extern void simulation_loop() ;
+extern void simulation_loop(checkpoint_t *resume) ;
+extern void event_simulation_loop(checkpoint_t *resume) ;
+/* the phases of one epoch of simulation_loop */
+extern void run_agent_controls(double current_time) ;
+extern void commit_epoch() ;
 
 #endif
 
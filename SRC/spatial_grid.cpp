@@ -0,0 +1,584 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "spatial_grid.h"
+#include "collision_detection.h"
+#include "agent_store.h"
+#include "checkpoint.h"
+
+/* globals */
+
+/* used when the config does not give a sim_grid_size_in_m */
+#define DEFAULT_GRID_CELL_SIZE_IN_M 0.1
+/* big arenas with small cells get coarser cells instead of running out of memory */
+#define MAX_GRID_CELLS 4194304
+
+/* stamps so an object in many cells is only tested once per query - one set per thread */
+thread_local unsigned int *grid_query_stamp = NULL;
+thread_local int grid_num_query_stamps = 0;
+thread_local unsigned int grid_current_stamp = 0;
+
+short sim_object_bounding_box(int sim_object_idx, rectangle_t *box);
+void start_query_stamp(spatial_grid_t *grid);
+void cells_of_box(spatial_grid_t *grid, rectangle_t *box, int *min_x, int *min_y, int *max_x, int *max_y);
+void mark_cells_moved(spatial_grid_t *grid, int min_x, int min_y, int max_x, int max_y);
+int clamp_cell(int cell, int num_cells);
+void cell_add_id(grid_cell_t *cell, int id);
+void cell_remove_id(grid_cell_t *cell, int id);
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_build)
+ * Buckets every agent into the cells its bounding box touches.  Agents
+ * outside the environment end up in the edge cells.  The static objects
+ * are not in the grid, they live in the BVH (see bvh.cpp).
+ *-----------------------------------------------------------------------*/
+void spatial_grid_build(spatial_grid_t *grid, double cell_size_in_m, double size_x_in_m, double size_y_in_m)
+{
+	int i;
+
+	if (cell_size_in_m <= 0)
+		cell_size_in_m = DEFAULT_GRID_CELL_SIZE_IN_M;
+
+	grid->cell_size_in_m = cell_size_in_m;
+	grid->num_cells_x = (int)ceil(size_x_in_m / grid->cell_size_in_m);
+	grid->num_cells_y = (int)ceil(size_y_in_m / grid->cell_size_in_m);
+	while ((double)grid->num_cells_x * (double)grid->num_cells_y > MAX_GRID_CELLS)
+	{
+		grid->cell_size_in_m *= 2;
+		grid->num_cells_x = (int)ceil(size_x_in_m / grid->cell_size_in_m);
+		grid->num_cells_y = (int)ceil(size_y_in_m / grid->cell_size_in_m);
+	}
+	if (grid->num_cells_x < 1)
+		grid->num_cells_x = 1;
+	if (grid->num_cells_y < 1)
+		grid->num_cells_y = 1;
+
+	grid->cells = (grid_cell_t*)calloc(grid->num_cells_x * grid->num_cells_y, sizeof(grid_cell_t));
+
+	grid->num_objects = num_sim_objects;
+	grid->min_cell_x = (int*)malloc(sizeof(int) * num_sim_objects);
+	grid->min_cell_y = (int*)malloc(sizeof(int) * num_sim_objects);
+	grid->max_cell_x = (int*)malloc(sizeof(int) * num_sim_objects);
+	grid->max_cell_y = (int*)malloc(sizeof(int) * num_sim_objects);
+
+	for (i = 0; i < num_sim_objects; i++)
+	{
+		/* -1 marks not in the grid so update does a full insert */
+		grid->min_cell_x[i] = -1;
+		if (sim_objects[i]->type == AGENT)
+			spatial_grid_update_object(grid, i);
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_free)
+ *-----------------------------------------------------------------------*/
+void spatial_grid_free(spatial_grid_t *grid)
+{
+	int i;
+
+	if (grid->cells == NULL)
+		return;
+
+	for (i = 0; i < grid->num_cells_x * grid->num_cells_y; i++)
+	{
+		free(grid->cells[i].ids);
+	}
+	free(grid->cells);
+	free(grid->min_cell_x);
+	free(grid->min_cell_y);
+	free(grid->max_cell_x);
+	free(grid->max_cell_y);
+
+	grid->cells = NULL;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_thread_done)
+ * Frees the calling thread's query stamps - a pool worker calls this as
+ * it leaves.
+ *-----------------------------------------------------------------------*/
+void spatial_grid_thread_done()
+{
+	free(grid_query_stamp);
+
+	grid_query_stamp = NULL;
+	grid_num_query_stamps = 0;
+	grid_current_stamp = 0;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_update_object)
+ * Re-buckets an object after it moved.  Only the cells it left or entered
+ * are touched, and nothing is done if it is still in the same cells.  All
+ * of its old and new cells are marked as moved in the current version.
+ *-----------------------------------------------------------------------*/
+void spatial_grid_update_object(spatial_grid_t *grid, int sim_object_idx)
+{
+	int x, y;
+	int min_x, min_y, max_x, max_y;
+	int old_min_x, old_min_y, old_max_x, old_max_y;
+	short in_grid;
+	rectangle_t box;
+
+	if (grid->cells == NULL)
+		return;
+
+	in_grid = sim_object_bounding_box(sim_object_idx, &box);
+	if (in_grid == FALSE)
+		return;
+
+	cells_of_box(grid, &box, &min_x, &min_y, &max_x, &max_y);
+
+	old_min_x = grid->min_cell_x[sim_object_idx];
+	old_min_y = grid->min_cell_y[sim_object_idx];
+	old_max_x = grid->max_cell_x[sim_object_idx];
+	old_max_y = grid->max_cell_y[sim_object_idx];
+
+	if (old_min_x != -1)
+		mark_cells_moved(grid, old_min_x, old_min_y, old_max_x, old_max_y);
+	mark_cells_moved(grid, min_x, min_y, max_x, max_y);
+
+	if (old_min_x == min_x && old_min_y == min_y && old_max_x == max_x && old_max_y == max_y)
+		return;
+
+	if (old_min_x != -1)
+	{
+		/* leave the cells not covered anymore */
+		for (y = old_min_y; y <= old_max_y; y++)
+		{
+			for (x = old_min_x; x <= old_max_x; x++)
+			{
+				if (x < min_x || x > max_x || y < min_y || y > max_y)
+					cell_remove_id(&grid->cells[y * grid->num_cells_x + x], sim_object_idx);
+			}
+		}
+	}
+
+	/* enter the newly covered cells */
+	for (y = min_y; y <= max_y; y++)
+	{
+		for (x = min_x; x <= max_x; x++)
+		{
+			if (old_min_x == -1 || x < old_min_x || x > old_max_x || y < old_min_y || y > old_max_y)
+				cell_add_id(&grid->cells[y * grid->num_cells_x + x], sim_object_idx);
+		}
+	}
+
+	grid->min_cell_x[sim_object_idx] = min_x;
+	grid->min_cell_y[sim_object_idx] = min_y;
+	grid->max_cell_x[sim_object_idx] = max_x;
+	grid->max_cell_y[sim_object_idx] = max_y;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_next_version)
+ * Called before the agent moves of an epoch are committed so reads made
+ * before them can tell (see spatial_grid_unchanged_since).
+ *-----------------------------------------------------------------------*/
+void spatial_grid_next_version(spatial_grid_t *grid)
+{
+	grid->version ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_unchanged_since)
+ * returns TRUE if nothing in the cells the box touches has moved since
+ * the grid was at version.
+ *-----------------------------------------------------------------------*/
+short spatial_grid_unchanged_since(spatial_grid_t *grid, rectangle_t *box, unsigned int version)
+{
+	int x, y;
+	int min_x, min_y, max_x, max_y;
+
+	if (grid->cells == NULL)
+		return TRUE;
+
+	cells_of_box(grid, box, &min_x, &min_y, &max_x, &max_y);
+
+	for (y = min_y; y <= max_y; y++)
+	{
+		for (x = min_x; x <= max_x; x++)
+		{
+			if (grid->cells[y * grid->num_cells_x + x].moved_version > version)
+				return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_raycast)
+ * Walks the cells the beam crosses in order from point1 to point2 (DDA)
+ * calling fptr_hit once per object found.  fptr_hit returns the distance
+ * from point1 to the hit or -1 for a miss.  Stops as soon as the closest
+ * hit found so far is before where the beam leaves the current cell since
+ * no later cell can have anything closer.
+ *
+ * returns the closest distance or -1 if nothing hit
+ *-----------------------------------------------------------------------*/
+double spatial_grid_raycast(spatial_grid_t *grid, line_segment_t *beam, double (*fptr_hit)(int sim_object_idx, void *context), void *context)
+{
+	int i;
+	double cs = grid->cell_size_in_m;
+	double x1 = beam->point1.x;
+	double y1 = beam->point1.y;
+	double dx = beam->point2.x - beam->point1.x;
+	double dy = beam->point2.y - beam->point1.y;
+	double length = sqrt(dx*dx + dy*dy);
+	double closest = -1;
+
+	int cell_x = (int)floor(x1 / cs);
+	int cell_y = (int)floor(y1 / cs);
+	int end_cell_x = (int)floor(beam->point2.x / cs);
+	int end_cell_y = (int)floor(beam->point2.y / cs);
+	int step_x = (dx > 0) ? 1 : ((dx < 0) ? -1 : 0);
+	int step_y = (dy > 0) ? 1 : ((dy < 0) ? -1 : 0);
+
+	/* t is the fraction along the beam of the next x and y cell boundary */
+	double t_max_x = HUGE_VAL;
+	double t_max_y = HUGE_VAL;
+	double t_delta_x = HUGE_VAL;
+	double t_delta_y = HUGE_VAL;
+
+	if (step_x > 0)
+		t_max_x = ((cell_x + 1) * cs - x1) / dx;
+	else if (step_x < 0)
+		t_max_x = (cell_x * cs - x1) / dx;
+	if (step_y > 0)
+		t_max_y = ((cell_y + 1) * cs - y1) / dy;
+	else if (step_y < 0)
+		t_max_y = (cell_y * cs - y1) / dy;
+	if (step_x != 0)
+		t_delta_x = cs / fabs(dx);
+	if (step_y != 0)
+		t_delta_y = cs / fabs(dy);
+
+	/* new query so everything can be tested again */
+	start_query_stamp(grid);
+
+	while (TRUE)
+	{
+		grid_cell_t *cell = &grid->cells[clamp_cell(cell_y, grid->num_cells_y) * grid->num_cells_x + clamp_cell(cell_x, grid->num_cells_x)];
+		double t_exit = minimum(minimum(t_max_x, t_max_y), 1.0);
+
+		for (i = 0; i < cell->num_ids; i++)
+		{
+			int id = cell->ids[i];
+			double distance;
+
+			if (grid_query_stamp[id] == grid_current_stamp)
+				continue;
+			grid_query_stamp[id] = grid_current_stamp;
+
+			distance = (*fptr_hit)(id, context);
+			if (distance >= 0 && (closest < 0 || distance < closest))
+				closest = distance;
+		}
+
+		/* nothing in later cells can be closer */
+		if (closest >= 0 && closest <= t_exit * length)
+			break;
+		if ((cell_x == end_cell_x && cell_y == end_cell_y) || t_exit >= 1.0)
+			break;
+
+		if (t_max_x < t_max_y)
+		{
+			cell_x += step_x;
+			t_max_x += t_delta_x;
+		}
+		else
+		{
+			cell_y += step_y;
+			t_max_y += t_delta_y;
+		}
+	}
+
+	return closest;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_query_overlap)
+ * Calls fptr_found once for each object bucketed in a cell the box
+ * touches.  These are candidates - the caller does the exact test.
+ *-----------------------------------------------------------------------*/
+void spatial_grid_query_overlap(spatial_grid_t *grid, rectangle_t *box, void (*fptr_found)(int sim_object_idx, void *context), void *context)
+{
+	int i, x, y;
+	int min_x, min_y, max_x, max_y;
+
+	if (grid->cells == NULL)
+		return;
+
+	cells_of_box(grid, box, &min_x, &min_y, &max_x, &max_y);
+
+	start_query_stamp(grid);
+
+	for (y = min_y; y <= max_y; y++)
+	{
+		for (x = min_x; x <= max_x; x++)
+		{
+			grid_cell_t *cell = &grid->cells[y * grid->num_cells_x + x];
+
+			for (i = 0; i < cell->num_ids; i++)
+			{
+				int id = cell->ids[i];
+
+				if (grid_query_stamp[id] == grid_current_stamp)
+					continue;
+				grid_query_stamp[id] = grid_current_stamp;
+
+				(*fptr_found)(id, context);
+			}
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: start_query_stamp)
+ * New query so every object can be found again.
+ *-----------------------------------------------------------------------*/
+void start_query_stamp(spatial_grid_t *grid)
+{
+	if (grid_num_query_stamps < grid->num_objects)
+	{
+		grid_query_stamp = (unsigned int*)realloc(grid_query_stamp, sizeof(unsigned int) * grid->num_objects);
+		memset(grid_query_stamp, 0, sizeof(unsigned int) * grid->num_objects);
+		grid_num_query_stamps = grid->num_objects;
+		grid_current_stamp = 0;
+	}
+	grid_current_stamp ++;
+	if (grid_current_stamp == 0)
+	{
+		memset(grid_query_stamp, 0, sizeof(unsigned int) * grid_num_query_stamps);
+		grid_current_stamp = 1;
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: sim_object_bounding_box)
+ * returns FALSE for things that are not in the physical world
+ *-----------------------------------------------------------------------*/
+short sim_object_bounding_box(int sim_object_idx, rectangle_t *box)
+{
+	if (sim_objects[sim_object_idx]->type == OBJECT)
+	{
+		if (sim_objects[sim_object_idx]->object->type == CIRCLE)
+		{
+			*box = circle_rectangle_hull(sim_objects[sim_object_idx]->object->circle);
+			return TRUE;
+		}
+		else if (sim_objects[sim_object_idx]->object->type == RECTANGLE)
+		{
+			*box = oriented_rectangle_rectangle_hull(sim_objects[sim_object_idx]->object->rectangle);
+			return TRUE;
+		}
+	}
+	else if (sim_objects[sim_object_idx]->type == AGENT)
+	{
+		int agent_idx = sim_objects[sim_object_idx]->agent->agent_idx;
+
+		if (agent_store.not_physical[agent_idx] == FALSE)
+		{
+			circle_t c = agent_store_circle(&agent_store, agent_idx);
+			*box = circle_rectangle_hull(&c);
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: cells_of_box)
+ *-----------------------------------------------------------------------*/
+void cells_of_box(spatial_grid_t *grid, rectangle_t *box, int *min_x, int *min_y, int *max_x, int *max_y)
+{
+	*min_x = clamp_cell((int)floor(box->origin.x / grid->cell_size_in_m), grid->num_cells_x);
+	*min_y = clamp_cell((int)floor(box->origin.y / grid->cell_size_in_m), grid->num_cells_y);
+	*max_x = clamp_cell((int)floor((box->origin.x + box->size.x) / grid->cell_size_in_m), grid->num_cells_x);
+	*max_y = clamp_cell((int)floor((box->origin.y + box->size.y) / grid->cell_size_in_m), grid->num_cells_y);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: mark_cells_moved)
+ *-----------------------------------------------------------------------*/
+void mark_cells_moved(spatial_grid_t *grid, int min_x, int min_y, int max_x, int max_y)
+{
+	int x, y;
+
+	for (y = min_y; y <= max_y; y++)
+	{
+		for (x = min_x; x <= max_x; x++)
+		{
+			grid->cells[y * grid->num_cells_x + x].moved_version = grid->version;
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: clamp_cell)
+ *-----------------------------------------------------------------------*/
+int clamp_cell(int cell, int num_cells)
+{
+	return cell < 0 ? 0 : (cell >= num_cells ? num_cells - 1 : cell);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: cell_add_id)
+ *-----------------------------------------------------------------------*/
+void cell_add_id(grid_cell_t *cell, int id)
+{
+	if (cell->num_ids == cell->alloc_ids)
+	{
+		cell->alloc_ids = (cell->alloc_ids == 0) ? 4 : cell->alloc_ids * 2;
+		cell->ids = (int*)realloc(cell->ids, sizeof(int) * cell->alloc_ids);
+	}
+	cell->ids[cell->num_ids] = id;
+	cell->num_ids ++;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: cell_remove_id)
+ *-----------------------------------------------------------------------*/
+void cell_remove_id(grid_cell_t *cell, int id)
+{
+	int i;
+
+	for (i = 0; i < cell->num_ids; i++)
+	{
+		if (cell->ids[i] == id)
+		{
+			/* order does not matter so move the last one in */
+			cell->ids[i] = cell->ids[cell->num_ids - 1];
+			cell->num_ids --;
+			return;
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_checkpoint_save)
+ * The order of the ids in each cell is kept as well since a tie in a
+ * raycast goes to the first object found.
+ *-----------------------------------------------------------------------*/
+void spatial_grid_checkpoint_save(spatial_grid_t *grid, checkpoint_t *checkpoint)
+{
+	int i;
+	int end = -1;
+	short built = (grid->cells != NULL);
+
+	checkpoint_put(checkpoint, &built, sizeof(short));
+	if (built == FALSE)
+		return;
+
+	checkpoint_put(checkpoint, &grid->num_cells_x, sizeof(int));
+	checkpoint_put(checkpoint, &grid->num_cells_y, sizeof(int));
+
+	checkpoint_put(checkpoint, &grid->num_objects, sizeof(int));
+	checkpoint_put(checkpoint, grid->min_cell_x, sizeof(int) * grid->num_objects);
+	checkpoint_put(checkpoint, grid->min_cell_y, sizeof(int) * grid->num_objects);
+	checkpoint_put(checkpoint, grid->max_cell_x, sizeof(int) * grid->num_objects);
+	checkpoint_put(checkpoint, grid->max_cell_y, sizeof(int) * grid->num_objects);
+
+	/* only the cells with something in them */
+	for (i = 0; i < grid->num_cells_x * grid->num_cells_y; i++)
+	{
+		if (grid->cells[i].num_ids == 0)
+			continue;
+
+		checkpoint_put(checkpoint, &i, sizeof(int));
+		checkpoint_put(checkpoint, &grid->cells[i].num_ids, sizeof(int));
+		checkpoint_put(checkpoint, grid->cells[i].ids, sizeof(int) * grid->cells[i].num_ids);
+	}
+	checkpoint_put(checkpoint, &end, sizeof(int));
+}
+
+/*-------------------------------------------------------------------------
+ * (function: spatial_grid_checkpoint_load)
+ * The grid is built from the config before this so only the contents of
+ * the cells are replaced.
+ *-----------------------------------------------------------------------*/
+void spatial_grid_checkpoint_load(spatial_grid_t *grid, checkpoint_t *checkpoint)
+{
+	int i;
+	int num_cells_x, num_cells_y;
+	int num_objects;
+	int idx;
+	grid_cell_t *cell;
+	short built;
+
+	checkpoint_get(checkpoint, &built, sizeof(short));
+	oassert(built == (grid->cells != NULL));
+	if (built == FALSE)
+		return;
+
+	checkpoint_get(checkpoint, &num_cells_x, sizeof(int));
+	checkpoint_get(checkpoint, &num_cells_y, sizeof(int));
+	if (num_cells_x != grid->num_cells_x || num_cells_y != grid->num_cells_y)
+	{
+		printf("Checkpoint grid is %d x %d cells but the config gives %d x %d\n", num_cells_x, num_cells_y, grid->num_cells_x, grid->num_cells_y);
+		oassert(FALSE);
+	}
+
+	checkpoint_get(checkpoint, &num_objects, sizeof(int));
+	oassert(num_objects == grid->num_objects);
+	checkpoint_get(checkpoint, grid->min_cell_x, sizeof(int) * grid->num_objects);
+	checkpoint_get(checkpoint, grid->min_cell_y, sizeof(int) * grid->num_objects);
+	checkpoint_get(checkpoint, grid->max_cell_x, sizeof(int) * grid->num_objects);
+	checkpoint_get(checkpoint, grid->max_cell_y, sizeof(int) * grid->num_objects);
+
+	for (i = 0; i < grid->num_cells_x * grid->num_cells_y; i++)
+	{
+		grid->cells[i].num_ids = 0;
+	}
+
+	checkpoint_get(checkpoint, &idx, sizeof(int));
+	while (idx != -1)
+	{
+		oassert(idx >= 0 && idx < grid->num_cells_x * grid->num_cells_y);
+		cell = &grid->cells[idx];
+
+		checkpoint_get(checkpoint, &cell->num_ids, sizeof(int));
+		if (cell->num_ids > cell->alloc_ids)
+		{
+			cell->alloc_ids = cell->num_ids;
+			cell->ids = (int*)realloc(cell->ids, sizeof(int) * cell->alloc_ids);
+		}
+		checkpoint_get(checkpoint, cell->ids, sizeof(int) * cell->num_ids);
+
+		checkpoint_get(checkpoint, &idx, sizeof(int));
+	}
+}
@@ -0,0 +1,45 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "types.h"
+
+void spatial_grid_build(spatial_grid_t *grid, double cell_size_in_m, double size_x_in_m, double size_y_in_m);
+void spatial_grid_free(spatial_grid_t *grid);
+void spatial_grid_thread_done();
+void spatial_grid_update_object(spatial_grid_t *grid, int sim_object_idx);
+double spatial_grid_raycast(spatial_grid_t *grid, line_segment_t *beam, double (*fptr_hit)(int sim_object_idx, void *context), void *context);
+
+void spatial_grid_next_version(spatial_grid_t *grid);
+short spatial_grid_unchanged_since(spatial_grid_t *grid, rectangle_t *box, unsigned int version);
+void spatial_grid_query_overlap(spatial_grid_t *grid, rectangle_t *box, void (*fptr_found)(int sim_object_idx, void *context), void *context);
+
+void spatial_grid_checkpoint_save(spatial_grid_t *grid, checkpoint_t *checkpoint);
+void spatial_grid_checkpoint_load(spatial_grid_t *grid, checkpoint_t *checkpoint);
+
+#endif
@@ -0,0 +1,185 @@
+/*
+Copyright (c) 2022 Peter Jamieson (jamieson.peter@gmail.com)
+and Bryan Van Scoy
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+*/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "types.h"
+#include "globals.h"
+#include "utils.h"
+
+#include "spatial_grid.h"
+#include "loose_quadtree.h"
+#include "thread_pool.h"
+
+/* globals */
+
+/* below this many items per thread waking the threads costs more than it saves */
+#define MIN_ITEMS_PER_THREAD 8
+
+/* the threads are made once and wait on the barrier between phases */
+typedef struct thread_pool_t_t thread_pool_t;
+struct thread_pool_t_t
+{
+	int num_threads;
+	pthread_t *threads;
+	int *thread_idxs;
+	pthread_barrier_t start_barrier;
+	pthread_barrier_t done_barrier;
+	short quit;
+
+	/* the current job */
+	int num_items;
+	void (*fptr_work)(int first_item, int last_item, void *context);
+	void *context;
+};
+
+thread_pool_t thread_pool; // num_threads of 0 or 1 runs everything on the calling thread
+
+void *thread_pool_worker(void *arg);
+void thread_pool_run_share(int thread_idx);
+
+/*-------------------------------------------------------------------------
+ * (function: thread_pool_start)
+ * The calling thread is thread 0 so only num_threads-1 are made.
+ *-----------------------------------------------------------------------*/
+void thread_pool_start(int num_threads)
+{
+	int i;
+
+	if (num_threads < 1)
+		num_threads = 1;
+
+	thread_pool.num_threads = num_threads;
+	thread_pool.quit = FALSE;
+
+	if (num_threads == 1)
+		return;
+
+	pthread_barrier_init(&thread_pool.start_barrier, NULL, num_threads);
+	pthread_barrier_init(&thread_pool.done_barrier, NULL, num_threads);
+
+	thread_pool.threads = (pthread_t*)malloc(sizeof(pthread_t) * num_threads);
+	thread_pool.thread_idxs = (int*)malloc(sizeof(int) * num_threads);
+
+	for (i = 1; i < num_threads; i++)
+	{
+		thread_pool.thread_idxs[i] = i;
+		if (pthread_create(&thread_pool.threads[i], NULL, thread_pool_worker, (void*)&thread_pool.thread_idxs[i]) != 0)
+		{
+			printf("EXIT - could not start thread %d\n", i);
+			exit(-1);
+		}
+	}
+}
+
+/*-------------------------------------------------------------------------
+ * (function: thread_pool_stop)
+ *-----------------------------------------------------------------------*/
+void thread_pool_stop()
+{
+	int i;
+
+	if (thread_pool.num_threads <= 1)
+		return;
+
+	/* wake the workers with nothing to do but leave */
+	thread_pool.quit = TRUE;
+	pthread_barrier_wait(&thread_pool.start_barrier);
+
+	for (i = 1; i < thread_pool.num_threads; i++)
+	{
+		pthread_join(thread_pool.threads[i], NULL);
+	}
+
+	pthread_barrier_destroy(&thread_pool.start_barrier);
+	pthread_barrier_destroy(&thread_pool.done_barrier);
+	free(thread_pool.threads);
+	free(thread_pool.thread_idxs);
+
+	thread_pool.threads = NULL;
+	thread_pool.thread_idxs = NULL;
+	thread_pool.num_threads = 1;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: thread_pool_run)
+ * Splits items 0 to num_items-1 into one contiguous share per thread and
+ * returns when every share is done.  fptr_work gets [first_item, last_item).
+ *-----------------------------------------------------------------------*/
+void thread_pool_run(int num_items, void (*fptr_work)(int first_item, int last_item, void *context), void *context)
+{
+	if (thread_pool.num_threads <= 1 || num_items < thread_pool.num_threads * MIN_ITEMS_PER_THREAD)
+	{
+		(*fptr_work)(0, num_items, context);
+		return;
+	}
+
+	thread_pool.num_items = num_items;
+	thread_pool.fptr_work = fptr_work;
+	thread_pool.context = context;
+
+	pthread_barrier_wait(&thread_pool.start_barrier);
+	thread_pool_run_share(0);
+	pthread_barrier_wait(&thread_pool.done_barrier);
+}
+
+/*-------------------------------------------------------------------------
+ * (function: thread_pool_worker)
+ *-----------------------------------------------------------------------*/
+void *thread_pool_worker(void *arg)
+{
+	int thread_idx = *(int*)arg;
+
+	while (TRUE)
+	{
+		pthread_barrier_wait(&thread_pool.start_barrier);
+		if (thread_pool.quit == TRUE)
+			break;
+
+		thread_pool_run_share(thread_idx);
+		pthread_barrier_wait(&thread_pool.done_barrier);
+	}
+
+	/* the queries keep their scratch per thread */
+	spatial_grid_thread_done();
+	loose_quadtree_thread_done();
+
+	return NULL;
+}
+
+/*-------------------------------------------------------------------------
+ * (function: thread_pool_run_share)
+ *-----------------------------------------------------------------------*/
+void thread_pool_run_share(int thread_idx)
+{
+	int first_item = (int)(((long long)thread_pool.num_items * thread_idx) / thread_pool.num_threads);
+	int last_item = (int)(((long long)thread_pool.num_items * (thread_idx + 1)) / thread_pool.num_threads);
+
+	if (first_item < last_item)
+		(*thread_pool.fptr_work)(first_item, last_item, thread_pool.context);
+}
@@ -51,6 +51,9 @@ typedef struct act_inputs_t_t act_inputs_t;
 typedef struct actuator_t_t actuator_t;
 typedef struct agent_group_t_t agent_group_t;
 typedef struct agent_t_t agent_t;
+typedef struct agent_store_t_t agent_store_t;
+typedef struct beam_hit_log_t_t beam_hit_log_t;
+typedef struct beam_cache_t_t beam_cache_t;
 typedef struct objects_t_t objects_t;
 typedef struct agent_groups_t_t agent_groups_t;
 typedef struct sim_system_t_t sim_system_t;
@@ -66,6 +69,24 @@ typedef struct oriented_rectangle_t_t oriented_rectangle_t;
 typedef struct circle_t_t circle_t;
 typedef struct range_t_t range_t;
 typedef struct points_t_t points_t;
+typedef struct segment_hits_t_t segment_hits_t;
+/* SPATIAL index of the simulation */
+typedef struct grid_cell_t_t grid_cell_t;
+typedef struct spatial_grid_t_t spatial_grid_t;
+typedef struct bvh_node_t_t bvh_node_t;
+typedef struct bvh_t_t bvh_t;
+typedef struct quadtree_node_t_t quadtree_node_t;
+typedef struct loose_quadtree_t_t loose_quadtree_t;
+/* EVENTS of the event simulation */
+typedef struct event_queue_t_t event_queue_t;
+/* BAYESIAN filter of the characterized sensors */
+typedef struct bayesian_table_t_t bayesian_table_t;
+/* NOISE streams of the agents */
+typedef struct rng_stream_t_t rng_stream_t;
+/* LOG output - defined in log_writer.cpp */
+typedef struct log_writer_t_t log_writer_t;
+/* CHECKPOINT of a run - defined in checkpoint.cpp */
+typedef struct checkpoint_t_t checkpoint_t;
 
 
 
@@ -77,6 +98,14 @@ struct global_args_t_t
 	argparse::ArgValue<char*> test_file;
 	argparse::ArgValue<char*> config_file;
 	argparse::ArgValue<int> mode;
+	argparse::ArgValue<int> num_threads;
+	argparse::ArgValue<int> num_runs;
+	argparse::ArgValue<int> seed_start;
+	argparse::ArgValue<char*> profile_file;
+	argparse::ArgValue<char*> scenario_cache;
+	argparse::ArgValue<char*> resume_file;
+	argparse::ArgValue<char*> branches_file;
+	argparse::ArgValue<double> branch_at_s;
 	argparse::ArgValue<bool> show_help;
 };
 
@@ -96,8 +125,16 @@ struct sensor_t_t
 	double angle; // <!-- assume 0 = 0 radian angle facing forward of robot, 1.57079 is facing East, and 3.14 is facing backwards (counter clockwise rotation) --> 
 	double sim_time_computation_epoch_s; // how fast the sensor reads
 
+	/* scanning sensors (LIDAR) - a fan of num_beams over field_of_view radians centered on angle */
+	int num_beams;
+	double field_of_view;
+	double range_in_m; // from the edge of the agent
+
 	/* the function that returns void * data for what sensor sees */
 	void* (*fptr_sensor)(sensor_t *sensor, agent_t *agent, double current_time);
+	/* write and read back an agent's sensor memory for checkpoints */
+	void (*fptr_sensor_memory_save)(void *memory, checkpoint_t *checkpoint);
+	void* (*fptr_sensor_memory_load)(checkpoint_t *checkpoint);
 
 	int sensor_idx;
 };
@@ -115,6 +152,9 @@ struct act_inputs_t_t
 struct actuator_t_t 
 {
 	void (*fptr_actuator)(actuator_t *actuator, agent_t *agent, act_inputs_t *values, double current_time);
+	/* write and read back an agent's actuator memory for checkpoints */
+	void (*fptr_actuator_memory_save)(void *memory, checkpoint_t *checkpoint);
+	void* (*fptr_actuator_memory_load)(checkpoint_t *checkpoint);
 
 	int actuator_idx;
 };
@@ -123,19 +163,34 @@ struct actuator_t_t
 struct agent_t_t 
 {
 	agent_group_t *agent_group; // back pointer to description of agent
-	short not_physical_agent; // for overlords and other agents of this type
+	int agent_idx; // handle into agent_store where the pose and state live
 
 	/* personal state */
-	double angle; // assuming in radians where 0 degrees is East and West is "pi" = 3.14
-	circle_t *circle;
-	
 	void *general_memory;
 	void **sensor_memories;
 	void **actuator_memories;
 
-	int CURRENT_STATE;
 	double time_in_state;
 	double last_time;
+
+	int sim_object_idx; // where this agent is in sim_objects
+
+	/* hints for the event simulation */
+	double wake_time; // control has to run again at the first epoch after this
+	double moving_until_time; // actuators still move the agent at epochs before this
+
+	/* beam hits from this epoch - logged in agent order at the commit */
+	beam_hit_log_t *beam_hit_logs;
+	int num_beam_hit_logs;
+	int alloc_beam_hit_logs;
+
+	/* sim objects this agent touches - this epoch and the one before so only new contacts are reported */
+	int *contacts;
+	int num_contacts;
+	int alloc_contacts;
+	int *last_contacts;
+	int num_last_contacts;
+	int alloc_last_contacts;
 	
 
 	/* personal goals */
@@ -167,6 +222,12 @@ struct agent_group_t_t
 
 	/* function pointer of control algorithm */
 	void (*fptr_control_algorithm)(agent_t *agent, double current_time);
+	/* batch control - one call runs agent_store agents first_agent to last_agent-1 (all of this group).  Set by the control or by setup_group_kernels (see group_kernel.h) - NULL runs fptr_control_algorithm per agent */
+	void (*fptr_control_algorithm_batch)(agent_group_t *agent_group, int first_agent, int last_agent, double current_time);
+	int first_agent_idx; // the group's agents are agent_store indexes first_agent_idx to first_agent_idx+num_agents-1
+	/* write and read back an agent's general_memory for checkpoints - NULL for controls without one */
+	void (*fptr_control_memory_save)(void *memory, checkpoint_t *checkpoint);
+	void* (*fptr_control_memory_load)(checkpoint_t *checkpoint);
 
 	// goals not here 
 };
@@ -178,26 +239,70 @@ struct agent_groups_t_t
 	agent_group_t **agent_group;
 };
 
+/* state of every agent in parallel arrays indexed by agent->agent_idx, in the same order as in sim_objects */
+struct agent_store_t_t
+{
+	int num_agents;
+	int alloc_agents;
+
+	double *x;
+	double *y;
+	double *angle; // assuming in radians where 0 degrees is East and West is "pi" = 3.14
+	double *radius;
+	/* where the actuators leave the agent this epoch - sensors only read the x, y, angle above */
+	double *next_x;
+	double *next_y;
+	double *next_angle;
+	int *state; // CURRENT_STATE of the control algorithm
+	int *group; // index into agent_groups.agent_group
+	short *not_physical; // for overlords and other agents of this type
+	short *crashed; // stopped for good by a collision (stop_on_collision)
+	unsigned int *pose_version; // goes up every time the pose changes
+
+	agent_t **agents; // back pointer to the memories
+
+	unsigned int rand_seed; // key of the agents' noise streams (see rng.cpp)
+};
+
 /* the system file */
+enum log_format {LOG_XML, LOG_BINARY, LOG_BINARY32};
+enum log_writer_mode {LOG_WRITER_STDIO, LOG_WRITER_ASYNC};
 struct sim_system_t_t 
 {
 	int rand_seed;
 	char *debug_file_out;
 	FILE *Fdebug_out;
 	char *sim_log_file_out;
-	FILE *Fsim_log_out;
+	log_writer_t *sim_log_out;
+	log_writer_t *sim_beam_log_out; // binary logs keep the sensor beams apart
 	int output_log_tab_step;
+	log_format sim_log_format;
+	log_writer_mode sim_log_writer; // async writes the log from its own thread
+	/* level of detail of the sim log (see log_file.cpp) */
+	int sim_log_every_epochs; // agents are logged every this many epochs - 0 or 1 is every epoch
+	int sim_log_beam_every_epochs; // the same for the sensor beams - 0 is the agents' rate
+	short sim_log_changes_only; // an agent is only logged once it moved or turned more than below since it was last logged
+	double sim_log_move_threshold_in_m;
+	double sim_log_turn_threshold_in_degrees;
 	char *simulation_type;
+	/* checkpoints of the run (see checkpoint.cpp) */
+	double checkpoint_every_s; // of simulated time - 0 is never
+	char *checkpoint_file_out;
 };
 
 /* the environment - what the 2D space looks like */
+enum agent_index_type {AGENT_INDEX_GRID, AGENT_INDEX_LOOSE_QUADTREE};
 struct environment_t_t 
 {
 	double real_size_x_in_m;
 	double real_size_y_in_m;
 	double sim_time_s; 
 	double sim_time_computation_epoch_s; // assume the use has set this time to the smallest and all other sim_time are divisible by
+	double sim_grid_size_in_m; // cell size of the spatial grid
+	agent_index_type agent_index; // what finds the agents for the sensors and crash checks
 	short boundary_walls;
+	short check_collisions; // report agents touching agents or objects
+	short stop_on_collision; // and stop them where they are
 	objects_t **objects;
 	int num_objects;
 };
@@ -252,6 +357,13 @@ struct oriented_rectangle_t_t
 	vector_2D_t center;
 	vector_2D_t halfExtend;
 	double rotation;
+
+	/* from the above by oriented_rectangle_update - call it again when the rectangle moves */
+	double cosine; // of the rotation
+	double sine;
+	vector_2D_t corners[4]; // oriented_rectangle_corner 0 to 3
+	vector_2D_t points[4]; // a b c d of oriented_rectangle_to_points
+	rectangle_t hull;
 };
 
 /* axis oreinted rectangle */
@@ -273,4 +385,145 @@ struct points_t_t
 	vector_2D_t **points;
 };
 
+/* where a segment crosses a shape - returned by value so nothing is allocated */
+#define MAX_SEGMENT_HITS 4 // one per edge of a rectangle
+struct segment_hits_t_t
+{
+	int num_points;
+	vector_2D_t points[MAX_SEGMENT_HITS];
+};
+
+/* a bucket of the spatial grid - indexes into sim_objects */
+struct grid_cell_t_t
+{
+	int num_ids;
+	int alloc_ids;
+	int *ids;
+
+	unsigned int moved_version; // version of the grid when an object in the cell last moved
+};
+
+/* uniform grid over the environment - agents are in every cell their bounding box touches */
+struct spatial_grid_t_t
+{
+	double cell_size_in_m;
+	int num_cells_x;
+	int num_cells_y;
+	grid_cell_t *cells;
+
+	/* per sim object the range of cells it is bucketed in */
+	int num_objects;
+	int *min_cell_x;
+	int *min_cell_y;
+	int *max_cell_x;
+	int *max_cell_y;
+
+	unsigned int version; // goes up once per commit of the agent moves (see spatial_grid_next_version)
+};
+
+/* node of the bounding volume hierarchy - leaves have left == -1 */
+struct bvh_node_t_t
+{
+	rectangle_t box;
+	int left;
+	int right;
+	int first_item;
+	int num_items;
+};
+
+/* bounding volume hierarchy over the static objects in the environment */
+struct bvh_t_t
+{
+	int num_nodes;
+	bvh_node_t *nodes;
+	int num_items;
+	int *items; // index into environment.objects (and sim_objects as objects are first)
+};
+
+/* node of the loose quadtree - an agent is kept in the smallest node whose
+ * tight cell has its center, and the loose cell (the tight cell grown by the
+ * largest agent radius) holds all of it */
+#define QUADTREE_NO_CHILDREN -1
+struct quadtree_node_t_t
+{
+	double center_x;
+	double center_y;
+	double half_size; // of the tight cell
+	double loose_half_size;
+	int depth;
+	int parent; // -1 for the root
+	int children[4]; // QUADTREE_NO_CHILDREN for a leaf - index is (x >= center_x) + 2 * (y >= center_y)
+
+	int num_ids; // sorted by sim object
+	int alloc_ids;
+	int *ids;
+	int num_in_subtree;
+
+	unsigned int moved_version; // version of the tree when an object in the node last moved
+	unsigned int subtree_moved_version; // the latest of these in the node and below
+};
+
+/* loose quadtree over the agents - nodes split past a handful of agents so
+ * clustered swarms get small cells only where they are */
+struct loose_quadtree_t_t
+{
+	int num_nodes;
+	int alloc_nodes;
+	quadtree_node_t *nodes; // the root is node 0
+	int num_free_nodes;
+	int *free_nodes;
+
+	int num_objects;
+	int *node_of; // per sim object the node it is in, -1 if not in the tree
+	double max_radius_in_m; // of the agents - no cell is split below this
+
+	unsigned int version; // goes up once per commit of the agent moves (see loose_quadtree_next_version)
+};
+
+/* a sensor beam hit waiting to go in the log */
+struct beam_hit_log_t_t
+{
+	line_segment_t sensor_beam;
+	vector_2D_t point_intersect;
+	double distance;
+};
+
+/* the last beam a sensor cast - used again while neither the agent nor anything near the beam has moved */
+struct beam_cache_t_t
+{
+	short valid;
+	unsigned int pose_version; // of the agent when cast
+	unsigned int index_version; // of the agent index when cast (see agent_index.cpp)
+	short hit;
+	beam_hit_log_t hit_log;
+};
+
+/* min heap of agent wake times for the event simulation */
+struct event_queue_t_t
+{
+	int num_events;
+	int alloc_events;
+	double *times;
+	int *agent_idxs;
+};
+
+/* what a characterized sensor reads at each distance state - the same for every agent so it is built once */
+struct bayesian_table_t_t
+{
+	int num_states;
+	double *state; // distance of each state in cm
+	double *mean; // of the reading at that state
+	double *neg_half_inv_variance; // -1/(2 std^2)
+	double *scale; // 1/(std sqrt(2 pi))
+};
+
+/* counter based (Philox4x32-10) random numbers - the same key and counter always give the same numbers */
+struct rng_stream_t_t
+{
+	unsigned int key[2];
+	unsigned int counter[4];
+	unsigned int block[4]; // output of the last counter
+	int num_used; // words of block already handed out
+};
+
 #endif // TYPES_H
@@ -30,9 +30,11 @@ OTHER DEALINGS IN THE SOFTWARE.
 #include <math.h>
 #include <time.h>
 #include <sys/time.h>
+#include <fcntl.h>
 #include "globals.h"
 #include "types.h"
 #include "utils.h"
+#include "checkpoint.h"
 
 /*---------------------------------------------------------------------------------------------
  * (function: return_string_in_list)
@@ -154,6 +156,31 @@ double rand_float()
 		return temp;
 }
 
+/*---------------------------------------------------------------------------------------------
+ * (function: rand_float_checkpoint_save)
+ * The state of rand_float and my_int_rand so a resumed run draws the same numbers
+ *-------------------------------------------------------------------------------------------*/
+void rand_float_checkpoint_save(checkpoint_t *checkpoint)
+{
+	checkpoint_put(checkpoint, &idum, sizeof(long));
+	checkpoint_put(checkpoint, &idum2, sizeof(long));
+	checkpoint_put(checkpoint, &iy, sizeof(long));
+	checkpoint_put(checkpoint, iv, sizeof(long) * NTAB);
+	checkpoint_put(checkpoint, &next, sizeof(unsigned long int));
+}
+
+/*---------------------------------------------------------------------------------------------
+ * (function: rand_float_checkpoint_load)
+ *-------------------------------------------------------------------------------------------*/
+void rand_float_checkpoint_load(checkpoint_t *checkpoint)
+{
+	checkpoint_get(checkpoint, &idum, sizeof(long));
+	checkpoint_get(checkpoint, &idum2, sizeof(long));
+	checkpoint_get(checkpoint, &iy, sizeof(long));
+	checkpoint_get(checkpoint, iv, sizeof(long) * NTAB);
+	checkpoint_get(checkpoint, &next, sizeof(unsigned long int));
+}
+
 #undef IM1
 #undef IM2
 #undef AM
@@ -169,6 +196,37 @@ double rand_float()
 #undef EPS
 #undef RNMX
 
+/*---------------------------------------------------------------------------------------------
+ * (function: copy_file_prefix)
+ * to_file_name becomes the first length bytes of from_file_name
+ *-------------------------------------------------------------------------------------------*/
+void copy_file_prefix(char *from_file_name, char *to_file_name, long long length)
+{
+	char buffer[1 << 16];
+	int from_fd;
+	int to_fd;
+	ssize_t num_read;
+
+	from_fd = open(from_file_name, O_RDONLY);
+	to_fd = open(to_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (from_fd < 0 || to_fd < 0)
+	{
+		printf("Could not copy %s to %s\n", from_file_name, to_file_name);
+		oassert(FALSE);
+	}
+
+	while (length > 0)
+	{
+		num_read = read(from_fd, buffer, (length < (long long)sizeof(buffer)) ? length : sizeof(buffer));
+		oassert(num_read > 0);
+		oassert(write(to_fd, buffer, num_read) == num_read);
+		length -= num_read;
+	}
+
+	close(from_fd);
+	close(to_fd);
+}
+
 /* 
 	Start Bit string from: https://rosettacode.org/wiki/Binary_strings#C
 */
@@ -32,9 +32,13 @@ extern double random_float();
 extern double random_float_in_range(double low, double high);
 extern void rand_float_seed(unsigned int seed);
 extern double rand_float();
+extern void rand_float_checkpoint_save(checkpoint_t *checkpoint);
+extern void rand_float_checkpoint_load(checkpoint_t *checkpoint);
 extern void my_int_srand(int x);
 extern int my_int_rand(void); // RAND_MAX assumed to be 32767
 
+extern void copy_file_prefix(char *from_file_name, char *to_file_name, long long length);
+
 extern bstr bitstr_new(int len);
 extern void bitstr_del(bstr s);
 extern bstr bitstr_dup(bstr src);